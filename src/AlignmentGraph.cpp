@@ -14,7 +14,7 @@ using namespace shasta;
 void shasta::align(
 
     // Markers of the two oriented reads to be aligned, sorted by KmerId.
-    const array<vector<MarkerWithOrdinal>, 2>& markers,
+    const array<span<const MarkerWithOrdinal>, 2>& markers,
 
     // The maximum ordinal skip to be tolerated between successive markers
     // in the alignment.
@@ -56,7 +56,7 @@ void shasta::align(
 
 
 void AlignmentGraph::create(
-    const array<vector<MarkerWithOrdinal>, 2>& markers,
+    const array<span<const MarkerWithOrdinal>, 2>& markers,
     uint32_t maxMarkerFrequency,
     size_t maxSkip,
     size_t maxDrift,
@@ -132,14 +132,17 @@ void AlignmentGraph::create(
 
 #ifdef SHASTA_HTTP_SERVER
     if(debug) {
-        writeImage(markers[0], markers[1], alignment, "Alignment.png");
+        writeImage(
+            vector<MarkerWithOrdinal>(markers[0].begin(), markers[0].end()),
+            vector<MarkerWithOrdinal>(markers[1].begin(), markers[1].end()),
+            alignment, "Alignment.png");
     }
 #endif
 }
 
 
 void AlignmentGraph::writeMarkers(
-    const vector<MarkerWithOrdinal>& markers,
+    const span<const MarkerWithOrdinal>& markers,
     const string& fileName
     )
 {
@@ -156,15 +159,15 @@ void AlignmentGraph::writeMarkers(
 
 
 void AlignmentGraph::createVertices(
-    const array<vector<MarkerWithOrdinal>, 2>& markers,
+    const array<span<const MarkerWithOrdinal>, 2>& markers,
     uint32_t maxMarkerFrequency)
 {
     // Some shorthands for readability.
-    const vector<MarkerWithOrdinal>& markers0 = markers[0];
-    const vector<MarkerWithOrdinal>& markers1 = markers[1];
+    const span<const MarkerWithOrdinal>& markers0 = markers[0];
+    const span<const MarkerWithOrdinal>& markers1 = markers[1];
 
     // Some iterators we will need.
-    using MarkerIterator = vector<MarkerWithOrdinal>::const_iterator;
+    using MarkerIterator = const MarkerWithOrdinal*;
     const MarkerIterator begin0 = markers0.begin();
     const MarkerIterator end0   = markers0.end();
     const MarkerIterator begin1 = markers1.begin();
@@ -23,6 +23,7 @@ To find a good alignment, we find a shortest path in the graph.
 #include "CompactUndirectedGraph.hpp"
 #include "Marker.hpp"
 #include "shortestPath.hpp"
+#include "span.hpp"
 
 // Standard library.
 #include "utility.hpp"
@@ -43,7 +44,7 @@ namespace shasta {
     void align(
 
         // Markers of the two oriented reads to be aligned, sorted by KmerId.
-        const array<vector<MarkerWithOrdinal>, 2>& markers,
+        const array<span<const MarkerWithOrdinal>, 2>& markers,
 
         // The maximum ordinal skip to be tolerated between successive markers
         // in the alignment.
@@ -128,7 +129,7 @@ class shasta::AlignmentGraph : public AlignmentGraphBaseClass {
 public:
 
     void create(
-        const array<vector<MarkerWithOrdinal>, 2>&,
+        const array<span<const MarkerWithOrdinal>, 2>&,
         uint32_t maxMarkerFrequency,
         size_t maxSkip,
         size_t maxDrift,
@@ -144,11 +145,11 @@ private:
     vertex_descriptor vFinish;
 
     static void writeMarkers(
-        const vector<MarkerWithOrdinal>&,
+        const span<const MarkerWithOrdinal>&,
         const string& fileName
         );
     void createVertices(
-        const array<vector<MarkerWithOrdinal>, 2>&,
+        const array<span<const MarkerWithOrdinal>, 2>&,
         uint32_t maxMarkerFrequency);
     void writeVertices(const string& fileName) const;
     void createEdges(
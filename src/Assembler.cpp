@@ -45,7 +45,10 @@ Assembler::Assembler(
             largeDataName("ReadNames"),
             largeDataName("ReadMetaData"),
             largeDataName("ReadRepeatCounts"),
-            largeDataName("ReadFlags")
+            largeDataName("CompactReadRepeatCounts"),
+            largeDataName("ReadFlags"),
+            largeDataName("ReadNameIndex"),
+            largeDataName("ParsedReadMetaData")
         );
         // cout << "Accessed an existing assembly with page size " << largeDataPageSize << endl;
 
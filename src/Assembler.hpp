@@ -13,9 +13,11 @@
 #include "HttpServer.hpp"
 #include "InducedAlignment.hpp"
 #include "Kmer.hpp"
+#include "KmerCounter.hpp"
 #include "LongBaseSequence.hpp"
 #include "Marker.hpp"
 #include "MarkerGraph.hpp"
+#include "Markers.hpp"
 #include "MemoryMappedObject.hpp"
 #include "MultithreadedObject.hpp"
 #include "OrientedReadPair.hpp"
@@ -24,6 +26,7 @@
 #include "ReadFlags.hpp"
 #include "ReadId.hpp"
 #include "Reads.hpp"
+#include "SparseKmerTable.hpp"
 
 // Standard library.
 #include "memory.hpp"
@@ -47,6 +50,7 @@ namespace shasta {
     class LocalAssemblyGraph;
     class LocalAlignmentGraph;
     class LocalReadGraph;
+    class LowHashSketches;
     class SegmentGraph;
     class Reads;
 
@@ -77,6 +81,13 @@ public:
     // The length of k-mers used to define markers.
     size_t k;
 
+    // The method used by MarkerFinder to select markers in each read,
+    // and its parameters (see MarkerFinder.hpp).
+    // 0 = all occurrences of marker k-mers, 1 = window minimizers, 2 = open syncmers.
+    uint64_t markerSelectionMethod = 0;
+    uint64_t minimizerWindow = 0;
+    uint64_t syncmerS = 0;
+
     // The page size in use for this run.
     size_t largeDataPageSize;
 
@@ -100,6 +111,11 @@ public:
     uint64_t discardedBadRepeatCountReadCount = 0;
     uint64_t discardedBadRepeatCountBaseCount = 0;
 
+    // The number of reads and raw bases discarded by selectReadsForCoverage
+    // because they were not needed to reach the desired coverage.
+    uint64_t discardedExcessCoverageReadCount = 0;
+    uint64_t discardedExcessCoverageBaseCount = 0;
+
 
 
     // Statistics for the reads kept in the assembly
@@ -172,7 +188,53 @@ public:
         const string& fileName,
         uint64_t minReadLength,
         bool noCache,
+        uint64_t streamingMemoryBudget,
+        size_t threadCount);
+
+    // Add reads from multiple files, processing up to
+    // concurrentFileCount files at a time (0 = as many as possible).
+    // The reads are stored in the order in which the files are specified.
+    void addReads(
+        const vector<string>& fileNames,
+        uint64_t minReadLength,
+        bool noCache,
+        uint64_t streamingMemoryBudget,
+        uint64_t concurrentFileCount,
+        size_t threadCount);
+private:
+    void addReadsFromOneFile(
+        const string& fileName,
+        uint64_t minReadLength,
+        bool noCache,
+        uint64_t streamingMemoryBudget,
         size_t threadCount);
+public:
+
+    // Create the hash index used to find a read given its name.
+    // This is called automatically by addReads.
+    void computeReadNameIndex();
+
+    // Parse the read meta data fields used by suppressAlignment.
+    // This is called automatically by addReads.
+    void parseReadMetaData();
+
+    // Return the ReadId of the read with a given name, or invalidReadId
+    // if no read with that name exists. If more than one read
+    // has that name, the one with the lowest ReadId is returned.
+    ReadId getReadId(const string& readName) const;
+
+    // Write all reads to a read archive, which can later
+    // be used as an input file in place of the original input files.
+    void createReadArchive(const string& fileName, size_t threadCount);
+
+    // Keep only the longest reads needed to reach the desired coverage,
+    // given the expected genome size. This must be called after
+    // all reads are added and before anything else is done with them.
+    void selectReadsForCoverage(double genomeSize, double desiredCoverage);
+
+    // Convert the read repeat counts to a compact representation.
+    // This must be called after all reads are added.
+    void compactRepeatCounts();
 
     // Create a histogram of read lengths.
     void histogramReadLength(const string& fileName);
@@ -182,10 +244,31 @@ public:
     // See the beginning of Marker.hpp for more information.
     void findMarkers(size_t threadCount);
     void accessMarkers();
+
+    // Convert the markers to a compact representation
+    // (see Markers.hpp). This must be called after findMarkers.
+    void compactMarkerPositions();
     void writeMarkers(ReadId, Strand, const string& fileName);
     vector<KmerId> getMarkers(ReadId, Strand);
     void writeMarkerFrequency();
 
+    // Cache of k-mers and markers that can be reused by later runs
+    // with the same reads and options (see AssemblerStageCache.cpp).
+    // The fingerprint is a function of the reads and of a string
+    // describing the options that control k-mers and markers.
+    string computeKmersAndMarkersFingerprint(const string& options, size_t threadCount);
+    bool restoreKmersAndMarkersFromCache(
+        const string& cacheDirectory,
+        const string& fingerprint);
+    void saveKmersAndMarkersToCache(
+        const string& cacheDirectory,
+        const string& fingerprint) const;
+private:
+    void computeReadsFingerprintThreadFunction(size_t threadId);
+    uint64_t readsFingerprint;
+    vector<string> kmersAndMarkersFileNames() const;
+public:
+
     // Write the reads that overlap a given read.
     void writeOverlappingReads(ReadId, Strand, const string& fileName);
 
@@ -482,18 +565,77 @@ private:
     // is also a marker. That is, for all permitted values of i, 0 <= i < 4^k:
     // kmerTable[i].isMarker == kmerTable[kmerTable[i].reverseComplementKmerId].isMarker
     MemoryMapped::Vector<KmerInfo> kmerTable;
+
+    // For k > maxDenseKmerTableK, a sparse k-mer table
+    // containing only the marker k-mers is used instead.
+    // Only one of kmerTable and sparseKmerTable is open.
+    SparseKmerTable sparseKmerTable;
     void checkKmersAreOpen() const;
 
+    // Return true if a k-mer is a marker,
+    // using whichever k-mer table is in use.
+    bool isMarkerKmer(KmerId kmerId) const
+    {
+        if(sparseKmerTable.isOpen()) {
+            return sparseKmerTable.isMarker(kmerId);
+        } else {
+            return kmerTable[kmerId].isMarker;
+        }
+    }
+
+    // Return the KmerInfo of a marker k-mer,
+    // using whichever k-mer table is in use.
+    const KmerInfo& getMarkerKmerInfo(KmerId kmerId) const
+    {
+        if(sparseKmerTable.isOpen()) {
+            const KmerInfo* kmerInfo = sparseKmerTable.find(kmerId);
+            SHASTA_ASSERT(kmerInfo);
+            return *kmerInfo;
+        } else {
+            return kmerTable[kmerId];
+        }
+    }
+
+    // Compute the total number of run-length k-mers
+    // and the number of run-length k-mers used as markers.
+    void countRleKmers(
+        uint64_t& totalRleKmerCount,
+        uint64_t& markerRleKmerCount) const;
+
 public:
     void accessKmers();
     void writeKmers(const string& fileName) const;
 
     // Select marker k-mers randomly.
+    // For k > maxDenseKmerTableK, this uses randomlySelectKmersSparse.
     void randomlySelectKmers(
         size_t k,           // k-mer length.
         double probability, // The probability that a k-mer is selected as a marker.
-        int seed            // For random number generator.
+        int seed,           // For random number generator.
+        size_t threadCount = 0
     );
+private:
+
+    // Select marker k-mers randomly and store them in the sparse k-mer table.
+    // Because not all 4^k k-mers can be enumerated, this uses
+    // the k-mers present in the reads. A k-mer and its reverse complement
+    // are selected together, based on a hash of the lesser of their KmerIds.
+    void randomlySelectKmersSparse(
+        size_t k,
+        double probability,
+        int seed,
+        size_t threadCount);
+    class RandomlySelectKmersSparseData {
+    public:
+        uint64_t hashThreshold;
+        uint64_t seed;
+
+        // The selected k-mers found by each thread.
+        vector< vector<KmerId> > threadKmerIds;
+    };
+    RandomlySelectKmersSparseData randomlySelectKmersSparseData;
+    void randomlySelectKmersSparseThreadFunction(size_t threadId);
+public:
 
 
 
@@ -549,13 +691,14 @@ private:
         double enrichmentThreshold;
 
         // The number of times each k-mer appears in an oriented read.
-        // Indexed by KmerId.
-        MemoryMapped::Vector<uint64_t> globalFrequency;
+        KmerCounter globalFrequency;
 
         // The number of oriented reads that each k-mer is
         // over-enriched in by more than a factor enrichmentThreshold.
-        // Indexed by KmerId.
-        MemoryMapped::Vector<ReadId> overenrichedReadCount;
+        KmerCounter overenrichedReadCount;
+
+        // The total number of RLE k-mers.
+        uint64_t rleKmerCount;
 
     };
     SelectKmers2Data selectKmers2Data;
@@ -567,14 +710,25 @@ private:
 public:
     void readKmersFromFile(uint64_t k, const string& fileName);
 
+    // Instead of selecting a subset of k-mers, use window minimizers
+    // or open syncmers as markers (see MarkerFinder.hpp).
+    // All k-mers are flagged as markers in the k-mer table,
+    // and markers are selected in each read when finding markers.
+    void selectMinimizerKmers(uint64_t k, uint64_t minimizerWindow);
+    void selectSyncmerKmers(uint64_t k, uint64_t syncmerS);
+private:
+    void flagAllKmersAsMarkers(uint64_t k);
+public:
+
 private:
     void computeKmerFrequency(size_t threadId);
+    KmerCounter kmerFrequency;
     void initializeKmerTable();
 
 
 
     // The markers on all oriented reads. Indexed by OrientedReadId::getValue().
-    MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t> markers;
+    Markers markers;
     void checkMarkersAreOpen() const;
 
     // Get markers sorted by KmerId for a given OrientedReadId.
@@ -582,6 +736,26 @@ private:
         OrientedReadId,
         vector<MarkerWithOrdinal>&) const;
 
+    // Optional precomputed markers sorted by KmerId
+    // for each oriented read. Indexed by OrientedReadId::getValue().
+    // If available, these are used by the alignment code
+    // instead of calling getMarkersSortedByKmerId.
+    MemoryMapped::VectorOfVectors<MarkerWithOrdinal, uint64_t> sortedMarkers;
+public:
+    void computeSortedMarkers(size_t threadCount);
+    void accessSortedMarkers();
+    void removeSortedMarkers();
+private:
+    void computeSortedMarkersThreadFunction(size_t threadId);
+
+    // Return the markers sorted by KmerId for a given OrientedReadId.
+    // If sortedMarkers is available, this returns a span into it
+    // and the work area is not used. Otherwise the markers
+    // are sorted in the work area.
+    span<const MarkerWithOrdinal> getSortedMarkers(
+        OrientedReadId,
+        vector<MarkerWithOrdinal>& workArea) const;
+
     // Given a marker by its OrientedReadId and ordinal,
     // return the corresponding global marker id.
     MarkerId getMarkerId(OrientedReadId, uint32_t ordinal) const;
@@ -667,6 +841,12 @@ public:
         size_t minBucketSize,           // The minimum size for a bucket to be used.
         size_t maxBucketSize,           // The maximum size for a bucket to be used.
         size_t minFrequency,            // Minimum number of lowHash hits for a pair to become a candidate.
+        size_t hashBatchSize,           // Number of iterations for which hashes are computed together.
+        size_t hashFamily,              // 0 = MurmurHash64A, 1 = multiply-xorshift.
+        bool noKmerIdsCopy,             // Get KmerIds from the markers instead of a copy.
+        bool sortBuckets,               // Use sorted buckets instead of log2MinHashBucketCount buckets.
+        bool storeSketches,             // Store the low hash sketches in the Data directory.
+        bool useStoredSketches,         // Use the stored low hash sketches instead of hashing.
         size_t threadCount
     );
     void findAlignmentCandidatesLowHash1(
@@ -677,6 +857,20 @@ public:
         size_t minBucketSize,           // The minimum size for a bucket to be used.
         size_t maxBucketSize,           // The maximum size for a bucket to be used.
         size_t minFrequency,            // Minimum number of lowHash hits for a pair to become a candidate.
+        size_t hashBatchSize,           // Number of iterations for which hashes are computed together.
+        size_t hashFamily,              // 0 = MurmurHash64A, 1 = multiply-xorshift.
+        bool noKmerIdsCopy,             // Get KmerIds from the markers instead of a copy.
+        bool storeSketches,             // Store the low hash sketches in the Data directory.
+        bool useStoredSketches,         // Use the stored low hash sketches instead of hashing.
+        size_t threadCount
+    );
+    void findAlignmentCandidatesStrobemerChaining(
+        size_t minOffset,               // Minimum ordinal offset of the second marker of a seed.
+        size_t maxOffset,               // Maximum ordinal offset of the second marker of a seed.
+        double seedFraction,            // Fraction of the seeds that are used.
+        size_t maxSeedFrequency,        // Seeds more frequent than this are ignored.
+        size_t chainBandWidth,          // Maximum diagonal difference between consecutive hits of a chain.
+        size_t minFrequency,            // Minimum number of hits in a chain for a pair to become a candidate.
         size_t threadCount
     );
     void markAlignmentCandidatesAllPairs();
@@ -684,6 +878,14 @@ public:
     vector<OrientedReadPair> getAlignmentCandidates() const;
 private:
     void checkAlignmentCandidatesAreOpen() const;
+    void prepareLowHashSketches(
+        LowHashSketches&,
+        bool storeSketches,
+        bool useStoredSketches,
+        size_t m,
+        double hashFraction,
+        size_t hashFamily,
+        bool hasOrdinals);
 
 
     // LowHash statistics for read.
@@ -724,6 +926,17 @@ private:
         Alignment&,
         AlignmentInfo&
     );
+    // Same, with the sorted markers given as spans.
+    void alignOrientedReads(
+        const array<span<const MarkerWithOrdinal>, 2>& markersSortedByKmerId,
+        size_t maxSkip,             // Maximum ordinal skip allowed.
+        size_t maxDrift,            // Maximum ordinal drift allowed.
+        uint32_t maxMarkerFrequency,
+        bool debug,
+        AlignmentGraph&,
+        Alignment&,
+        AlignmentInfo&
+    );
 public:
     void analyzeAlignmentMatrix(ReadId, Strand, ReadId, Strand);
 private:
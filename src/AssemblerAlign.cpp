@@ -111,6 +111,31 @@ void Assembler::alignOrientedReads(
     Alignment& alignment,
     AlignmentInfo& alignmentInfo
 )
+{
+    const array<span<const MarkerWithOrdinal>, 2> markersSortedByKmerIdSpans = {
+        span<const MarkerWithOrdinal>(
+            markersSortedByKmerId[0].data(),
+            markersSortedByKmerId[0].data() + markersSortedByKmerId[0].size()),
+        span<const MarkerWithOrdinal>(
+            markersSortedByKmerId[1].data(),
+            markersSortedByKmerId[1].data() + markersSortedByKmerId[1].size())
+    };
+    alignOrientedReads(markersSortedByKmerIdSpans,
+        maxSkip, maxDrift, maxMarkerFrequency, debug, graph, alignment, alignmentInfo);
+}
+
+
+
+void Assembler::alignOrientedReads(
+    const array<span<const MarkerWithOrdinal>, 2>& markersSortedByKmerId,
+    size_t maxSkip,             // Maximum ordinal skip allowed.
+    size_t maxDrift,            // Maximum ordinal drift allowed.
+    uint32_t maxMarkerFrequency,
+    bool debug,
+    AlignmentGraph& graph,
+    Alignment& alignment,
+    AlignmentInfo& alignmentInfo
+)
 {
     align(markersSortedByKmerId,
         maxSkip, maxDrift, maxMarkerFrequency, debug, graph, alignment, alignmentInfo);
@@ -357,7 +382,8 @@ void Assembler::computeAlignmentsThreadFunction(size_t threadId)
 {
 
     array<OrientedReadId, 2> orientedReadIds;
-    array<vector<MarkerWithOrdinal>, 2> markersSortedByKmerId;
+    array<vector<MarkerWithOrdinal>, 2> markersWorkArea;
+    array<span<const MarkerWithOrdinal>, 2> markersSortedByKmerId;
     AlignmentGraph graph;
     Alignment alignment;
     AlignmentInfo alignmentInfo;
@@ -418,7 +444,7 @@ void Assembler::computeAlignmentsThreadFunction(size_t threadId)
 
                     // Get the markers for the two oriented reads in this candidate.
                     for(size_t j=0; j<2; j++) {
-                        getMarkersSortedByKmerId(orientedReadIds[j], markersSortedByKmerId[j]);
+                        markersSortedByKmerId[j] = getSortedMarkers(orientedReadIds[j], markersWorkArea[j]);
                     }
 
                     // Compute the Alignment.
@@ -724,7 +750,8 @@ void Assembler::flagPalindromicReadsThreadFunction(size_t threadId)
     AlignmentGraph graph;
     Alignment alignment;
     AlignmentInfo alignmentInfo;
-    array<vector<MarkerWithOrdinal>, 2> markersSortedByKmerId;
+    array<vector<MarkerWithOrdinal>, 2> markersWorkArea;
+    array<span<const MarkerWithOrdinal>, 2> markersSortedByKmerId;
 
     // Make local copies of the parameters.
     const uint32_t maxSkip = flagPalindromicReadsData.maxSkip;
@@ -751,7 +778,8 @@ void Assembler::flagPalindromicReadsThreadFunction(size_t threadId)
 
             // Get markers sorted by KmerId for this read and its reverse complement.
             for(Strand strand=0; strand<2; strand++) {
-                getMarkersSortedByKmerId(OrientedReadId(readId, strand), markersSortedByKmerId[strand]);
+                markersSortedByKmerId[strand] =
+                    getSortedMarkers(OrientedReadId(readId, strand), markersWorkArea[strand]);
             }
 
             // Compute a marker alignment of this read versus its reverse complement.
@@ -1032,89 +1060,19 @@ uint32_t Assembler::countCommonMarkersWithOffsetIn(
 // Check if an alignment between two reads should be suppressed,
 // bases on the setting of command line option
 // --Align.sameChannelReadAlignment.suppressDeltaThreshold.
+// The alignment is suppressed if the two reads have the same
+// ch, sampleid, and runid meta data fields, and their read meta data
+// fields differ by less than delta.
+// This uses the meta data fields parsed by Reads::parseReadMetaData.
 bool Assembler::suppressAlignment(
     ReadId readId0,
     ReadId readId1,
     uint64_t delta)
 {
-
-    // If the ch meta data fields of the two reads are missing or different,
-    // don't suppress the alignment.
-    // Check the channel first for efficiency,
-    // so we can return faster in most cases.
-    const auto ch0 = reads.getMetaData(readId0, "ch");
-    if(ch0.empty()) {
-        return false;
-    }
-    const auto ch1 = reads.getMetaData(readId1, "ch");
-    if(ch1.empty()) {
-        return false;
-    }
-    if(ch0 not_eq ch1) {
-        return false;
-    }
-
-
-
-    // If the sampleid meta data fields of the two reads are missing or different,
-    // don't suppress the alignment.
-    const auto sampleid0 = reads.getMetaData(readId0, "sampleid");
-    if(sampleid0.empty()) {
-        return false;
-    }
-    const auto sampleid1 = reads.getMetaData(readId1, "sampleid");
-    if(sampleid1.empty()) {
-        return false;
-    }
-    if(sampleid0 not_eq sampleid1) {
-        return false;
-    }
-
-
-
-    // If the runid meta data fields of the two reads are missing or different,
-    // don't suppress the alignment.
-    const auto runid0 = reads.getMetaData(readId0, "runid");
-    if(runid0.empty()) {
-        return false;
-    }
-    const auto runid1 = reads.getMetaData(readId1, "runid");
-    if(runid1.empty()) {
-        return false;
-    }
-    if(runid0 not_eq runid1) {
-        return false;
-    }
-
-    // cout << "Checking " << readId0 << " " << readId1 << endl;
-
-
-    // If the read meta data fields of the two reads are missing,
-    // don't suppress the alignment.
-    const auto read0 = reads.getMetaData(readId0, "read");
-    if(read0.empty()) {
-        return false;
-    }
-    const auto read1 = reads.getMetaData(readId1, "read");
-    if(read1.empty()) {
-        return false;
-    }
-    // cout << read0 << " " << read1 << endl;
-
-
-
-    // Convert the read meta data fields to integers.
-    // Keep in mind the span<char> is not null-terminated.
-    const int64_t r0 = int64_t(atoul(read0));
-    const int64_t r1 = int64_t(atoul(read1));
-    // cout << r0 << " " << r1 << endl;
-
-
-
-    // Suppress the alignment if the absolute difference of the
-    // read meta data fields is less than delta.
-    return abs(r0 - r1) < int64_t(delta);
-
+    return ParsedReadMetaData::suppressAlignment(
+        reads.getParsedReadMetaData(readId0),
+        reads.getParsedReadMetaData(readId1),
+        delta);
 }
 
 
@@ -1127,6 +1085,11 @@ void Assembler::suppressAlignmentCandidates(
 {
     cout << timestamp << "Suppressing alignment candidates." << endl;
 
+    // Assemblies created by older versions don't have parsed read meta data.
+    if(not reads.readMetaDataIsParsed()) {
+        parseReadMetaData();
+    }
+
     // Allocate memory for flags to keep track of which alignments
     // should be suppressed.
 
@@ -1179,6 +1142,7 @@ void Assembler::suppressAlignmentCandidates(
 void Assembler::suppressAlignmentCandidatesThreadFunction(size_t threadId)
 {
     const uint64_t delta = suppressAlignmentCandidatesData.delta;
+    const ParsedReadMetaData* parsedReadMetaData = reads.getParsedReadMetaData();
 
     // Loop over batches assigned to this thread.
     uint64_t begin, end;
@@ -1187,9 +1151,10 @@ void Assembler::suppressAlignmentCandidatesThreadFunction(size_t threadId)
         // Loop over candidate alignments in this batch.
         for(uint64_t i=begin; i!=end; i++) {
             const OrientedReadPair& p = alignmentCandidates.candidates[i];
-            // cout << "Checking " << p.readIds[0] << " " << p.readIds[1] <<  " " << int(p.isSameStrand) << endl;
-            suppressAlignmentCandidatesData.suppress[i] =
-                suppressAlignment(p.readIds[0], p.readIds[1], delta);
+            suppressAlignmentCandidatesData.suppress[i] = ParsedReadMetaData::suppressAlignment(
+                parsedReadMetaData[p.readIds[0]],
+                parsedReadMetaData[p.readIds[1]],
+                delta);
         }
 
     }
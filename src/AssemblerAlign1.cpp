@@ -73,10 +73,10 @@ void Assembler::alignOrientedReads1(
     using TAlignGraph = Graph<Alignment<TDepStringSet> >;
 
     // Access the markers of our oriented reads.
-    const span<CompressedMarker> markers0 =
-        markers[orientedReadId0.getValue()];
-    const span<CompressedMarker> markers1 =
-        markers[orientedReadId1.getValue()];
+    vector<CompressedMarker> markers0;
+    vector<CompressedMarker> markers1;
+    markers[orientedReadId0.getValue()].get(markers0);
+    markers[orientedReadId1.getValue()].get(markers1);
 
 
 
@@ -88,14 +88,22 @@ void Assembler::alignOrientedReads1(
     bool replacementIsNeeded = false;
     const KmerId seqanGapValue = 45;
     KmerId replacementValue = seqanGapValue;
-    if(kmerTable[seqanGapValue].isMarker) {
+    if(isMarkerKmer(seqanGapValue)) {
         replacementIsNeeded = true;
-        for(uint64_t i=0; i<kmerTable.size(); i++) {
-            if(!kmerTable[i].isMarker) {
+        const uint64_t kmerIdEnd = sparseKmerTable.isOpen() ?
+            std::numeric_limits<uint64_t>::max() : kmerTable.size();
+        for(uint64_t i=0; i<kmerIdEnd; i++) {
+            if(!isMarkerKmer(KmerId(i))) {
                 replacementValue = KmerId(i);
                 break;
             }
         }
+        // If all k-mers are markers (this happens when using
+        // minimizers or syncmers), use a value that is not a valid KmerId.
+        if(replacementValue == seqanGapValue and
+            kmerIdEnd < std::numeric_limits<KmerId>::max()) {
+            replacementValue = KmerId(kmerIdEnd);
+        }
         // cout << "Replacement value " << replacementValue << endl;
         SHASTA_ASSERT(replacementValue != seqanGapValue);
     }
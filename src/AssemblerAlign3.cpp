@@ -53,9 +53,9 @@ void Assembler::alignOrientedReads3(
 
 
     // Get the markers for the two oriented reads.
-    array<span<CompressedMarker>, 2> allMarkers;
-    allMarkers[0] = markers[orientedReadId0.getValue()];
-    allMarkers[1] = markers[orientedReadId1.getValue()];
+    array<vector<CompressedMarker>, 2> allMarkers;
+    markers[orientedReadId0.getValue()].get(allMarkers[0]);
+    markers[orientedReadId1.getValue()].get(allMarkers[1]);
 
     // Vectors to contain downsampled markers.
     // For each of the two reads we store vectors of
@@ -71,7 +71,7 @@ void Assembler::alignOrientedReads3(
     for(uint64_t i=0; i<2; i++) {
         for(uint32_t ordinal=0; ordinal<uint32_t(allMarkers[i].size()); ordinal++) {
             const KmerId kmerId = allMarkers[i][ordinal].kmerId;
-             if(kmerTable[kmerId].hash < hashThreshold) {
+             if(getMarkerKmerInfo(kmerId).hash < hashThreshold) {
                 downsampledMarkers[i].push_back(make_pair(ordinal, kmerId));
                 appendValue(downsampledSequences[i], kmerId + 100);
             }
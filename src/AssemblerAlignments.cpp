@@ -418,7 +418,7 @@ void Assembler::analyzeAlignments2(ReadId readId0, Strand strand0) const
         Sequence& sequence = sequences[sequenceId];
         const OrientedReadId orientedReadId1 = alignments[sequenceId].first;
         orientedReadIds[sequenceId] = orientedReadId1;
-        const span<const CompressedMarker> markers1 = markers[orientedReadId1.getValue()];
+        const OrientedReadMarkers markers1 = markers[orientedReadId1.getValue()];
         const AlignmentInfo& alignmentInfo = alignments[sequenceId].second;
         const uint32_t first1 = alignmentInfo.data[1].firstOrdinal;
         firstOrdinals[sequenceId] = first1;
@@ -431,7 +431,7 @@ void Assembler::analyzeAlignments2(ReadId readId0, Strand strand0) const
     Sequence& sequence0 = sequences.back();
     orientedReadIds.back() = orientedReadId0;
     firstOrdinals.back() = 0;
-    const span<const CompressedMarker> markers0 = markers[orientedReadId0.getValue()];
+    const OrientedReadMarkers markers0 = markers[orientedReadId0.getValue()];
     const uint64_t markerCount0 = markers0.size();
     sequence0.resize(markerCount0);
     for(uint32_t ordinal=0; ordinal!=markerCount0; ordinal++) {
@@ -919,7 +919,7 @@ void Assembler::analyzeAlignments3(ReadId readId0, Strand strand0) const
         Sequence& sequence = sequences[sequenceId];
         const OrientedReadId orientedReadId1 = alignments[sequenceId].orientedReadId;
         orientedReadIds[sequenceId] = orientedReadId1;
-        const span<const CompressedMarker> markers1 = markers[orientedReadId1.getValue()];
+        const OrientedReadMarkers markers1 = markers[orientedReadId1.getValue()];
         const Alignment& alignment = alignments[sequenceId].alignment;
         const uint32_t first1 = alignment.ordinals.front()[1];
         firstOrdinals[sequenceId] = first1;
@@ -935,7 +935,7 @@ void Assembler::analyzeAlignments3(ReadId readId0, Strand strand0) const
     Sequence& sequence0 = sequences.back();
     const SequenceId sequenceId0 = sequences.size() - 1;
     orientedReadIds.back() = orientedReadId0;
-    const span<const CompressedMarker> markers0 = markers[orientedReadId0.getValue()];
+    const OrientedReadMarkers markers0 = markers[orientedReadId0.getValue()];
     const uint64_t markerCount0 = markers0.size();
     firstOrdinals.back() = 0;
     lastOrdinals.back() = uint32_t(markers0.size() - 1);
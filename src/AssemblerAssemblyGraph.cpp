@@ -1728,8 +1728,10 @@ void Assembler::assembleAssemblyGraphEdge(
     for(size_t i=0; i<assembledSegment.vertexCount; i++) {
 
         // Get the sequence.
+        // Markers::get locates the oriented read with a binary search
+        // over reads, so this is O(log(readCount)) per vertex.
         const MarkerId firstMarkerId = markerGraph.getVertexMarkerIds(assembledSegment.vertexIds[i])[0];
-        const CompressedMarker& firstMarker = markers.begin()[firstMarkerId];
+        const CompressedMarker firstMarker = markers.get(firstMarkerId);
         const KmerId kmerId = firstMarker.kmerId;
         const Kmer kmer(kmerId, assemblerInfo->k);
 
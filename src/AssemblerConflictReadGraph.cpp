@@ -120,7 +120,7 @@ void Assembler::createConflictReadGraphThreadFunction1(size_t threadId)
             ConflictReadGraphVertex& vertex = conflictReadGraph.getVertex(v);
 
             // The MarkerId of the first marker for this oriented read.
-            const MarkerId firstMarkerId =  markers.begin(v) - markers.begin();
+            const MarkerId firstMarkerId =  markers.beginMarkerId(v);
 
             // The number of markers in this oriented read.
             const uint32_t markerCount = uint32_t(markers.size(v));
@@ -268,7 +268,7 @@ void Assembler::addConflictGraphEdges(
     // with orientedReadId0.
     // To do this, we loop over all markers of orientedReadId0.
     conflictCandidates.clear();
-    const MarkerId firstMarkerId = markers.begin(orientedReadId0.getValue()) - markers.begin();
+    const MarkerId firstMarkerId = markers.beginMarkerId(orientedReadId0.getValue());
     const uint32_t markerCount = uint32_t(markers.size(orientedReadId0.getValue()));
     for(uint32_t ordinal=0; ordinal<markerCount; ordinal++) {
         const MarkerId markerId0 = firstMarkerId + ordinal;
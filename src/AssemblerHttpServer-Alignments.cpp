@@ -1224,11 +1224,7 @@ void Assembler::sampleReads(vector<OrientedReadId>& sample, uint64_t n, uint64_t
         const OrientedReadId r(readId, strand);
 
         // Number of raw bases.
-        const auto repeatCounts = reads.getReadRepeatCounts(readId);
-        uint64_t length = 0;
-        for(const auto repeatCount: repeatCounts) {
-            length += repeatCount;
-        }
+        const uint64_t length = reads.getReadRawSequenceLength(readId);
 
         // Only update the sample of reads if this read passes the length criteria
         if(length >= minLength and length <= maxLength) {
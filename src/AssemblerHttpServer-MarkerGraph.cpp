@@ -444,7 +444,9 @@ void Assembler::exploreMarkerGraphVertex(const vector<string>& request, ostream&
     SHASTA_ASSERT(markerCount > 0);
 
     // Get the marker sequence.
-    const KmerId kmerId = markers.begin()[markerIds[0]].kmerId;
+    // Markers::get locates the oriented read with a binary search,
+    // which is negligible for a single marker.
+    const KmerId kmerId = markers.get(markerIds[0]).kmerId;
     const size_t k = assemblerInfo->k;
     const Kmer kmer(kmerId, k);
 
@@ -456,8 +458,8 @@ void Assembler::exploreMarkerGraphVertex(const vector<string>& request, ostream&
     vector< vector<uint8_t> > repeatCounts(markerCount, vector<uint8_t>(k));
     for(size_t j=0; j<markerCount; j++) {
         const MarkerId markerId = markerIds[j];
-        const CompressedMarker& marker = markers.begin()[markerId];
         tie(orientedReadIds[j], ordinals[j]) = findMarkerId(markerId);
+        const CompressedMarker marker = markers[orientedReadIds[j].getValue()][ordinals[j]];
 
         // Get the repeat count for this marker at each of the k positions.
         for(size_t i=0; i<k; i++) {
@@ -10,9 +10,15 @@ void Assembler::exploreRead(
 {
     // Get the ReadId and Strand from the request.
     ReadId readId = 0;
-    const bool readIdIsPresent = getParameterValue(request, "readId", readId);
+    bool readIdIsPresent = getParameterValue(request, "readId", readId);
     Strand strand = 0;
-    const bool strandIsPresent = getParameterValue(request, "strand", strand);
+    bool strandIsPresent = getParameterValue(request, "strand", strand);
+
+    // The read can also be specified by name.
+    string requestedReadName;
+    const bool readNameIsPresent =
+        getParameterValue(request, "readName", requestedReadName) and
+        not requestedReadName.empty();
 
     // Get the begin and end position.
     uint32_t beginPosition = 0;
@@ -37,9 +43,12 @@ void Assembler::exploreRead(
         "<form>"
         "<input type=submit value='Show'> " <<
         "read &nbsp" <<
-        "<input type=text name=readId required" <<
+        "<input type=text name=readId" <<
         (readIdIsPresent ? (" value=" + to_string(readId)) : "") <<
         " size=8 title='Enter a read id between 0 and " << reads.readCount()-1 << "'>"
+        " or read name &nbsp"
+        "<input type=text name=readName size=24"
+        " title='Enter a read name. This is used only if the read id is blank.'>"
         " on strand ";
     writeStrandSelection(html, "strand", strandIsPresent && strand==0, strandIsPresent && strand==1);
     
@@ -68,6 +77,25 @@ void Assembler::exploreRead(
     
     html << "</form>";
 
+    // If the read was specified by name, look it up
+    // using the read name index. Default to strand 0.
+    if(!readIdIsPresent && readNameIsPresent) {
+        if(!reads.readNameIndexIsOpen()) {
+            html << "<p>The read name index is not available for this assembly.";
+            return;
+        }
+        readId = reads.getReadId(requestedReadName);
+        if(readId == invalidReadId) {
+            html << "<p>There is no read named " << requestedReadName << ".";
+            return;
+        }
+        readIdIsPresent = true;
+        if(!strandIsPresent) {
+            strand = 0;
+            strandIsPresent = true;
+        }
+    }
+
     // If the readId or strand are missing, stop here.
     if(!readIdIsPresent || !strandIsPresent) {
         return;
@@ -582,23 +582,18 @@ void Assembler::writeAssemblySummaryBody(ostream& html)
     // Compute the number of run-length k-mers used as markers.
     uint64_t totalRleKmerCount = 0;
     uint64_t markerRleKmerCount = 0;
-    for(const auto& tableEntry: kmerTable) {
-        if(tableEntry.isRleKmer) {
-            ++totalRleKmerCount;
-            if(tableEntry.isMarker) {
-                ++markerRleKmerCount;
-            }
-        }
-    }
+    countRleKmers(totalRleKmerCount, markerRleKmerCount);
 
     const uint64_t totalDiscardedReadCount =
         assemblerInfo->discardedInvalidBaseReadCount +
         assemblerInfo->discardedShortReadReadCount +
-        assemblerInfo->discardedBadRepeatCountReadCount;
+        assemblerInfo->discardedBadRepeatCountReadCount +
+        assemblerInfo->discardedExcessCoverageReadCount;
     const uint64_t totalDiscardedBaseCount =
         assemblerInfo->discardedInvalidBaseBaseCount +
         assemblerInfo->discardedShortReadBaseCount +
-        assemblerInfo->discardedBadRepeatCountBaseCount;
+        assemblerInfo->discardedBadRepeatCountBaseCount +
+        assemblerInfo->discardedExcessCoverageBaseCount;
 
 
     html <<
@@ -648,6 +643,9 @@ void Assembler::writeAssemblySummaryBody(ostream& html)
         "<tr><td>Reads discarded on input because they contained repeat counts greater than 255"
         "<td class=right>" << assemblerInfo->discardedBadRepeatCountReadCount <<
         "<td class=right>" << assemblerInfo->discardedBadRepeatCountBaseCount <<
+        "<tr><td>Reads discarded on input because they were not needed for the desired coverage"
+        "<td class=right>" << assemblerInfo->discardedExcessCoverageReadCount <<
+        "<td class=right>" << assemblerInfo->discardedExcessCoverageBaseCount <<
         "<tr><td>Reads discarded on input, total"
         "<td class=right>" <<totalDiscardedReadCount <<
         "<td class=right>" <<totalDiscardedBaseCount <<
@@ -831,23 +829,18 @@ void Assembler::writeAssemblySummaryJson(ostream& json)
     // Compute the number of run-length k-mers used as markers.
     uint64_t totalRleKmerCount = 0;
     uint64_t markerRleKmerCount = 0;
-    for(const auto& tableEntry: kmerTable) {
-        if(tableEntry.isRleKmer) {
-            ++totalRleKmerCount;
-            if(tableEntry.isMarker) {
-                ++markerRleKmerCount;
-            }
-        }
-    }
+    countRleKmers(totalRleKmerCount, markerRleKmerCount);
 
     const uint64_t totalDiscardedReadCount =
         assemblerInfo->discardedInvalidBaseReadCount +
         assemblerInfo->discardedShortReadReadCount +
-        assemblerInfo->discardedBadRepeatCountReadCount;
+        assemblerInfo->discardedBadRepeatCountReadCount +
+        assemblerInfo->discardedExcessCoverageReadCount;
     const uint64_t totalDiscardedBaseCount =
         assemblerInfo->discardedInvalidBaseBaseCount +
         assemblerInfo->discardedShortReadBaseCount +
-        assemblerInfo->discardedBadRepeatCountBaseCount;
+        assemblerInfo->discardedBadRepeatCountBaseCount +
+        assemblerInfo->discardedExcessCoverageBaseCount;
 
 
     json <<
@@ -893,6 +886,11 @@ void Assembler::writeAssemblySummaryJson(ostream& json)
         "      \"Reads\": " << assemblerInfo->discardedBadRepeatCountReadCount << ",\n"
         "      \"Bases\": " << assemblerInfo->discardedBadRepeatCountBaseCount << "\n"
         "    },\n"
+        "    \"Reads discarded on input because they were not needed for the desired coverage\":\n"
+        "    {\n"
+        "      \"Reads\": " << assemblerInfo->discardedExcessCoverageReadCount << ",\n"
+        "      \"Bases\": " << assemblerInfo->discardedExcessCoverageBaseCount << "\n"
+        "    },\n"
         "    \"Reads discarded on input, total\":\n"
         "    {\n"
         "      \"Reads\": " << totalDiscardedReadCount << ",\n"
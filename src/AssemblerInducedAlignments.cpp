@@ -120,7 +120,7 @@ void Assembler::computeInducedAlignments(
 
 
     // Main loop over markers in orientedReadId0.
-    const MarkerId firstMarkerId = markers.begin(orientedReadId0.getValue()) - markers.begin();
+    const MarkerId firstMarkerId = markers.beginMarkerId(orientedReadId0.getValue());
     const uint32_t markerCount = uint32_t(markers.size(orientedReadId0.getValue()));
     for(uint32_t ordinal0=0; ordinal0<markerCount; ordinal0++) {
         const MarkerId markerId0 = firstMarkerId + ordinal0;
@@ -234,12 +234,12 @@ bool Assembler::evaluateInducedAlignment(
     }
 
     // Access the markers for the two oriented reads.
-    const span<CompressedMarker> markers0 = markers[orientedReadId0.getValue()];
-    const span<CompressedMarker> markers1 = markers[orientedReadId1.getValue()];
+    const OrientedReadMarkers markers0 = markers[orientedReadId0.getValue()];
+    const OrientedReadMarkers markers1 = markers[orientedReadId1.getValue()];
     const int64_t markerCount0 = markers0.size();
     const int64_t markerCount1 = markers1.size();
-    const int64_t firstMarkerId0 = markers.begin(orientedReadId0.getValue()) - markers.begin();
-    const int64_t firstMarkerId1 = markers.begin(orientedReadId1.getValue()) - markers.begin();
+    const int64_t firstMarkerId0 = markers.beginMarkerId(orientedReadId0.getValue());
+    const int64_t firstMarkerId1 = markers.beginMarkerId(orientedReadId1.getValue());
 
 
 
@@ -451,7 +451,7 @@ void Assembler::fillCompressedOrdinals(
     for(uint64_t i=0; i<2; i++) {
         const OrientedReadId orientedReadId = orientedReadIds[i];
 
-        const MarkerId firstMarkerId = markers.begin(orientedReadId.getValue()) - markers.begin();
+        const MarkerId firstMarkerId = markers.beginMarkerId(orientedReadId.getValue());
         const uint32_t markerCount = uint32_t(markers.size(orientedReadId.getValue()));
         ordinalTable[i].resize(markerCount);
 
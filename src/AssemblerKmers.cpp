@@ -7,6 +7,10 @@ using namespace shasta;
 
 void Assembler::accessKmers()
 {
+    if(assemblerInfo->k > maxDenseKmerTableK) {
+        sparseKmerTable.accessExistingReadOnly(largeDataName("SparseKmers"));
+        return;
+    }
     kmerTable.accessExistingReadOnly(largeDataName("Kmers"));
     if(kmerTable.size() != (1ULL<< (2*assemblerInfo->k))) {
         throw runtime_error("Size of k-mer vector is inconsistent with stored value of k.");
@@ -15,20 +19,63 @@ void Assembler::accessKmers()
 
 void Assembler::checkKmersAreOpen()const
 {
-    if(!kmerTable.isOpen) {
+    if(!kmerTable.isOpen and !sparseKmerTable.isOpen()) {
         throw runtime_error("Kmers are not accessible.");
     }
 }
 
 
 
+void Assembler::countRleKmers(
+    uint64_t& totalRleKmerCount,
+    uint64_t& markerRleKmerCount) const
+{
+    totalRleKmerCount = 0;
+    markerRleKmerCount = 0;
+
+    if(sparseKmerTable.isOpen()) {
+
+        // The sparse k-mer table only stores markers.
+        // The total number of run-length k-mers is 4*3^(k-1).
+        totalRleKmerCount = 4;
+        for(size_t i=1; i<assemblerInfo->k; i++) {
+            totalRleKmerCount *= 3;
+        }
+        sparseKmerTable.forEach([&markerRleKmerCount](KmerId, const KmerInfo& info) {
+            if(info.isRleKmer) {
+                ++markerRleKmerCount;
+            }
+        });
+
+    } else {
+
+        for(const auto& tableEntry: kmerTable) {
+            if(tableEntry.isRleKmer) {
+                ++totalRleKmerCount;
+                if(tableEntry.isMarker) {
+                    ++markerRleKmerCount;
+                }
+            }
+        }
+    }
+}
+
+
+
 // Randomly select the k-mers to be used as markers.
 void Assembler::randomlySelectKmers(
     size_t k,           // k-mer length.
     double probability, // The probability that a k-mer is selected as a marker.
-    int seed            // For random number generator.
+    int seed,           // For random number generator.
+    size_t threadCount
 )
 {
+    // Long k-mers use the sparse k-mer table.
+    if(k > maxDenseKmerTableK) {
+        randomlySelectKmersSparse(k, probability, seed, threadCount);
+        return;
+    }
+
     // Sanity check on the value of k, then store it.
     if(k > Kmer::capacity) {
         throw runtime_error("K-mer capacity exceeded.");
@@ -108,8 +155,129 @@ void Assembler::randomlySelectKmers(
 
 
 
+// Select marker k-mers randomly and store them in the sparse k-mer table.
+// A k-mer and its reverse complement are selected together
+// if a hash of the lesser of their KmerIds is less than
+// probability * 2^64, so the expected fraction of k-mers
+// selected is the same as for the dense version above.
+// Only k-mers present in the reads are stored.
+void Assembler::randomlySelectKmersSparse(
+    size_t k,
+    double probability,
+    int seed,
+    size_t threadCount)
+{
+    if(k > SparseKmerTable::maxK) {
+        throw runtime_error("K-mer length " + to_string(k) +
+            " is not supported. The maximum supported k-mer length "
+            "for this build is " + to_string(SparseKmerTable::maxK) + ".");
+    }
+    if(probability<0. || probability>1.) {
+        throw runtime_error("Invalid k-mer probability " +
+            to_string(probability) + " requested.");
+    }
+    reads.checkReadsAreOpen();
+    assemblerInfo->k = k;
+    if(threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    // Find the selected k-mers present in the reads.
+    cout << timestamp << "Selecting marker " << k << "-mers from " <<
+        reads.readCount() << " reads." << endl;
+    RandomlySelectKmersSparseData& data = randomlySelectKmersSparseData;
+    data.hashThreshold = (probability == 1.) ?
+        std::numeric_limits<uint64_t>::max() :
+        uint64_t(probability * 18446744073709551616.);
+    data.seed = uint64_t(seed);
+    data.threadKmerIds.clear();
+    data.threadKmerIds.resize(threadCount);
+    const uint64_t batchSize = 100;
+    setupLoadBalancing(reads.readCount(), batchSize);
+    runThreads(&Assembler::randomlySelectKmersSparseThreadFunction, threadCount);
+
+    // Gather them.
+    vector<KmerId> kmerIds;
+    for(const vector<KmerId>& v: data.threadKmerIds) {
+        kmerIds.insert(kmerIds.end(), v.begin(), v.end());
+    }
+    data.threadKmerIds.clear();
+    sort(kmerIds.begin(), kmerIds.end());
+    kmerIds.resize(unique(kmerIds.begin(), kmerIds.end()) - kmerIds.begin());
+
+    // Store them.
+    assemblerInfo->markerSelectionMethod = 0;
+    sparseKmerTable.createNew(largeDataName("SparseKmers"), largeDataPageSize);
+    sparseKmerTable.store(k, kmerIds);
+    cout << timestamp << "Selected " << sparseKmerTable.size() << " " << k <<
+        "-mers present in the reads as markers." << endl;
+    cout << "Requested inclusion probability: " << probability << "." << endl;
+}
+
+
+
+void Assembler::randomlySelectKmersSparseThreadFunction(size_t threadId)
+{
+    const size_t k = assemblerInfo->k;
+    const uint64_t hashThreshold = randomlySelectKmersSparseData.hashThreshold;
+    const uint64_t seed = randomlySelectKmersSparseData.seed;
+    vector<KmerId>& kmerIds = randomlySelectKmersSparseData.threadKmerIds[threadId];
+
+    // To limit memory, remove duplicates whenever
+    // the number of k-mers stored doubles.
+    uint64_t compactionSize = 1024 * 1024;
+
+    // Loop over batches assigned to this thread.
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over reads of this batch.
+        for(ReadId readId=ReadId(begin); readId!=ReadId(end); readId++) {
+            const LongBaseSequenceView read = reads.getRead(readId);
+            if(read.baseCount < k) {
+                continue;
+            }
+
+            // Loop over k-mers of this read.
+            Kmer kmer;
+            for(size_t position=0; position<k; position++) {
+                kmer.set(position, read[position]);
+            }
+            for(uint64_t position=0; /*The check is done later */; position++) {
+                const KmerId kmerId = KmerId(kmer.id(k));
+                const KmerId reverseComplementedKmerId = KmerId(kmer.reverseComplement(k).id(k));
+                const KmerId canonicalKmerId = min(kmerId, reverseComplementedKmerId);
+                if(MurmurHash64A(&canonicalKmerId, sizeof(canonicalKmerId), seed) <= hashThreshold) {
+                    kmerIds.push_back(kmerId);
+                    kmerIds.push_back(reverseComplementedKmerId);
+                }
+
+                if(position+k == read.baseCount) {
+                    break;
+                }
+
+                // Update the k-mer.
+                kmer.shiftLeft();
+                kmer.set(k-1, read[position+k]);
+            }
+        }
+
+        if(kmerIds.size() > compactionSize) {
+            sort(kmerIds.begin(), kmerIds.end());
+            kmerIds.resize(unique(kmerIds.begin(), kmerIds.end()) - kmerIds.begin());
+            compactionSize = max(compactionSize, 2 * kmerIds.size());
+        }
+    }
+}
+
+
+
 void Assembler::initializeKmerTable()
 {
+    // Unless requested otherwise after this, all occurrences
+    // of marker k-mers will be used as markers.
+    assemblerInfo->markerSelectionMethod = 0;
+
     // Create the kmer table with the necessary size.
     kmerTable.createNew(largeDataName("Kmers"), largeDataPageSize);
     const size_t k = assemblerInfo->k;
@@ -159,13 +327,27 @@ void Assembler::writeKmers(const string& fileName) const
 
     // Get the k-mer length.
     const size_t k = assemblerInfo->k;
-    const size_t kmerCount = 1ULL << (2ULL*k);
-    SHASTA_ASSERT(kmerTable.size() == kmerCount);
 
     // Open the output file and write the header line.
     ofstream file(fileName);
     file << "KmerId,Kmer,IsMarker,ReverseComplementedKmerId,ReverseComplementedKmer\n";
 
+    // The sparse k-mer table only stores markers,
+    // so in that case we only write those.
+    if(sparseKmerTable.isOpen()) {
+        sparseKmerTable.forEach([&file, k](KmerId kmerId, const KmerInfo& info) {
+            file << kmerId << ",";
+            file << Kmer(kmerId, k) << ",";
+            file << "1,";
+            file << info.reverseComplementedKmerId << ",";
+            file << Kmer(info.reverseComplementedKmerId, k) << "\n";
+        });
+        return;
+    }
+
+    const size_t kmerCount = 1ULL << (2ULL*k);
+    SHASTA_ASSERT(kmerTable.size() == kmerCount);
+
     // Write a line for each k-mer.
     for(uint64_t kmerId=0; kmerId<kmerCount; kmerId++) {
         file << kmerId << ",";
@@ -204,6 +386,10 @@ void Assembler::selectKmersBasedOnFrequency(
     if(k > Kmer::capacity) {
         throw runtime_error("K-mer capacity exceeded.");
     }
+    if(k > maxDenseKmerTableK) {
+        throw runtime_error("This k-mer generation method requires k <= " +
+            to_string(maxDenseKmerTableK) + ". Use random k-mer selection instead.");
+    }
     assemblerInfo->k = k;
 
     // Sanity check.
@@ -222,8 +408,16 @@ void Assembler::selectKmersBasedOnFrequency(
     initializeKmerTable();
 
     // Compute the frequency of all k-mers in oriented reads.
+    // The threads only count k-mers on strand 0
+    // and we add the reverse complements at the end.
+    kmerFrequency.createNew(k, largeDataName("tmp-KmerFrequency"), largeDataPageSize);
     setupLoadBalancing(reads.readCount(), 1000);
     runThreads(&Assembler::computeKmerFrequency, threadCount);
+    kmerFrequency.addReverseComplements();
+    for(uint64_t kmerId=0; kmerId!=kmerTable.size(); kmerId++) {
+        kmerTable[kmerId].frequency = kmerFrequency[KmerId(kmerId)];
+    }
+    kmerFrequency.remove();
 
     // Compute the total number of k-mer occurrences
     // and the number of RLE kmers.
@@ -359,15 +553,7 @@ void Assembler::selectKmersBasedOnFrequency(
 
 void Assembler::computeKmerFrequency(size_t threadId)
 {
-    // Create a frequency vector for this thread.
-    MemoryMapped::Vector<uint64_t> frequency;
-    frequency.createNew(
-        largeDataName("tmp-KmerFrequency-" + to_string(threadId)),
-        largeDataPageSize);
-    frequency.resize(kmerTable.size());
-    fill(frequency.begin(), frequency.end(), 0);
-
-
+    KmerCounter::Buffer buffer(kmerFrequency);
 
     // Loop over all batches assigned to this thread.
     const size_t k = assemblerInfo->k;
@@ -392,14 +578,8 @@ void Assembler::computeKmerFrequency(size_t threadId)
             }
             for(uint32_t position=0; /*The check is done later */; position++) {
 
-                // Get the k-mer id.
-                const KmerId kmerId = KmerId(kmer.id(k));
-
-                // Increment its frequency.
-                ++frequency[kmerId];
-
-                // Also increment the frequency of the reverse complemented k-mer.
-                ++frequency[kmerTable[kmerId].reverseComplementedKmerId];
+                // Increment the frequency of this k-mer.
+                buffer.add(KmerId(kmer.id(k)));
 
                 // Check if we reached the end of the read.
                 if(position+k == read.baseCount) {
@@ -413,19 +593,7 @@ void Assembler::computeKmerFrequency(size_t threadId)
         }
     }
 
-
-    // Update the frequency in the k-mer table.
-    {
-        std::lock_guard<std::mutex> lock(mutex);
-        for(uint64_t kmerId=0; kmerId!=frequency.size(); kmerId++) {
-            kmerTable[kmerId].frequency += frequency[kmerId];
-        }
-    }
-
-
-
-    // Remove the frequency vector for this thread.
-    frequency.remove();
+    buffer.flush();
 }
 
 
@@ -437,6 +605,10 @@ void Assembler::readKmersFromFile(uint64_t k, const string& fileName)
     if(k > Kmer::capacity) {
         throw runtime_error("K-mer capacity exceeded.");
     }
+    if(k > maxDenseKmerTableK) {
+        throw runtime_error("This k-mer generation method requires k <= " +
+            to_string(maxDenseKmerTableK) + ". Use random k-mer selection instead.");
+    }
     assemblerInfo->k = k;
 
     // Fill in the fields of the k-mer table
@@ -539,6 +711,10 @@ void Assembler::selectKmers2(
     if(k > Kmer::capacity) {
         throw runtime_error("K-mer capacity exceeded.");
     }
+    if(k > maxDenseKmerTableK) {
+        throw runtime_error("This k-mer generation method requires k <= " +
+            to_string(maxDenseKmerTableK) + ". Use random k-mer selection instead.");
+    }
     assemblerInfo->k = k;
 
     // Sanity check.
@@ -563,32 +739,34 @@ void Assembler::selectKmers2(
     // global frequency (total number of occurrences in all
     // oriented reads) and the number of reads in
     // which the k-mer is over-enriched.
-    selectKmers2Data.globalFrequency.createNew(
+    // The threads only count k-mers on strand 0
+    // and we add the reverse complements at the end.
+    selectKmers2Data.globalFrequency.createNew(k,
         largeDataName("tmp-SelectKmers2-GlobalFrequency"),  largeDataPageSize);
-    selectKmers2Data.overenrichedReadCount.createNew(
+    selectKmers2Data.overenrichedReadCount.createNew(k,
         largeDataName("tmp-SelectKmers2-OverenrichedReadCount"),  largeDataPageSize);
-    selectKmers2Data.globalFrequency.resize(kmerTable.size());
-    selectKmers2Data.overenrichedReadCount.resize(kmerTable.size());
-    fill(
-        selectKmers2Data.globalFrequency.begin(),
-        selectKmers2Data.globalFrequency.end(), 0);
-    fill(
-        selectKmers2Data.overenrichedReadCount.begin(),
-        selectKmers2Data.overenrichedReadCount.end(), 0);
+
+    // Compute the number of RLE k-mers.
+    // It is needed for overenrichment computations.
+    uint64_t rleKmerCount = 0;
+    for(uint64_t kmerId=0; kmerId!=kmerTable.size(); kmerId++) {
+        if(kmerTable[kmerId].isRleKmer) {
+            ++rleKmerCount;
+        }
+    }
+    selectKmers2Data.rleKmerCount = rleKmerCount;
+
     setupLoadBalancing(reads.readCount(), 100);
     runThreads(&Assembler::selectKmers2ThreadFunction, threadCount);
+    selectKmers2Data.globalFrequency.addReverseComplements();
+    selectKmers2Data.overenrichedReadCount.addReverseComplements();
 
 
 
-    // Compute the total number of k-mer occurrences
-    // and the number of RLE kmers.
+    // Compute the total number of k-mer occurrences.
     uint64_t totalKmerOccurrences = 0;
-    uint64_t rleKmerCount = 0;
     for(uint64_t kmerId=0; kmerId!=kmerTable.size(); kmerId++) {
-        totalKmerOccurrences += selectKmers2Data.globalFrequency[kmerId];
-        if(kmerTable[kmerId].isRleKmer) {
-            ++rleKmerCount;
-        }
+        totalKmerOccurrences += selectKmers2Data.globalFrequency[KmerId(kmerId)];
     }
     const double averageOccurrenceCount =
         double(totalKmerOccurrences) / double(rleKmerCount);
@@ -601,7 +779,7 @@ void Assembler::selectKmers2(
         "GlobalFrequency,GlobalEnrichment,NumberOfReadsOverenriched\n";
     for(uint64_t kmerId=0; kmerId<kmerTable.size(); kmerId++) {
         const KmerInfo& info = kmerTable[kmerId];
-        const uint64_t frequency = selectKmers2Data.globalFrequency[kmerId];
+        const uint64_t frequency = selectKmers2Data.globalFrequency[KmerId(kmerId)];
         if(!info.isRleKmer) {
             SHASTA_ASSERT(frequency == 0);
             continue;
@@ -618,7 +796,7 @@ void Assembler::selectKmers2(
         csv << frequency << ",";
         csv << double(frequency) / averageOccurrenceCount;
         csv << ",";
-        csv << selectKmers2Data.overenrichedReadCount[kmerId];
+        csv << selectKmers2Data.overenrichedReadCount[KmerId(kmerId)];
 
         csv << "\n";
     }
@@ -628,7 +806,7 @@ void Assembler::selectKmers2(
     // can be used as markers..
     vector<KmerId> candidateKmers;
     for(uint64_t kmerId=0; kmerId<kmerTable.size(); kmerId++) {
-        if(kmerTable[kmerId].isRleKmer and selectKmers2Data.overenrichedReadCount[kmerId] == 0) {
+        if(kmerTable[kmerId].isRleKmer and selectKmers2Data.overenrichedReadCount[KmerId(kmerId)] == 0) {
             candidateKmers.push_back(KmerId(kmerId));
         }
     }
@@ -698,27 +876,17 @@ void Assembler::selectKmers2(
         " occurrences out of a total " << totalKmerOccurrences <<
         " in all oriented reads." << endl;
 
+    selectKmers2Data.globalFrequency.remove();
+    selectKmers2Data.overenrichedReadCount.remove();
 }
 
 
 
 void Assembler::selectKmers2ThreadFunction(size_t threadId)
 {
-    // Initialize globalFrequency for this thread.
-    MemoryMapped::Vector<uint64_t> globalFrequency;
-    globalFrequency.createNew(
-        largeDataName("tmp-SelectKmers2-GlobalFrequency-" + to_string(threadId)),
-        largeDataPageSize);
-    globalFrequency.resize(kmerTable.size());
-    fill(globalFrequency.begin(), globalFrequency.end(), 0);
-
-    // Initialize overenrichedReadCount for this thread.
-    MemoryMapped::Vector<ReadId> overenrichedReadCount;
-    overenrichedReadCount.createNew(
-        largeDataName("tmp-SelectKmers2-OverenrichedReadCount-" + to_string(threadId)),
-        largeDataPageSize);
-    overenrichedReadCount.resize(kmerTable.size());
-    fill(overenrichedReadCount.begin(), overenrichedReadCount.end(), 0);
+    // Buffers to add to globalFrequency and overenrichedReadCount.
+    KmerCounter::Buffer globalFrequency(selectKmers2Data.globalFrequency);
+    KmerCounter::Buffer overenrichedReadCount(selectKmers2Data.overenrichedReadCount);
 
     // Vectors to hold KmerIds and their frequencies for a single read.
     vector<KmerId> readKmerIds;
@@ -727,14 +895,9 @@ void Assembler::selectKmers2ThreadFunction(size_t threadId)
     // Access the enrichmentThreshold.
     const double enrichmentThreshold = selectKmers2Data.enrichmentThreshold;
 
-    // Compute the total number of RLE k-mers.
+    // The total number of RLE k-mers.
     // It is needed below for overenrichment computations.
-    uint64_t rleKmerCount = 0;
-    for(const KmerInfo& kmerInfo: kmerTable) {
-        if(kmerInfo.isRleKmer) {
-            ++rleKmerCount;
-        }
-    }
+    const uint64_t rleKmerCount = selectKmers2Data.rleKmerCount;
 
 
     // Loop over all batches assigned to this thread.
@@ -766,10 +929,7 @@ void Assembler::selectKmers2ThreadFunction(size_t threadId)
                 readKmerIds.push_back(kmerId);
 
                 // Increment its global frequency.
-                ++globalFrequency[kmerId];
-
-                // Also increment the frequency of the reverse complemented k-mer.
-                ++globalFrequency[kmerTable[kmerId].reverseComplementedKmerId];
+                globalFrequency.add(kmerId);
 
                 // Check if we reached the end of the read.
                 if(position+k == read.baseCount) {
@@ -796,24 +956,68 @@ void Assembler::selectKmers2ThreadFunction(size_t threadId)
                 const KmerId kmerId = readKmerIds[i];
                 const uint32_t frequency = readKmerIdFrequencies[i];
                 if(frequency > frequencyThreshold) {
-                    ++overenrichedReadCount[kmerId];
-                    ++overenrichedReadCount[kmerTable[kmerId].reverseComplementedKmerId];
+                    overenrichedReadCount.add(kmerId);
                 }
             }
         }
     }
 
 
-    // Add our globalFrequency and overenrichedReadCount
-    // to the values computer by the other threads.
-    {
-        std::lock_guard<std::mutex> lock(mutex);
-        for(uint64_t kmerId=0; kmerId!=globalFrequency.size(); kmerId++) {
-            selectKmers2Data.globalFrequency[kmerId] += globalFrequency[kmerId];
-            selectKmers2Data.overenrichedReadCount[kmerId] += overenrichedReadCount[kmerId];
-        }
-    }
-    globalFrequency.remove();
-    overenrichedReadCount.remove();
+    // Add what remains in our buffers
+    // to the values computed by the other threads.
+    globalFrequency.flush();
+    overenrichedReadCount.flush();
 }
 
+
+
+void Assembler::selectMinimizerKmers(uint64_t k, uint64_t minimizerWindow)
+{
+    if(minimizerWindow == 0) {
+        throw runtime_error("Invalid minimizer window " + to_string(minimizerWindow));
+    }
+    flagAllKmersAsMarkers(k);
+    assemblerInfo->markerSelectionMethod = 1;
+    assemblerInfo->minimizerWindow = minimizerWindow;
+    cout << "Markers will be window minimizers with a window of " <<
+        minimizerWindow << " " << k << "-mers." << endl;
+}
+
+
+
+void Assembler::selectSyncmerKmers(uint64_t k, uint64_t syncmerS)
+{
+    if(syncmerS == 0 or syncmerS >= k or ((k - syncmerS) % 2) != 0) {
+        throw runtime_error("Invalid syncmer s-mer length " + to_string(syncmerS) +
+            " for k = " + to_string(k) +
+            ". It must be less than k, and k-s must be even.");
+    }
+    flagAllKmersAsMarkers(k);
+    assemblerInfo->markerSelectionMethod = 2;
+    assemblerInfo->syncmerS = syncmerS;
+    cout << "Markers will be open syncmers with k = " << k <<
+        " and s = " << syncmerS << "." << endl;
+}
+
+
+
+void Assembler::flagAllKmersAsMarkers(uint64_t k)
+{
+    // Sanity check on the value of k, then store it.
+    if(k > Kmer::capacity) {
+        throw runtime_error("K-mer capacity exceeded.");
+    }
+    if(k > maxDenseKmerTableK) {
+        throw runtime_error("This k-mer generation method requires k <= " +
+            to_string(maxDenseKmerTableK) + ". Use random k-mer selection instead.");
+    }
+    assemblerInfo->k = k;
+
+    // Fill in the fields of the k-mer table
+    // that depends only on k.
+    initializeKmerTable();
+
+    for(KmerInfo& kmerInfo: kmerTable) {
+        kmerInfo.isMarker = true;
+    }
+}
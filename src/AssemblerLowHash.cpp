@@ -1,6 +1,8 @@
 #include "Assembler.hpp"
 #include "LowHash0.hpp"
 #include "LowHash1.hpp"
+#include "LowHashSketches.hpp"
+#include "StrobemerChaining.hpp"
 using namespace shasta;
 
 
@@ -19,6 +21,12 @@ void Assembler::findAlignmentCandidatesLowHash0(
     size_t minBucketSize,           // The minimum size for a bucket to be used.
     size_t maxBucketSize,           // The maximum size for a bucket to be used.
     size_t minFrequency,            // Minimum number of minHash hits for a pair to become a candidate.
+    size_t hashBatchSize,           // Number of iterations for which hashes are computed together.
+    size_t hashFamily,              // 0 = MurmurHash64A, 1 = multiply-xorshift.
+    bool noKmerIdsCopy,             // Get KmerIds from the markers instead of a copy.
+    bool sortBuckets,               // Use sorted buckets instead of log2MinHashBucketCount buckets.
+    bool storeSketches,             // Store the low hash sketches in the Data directory.
+    bool useStoredSketches,         // Use the stored low hash sketches instead of hashing.
     size_t threadCount)
 {
 
@@ -32,6 +40,11 @@ void Assembler::findAlignmentCandidatesLowHash0(
     alignmentCandidates.candidates.createNew(largeDataName("AlignmentCandidates"), largeDataPageSize);
     readLowHashStatistics.createNew(largeDataName("ReadLowHashStatistics"), largeDataPageSize);
 
+    // Create or access the low hash sketches, if requested.
+    LowHashSketches sketches;
+    prepareLowHashSketches(sketches, storeSketches, useStoredSketches,
+        m, hashFraction, hashFamily, false);
+
     // Run the LowHash computation to find candidate alignments.
     LowHash0 lowHash(
         m,
@@ -42,8 +55,13 @@ void Assembler::findAlignmentCandidatesLowHash0(
         minBucketSize,
         maxBucketSize,
         minFrequency,
+        hashBatchSize,
+        hashFamily,
+        noKmerIdsCopy,
+        sortBuckets,
+        storeSketches ? &sketches : 0,
+        useStoredSketches ? &sketches : 0,
         threadCount,
-        kmerTable,
         reads,
         markers,
         alignmentCandidates.candidates,
@@ -137,6 +155,11 @@ void Assembler::findAlignmentCandidatesLowHash1(
     size_t minBucketSize,           // The minimum size for a bucket to be used.
     size_t maxBucketSize,           // The maximum size for a bucket to be used.
     size_t minFrequency,            // Minimum number of minHash hits for a pair to become a candidate.
+    size_t hashBatchSize,           // Number of iterations for which hashes are computed together.
+    size_t hashFamily,              // 0 = MurmurHash64A, 1 = multiply-xorshift.
+    bool noKmerIdsCopy,             // Get KmerIds from the markers instead of a copy.
+    bool storeSketches,             // Store the low hash sketches in the Data directory.
+    bool useStoredSketches,         // Use the stored low hash sketches instead of hashing.
     size_t threadCount)
 {
     // Check that we have what we need.
@@ -151,6 +174,11 @@ void Assembler::findAlignmentCandidatesLowHash1(
     alignmentCandidates.featureOrdinals.createNew(
         largeDataName("AlignmentCandidatesFeatureOrdinale"), largeDataPageSize);
 
+    // Create or access the low hash sketches, if requested.
+    LowHashSketches sketches;
+    prepareLowHashSketches(sketches, storeSketches, useStoredSketches,
+        m, hashFraction, hashFamily, true);
+
     // Do the computation.
     LowHash1 lowHash1(
         m,
@@ -160,8 +188,12 @@ void Assembler::findAlignmentCandidatesLowHash1(
         minBucketSize,
         maxBucketSize,
         minFrequency,
+        hashBatchSize,
+        hashFamily,
+        noKmerIdsCopy,
+        storeSketches ? &sketches : 0,
+        useStoredSketches ? &sketches : 0,
         threadCount,
-        kmerTable,
         reads,
         markers,
         alignmentCandidates,
@@ -173,6 +205,78 @@ void Assembler::findAlignmentCandidatesLowHash1(
 
 
 
+// Find alignment candidates using marker strobemers
+// and diagonal-band chaining (--MinHash.version 2).
+// See StrobemerChaining.hpp for details.
+void Assembler::findAlignmentCandidatesStrobemerChaining(
+    size_t minOffset,               // Minimum ordinal offset of the second marker of a seed.
+    size_t maxOffset,               // Maximum ordinal offset of the second marker of a seed.
+    double seedFraction,            // Fraction of the seeds that are used.
+    size_t maxSeedFrequency,        // Seeds more frequent than this are ignored.
+    size_t chainBandWidth,          // Maximum diagonal difference between consecutive hits of a chain.
+    size_t minFrequency,            // Minimum number of hits in a chain for a pair to become a candidate.
+    size_t threadCount)
+{
+    // Check that we have what we need.
+    checkMarkersAreOpen();
+    const ReadId readCount = ReadId(markers.size() / 2);
+    SHASTA_ASSERT(readCount > 0);
+
+    // Prepare storage.
+    alignmentCandidates.candidates.createNew(
+        largeDataName("AlignmentCandidates"), largeDataPageSize);
+    alignmentCandidates.featureOrdinals.createNew(
+        largeDataName("AlignmentCandidatesFeatureOrdinale"), largeDataPageSize);
+
+    // Do the computation.
+    StrobemerChaining strobemerChaining(
+        minOffset,
+        maxOffset,
+        seedFraction,
+        maxSeedFrequency,
+        chainBandWidth,
+        minFrequency,
+        threadCount,
+        reads,
+        markers,
+        alignmentCandidates,
+        largeDataFileNamePrefix,
+        largeDataPageSize);
+
+    alignmentCandidates.unreserve();
+}
+
+
+
+// Create or access the LowHash sketches stored in the Data directory.
+// Storing them makes it possible to later regenerate the alignment
+// candidates with different thresholds without hashing again.
+void Assembler::prepareLowHashSketches(
+    LowHashSketches& sketches,
+    bool storeSketches,
+    bool useStoredSketches,
+    size_t m,
+    double hashFraction,
+    size_t hashFamily,
+    bool hasOrdinals)
+{
+    if(storeSketches and useStoredSketches) {
+        throw runtime_error("Cannot store LowHash sketches while using stored sketches.");
+    }
+    if(storeSketches) {
+        sketches.createNew(largeDataName("LowHashSketches"), largeDataPageSize,
+            m, hashFraction, hashFamily, markers.size(), hasOrdinals);
+    } else if(useStoredSketches) {
+        if(largeDataFileNamePrefix.empty()) {
+            throw runtime_error("Stored LowHash sketches are not available "
+                "with anonymous memory mode.");
+        }
+        sketches.accessExistingReadOnly(largeDataName("LowHashSketches"));
+    }
+}
+
+
+
 void Assembler::writeAlignmentCandidates() const
 {
 
@@ -497,7 +497,8 @@ void Assembler::createMarkerGraphVertices(
 void Assembler::createMarkerGraphVerticesThreadFunction1(size_t threadId)
 {
 
-    array<vector<MarkerWithOrdinal>, 2> markersSortedByKmerId;
+    array<vector<MarkerWithOrdinal>, 2> markersWorkArea;
+    array<span<const MarkerWithOrdinal>, 2> markersSortedByKmerId;
     AlignmentGraph graph;
     Alignment alignment;
     AlignmentInfo alignmentInfo;
@@ -606,7 +607,7 @@ void Assembler::createMarkerGraphVerticesThreadFunction1(size_t threadId)
                 // Compute the Alignment between these two oriented reads.
                 if(alignMethod == 0) {
                     for(size_t j=0; j<2; j++) {
-                        getMarkersSortedByKmerId(orientedReadIds[j], markersSortedByKmerId[j]);
+                        markersSortedByKmerId[j] = getSortedMarkers(orientedReadIds[j], markersWorkArea[j]);
                     }
                     alignOrientedReads(
                         markersSortedByKmerId,
@@ -636,7 +637,9 @@ void Assembler::createMarkerGraphVerticesThreadFunction1(size_t threadId)
                 const uint32_t ordinal1 = p[1];
                 const MarkerId markerId0 = getMarkerId(orientedReadIds[0], ordinal0);
                 const MarkerId markerId1 = getMarkerId(orientedReadIds[1], ordinal1);
-                SHASTA_ASSERT(markers.begin()[markerId0].kmerId == markers.begin()[markerId1].kmerId);
+                SHASTA_ASSERT(
+                    markers[orientedReadIds[0].getValue()][ordinal0].kmerId ==
+                    markers[orientedReadIds[1].getValue()][ordinal1].kmerId);
                 disjointSetsPointer->unite(markerId0, markerId1);
 
                 // Also merge the reverse complemented markers.
@@ -1645,10 +1648,10 @@ vector<Assembler::GlobalMarkerGraphEdgeInformation> Assembler::getGlobalMarkerGr
             info.ordinal1 = childInfo.ordinals[1];
 
             // Get the positions.
-            const MarkerId markerId0 = getMarkerId(childInfo.orientedReadId, info.ordinal0);
-            const MarkerId markerId1 = getMarkerId(childInfo.orientedReadId, info.ordinal1);
-            const auto& marker0 = markers.begin()[markerId0];
-            const auto& marker1 = markers.begin()[markerId1];
+            const OrientedReadMarkers orientedReadMarkers =
+                markers[childInfo.orientedReadId.getValue()];
+            const CompressedMarker marker0 = orientedReadMarkers[info.ordinal0];
+            const CompressedMarker marker1 = orientedReadMarkers[info.ordinal1];
             info.position0 = marker0.position;
             info.position1 = marker1.position;
 
@@ -3163,7 +3166,9 @@ void Assembler::computeMarkerGraphVertexConsensusSequence(
     markerPositions.reserve(markerIds.size());
     for(const MarkerId markerId: markerIds) {
         markerInfos.push_back(findMarkerId(markerId));
-        markerPositions.push_back(markers.begin()[markerId].position);
+        const auto& markerInfo = markerInfos.back();
+        markerPositions.push_back(
+            markers[markerInfo.first.getValue()][markerInfo.second].position);
     }
 
 
@@ -4456,7 +4461,9 @@ void Assembler::computeMarkerGraphVerticesCoverageDataThreadFunction(size_t thre
             markerPositions.clear();
             for(const MarkerId markerId: markerIds) {
                 markerInfos.push_back(findMarkerId(markerId));
-                markerPositions.push_back(markers.begin()[markerId].position);
+                const auto& markerInfo = markerInfos.back();
+                markerPositions.push_back(
+                    markers[markerInfo.first.getValue()][markerInfo.second].position);
             }
 
             // Loop over the k base positions in this vertex.
@@ -4879,7 +4886,9 @@ void Assembler::analyzeMarkerGraphVertex(MarkerGraph::VertexId vertexId) const
     SHASTA_ASSERT(markerCount > 0);
 
     // Get the marker sequence.
-    const KmerId kmerId = markers.begin()[markerIds[0]].kmerId;
+    // Markers::get locates the oriented read with a binary search,
+    // which is negligible for a single marker.
+    const KmerId kmerId = markers.get(markerIds[0]).kmerId;
     const size_t k = assemblerInfo->k;
     const Kmer kmer(kmerId, k);
 
@@ -2,8 +2,12 @@
 #include "Assembler.hpp"
 #include "findMarkerId.hpp"
 #include "MarkerFinder.hpp"
+#include "timestamp.hpp"
 using namespace shasta;
 
+// Standard library.
+#include "chrono.hpp"
+
 
 
 void Assembler::findMarkers(size_t threadCount)
@@ -15,9 +19,13 @@ void Assembler::findMarkers(size_t threadCount)
     MarkerFinder markerFinder(
         assemblerInfo->k,
         kmerTable,
+        sparseKmerTable,
         reads,
         markers,
-        threadCount);
+        threadCount,
+        assemblerInfo->markerSelectionMethod,
+        assemblerInfo->minimizerWindow,
+        assemblerInfo->syncmerS);
 
 }
 
@@ -28,6 +36,20 @@ void Assembler::accessMarkers()
     markers.accessExistingReadOnly(largeDataName("Markers"));
 }
 
+
+
+// Convert the markers to a compact representation
+// in which positions are stored as variable length deltas.
+void Assembler::compactMarkerPositions()
+{
+    checkMarkersAreOpen();
+    const uint64_t oldByteCount = markers.byteCount();
+    markers.compactPositions(largeDataName("Markers"), largeDataPageSize);
+    cout << timestamp << "Converted " << markers.totalSize() / 2 <<
+        " markers to compact representation. Memory for markers reduced from " <<
+        oldByteCount << " to " << markers.byteCount() << " bytes." << endl;
+}
+
 void Assembler::checkMarkersAreOpen() const
 {
     if(!markers.isOpen()) {
@@ -82,7 +104,9 @@ void Assembler::getMarkersSortedByKmerId(
     OrientedReadId orientedReadId,
     vector<MarkerWithOrdinal>& markersSortedByKmerId) const
 {
-    const auto compressedMarkers = markers[orientedReadId.getValue()];
+    // Decode all the markers at once.
+    vector<CompressedMarker> compressedMarkers;
+    markers[orientedReadId.getValue()].get(compressedMarkers);
     markersSortedByKmerId.clear();
     markersSortedByKmerId.resize(compressedMarkers.size());
 
@@ -97,13 +121,108 @@ void Assembler::getMarkersSortedByKmerId(
 
 
 
+// Return the markers sorted by KmerId for a given OrientedReadId.
+// If sortedMarkers is available, this returns a span into it
+// and the work area is not used. Otherwise the markers
+// are sorted in the work area.
+span<const MarkerWithOrdinal> Assembler::getSortedMarkers(
+    OrientedReadId orientedReadId,
+    vector<MarkerWithOrdinal>& workArea) const
+{
+    if(sortedMarkers.isOpen()) {
+        return sortedMarkers[orientedReadId.getValue()];
+    } else {
+        getMarkersSortedByKmerId(orientedReadId, workArea);
+        return span<const MarkerWithOrdinal>(workArea.data(), workArea.data() + workArea.size());
+    }
+}
+
+
+
+// Compute markers sorted by KmerId for all oriented reads
+// and store them in sortedMarkers, so the alignment code
+// does not have to recompute them for each alignment candidate.
+void Assembler::computeSortedMarkers(size_t threadCount)
+{
+    checkMarkersAreOpen();
+    const auto tBegin = steady_clock::now();
+    cout << timestamp << "Computing sorted markers." << endl;
+
+    // Adjust the numbers of threads, if necessary.
+    if(threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    // Each oriented read has the same number of sorted markers
+    // as it has markers.
+    const uint64_t orientedReadCount = markers.size();
+    sortedMarkers.createNew(largeDataName("SortedMarkers"), largeDataPageSize);
+    sortedMarkers.beginPass1(orientedReadCount);
+    for(uint64_t i=0; i<orientedReadCount; i++) {
+        sortedMarkers.incrementCount(i, markers.size(i));
+    }
+    sortedMarkers.beginPass2();
+    sortedMarkers.endPass2(false);
+
+    // Fill them in, in parallel.
+    setupLoadBalancing(orientedReadCount / 2, 1000);
+    runThreads(&Assembler::computeSortedMarkersThreadFunction, threadCount);
+
+    const auto tEnd = steady_clock::now();
+    const double tTotal = seconds(tEnd - tBegin);
+    cout << timestamp << "Computation of sorted markers completed in " << tTotal << " s." << endl;
+}
+
+
+
+void Assembler::computeSortedMarkersThreadFunction(size_t threadId)
+{
+    vector<MarkerWithOrdinal> markersSortedByKmerId;
+
+    // Loop over batches assigned to this thread.
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over reads assigned to this batch.
+        for(ReadId readId=ReadId(begin); readId!=ReadId(end); readId++) {
+            for(Strand strand=0; strand<2; strand++) {
+                const OrientedReadId orientedReadId(readId, strand);
+                getMarkersSortedByKmerId(orientedReadId, markersSortedByKmerId);
+                SHASTA_ASSERT(markersSortedByKmerId.size() == sortedMarkers.size(orientedReadId.getValue()));
+                copy(markersSortedByKmerId.begin(), markersSortedByKmerId.end(),
+                    sortedMarkers.begin(orientedReadId.getValue()));
+            }
+        }
+    }
+}
+
+
+
+void Assembler::accessSortedMarkers()
+{
+    sortedMarkers.accessExistingReadOnly(largeDataName("SortedMarkers"));
+}
+
+
+
+// The sorted markers are no longer needed once
+// marker graph vertices are created.
+void Assembler::removeSortedMarkers()
+{
+    if(sortedMarkers.isOpen()) {
+        sortedMarkers.remove();
+    }
+}
+
+
+
 // Given a marker by its OrientedReadId and ordinal,
 // return the corresponding global marker id.
 MarkerId Assembler::getMarkerId(
     OrientedReadId orientedReadId, uint32_t ordinal) const
 {
     return
-        (markers.begin(orientedReadId.getValue()) - markers.begin())
+        (markers.beginMarkerId(orientedReadId.getValue()))
         + ordinal;
 }
 
@@ -149,10 +268,17 @@ void Assembler::writeMarkerFrequency()
     SHASTA_ASSERT(markers.isOpen());
     vector<uint64_t> frequency(kmerCount, 0);
 
-    const CompressedMarker* compressedMarker = markers.begin();
-    const CompressedMarker* end = markers.end();
-    for(; compressedMarker!=end; ++compressedMarker) {
-        ++frequency[compressedMarker->kmerId];
+    // Only the markers on strand 0 are stored.
+    // Each also contributes its reverse complement on strand 1.
+    vector<KmerId> kmerIds;
+    for(ReadId readId=0; readId<reads.readCount(); readId++) {
+        const auto orientedReadMarkers = markers[OrientedReadId(readId, 0).getValue()];
+        kmerIds.resize(orientedReadMarkers.size());
+        orientedReadMarkers.getKmerIds(kmerIds.data());
+        for(const KmerId kmerId: kmerIds) {
+            ++frequency[kmerId];
+            ++frequency[OrientedReadMarkers::reverseComplement(kmerId, k)];
+        }
     }
 
     ofstream csv("MarkerFrequency.csv");
@@ -128,7 +128,14 @@ void AssemblerOptions::addCommandLineOnlyOptions()
         value<string>(&commandLineOnlyOptions.command)->
         default_value("assemble"),
         "Command to run. Must be one of: "
-        "assemble, saveBinaryData, cleanupBinaryData, explore, createBashCompletionScript")
+        "assemble, saveBinaryData, cleanupBinaryData, explore, createBashCompletionScript, "
+        "createReadArchive, regenerateAlignmentCandidates")
+
+        ("readArchive",
+        value<string>(&commandLineOnlyOptions.readArchiveFileName)->
+        default_value("Reads.shastaReads"),
+        "Name of the read archive created by command createReadArchive. "
+        "Must have extension .shastaReads.")
 
 #ifdef __linux__
         ("memoryMode",
@@ -208,6 +215,45 @@ void AssemblerOptions::addConfigurableOptions()
         "This is done by specifying the O_DIRECT flag when opening "
         "input files containing reads.")
 
+        ("Reads.streamingMemoryBudget",
+        value<int>(&readsOptions.streamingMemoryBudget)->
+        default_value(0),
+        "If not zero, input files are processed in streaming mode, "
+        "using at most this amount of memory (in MB) for input buffers. "
+        "Reading of the input file is then overlapped with parsing. "
+        "If zero, each uncompressed input file is read entirely into memory before parsing. "
+        "Compressed input files are always processed in streaming mode, "
+        "using 1024 MB if this is zero.")
+
+        ("Reads.concurrentFileCount",
+        value<int>(&readsOptions.concurrentFileCount)->
+        default_value(1),
+        "The maximum number of input files processed concurrently. "
+        "If 1, input files are processed one at a time. "
+        "If 0, as many files as the number of threads are processed concurrently. "
+        "Processing files concurrently is faster when there are many input files, "
+        "but uses more memory.")
+
+        ("Reads.genomeSize",
+        value<double>(&readsOptions.genomeSize)->
+        default_value(0.),
+        "The expected genome size, in bases. "
+        "Only used if Reads.desiredCoverage is not zero.")
+
+        ("Reads.desiredCoverage",
+        value<double>(&readsOptions.desiredCoverage)->
+        default_value(0.),
+        "If not zero, only the longest reads are kept, "
+        "up to this coverage of a genome of size Reads.genomeSize. "
+        "The remaining reads are discarded on input.")
+
+        ("Reads.compactRepeatCounts",
+        bool_switch(&readsOptions.compactRepeatCounts)->
+        default_value(false),
+        "If set, after loading the reads their repeat counts are stored "
+        "using a little over 2 bits per base instead of 8. "
+        "This reduces memory usage at a small performance cost.")
+
         ("Reads.palindromicReads.skipFlagging",
         bool_switch(&readsOptions.palindromicReads.skipFlagging)->
         default_value(false),
@@ -250,12 +296,16 @@ void AssemblerOptions::addConfigurableOptions()
          "0 = random, "
          "1 = random, excluding globally overenriched,"
          "2 = random, excluding overenriched even in a single read,"
-         "3 = read from file.")
+         "3 = read from file,"
+         "4 = window minimizers,"
+         "5 = open syncmers.")
 
          ("Kmers.k",
          value<int>(&kmersOptions.k)->
          default_value(10),
-         "Length of marker k-mers (in run-length space).")
+         "Length of marker k-mers (in run-length space). "
+         "Values greater than 16 require generation method 0 "
+         "and a build with BUILD_LONG_KMERS.")
 
          ("Kmers.probability",
          value<double>(&kmersOptions.probability)->
@@ -274,11 +324,37 @@ void AssemblerOptions::addConfigurableOptions()
         "A relative path is not accepted. "
         "Only used if Kmers.generationMethod is 3.")
 
+        ("Kmers.minimizerWindow",
+        value<int>(&kmersOptions.minimizerWindow)->
+        default_value(19),
+        "The number of consecutive k-mers in each minimizer window. "
+        "Only used if Kmers.generationMethod is 4.")
+
+        ("Kmers.syncmerS",
+        value<int>(&kmersOptions.syncmerS)->
+        default_value(4),
+        "The length of the s-mers used to define open syncmers. "
+        "k-s must be even. "
+        "Only used if Kmers.generationMethod is 5.")
+
+        ("Kmers.compactMarkerPositions",
+        bool_switch(&kmersOptions.compactMarkerPositions)->
+        default_value(false),
+        "If set, after markers are found their positions are stored "
+        "as variable length deltas instead of 3 bytes per marker. "
+        "This reduces memory usage at a small performance cost.")
+
+        ("Kmers.cacheDirectory",
+        value<string>(&kmersOptions.cacheDirectory),
+        "If not empty, the k-mer table and markers are saved to "
+        "this directory, and reused by later runs with the same reads "
+        "and the same Kmers options.")
+
         ("MinHash.version",
         value<int>(&minHashOptions.version)->
         default_value(0),
-        "Controls the version of the LowHash algorithm to use. Can be 0 (default) "
-        "or 1.(experimental).")
+        "Controls the version of the LowHash algorithm to use. Can be 0 (default), "
+        "1 (experimental), or 2 (experimental, strobemer seeds with chaining).")
 
         ("MinHash.m",
         value<int>(&minHashOptions.m)->
@@ -304,6 +380,13 @@ void AssemblerOptions::addConfigurableOptions()
         "reaches this value. If --MinHash.minHashIterationCount is not 0, "
         "this is not used.")
 
+        ("MinHash.log2MinHashBucketCount",
+        value<int>(&minHashOptions.log2MinHashBucketCount)->
+        default_value(0),
+        "For --MinHash.version 0 and 1, the base 2 log of the number of buckets "
+        "used by the MinHash/LowHash algorithm, or 0 to choose it automatically "
+        "based on the number of markers.")
+
         ("MinHash.minBucketSize",
         value<int>(&minHashOptions.minBucketSize)->
         default_value(0),
@@ -320,6 +403,73 @@ void AssemblerOptions::addConfigurableOptions()
         "The minimum number of times a pair of reads must be found by the MinHash/LowHash algorithm "
         "in order to be considered a candidate alignment.")
 
+        ("MinHash.hashBatchSize",
+        value<int>(&minHashOptions.hashBatchSize)->
+        default_value(1),
+        "The number of MinHash/LowHash iterations for which feature hashes "
+        "are computed together, in a single pass over the markers. "
+        "Must be between 1 and 16. Larger values are faster "
+        "but use more memory to store the low hashes.")
+
+        ("MinHash.hashFamily",
+        value<int>(&minHashOptions.hashFamily)->
+        default_value(0),
+        "The hash functions used to hash MinHash/LowHash features: "
+        "0 = MurmurHash64A, 1 = multiply-xorshift (faster).")
+
+        ("MinHash.noKmerIdsCopy",
+        bool_switch(&minHashOptions.noKmerIdsCopy)->
+        default_value(false),
+        "For --MinHash.version 0 and 1, compute feature hashes from k-mer ids "
+        "read from the markers, instead of from a temporary copy of the k-mer ids "
+        "of all oriented reads. This saves 4 bytes per marker on each strand, "
+        "but hashing is slower.")
+
+        ("MinHash.sortBuckets",
+        bool_switch(&minHashOptions.sortBuckets)->
+        default_value(false),
+        "For --MinHash.version 0, build the LowHash buckets by sorting "
+        "the low hashes instead of using 2^log2MinHashBucketCount buckets. "
+        "This uses mostly sequential memory access and avoids hash collisions.")
+
+        ("MinHash.storeSketches",
+        bool_switch(&minHashOptions.storeSketches)->
+        default_value(false),
+        "Store the LowHash sketches in the Data directory, so alignment candidates "
+        "can later be regenerated with different thresholds using "
+        "--command regenerateAlignmentCandidates.")
+
+        ("MinHash.strobemerMinOffset",
+        value<int>(&minHashOptions.strobemerMinOffset)->
+        default_value(2),
+        "For --MinHash.version 2, the minimum ordinal offset of the second "
+        "marker of a strobemer seed.")
+
+        ("MinHash.strobemerMaxOffset",
+        value<int>(&minHashOptions.strobemerMaxOffset)->
+        default_value(8),
+        "For --MinHash.version 2, the maximum ordinal offset of the second "
+        "marker of a strobemer seed.")
+
+        ("MinHash.seedFraction",
+        value<double>(&minHashOptions.seedFraction)->
+        default_value(0.2, "0.2"),
+        "For --MinHash.version 2, the fraction of strobemer seeds that are used.")
+
+        ("MinHash.maxSeedFrequency",
+        value<int>(&minHashOptions.maxSeedFrequency)->
+        default_value(100),
+        "For --MinHash.version 2, strobemer seeds that occur more than "
+        "this number of times are ignored.")
+
+        ("MinHash.chainBandWidth",
+        value<int>(&minHashOptions.chainBandWidth)->
+        default_value(10),
+        "For --MinHash.version 2, the maximum difference in diagonal "
+        "(in markers) between consecutive seed hits of a chain. "
+        "A pair of reads becomes an alignment candidate if its largest chain "
+        "contains at least --MinHash.minFrequency hits.")
+
         ("MinHash.allPairs",
         bool_switch(&minHashOptions.allPairs)->
         default_value(false),
@@ -418,6 +568,14 @@ void AssemblerOptions::addConfigurableOptions()
         "one read is entirely contained in another read, "
         "except possibly for up to maxTrim markers at the beginning and end.")
 
+        ("Align.storeSortedMarkers",
+        bool_switch(&alignOptions.storeSortedMarkers)->
+        default_value(false),
+        "If set, the markers of each oriented read sorted by k-mer id "
+        "are computed once and stored, instead of being recomputed for "
+        "each alignment. This is faster but uses more memory. "
+        "Only used if Align.alignMethod is 0.")
+
         ("ReadGraph.creationMethod",
         value<int>(&readGraphOptions.creationMethod)->
         default_value(0),
@@ -596,6 +754,12 @@ void AssemblerOptions::ReadsOptions::write(ostream& s) const
     s << "minReadLength = " << minReadLength << "\n";
     s << "noCache = " <<
         convertBoolToPythonString(noCache) << "\n";
+    s << "streamingMemoryBudget = " << streamingMemoryBudget << "\n";
+    s << "concurrentFileCount = " << concurrentFileCount << "\n";
+    s << "genomeSize = " << genomeSize << "\n";
+    s << "desiredCoverage = " << desiredCoverage << "\n";
+    s << "compactRepeatCounts = " <<
+        convertBoolToPythonString(compactRepeatCounts) << "\n";
     palindromicReads.write(s);
 }
 
@@ -609,6 +773,11 @@ void AssemblerOptions::KmersOptions::write(ostream& s) const
     s << "probability = " << probability << "\n";
     s << "enrichmentThreshold = " << enrichmentThreshold << "\n";
     s << "file = " << file << "\n";
+    s << "minimizerWindow = " << minimizerWindow << "\n";
+    s << "syncmerS = " << syncmerS << "\n";
+    s << "compactMarkerPositions = " <<
+        convertBoolToPythonString(compactMarkerPositions) << "\n";
+    s << "cacheDirectory = " << cacheDirectory << "\n";
 }
 
 
@@ -621,9 +790,23 @@ void AssemblerOptions::MinHashOptions::write(ostream& s) const
     s << "hashFraction = " << hashFraction << "\n";
     s << "minHashIterationCount = " << minHashIterationCount << "\n";
     s << "alignmentCandidatesPerRead = " << alignmentCandidatesPerRead << "\n";
+    s << "log2MinHashBucketCount = " << log2MinHashBucketCount << "\n";
     s << "minBucketSize = " << minBucketSize << "\n";
     s << "maxBucketSize = " << maxBucketSize << "\n";
     s << "minFrequency = " << minFrequency << "\n";
+    s << "hashBatchSize = " << hashBatchSize << "\n";
+    s << "hashFamily = " << hashFamily << "\n";
+    s << "noKmerIdsCopy = " <<
+        convertBoolToPythonString(noKmerIdsCopy) << "\n";
+    s << "sortBuckets = " <<
+        convertBoolToPythonString(sortBuckets) << "\n";
+    s << "storeSketches = " <<
+        convertBoolToPythonString(storeSketches) << "\n";
+    s << "strobemerMinOffset = " << strobemerMinOffset << "\n";
+    s << "strobemerMaxOffset = " << strobemerMaxOffset << "\n";
+    s << "seedFraction = " << seedFraction << "\n";
+    s << "maxSeedFrequency = " << maxSeedFrequency << "\n";
+    s << "chainBandWidth = " << chainBandWidth << "\n";
     s << "allPairs = " <<
         convertBoolToPythonString(allPairs) << "\n";
 }
@@ -650,6 +833,8 @@ void AssemblerOptions::AlignOptions::write(ostream& s) const
         sameChannelReadAlignmentSuppressDeltaThreshold << "\n";
     s << "suppressContainments = " <<
         convertBoolToPythonString(suppressContainments) << "\n";
+    s << "storeSortedMarkers = " <<
+        convertBoolToPythonString(storeSortedMarkers) << "\n";
 }
 
 
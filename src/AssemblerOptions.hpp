@@ -87,6 +87,7 @@ public:
         vector <string> inputFileNames;
         string assemblyDirectory;
         string command;
+        string readArchiveFileName;
         string memoryMode;
         string memoryBacking;
         uint32_t threadCount;
@@ -106,6 +107,11 @@ public:
     public:
         int minReadLength;
         bool noCache;
+        int streamingMemoryBudget;
+        int concurrentFileCount;
+        double genomeSize;
+        double desiredCoverage;
+        bool compactRepeatCounts;
         class PalindromicReadOptions {
         public:
             bool skipFlagging;
@@ -135,6 +141,10 @@ public:
         double probability;
         double enrichmentThreshold;
         string file;
+        int minimizerWindow;
+        int syncmerS;
+        bool compactMarkerPositions;
+        string cacheDirectory;
         void write(ostream&) const;
     };
     KmersOptions kmersOptions;
@@ -151,9 +161,20 @@ public:
         double hashFraction;
         int minHashIterationCount;
         double alignmentCandidatesPerRead;
+        int log2MinHashBucketCount;
         int minBucketSize;
         int maxBucketSize;
         int minFrequency;
+        int hashBatchSize;
+        int hashFamily;
+        bool noKmerIdsCopy;
+        bool sortBuckets;
+        bool storeSketches;
+        int strobemerMinOffset;
+        int strobemerMaxOffset;
+        double seedFraction;
+        int maxSeedFrequency;
+        int chainBandWidth;
         bool allPairs;
         void write(ostream&) const;
     };
@@ -181,6 +202,7 @@ public:
         int maxBand;
         int sameChannelReadAlignmentSuppressDeltaThreshold;
         bool suppressContainments;
+        bool storeSortedMarkers;
         void write(ostream&) const;
     };
     AlignOptions alignOptions;
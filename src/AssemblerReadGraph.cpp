@@ -753,6 +753,7 @@ void Assembler::writeLocalReadGraphReads(
     // Write the fasta file.
     const string fileName = "LocalReadGraph.fasta";
     ofstream fasta(fileName);
+    vector<uint8_t> counts;
     for(const ReadId readId: readsSet) {
 
         // Write the header line with the read name.
@@ -768,7 +769,7 @@ void Assembler::writeLocalReadGraphReads(
 
         // Write the sequence.
         const auto& sequence = reads.getRead(readId);
-        const auto& counts = reads.getReadRepeatCounts(readId);
+        reads.getReadRepeatCounts(readId, counts);
         const size_t n = sequence.baseCount;
         SHASTA_ASSERT(counts.size() == n);
         for(size_t i=0; i<n; i++) {
@@ -107,7 +107,7 @@ void Assembler::createReadGraph2LowLevel(ReadId readId0)
         Sequence& sequence = sequences[sequenceId];
         const OrientedReadId orientedReadId1 = alignments[sequenceId].orientedReadId;
         orientedReadIds[sequenceId] = orientedReadId1;
-        const span<CompressedMarker> markers1 = markers[orientedReadId1.getValue()];
+        const OrientedReadMarkers markers1 = markers[orientedReadId1.getValue()];
         const Alignment& alignment = alignments[sequenceId].alignment;
         const uint32_t first1 = alignment.ordinals.front()[1];
         firstOrdinals[sequenceId] = first1;
@@ -123,7 +123,7 @@ void Assembler::createReadGraph2LowLevel(ReadId readId0)
     Sequence& sequence0 = sequences.back();
     const SequenceId sequenceId0 = sequences.size() - 1;
     orientedReadIds.back() = orientedReadId0;
-    const span<CompressedMarker> markers0 = markers[orientedReadId0.getValue()];
+    const OrientedReadMarkers markers0 = markers[orientedReadId0.getValue()];
     const uint64_t markerCount0 = markers0.size();
     firstOrdinals.back() = 0;
     lastOrdinals.back() = uint32_t(markers0.size() - 1);
@@ -1,5 +1,7 @@
 // Shasta.
 #include "Assembler.hpp"
+#include "MultiFileReadLoader.hpp"
+#include "ReadArchive.hpp"
 #include "ReadLoader.hpp"
 using namespace shasta;
 
@@ -14,15 +16,33 @@ void Assembler::addReads(
     const string& fileName,
     uint64_t minReadLength,
     bool noCache,
+    uint64_t streamingMemoryBudget,
+    const size_t threadCount)
+{
+    addReadsFromOneFile(fileName, minReadLength, noCache, streamingMemoryBudget, threadCount);
+    computeReadNameIndex();
+    parseReadMetaData();
+}
+
+
+
+// Same as above, but does not update the read name index.
+void Assembler::addReadsFromOneFile(
+    const string& fileName,
+    uint64_t minReadLength,
+    bool noCache,
+    uint64_t streamingMemoryBudget,
     const size_t threadCount)
 {
     reads.checkReadsAreOpen();
     reads.checkReadNamesAreOpen();
+    reads.checkRepeatCountsAreNotCompact();
 
     ReadLoader readLoader(
         fileName,
         minReadLength,
         noCache,
+        streamingMemoryBudget,
         threadCount,
         largeDataFileNamePrefix,
         largeDataPageSize,
@@ -51,6 +71,149 @@ void Assembler::addReads(
 }
 
 
+
+// Add reads from multiple files.
+// If only one file is processed at a time, this is the same
+// as calling addReads for each file.
+void Assembler::addReads(
+    const vector<string>& fileNames,
+    uint64_t minReadLength,
+    bool noCache,
+    uint64_t streamingMemoryBudget,
+    uint64_t concurrentFileCount,
+    size_t threadCount)
+{
+    if(concurrentFileCount == 1 or fileNames.size() < 2) {
+        for(const string& fileName: fileNames) {
+            addReadsFromOneFile(fileName, minReadLength, noCache, streamingMemoryBudget, threadCount);
+        }
+        computeReadNameIndex();
+        parseReadMetaData();
+        return;
+    }
+
+    reads.checkReadsAreOpen();
+    reads.checkReadNamesAreOpen();
+    reads.checkRepeatCountsAreNotCompact();
+
+    MultiFileReadLoader readLoader(
+        fileNames,
+        minReadLength,
+        noCache,
+        streamingMemoryBudget,
+        concurrentFileCount,
+        threadCount,
+        largeDataFileNamePrefix,
+        largeDataPageSize,
+        reads);
+
+    reads.checkSanity();
+
+    for(const MultiFileReadLoader::FileInfo& fileInfo: readLoader.fileInfos) {
+        cout << "Discarded read statistics for file " << fileInfo.fileName << ":" << endl;
+        cout << "    Discarded " << fileInfo.discardedInvalidBaseReadCount <<
+            " reads containing invalid bases for a total " <<
+            fileInfo.discardedInvalidBaseBaseCount << " valid bases." << endl;
+        cout << "    Discarded " << fileInfo.discardedShortReadReadCount <<
+            " reads shorter than " << minReadLength <<
+            " bases for a total " << fileInfo.discardedShortReadBaseCount << " bases." << endl;
+        cout << "    Discarded " << fileInfo.discardedBadRepeatCountReadCount <<
+            " reads containing repeat counts 256 or more" <<
+            " for a total " << fileInfo.discardedBadRepeatCountBaseCount << " bases." << endl;
+
+        // Increment the discarded reads statistics.
+        assemblerInfo->discardedInvalidBaseReadCount += fileInfo.discardedInvalidBaseReadCount;
+        assemblerInfo->discardedInvalidBaseBaseCount += fileInfo.discardedInvalidBaseBaseCount;
+        assemblerInfo->discardedShortReadReadCount += fileInfo.discardedShortReadReadCount;
+        assemblerInfo->discardedShortReadBaseCount += fileInfo.discardedShortReadBaseCount;
+        assemblerInfo->discardedBadRepeatCountReadCount += fileInfo.discardedBadRepeatCountReadCount;
+        assemblerInfo->discardedBadRepeatCountBaseCount += fileInfo.discardedBadRepeatCountBaseCount;
+    }
+
+    computeReadNameIndex();
+    parseReadMetaData();
+}
+
+
+
+// Create the hash index used to find a read given its name.
+// This is called automatically by addReads.
+void Assembler::computeReadNameIndex()
+{
+    reads.computeReadNameIndex(largeDataName("ReadNameIndex"), largeDataPageSize);
+}
+
+
+
+// Parse the read meta data fields used by suppressAlignment.
+// This is called automatically by addReads.
+void Assembler::parseReadMetaData()
+{
+    reads.parseReadMetaData(largeDataName("ParsedReadMetaData"), largeDataPageSize);
+}
+
+
+
+// Return the ReadId of the read with a given name, or invalidReadId
+// if no read with that name exists.
+ReadId Assembler::getReadId(const string& readName) const
+{
+    return reads.getReadId(readName);
+}
+
+
+// Write all reads to a read archive, which can later
+// be used as an input file in place of the original input files.
+void Assembler::createReadArchive(const string& fileName, size_t threadCount)
+{
+    reads.checkReadsAreOpen();
+    reads.checkReadNamesAreOpen();
+    reads.checkReadMetaDataAreOpen();
+
+    ReadArchive readArchive;
+    readArchive.create(reads, fileName, threadCount);
+}
+
+
+
+// Keep only the longest reads needed to reach the desired coverage,
+// given the expected genome size.
+void Assembler::selectReadsForCoverage(double genomeSize, double desiredCoverage)
+{
+    const uint64_t targetBaseCount = uint64_t(genomeSize * desiredCoverage);
+    uint64_t discardedReadCount;
+    uint64_t discardedBaseCount;
+    const uint64_t lengthCutoff =
+        reads.keepLongestReads(targetBaseCount, discardedReadCount, discardedBaseCount);
+
+    cout << "Selecting reads for a coverage of " << desiredCoverage <<
+        " on a genome of size " << genomeSize << "." << endl;
+    cout << "    Kept " << reads.readCount() << " reads of length " <<
+        lengthCutoff << " or more." << endl;
+    cout << "    Discarded " << discardedReadCount <<
+        " reads not needed for the desired coverage for a total " <<
+        discardedBaseCount << " bases." << endl;
+
+    assemblerInfo->discardedExcessCoverageReadCount += discardedReadCount;
+    assemblerInfo->discardedExcessCoverageBaseCount += discardedBaseCount;
+}
+
+
+
+// Convert the read repeat counts to a compact representation
+// that uses a little over 2 bits per base instead of 8.
+// This must be called after all reads are added.
+void Assembler::compactRepeatCounts()
+{
+    reads.checkReadsAreOpen();
+    const uint64_t oldSize = reads.getRepeatCountsTotalSize();
+    reads.compactRepeatCounts(largeDataName("CompactReadRepeatCounts"), largeDataPageSize);
+    cout << timestamp << "Converted " << oldSize <<
+        " read repeat counts to compact representation." << endl;
+}
+
+
+
 // Create a histogram of read lengths.
 // All lengths here are raw sequence lengths
 // (length of the original read), not lengths
@@ -69,6 +232,9 @@ void Assembler::histogramReadLength(const string& fileName)
     cout << "    Discarded " << assemblerInfo->discardedBadRepeatCountReadCount <<
         " reads containing repeat counts 256 or more" <<
         " for a total " << assemblerInfo->discardedBadRepeatCountBaseCount << " bases." << endl;
+    cout << "    Discarded " << assemblerInfo->discardedExcessCoverageReadCount <<
+        " reads not needed for the desired coverage" <<
+        " for a total " << assemblerInfo->discardedExcessCoverageBaseCount << " bases." << endl;
 
     cout << "Read statistics for reads that will be used in this assembly:" << endl;
     cout << "    Total number of reads is " << reads.readCount() << "." << endl;
@@ -77,8 +243,8 @@ void Assembler::histogramReadLength(const string& fileName)
     cout << " bases." << endl;
     cout << "    N50 for read length is " << reads.getN50() << " bases." << endl;
     cout << "    The above statistics only include reads that will be used in this assembly." << endl;
-    cout << "    Read discarded because they contained invalid bases, were too short or contained repeat counts 256"
-        " or more are not counted." << endl;
+    cout << "    Read discarded because they contained invalid bases, were too short, contained repeat counts 256"
+        " or more, or were not needed for the desired coverage are not counted." << endl;
 
     // Store read statistics in AssemblerInfo.
     assemblerInfo->readCount = reads.readCount();
@@ -120,11 +286,7 @@ void Assembler::writeReadsSummary()
         csv << ",";
 
         // Number of raw bases.
-        const auto repeatCounts = reads.getReadRepeatCounts(readId);
-        uint64_t rawBaseCount = 0;
-        for(const auto repeatCount: repeatCounts) {
-            rawBaseCount += repeatCount;
-        }
+        const uint64_t rawBaseCount = reads.getReadRawSequenceLength(readId);
         csv << rawBaseCount << ",";
 
         // Number of RLE bases.
@@ -0,0 +1,233 @@
+// Cache of k-mers and markers across runs.
+// When running repeatedly on the same reads with the same
+// Kmers options (for example to explore options that control
+// later phases of the assembly), the k-mer table and the markers
+// are the same for all runs. If a cache directory is specified,
+// they are saved to a subdirectory named using a fingerprint
+// of the reads and of the options, and later runs with the
+// same fingerprint reuse them instead of recomputing them.
+// The fingerprint is computed from the reads after they are loaded,
+// so it also reflects options that control which reads are used.
+// Files are restored as hard links if possible, so the cached files
+// should not be modified. If a hard link cannot be created
+// (for example because the Data directory is on the huge page
+// filesystem), files are copied with mappedCopy.
+
+// Shasta.
+#include "Assembler.hpp"
+#include "filesystem.hpp"
+#include "mappedCopy.hpp"
+#include "MurmurHash2.hpp"
+#include "timestamp.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "fstream.hpp"
+#include <iomanip>
+#include <sstream>
+
+// Linux.
+#include <unistd.h>
+
+
+
+// Return a fingerprint of the reads and of a string
+// describing the options that control k-mers and markers.
+string Assembler::computeKmersAndMarkersFingerprint(
+    const string& options,
+    size_t threadCount)
+{
+    reads.checkReadsAreOpen();
+    if(threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    // The contribution of the reads.
+    readsFingerprint = 0;
+    setupLoadBalancing(reads.readCount(), 1000);
+    runThreads(&Assembler::computeReadsFingerprintThreadFunction, threadCount);
+
+    // The contribution of the options.
+    // Also include the KmerId size, which depends on the build.
+    const string description = options + " KmerId size " + to_string(sizeof(KmerId));
+    const uint64_t fingerprint = MurmurHash64A(
+        description.data(), int(description.size()), readsFingerprint);
+
+    std::ostringstream s;
+    s << std::hex << std::setw(16) << std::setfill('0') << fingerprint;
+    return s.str();
+}
+
+
+
+void Assembler::computeReadsFingerprintThreadFunction(size_t threadId)
+{
+    // Each read contributes a hash of its bases, seeded with its ReadId.
+    // The contributions are summed, so the result does not depend
+    // on how reads are assigned to threads.
+    uint64_t fingerprint = 0;
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+        for(ReadId readId=ReadId(begin); readId!=ReadId(end); readId++) {
+            const LongBaseSequenceView read = reads.getRead(readId);
+
+            // Bases are stored in two bit planes, using two 64-bit words
+            // for each block of 64 bases. Hash the complete blocks,
+            // then the last block with its unused bits cleared.
+            const uint64_t fullBlockCount = read.baseCount / 64;
+            const uint64_t remainder = read.baseCount % 64;
+            uint64_t hash = MurmurHash64A(read.begin,
+                int(2 * fullBlockCount * sizeof(uint64_t)),
+                (uint64_t(readId) << 32) ^ read.baseCount);
+            if(remainder) {
+                const uint64_t mask = ~((1ULL << (64 - remainder)) - 1ULL);
+                const uint64_t lastBlock[2] = {
+                    read.begin[2 * fullBlockCount] & mask,
+                    read.begin[2 * fullBlockCount + 1] & mask};
+                hash = MurmurHash64A(lastBlock, int(sizeof(lastBlock)), hash);
+            }
+            fingerprint += hash;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    readsFingerprint += fingerprint;
+}
+
+
+
+// Return the names, without the large data prefix,
+// of the files in the Data directory that store the k-mer table
+// and the markers.
+vector<string> Assembler::kmersAndMarkersFileNames() const
+{
+    const uint64_t slashPosition = largeDataFileNamePrefix.find_last_of('/');
+    const string directory = (slashPosition == string::npos) ?
+        "." : largeDataFileNamePrefix.substr(0, slashPosition);
+    const string namePrefix = (slashPosition == string::npos) ?
+        largeDataFileNamePrefix : largeDataFileNamePrefix.substr(slashPosition + 1);
+
+    vector<string> fileNames;
+    for(const string& path: filesystem::directoryContents(directory)) {
+        const string fileName = filesystem::fileName(path);
+        if(fileName.substr(0, namePrefix.size()) != namePrefix) {
+            continue;
+        }
+        const string name = fileName.substr(namePrefix.size());
+        if(
+            name == "Kmers" or
+            name.substr(0, 12) == "SparseKmers-" or
+            name.substr(0, 7) == "Markers") {
+            fileNames.push_back(name);
+        }
+    }
+    return fileNames;
+}
+
+
+
+// If the cache contains k-mers and markers with the given fingerprint,
+// make them available to this run and return true.
+bool Assembler::restoreKmersAndMarkersFromCache(
+    const string& cacheDirectory,
+    const string& fingerprint)
+{
+    if(largeDataFileNamePrefix.empty()) {
+        cout << "The k-mer and marker cache cannot be used "
+            "with anonymous memory mode." << endl;
+        return false;
+    }
+
+    const string directory = cacheDirectory + "/" + fingerprint;
+    const string infoFileName = directory + "/Info";
+    if(not filesystem::isRegularFile(infoFileName)) {
+        cout << "K-mers and markers with fingerprint " << fingerprint <<
+            " were not found in cache directory " << cacheDirectory << endl;
+        return false;
+    }
+    cout << timestamp << "Reusing k-mers and markers with fingerprint " <<
+        fingerprint << " from cache directory " << cacheDirectory << endl;
+
+    // Read the information that is normally stored when selecting k-mers.
+    ifstream info(infoFileName);
+    info >>
+        assemblerInfo->k >>
+        assemblerInfo->markerSelectionMethod >>
+        assemblerInfo->minimizerWindow >>
+        assemblerInfo->syncmerS;
+    if(not info) {
+        throw runtime_error("Error reading " + infoFileName);
+    }
+
+    // Hard link or copy the files to the Data directory.
+    for(const string& path: filesystem::directoryContents(directory)) {
+        const string name = filesystem::fileName(path);
+        if(name == "Info") {
+            continue;
+        }
+        const string dataPath = largeDataFileNamePrefix + name;
+        if(filesystem::exists(dataPath)) {
+            filesystem::remove(dataPath);
+        }
+        if(::link(path.c_str(), dataPath.c_str()) != 0) {
+            mappedCopy(path, dataPath);
+        }
+    }
+
+    accessKmers();
+    accessMarkers();
+    cout << timestamp << "Reused " << markers.totalSize() <<
+        " markers for " << markers.size() << " oriented reads." << endl;
+    return true;
+}
+
+
+
+void Assembler::saveKmersAndMarkersToCache(
+    const string& cacheDirectory,
+    const string& fingerprint) const
+{
+    if(largeDataFileNamePrefix.empty()) {
+        cout << "The k-mer and marker cache cannot be used "
+            "with anonymous memory mode." << endl;
+        return;
+    }
+    checkKmersAreOpen();
+    checkMarkersAreOpen();
+
+    // If another run already saved this fingerprint, do nothing.
+    const string directory = cacheDirectory + "/" + fingerprint;
+    if(filesystem::exists(directory)) {
+        return;
+    }
+    if(not filesystem::exists(cacheDirectory)) {
+        filesystem::createDirectory(cacheDirectory);
+    }
+    cout << timestamp << "Saving k-mers and markers with fingerprint " <<
+        fingerprint << " to cache directory " << cacheDirectory << endl;
+
+    // Write to a temporary directory, then rename it,
+    // so concurrent runs never see a partially written entry.
+    const string temporaryDirectory = directory + "-tmp-" + to_string(::getpid());
+    filesystem::createDirectory(temporaryDirectory);
+    for(const string& name: kmersAndMarkersFileNames()) {
+        mappedCopy(largeDataFileNamePrefix + name, temporaryDirectory + "/" + name);
+    }
+    {
+        ofstream info(temporaryDirectory + "/Info");
+        info <<
+            assemblerInfo->k << " " <<
+            assemblerInfo->markerSelectionMethod << " " <<
+            assemblerInfo->minimizerWindow << " " <<
+            assemblerInfo->syncmerS << "\n";
+    }
+
+    if(::rename(temporaryDirectory.c_str(), directory.c_str()) != 0) {
+
+        // Another run saved the same fingerprint in the meantime.
+        for(const string& path: filesystem::directoryContents(temporaryDirectory)) {
+            filesystem::remove(path);
+        }
+        ::rmdir(temporaryDirectory.c_str());
+    }
+}
@@ -0,0 +1,349 @@
+// Shasta.
+#include "CandidatePairTable.hpp"
+#include "splitRange.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "algorithm.hpp"
+#include "iostream.hpp"
+#include "stdexcept.hpp"
+#include "tuple.hpp"
+#include <map>
+#include <thread>
+
+
+
+CandidatePairTable::CandidatePairTable() :
+    MultithreadedObject(*this),
+    mask(0),
+    entryCount(0)
+{
+}
+
+
+
+void CandidatePairTable::createNew(const string& name, size_t pageSize)
+{
+    entries.createNew(name, pageSize);
+    mask = 0;
+    entryCount = 0;
+}
+
+
+
+void CandidatePairTable::remove()
+{
+    entries.remove();
+    threadRehashEntries.clear();
+    threadRehashEntries.shrink_to_fit();
+    mask = 0;
+    entryCount = 0;
+}
+
+
+
+void CandidatePairTable::reserve(uint64_t newEntryCount, size_t threadCount)
+{
+    // Count the entries in use.
+    threadEntryCount.assign(threadCount, 0);
+    runThreads(&CandidatePairTable::countEntriesThreadFunction, threadCount);
+    entryCount = 0;
+    for(const uint64_t n: threadEntryCount) {
+        entryCount += n;
+    }
+
+    // If necessary, rehash to a capacity that keeps
+    // the load factor below 1/2.
+    const uint64_t requiredCapacity = 2 * (entryCount + newEntryCount);
+    if(requiredCapacity > entries.size()) {
+        uint64_t newCapacity = max(entries.size(), uint64_t(1024));
+        while(newCapacity < requiredCapacity) {
+            newCapacity *= 2;
+        }
+        rehash(newCapacity, threadCount);
+    }
+}
+
+
+
+// Count the entries in use in the slice of the table
+// assigned to this thread. The slices are the same
+// used by saveEntriesThreadFunction.
+void CandidatePairTable::countEntriesThreadFunction(size_t threadId)
+{
+    uint64_t begin, end;
+    tie(begin, end) = splitRange(0, entries.size(), threadEntryCount.size(), threadId);
+    uint64_t count = 0;
+    for(uint64_t i=begin; i!=end; i++) {
+        if(not entries[i].isEmpty()) {
+            ++count;
+        }
+    }
+    threadEntryCount[threadId] = count;
+}
+
+
+
+void CandidatePairTable::rehash(uint64_t newCapacity, size_t threadCount)
+{
+    // Each thread saves the entries in use in its slice of the table.
+    threadRehashEntries.clear();
+    threadRehashEntries.resize(threadCount);
+    runThreads(&CandidatePairTable::saveEntriesThreadFunction, threadCount);
+
+    // Clear the table at the new capacity.
+    entries.resize(newCapacity);
+    mask = newCapacity - 1;
+    runThreads(&CandidatePairTable::clearThreadFunction, threadCount);
+
+    // Each thread inserts the entries it saved.
+    runThreads(&CandidatePairTable::rehashThreadFunction, threadCount);
+    threadRehashEntries.clear();
+}
+
+
+
+void CandidatePairTable::saveEntriesThreadFunction(size_t threadId)
+{
+    vector<Entry>& thisThreadEntries = threadRehashEntries[threadId];
+    thisThreadEntries.reserve(threadEntryCount[threadId]);
+
+    uint64_t begin, end;
+    tie(begin, end) = splitRange(0, entries.size(), threadRehashEntries.size(), threadId);
+    for(uint64_t i=begin; i!=end; i++) {
+        const Entry& entry = entries[i];
+        if(not entry.isEmpty()) {
+            thisThreadEntries.push_back(entry);
+        }
+    }
+}
+
+
+
+void CandidatePairTable::clearThreadFunction(size_t threadId)
+{
+    Entry emptyEntry;
+    emptyEntry.key = emptyKey;
+    emptyEntry.frequency = {0, 0};
+    emptyEntry.unused = 0;
+
+    uint64_t begin, end;
+    tie(begin, end) = splitRange(0, entries.size(), threadRehashEntries.size(), threadId);
+    fill(entries.begin() + begin, entries.begin() + end, emptyEntry);
+}
+
+
+
+void CandidatePairTable::rehashThreadFunction(size_t threadId)
+{
+    vector<Entry>& thisThreadEntries = threadRehashEntries[threadId];
+    for(const Entry& entry: thisThreadEntries) {
+        for(uint64_t strand=0; strand<2; strand++) {
+            if(entry.frequency[strand]) {
+                increment(entries.begin(), mask, entry.key, strand, entry.frequency[strand]);
+            }
+        }
+    }
+    thisThreadEntries.clear();
+    thisThreadEntries.shrink_to_fit();
+}
+
+
+
+// Add count to the frequency of a key for a given strand,
+// creating a new entry if necessary.
+// Return the previous frequency.
+uint16_t CandidatePairTable::increment(
+    Entry* entries,
+    uint64_t mask,
+    uint64_t key,
+    uint64_t strand,
+    uint16_t count)
+{
+    const uint16_t maxFrequency = std::numeric_limits<uint16_t>::max();
+
+    // Linear probing.
+    for(uint64_t i=hash(key)&mask, probeCount=0; ; i=(i+1)&mask, ++probeCount) {
+        if(probeCount > mask) {
+            throw runtime_error("CandidatePairTable is full.");
+        }
+        Entry& entry = entries[i];
+
+        // Claim the entry if it is empty.
+        uint64_t entryKey = __atomic_load_n(&entry.key, __ATOMIC_ACQUIRE);
+        if(entryKey == emptyKey) {
+            if(__atomic_compare_exchange_n(&entry.key, &entryKey, key,
+                false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                entryKey = key;
+            }
+        }
+        if(entryKey != key) {
+            continue;
+        }
+
+        // Saturating add to the frequency.
+        uint16_t& frequency = entry.frequency[strand];
+        uint16_t oldFrequency = __atomic_load_n(&frequency, __ATOMIC_RELAXED);
+        while(oldFrequency != maxFrequency) {
+            const uint16_t newFrequency = uint16_t(min(
+                uint32_t(oldFrequency) + uint32_t(count), uint32_t(maxFrequency)));
+            if(__atomic_compare_exchange_n(&frequency, &oldFrequency, newFrequency,
+                true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+        return oldFrequency;
+    }
+}
+
+
+
+// Test the saturating frequencies, concurrent calls to increment
+// on the same pairs, and rehashing.
+void shasta::testCandidatePairTable()
+{
+    using Entry = CandidatePairTable::Entry;
+    const uint16_t maxFrequency = std::numeric_limits<uint16_t>::max();
+
+    // The frequency saturates at maxFrequency,
+    // independently for each strand.
+    {
+        CandidatePairTable table;
+        table.createNew("", 4096);
+        table.reserve(1, 1);
+        for(uint64_t i=0; i<uint64_t(maxFrequency)+1000; i++) {
+            const uint16_t oldFrequency = table.increment(3, 17, 0);
+            SHASTA_ASSERT(oldFrequency == min(i, uint64_t(maxFrequency)));
+        }
+        SHASTA_ASSERT(table.increment(3, 17, 1) == 0);
+        table.reserve(0, 1);
+        SHASTA_ASSERT(table.size() == 1);
+        table.remove();
+    }
+    cout << "CandidatePairTable saturation: OK." << endl;
+
+
+
+    // Many threads increment the same pairs in the same order, so they
+    // compete to claim the same empty entries. Each pair must get
+    // exactly one entry, and exactly one call must see it with frequency 0.
+    // One more pair is incremented past saturation by all threads,
+    // and exactly maxFrequency calls must see it below maxFrequency.
+    {
+        const uint64_t threadCount = 16;
+        const ReadId pairCount = 1000;
+        const uint64_t roundCount = 100;
+        const uint64_t saturationIncrementCount = 10000;
+        const auto readId1 = [](ReadId readId0) {return readId0 + 1 + readId0 % 7;};
+
+        CandidatePairTable table;
+        table.createNew("", 4096);
+        table.reserve(pairCount + 1, threadCount);
+        vector<uint64_t> threadZeroCount(threadCount, 0);
+        vector<uint64_t> threadBelowMaxCount(threadCount, 0);
+        vector<std::thread> threads;
+        for(uint64_t threadId=0; threadId<threadCount; threadId++) {
+            threads.push_back(std::thread([&, threadId]()
+            {
+                for(uint64_t round=0; round<roundCount; round++) {
+                    for(ReadId readId0=0; readId0<pairCount; readId0++) {
+                        if(table.increment(readId0, readId1(readId0), readId0 % 2) == 0) {
+                            ++threadZeroCount[threadId];
+                        }
+                    }
+                }
+                for(uint64_t i=0; i<saturationIncrementCount; i++) {
+                    if(table.increment(pairCount, pairCount + 1, 1) != maxFrequency) {
+                        ++threadBelowMaxCount[threadId];
+                    }
+                }
+            }));
+        }
+        for(std::thread& thread: threads) {
+            thread.join();
+        }
+
+        uint64_t zeroCount = 0;
+        uint64_t belowMaxCount = 0;
+        for(uint64_t threadId=0; threadId<threadCount; threadId++) {
+            zeroCount += threadZeroCount[threadId];
+            belowMaxCount += threadBelowMaxCount[threadId];
+        }
+        SHASTA_ASSERT(zeroCount == pairCount);
+        SHASTA_ASSERT(belowMaxCount == maxFrequency);
+
+        vector<uint64_t> keys;
+        for(const Entry* entry=table.begin(); entry!=table.end(); ++entry) {
+            if(entry->isEmpty()) {
+                continue;
+            }
+            keys.push_back(entry->key);
+            const ReadId readId0 = entry->readId0();
+            if(readId0 == pairCount) {
+                SHASTA_ASSERT(entry->readId1() == pairCount + 1);
+                SHASTA_ASSERT(entry->frequency[0] == 0);
+                SHASTA_ASSERT(entry->frequency[1] == maxFrequency);
+            } else {
+                SHASTA_ASSERT(readId0 < pairCount);
+                SHASTA_ASSERT(entry->readId1() == readId1(readId0));
+                SHASTA_ASSERT(entry->frequency[readId0 % 2] == threadCount * roundCount);
+                SHASTA_ASSERT(entry->frequency[1 - readId0 % 2] == 0);
+            }
+        }
+        SHASTA_ASSERT(keys.size() == pairCount + 1);
+        sort(keys.begin(), keys.end());
+        SHASTA_ASSERT(std::adjacent_find(keys.begin(), keys.end()) == keys.end());
+        table.remove();
+    }
+    cout << "CandidatePairTable concurrent increments: OK." << endl;
+
+
+
+    // Add random pairs in batches, starting from a small table, so reserve
+    // rehashes several times using multiple threads, including entries
+    // with saturated frequencies. Compare with a std::map.
+    {
+        const uint64_t threadCount = 4;
+        CandidatePairTable table;
+        table.createNew("", 4096);
+        std::map< pair<ReadId, ReadId>, array<uint64_t, 2> > expected;
+        uint64_t x = 231;
+        const auto random = [&x]()
+        {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            return x >> 16;
+        };
+        for(uint64_t batchSize=100; batchSize<=200000; batchSize*=4) {
+            table.reserve(batchSize, threadCount);
+            for(uint64_t i=0; i<batchSize; i++) {
+                const ReadId readId0 = ReadId(random() % 1000);
+                const ReadId readId1 = readId0 + 1 + ReadId(random() % 1000);
+                const uint64_t strand = random() % 2;
+                table.increment(readId0, readId1, strand);
+                ++expected[make_pair(readId0, readId1)][strand];
+            }
+            for(uint64_t i=0; i<uint64_t(maxFrequency)+10; i++) {
+                table.increment(2000, 2001, 0);
+            }
+            expected[make_pair(2000, 2001)][0] += uint64_t(maxFrequency)+10;
+        }
+        table.reserve(0, threadCount);
+        SHASTA_ASSERT(table.size() == expected.size());
+
+        uint64_t entryCount = 0;
+        for(const Entry* entry=table.begin(); entry!=table.end(); ++entry) {
+            if(entry->isEmpty()) {
+                continue;
+            }
+            ++entryCount;
+            const auto it = expected.find(make_pair(entry->readId0(), entry->readId1()));
+            SHASTA_ASSERT(it != expected.end());
+            for(uint64_t strand=0; strand<2; strand++) {
+                SHASTA_ASSERT(entry->frequency[strand] == min(it->second[strand], uint64_t(maxFrequency)));
+            }
+        }
+        SHASTA_ASSERT(entryCount == expected.size());
+        table.remove();
+    }
+    cout << "CandidatePairTable rehash: OK." << endl;
+}
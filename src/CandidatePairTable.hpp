@@ -0,0 +1,168 @@
+#ifndef SHASTA_CANDIDATE_PAIR_TABLE_HPP
+#define SHASTA_CANDIDATE_PAIR_TABLE_HPP
+
+/*******************************************************************************
+
+Class CandidatePairTable is a concurrent hash table used by LowHash0
+to count the number of times each pair of reads is found,
+for each relative orientation.
+
+It uses open addressing with linear probing. Each entry is keyed
+by (readId0, readId1), with readId0 < readId1, and contains
+a saturating 16-bit frequency for each relative orientation
+(0 = same strand, 1 = opposite strands).
+
+Calls to increment are lock-free and can be made concurrently
+from multiple threads: an empty entry is claimed with a
+compare-and-swap on its key, and the frequency is incremented
+with a compare-and-swap loop that stops at the maximum value.
+
+The table does not grow during calls to increment.
+Before each batch of calls to increment, call reserve with an upper
+bound on the number of new entries. If necessary, this rehashes
+the table, using multiple threads, so the load factor
+stays below 1/2 even if all the new entries are created.
+Each thread saves the entries in use in a slice of the old table,
+clears a slice of the new table, and then inserts the entries it saved.
+
+*******************************************************************************/
+
+// Shasta.
+#include "MemoryMappedVector.hpp"
+#include "MultithreadedObject.hpp"
+#include "OrientedReadPair.hpp"
+#include "ReadId.hpp"
+
+// Standard library.
+#include "array.hpp"
+#include "string.hpp"
+
+namespace shasta {
+    class CandidatePairTable;
+}
+
+
+
+class shasta::CandidatePairTable :
+    public MultithreadedObject<CandidatePairTable> {
+public:
+
+    CandidatePairTable();
+    void createNew(const string& name, size_t pageSize);
+    void remove();
+
+    // Make sure the table can accept entryCount new entries
+    // while keeping its load factor below 1/2.
+    // This is not thread safe.
+    void reserve(uint64_t entryCount, size_t threadCount);
+
+    // Increment the frequency of a pair of reads
+    // with the given relative orientation and return the previous frequency.
+    // The frequency saturates at the maximum value of uint16_t.
+    // This is thread safe and lock-free.
+    uint16_t increment(ReadId readId0, ReadId readId1, uint64_t strand)
+    {
+        SHASTA_ASSERT(readId0 < readId1);
+        const uint64_t key = (uint64_t(readId0) << 32) | uint64_t(readId1);
+        return increment(entries.begin(), mask, key, strand, 1);
+    }
+
+    // Prefetch the cache line where the entry for a pair of reads
+    // is most likely to be. This can be used to overlap cache misses
+    // when incrementing many pairs.
+    void prefetch(ReadId readId0, ReadId readId1) const
+    {
+        const uint64_t key = (uint64_t(readId0) << 32) | uint64_t(readId1);
+        __builtin_prefetch(entries.begin() + (hash(key) & mask), 1);
+    }
+
+    // Number of entries the table can hold.
+    uint64_t capacity() const
+    {
+        return entries.size();
+    }
+
+    // Number of pairs of reads in the table,
+    // as of the last call to reserve.
+    uint64_t size() const
+    {
+        return entryCount;
+    }
+
+    class Entry {
+    public:
+        uint64_t key;
+        array<uint16_t, 2> frequency;
+        uint32_t unused;
+
+        ReadId readId0() const
+        {
+            return ReadId(key >> 32);
+        }
+        ReadId readId1() const
+        {
+            return ReadId(key & 0xffffffffULL);
+        }
+        bool isEmpty() const
+        {
+            return key == emptyKey;
+        }
+    };
+    static_assert(sizeof(Entry) == 16, "Unexpected size of CandidatePairTable::Entry.");
+    static const uint64_t emptyKey = std::numeric_limits<uint64_t>::max();
+
+    // Access the entries, for example to extract pairs
+    // with sufficient frequency. Empty entries must be skipped.
+    const Entry* begin() const
+    {
+        return entries.begin();
+    }
+    const Entry* end() const
+    {
+        return entries.end();
+    }
+
+private:
+
+    // The entries. The size is a power of 2.
+    MemoryMapped::Vector<Entry> entries;
+    uint64_t mask;
+
+    // The number of entries in use, as counted by reserve.
+    // Each thread counts the entries in use in a slice of the table.
+    uint64_t entryCount;
+    vector<uint64_t> threadEntryCount;
+    void countEntriesThreadFunction(size_t threadId);
+
+    static uint16_t increment(
+        Entry* entries,
+        uint64_t mask,
+        uint64_t key,
+        uint64_t strand,
+        uint16_t count);
+
+    static uint64_t hash(uint64_t key)
+    {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    // Rehash to a new capacity.
+    // threadRehashEntries[threadId] holds the entries in use
+    // in the slice of the old table assigned to each thread.
+    vector< vector<Entry> > threadRehashEntries;
+    void rehash(uint64_t newCapacity, size_t threadCount);
+    void saveEntriesThreadFunction(size_t threadId);
+    void clearThreadFunction(size_t threadId);
+    void rehashThreadFunction(size_t threadId);
+};
+
+
+
+namespace shasta {
+    void testCandidatePairTable();
+}
+
+#endif
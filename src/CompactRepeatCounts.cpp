@@ -0,0 +1,185 @@
+// Shasta.
+#include "CompactRepeatCounts.hpp"
+#include "SHASTA_ASSERT.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "algorithm.hpp"
+
+
+
+void CompactRepeatCounts::createNew(const string& name, size_t pageSize)
+{
+    toc.createNew(dataName(name, "-Toc"), pageSize);
+    codes.createNew(dataName(name, "-Codes"), pageSize);
+    blockExceptionBegin.createNew(dataName(name, "-BlockExceptionBegin"), pageSize);
+    exceptions.createNew(dataName(name, "-Exceptions"), pageSize);
+    toc.push_back(0);
+}
+
+
+
+void CompactRepeatCounts::accessExistingReadOnly(const string& name)
+{
+    toc.accessExistingReadOnly(name + "-Toc");
+    codes.accessExistingReadOnly(name + "-Codes");
+    blockExceptionBegin.accessExistingReadOnly(name + "-BlockExceptionBegin");
+    exceptions.accessExistingReadOnly(name + "-Exceptions");
+}
+
+
+
+void CompactRepeatCounts::accessExistingReadWrite(const string& name)
+{
+    toc.accessExistingReadWrite(name + "-Toc");
+    codes.accessExistingReadWrite(name + "-Codes");
+    blockExceptionBegin.accessExistingReadWrite(name + "-BlockExceptionBegin");
+    exceptions.accessExistingReadWrite(name + "-Exceptions");
+}
+
+
+
+void CompactRepeatCounts::remove()
+{
+    toc.remove();
+    codes.remove();
+    blockExceptionBegin.remove();
+    exceptions.remove();
+}
+
+
+
+void CompactRepeatCounts::unreserve()
+{
+    toc.unreserve();
+    codes.unreserve();
+    blockExceptionBegin.unreserve();
+    exceptions.unreserve();
+}
+
+
+
+// Append the repeat counts of a new read.
+void CompactRepeatCounts::append(const uint8_t* begin, const uint8_t* end)
+{
+    uint64_t globalPosition = toc.back();
+    for(const uint8_t* p=begin; p!=end; ++p) {
+        if((globalPosition % countsPerBlock) == 0) {
+            blockExceptionBegin.push_back(exceptions.size());
+        }
+        if((globalPosition % countsPerWord) == 0) {
+            codes.push_back(0);
+        }
+
+        const uint8_t repeatCount = *p;
+        uint64_t code;
+        if(repeatCount >= 1 and repeatCount <= exceptionCode) {
+            code = repeatCount - 1;
+        } else {
+            code = exceptionCode;
+            exceptions.push_back(repeatCount);
+        }
+        codes.back() |= code << (2 * (globalPosition % countsPerWord));
+
+        ++globalPosition;
+    }
+    toc.push_back(globalPosition);
+}
+
+
+
+// Return the number of exceptions at global positions
+// less than the given global position.
+uint64_t CompactRepeatCounts::exceptionRank(uint64_t globalPosition) const
+{
+    const uint64_t blockId = globalPosition / countsPerBlock;
+    const uint64_t wordId = globalPosition / countsPerWord;
+    uint64_t rank = blockExceptionBegin[blockId];
+
+    // Full words preceding this position in the same block.
+    for(uint64_t w=blockId*wordsPerBlock; w!=wordId; w++) {
+        rank += uint64_t(__builtin_popcountll(exceptionMask(codes[w])));
+    }
+
+    // Codes preceding this position in the same word.
+    const uint64_t bitCount = 2 * (globalPosition % countsPerWord);
+    if(bitCount) {
+        const uint64_t mask = (uint64_t(1) << bitCount) - 1;
+        rank += uint64_t(__builtin_popcountll(exceptionMask(codes[wordId]) & mask));
+    }
+
+    return rank;
+}
+
+
+
+// Bulk decode the repeat counts of read i at positions [begin, end).
+// This processes one word of codes at a time and locates
+// the first exception only once.
+void CompactRepeatCounts::get(
+    uint64_t i,
+    uint64_t begin,
+    uint64_t end,
+    uint8_t* output) const
+{
+    SHASTA_ASSERT(begin <= end);
+    SHASTA_ASSERT(end <= size(i));
+
+    uint64_t globalPosition = toc[i] + begin;
+    const uint64_t globalEnd = toc[i] + end;
+    if(globalPosition == globalEnd) {
+        return;
+    }
+    const uint8_t* exception = exceptions.begin() + exceptionRank(globalPosition);
+
+    while(globalPosition != globalEnd) {
+        const uint64_t positionInWord = globalPosition % countsPerWord;
+        const uint64_t n = min(countsPerWord - positionInWord, globalEnd - globalPosition);
+        uint64_t word = codes[globalPosition / countsPerWord] >> (2 * positionInWord);
+        for(uint64_t j=0; j<n; j++, word>>=2) {
+            const uint64_t code = word & 3;
+            if(code == exceptionCode) {
+                *output++ = *exception++;
+            } else {
+                *output++ = uint8_t(code + 1);
+            }
+        }
+        globalPosition += n;
+    }
+}
+
+
+
+// Return the sum of all the repeat counts of read i.
+// For each word, the sum of the codes is computed with two popcounts.
+// Each exception code contributes 4 to that sum, which
+// is then replaced by the actual value of the exception.
+uint64_t CompactRepeatCounts::sum(uint64_t i) const
+{
+    uint64_t globalPosition = toc[i];
+    const uint64_t globalEnd = toc[i+1];
+    if(globalPosition == globalEnd) {
+        return 0;
+    }
+    const uint8_t* exception = exceptions.begin() + exceptionRank(globalPosition);
+
+    uint64_t s = 0;
+    while(globalPosition != globalEnd) {
+        const uint64_t positionInWord = globalPosition % countsPerWord;
+        const uint64_t n = min(countsPerWord - positionInWord, globalEnd - globalPosition);
+        uint64_t word = codes[globalPosition / countsPerWord] >> (2 * positionInWord);
+        if(n < countsPerWord) {
+            word &= (uint64_t(1) << (2 * n)) - 1;
+        }
+        s += n +
+            uint64_t(__builtin_popcountll(word & 0x5555555555555555ULL)) +
+            2 * uint64_t(__builtin_popcountll(word & 0xaaaaaaaaaaaaaaaaULL));
+        const uint64_t exceptionCount = uint64_t(__builtin_popcountll(exceptionMask(word)));
+        for(uint64_t j=0; j<exceptionCount; j++) {
+            s += *exception++;
+            s -= exceptionCode + 1;
+        }
+        globalPosition += n;
+    }
+    return s;
+}
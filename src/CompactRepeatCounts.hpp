@@ -0,0 +1,146 @@
+#ifndef SHASTA_COMPACT_REPEAT_COUNTS_HPP
+#define SHASTA_COMPACT_REPEAT_COUNTS_HPP
+
+/*******************************************************************************
+
+Compact storage of the repeat counts of the run-length representation
+of the reads. See Reads.hpp for more information on the
+run-length representation.
+
+Most repeat counts are 1, 2, or 3. Each repeat count is stored
+as a 2-bit code, 32 codes per 64-bit word:
+- Codes 0, 1, 2 represent repeat counts 1, 2, 3.
+- Code 3 is an exception: the repeat count is stored as a byte
+  in a separate vector of exceptions.
+
+The repeat counts of all reads are stored contiguously,
+and each repeat count has a global position.
+Global positions are grouped in blocks of 256 (8 words),
+and for each block we store the index in the exceptions vector
+of the first exception in that block. So locating the exception
+for a given global position requires looking at no more
+than 8 words, and random access to any repeat count is O(1).
+
+For typical nanopore reads this uses a little more than 2 bits per
+run-length base, compared to 8 bits for the one byte per base
+representation.
+
+*******************************************************************************/
+
+// Shasta.
+#include "MemoryMappedVector.hpp"
+
+// Standard library.
+#include "cstdint.hpp"
+#include "string.hpp"
+#include "vector.hpp"
+
+namespace shasta {
+    class CompactRepeatCounts;
+}
+
+
+
+class shasta::CompactRepeatCounts {
+public:
+
+    void createNew(const string& name, size_t pageSize);
+    void accessExistingReadOnly(const string& name);
+    void accessExistingReadWrite(const string& name);
+    void remove();
+    void unreserve();
+
+    bool isOpen() const
+    {
+        return toc.isOpen;
+    }
+
+    // Append the repeat counts of a new read.
+    void append(const uint8_t* begin, const uint8_t* end);
+
+    // The number of reads.
+    uint64_t size() const
+    {
+        return toc.size() - 1;
+    }
+
+    // The number of repeat counts for read i.
+    uint64_t size(uint64_t i) const
+    {
+        return toc[i+1] - toc[i];
+    }
+
+    // The total number of repeat counts for all reads.
+    uint64_t totalSize() const
+    {
+        return toc.back();
+    }
+
+    // Return the repeat count at a given position of read i.
+    uint8_t get(uint64_t i, uint64_t position) const
+    {
+        const uint64_t globalPosition = toc[i] + position;
+        const uint64_t code = getCode(globalPosition);
+        if(code == exceptionCode) {
+            return exceptions[exceptionRank(globalPosition)];
+        } else {
+            return uint8_t(code + 1);
+        }
+    }
+
+    // Bulk decode the repeat counts of read i at positions [begin, end).
+    // The output must have room for end-begin repeat counts.
+    void get(uint64_t i, uint64_t begin, uint64_t end, uint8_t* output) const;
+
+    // Return the sum of all the repeat counts of read i.
+    // This is the raw length of the read.
+    uint64_t sum(uint64_t i) const;
+
+private:
+
+    static const uint64_t countsPerWord = 32;
+    static const uint64_t wordsPerBlock = 8;
+    static const uint64_t countsPerBlock = countsPerWord * wordsPerBlock;
+    static const uint64_t exceptionCode = 3;
+
+    // The global position of the first repeat count of each read.
+    // Indexed by ReadId, with an additional entry at the end
+    // containing the total number of repeat counts.
+    MemoryMapped::Vector<uint64_t> toc;
+
+    // The 2-bit codes, 32 per word.
+    // The code for global position p is in bits
+    // [2*(p%32), 2*(p%32)+2) of word p/32.
+    MemoryMapped::Vector<uint64_t> codes;
+
+    // For each block of 256 global positions, the index in the
+    // exceptions vector of the first exception in the block.
+    MemoryMapped::Vector<uint64_t> blockExceptionBegin;
+
+    // The repeat counts that cannot be stored as 2-bit codes.
+    MemoryMapped::Vector<uint8_t> exceptions;
+
+    uint64_t getCode(uint64_t globalPosition) const
+    {
+        return (codes[globalPosition / countsPerWord] >>
+            (2 * (globalPosition % countsPerWord))) & 3;
+    }
+
+    // Return a word with the low bit of each 2-bit code set
+    // if and only if that code is an exception.
+    static uint64_t exceptionMask(uint64_t word)
+    {
+        return word & (word >> 1) & 0x5555555555555555ULL;
+    }
+
+    // Return the number of exceptions at global positions
+    // less than the given global position.
+    uint64_t exceptionRank(uint64_t globalPosition) const;
+
+    static string dataName(const string& name, const string& suffix)
+    {
+        return name.empty() ? string() : (name + suffix);
+    }
+};
+
+#endif
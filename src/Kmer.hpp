@@ -8,8 +8,23 @@ namespace shasta {
 
     // Types used to represent a k-mer and a k-mer id.
     // These limit the maximum k-mer length that can be used.
+    // By default k-mers can be up to 16 bases long.
+    // Building with SHASTA_LONG_KMERS defined (cmake -DBUILD_LONG_KMERS=ON)
+    // allows k-mers up to 31 bases long, at the cost of
+    // more memory for markers. In that case k-mer lengths
+    // above 16 use a sparse k-mer table (see SparseKmerTable.hpp).
+#ifdef SHASTA_LONG_KMERS
+    using Kmer = ShortBaseSequence32;
+    using KmerId = uint64_t;
+#else
     using Kmer = ShortBaseSequence16;
     using KmerId = uint32_t;
+#endif
+
+    // The maximum k-mer length for which the dense k-mer table
+    // (a KmerInfo for each of the 4^k k-mers) is used.
+    // Longer k-mers use a SparseKmerTable.
+    const size_t maxDenseKmerTableK = 16;
 
     // Check for consistency of these two types.
     static_assert(
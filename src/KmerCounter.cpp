@@ -0,0 +1,101 @@
+// Shasta.
+#include "KmerCounter.hpp"
+#include "Markers.hpp"
+#include "SHASTA_ASSERT.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "algorithm.hpp"
+#include "stdexcept.hpp"
+
+
+
+void KmerCounter::createNew(uint64_t kArgument, const string& name, size_t pageSize)
+{
+    if(kArgument == 0 or kArgument > maxDenseKmerTableK) {
+        throw runtime_error("Invalid k-mer length " + to_string(kArgument) +
+            " for k-mer counting. The maximum is " + to_string(maxDenseKmerTableK) + ".");
+    }
+    k = kArgument;
+
+    // Use up to 1024 partitions.
+    const uint64_t kmerIdBits = 2 * k;
+    const uint64_t partitionBits = min(kmerIdBits, uint64_t(10));
+    partitionShift = kmerIdBits - partitionBits;
+    partitionCount = 1ULL << partitionBits;
+    mutexes = vector<std::mutex>(partitionCount);
+
+    counts.createNew(name, pageSize);
+    counts.resize(1ULL << kmerIdBits);
+    fill(counts.begin(), counts.end(), 0);
+}
+
+
+
+void KmerCounter::remove()
+{
+    if(counts.isOpen) {
+        counts.remove();
+    }
+    mutexes.clear();
+    k = 0;
+}
+
+
+
+// Add occurrences of k-mers that all belong to the given partition.
+void KmerCounter::add(uint64_t partitionId, const KmerId* begin, const KmerId* end)
+{
+    std::lock_guard<std::mutex> lock(mutexes[partitionId]);
+    uint64_t* c = counts.begin();
+    for(const KmerId* p=begin; p!=end; ++p) {
+        ++c[*p];
+    }
+}
+
+
+
+void KmerCounter::addReverseComplements()
+{
+    uint64_t* c = counts.begin();
+    for(uint64_t kmerId=0; kmerId<counts.size(); kmerId++) {
+        const uint64_t reverseComplementedKmerId =
+            OrientedReadMarkers::reverseComplement(KmerId(kmerId), k);
+        if(reverseComplementedKmerId == kmerId) {
+            c[kmerId] *= 2;
+        } else if(reverseComplementedKmerId > kmerId) {
+            const uint64_t count = c[kmerId] + c[reverseComplementedKmerId];
+            c[kmerId] = count;
+            c[reverseComplementedKmerId] = count;
+        }
+    }
+}
+
+
+
+KmerCounter::Buffer::Buffer(KmerCounter& counter) :
+    counter(counter),
+    buffer(counter.partitionCount * bucketCapacity),
+    sizes(counter.partitionCount, 0)
+{
+}
+
+
+
+void KmerCounter::Buffer::flush(uint64_t partitionId)
+{
+    const KmerId* begin = buffer.data() + partitionId * bucketCapacity;
+    counter.add(partitionId, begin, begin + sizes[partitionId]);
+    sizes[partitionId] = 0;
+}
+
+
+
+void KmerCounter::Buffer::flush()
+{
+    for(uint64_t partitionId=0; partitionId<sizes.size(); partitionId++) {
+        if(sizes[partitionId]) {
+            flush(partitionId);
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#ifndef SHASTA_KMER_COUNTER_HPP
+#define SHASTA_KMER_COUNTER_HPP
+
+/*******************************************************************************
+
+Class KmerCounter counts occurrences of k-mers, using multiple threads.
+
+Counting with one full table of counters per thread, followed
+by a serial merge, uses memory proportional to the number of threads
+and serializes a pass over the entire table for each thread.
+Incrementing a single shared table directly instead
+causes contention and random accesses over the entire table.
+
+KmerCounter instead partitions the KmerId space by its high bits.
+Each thread owns a KmerCounter::Buffer, which accumulates
+KmerIds in a small bucket for each partition. When a bucket
+is full, its KmerIds are added to the counters of the partition
+while holding a lock for that partition only.
+Because there are many more partitions than threads,
+contention is rare, and each flush only touches
+the counters of one partition, which is cache friendly.
+
+Counters are stored in a dense table indexed by KmerId,
+so KmerCounter is only available for k <= maxDenseKmerTableK.
+This is the same limit that applies to the k-mer table used by
+frequency-based k-mer selection, its only client.
+
+Typical usage:
+- Call createNew.
+- In each thread, create a KmerCounter::Buffer and call add
+  for each k-mer occurrence. Call flush when done.
+- Optionally, call addReverseComplements.
+- Access the counts with operator[].
+- Call remove.
+
+*******************************************************************************/
+
+// Shasta.
+#include "Kmer.hpp"
+#include "MemoryMappedVector.hpp"
+
+// Standard library.
+#include "string.hpp"
+#include "vector.hpp"
+#include <mutex>
+
+namespace shasta {
+    class KmerCounter;
+}
+
+
+
+class shasta::KmerCounter {
+public:
+
+    void createNew(uint64_t k, const string& name, size_t pageSize);
+    void remove();
+
+    uint64_t getK() const
+    {
+        return k;
+    }
+
+    // Return the number of occurrences of a k-mer.
+    uint64_t operator[](KmerId kmerId) const
+    {
+        return counts[kmerId];
+    }
+
+    // Add to the count of each k-mer the count of its reverse complement.
+    // This can be used to count occurrences in all oriented reads
+    // while only adding k-mers on strand 0.
+    // The count of a palindromic k-mer is doubled.
+    // Must be called after all Buffers are flushed.
+    void addReverseComplements();
+
+    // The per-thread buffer used to add k-mer occurrences.
+    class Buffer {
+    public:
+        Buffer(KmerCounter&);
+
+        // Add an occurrence of a k-mer.
+        void add(KmerId kmerId)
+        {
+            const uint64_t partitionId = counter.partitionId(kmerId);
+            uint32_t& size = sizes[partitionId];
+            buffer[partitionId * bucketCapacity + size] = kmerId;
+            if(++size == bucketCapacity) {
+                flush(partitionId);
+            }
+        }
+
+        // Add all buffered occurrences to the counter.
+        // This must be called after the last call to add.
+        void flush();
+
+    private:
+        KmerCounter& counter;
+
+        // The bucket for each partition, stored contiguously.
+        static const uint32_t bucketCapacity = 256;
+        vector<KmerId> buffer;
+        vector<uint32_t> sizes;
+
+        void flush(uint64_t partitionId);
+    };
+
+private:
+
+    uint64_t k = 0;
+
+    // The partition of a KmerId is given by its high bits.
+    uint64_t partitionShift = 0;
+    uint64_t partitionCount = 0;
+    uint64_t partitionId(KmerId kmerId) const
+    {
+        return uint64_t(kmerId) >> partitionShift;
+    }
+
+    // The table of counters, indexed by KmerId.
+    MemoryMapped::Vector<uint64_t> counts;
+
+    // A mutex for each partition.
+    vector<std::mutex> mutexes;
+
+    // Add occurrences of k-mers that all belong to the given partition.
+    void add(uint64_t partitionId, const KmerId* begin, const KmerId* end);
+};
+
+#endif
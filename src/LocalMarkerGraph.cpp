@@ -15,7 +15,7 @@ using namespace shasta;
 LocalMarkerGraph::LocalMarkerGraph(
     uint32_t k,
     const Reads& reads,
-    const MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>& markers,
+    const Markers& markers,
     const MemoryMapped::Vector<MarkerGraph::CompressedVertexId>& globalMarkerGraphVertex,
     const ConsensusCaller& consensusCaller
     ) :
@@ -82,14 +82,16 @@ KmerId LocalMarkerGraph::getKmerId(vertex_descriptor v) const
 {
     const LocalMarkerGraphVertex& vertex = (*this)[v];
     SHASTA_ASSERT(!vertex.markerInfos.empty());
-    const MarkerId firstMarkerId = vertex.markerInfos.front().markerId;
-    const CompressedMarker& firstMarker = markers.begin()[firstMarkerId];
+    const auto& firstMarkerInfo = vertex.markerInfos.front();
+    const CompressedMarker firstMarker =
+        markers[firstMarkerInfo.orientedReadId.getValue()][firstMarkerInfo.ordinal];
     const KmerId kmerId = firstMarker.kmerId;
 
     // Sanity check that all markers have the same kmerId.
     // At some point this can be removed.
     for(const auto& markerInfo: vertex.markerInfos){
-        const CompressedMarker& marker = markers.begin()[markerInfo.markerId];
+        const CompressedMarker marker =
+            markers[markerInfo.orientedReadId.getValue()][markerInfo.ordinal];
         SHASTA_ASSERT(marker.kmerId == kmerId);
     }
 
@@ -105,16 +107,16 @@ vector<uint8_t> LocalMarkerGraph::getRepeatCounts(
     const OrientedReadId orientedReadId = markerInfo.orientedReadId;
     const ReadId readId = orientedReadId.getReadId();
     const Strand strand = orientedReadId.getStrand();
-    const CompressedMarker& marker = markers.begin()[markerInfo.markerId];
+    const CompressedMarker marker = markers[orientedReadId.getValue()][markerInfo.ordinal];
 
-    const auto& counts = reads.getReadRepeatCounts(readId);
+    const uint32_t readLength = uint32_t(reads.getRead(readId).baseCount);
 
     vector<uint8_t> v(k);
-    for(size_t i=0; i<k; i++) {
+    for(uint32_t i=0; i<k; i++) {
         if(strand == 0) {
-            v[i] = counts[marker.position + i];
+            v[i] = reads.getReadRepeatCount(readId, marker.position + i);
         } else {
-            v[i] = counts[counts.size() - 1 - marker.position - i];
+            v[i] = reads.getReadRepeatCount(readId, readLength - 1 - marker.position - i);
         }
     }
 
@@ -177,22 +179,24 @@ void LocalMarkerGraph::storeEdgeInfo(
     // Map to store the oriented read ids and ordinals, grouped by sequence.
     std::map<LocalMarkerGraphEdge::Sequence, vector<MarkerIntervalWithRepeatCounts> > sequenceTable;
     for(const MarkerInterval& interval: intervals) {
-        const CompressedMarker& marker0 = markers.begin(interval.orientedReadId.getValue())[interval.ordinals[0]];
-        const CompressedMarker& marker1 = markers.begin(interval.orientedReadId.getValue())[interval.ordinals[1]];
+        const OrientedReadMarkers orientedReadMarkers = markers[interval.orientedReadId.getValue()];
+        const CompressedMarker marker0 = orientedReadMarkers[interval.ordinals[0]];
+        const CompressedMarker marker1 = orientedReadMarkers[interval.ordinals[1]];
 
         // Fill in the sequence information and, if necessary, the base repeat counts.
         LocalMarkerGraphEdge::Sequence sequence;
         MarkerIntervalWithRepeatCounts intervalWithRepeatCounts(interval);
         if(marker1.position <= marker0.position + k) {
             sequence.overlappingBaseCount = uint8_t(marker0.position + k - marker1.position);
-            const auto& repeatCounts = reads.getReadRepeatCounts(interval.orientedReadId.getReadId());
+            const ReadId readId = interval.orientedReadId.getReadId();
+            const uint32_t readLength = uint32_t(reads.getRead(readId).baseCount);
             for(uint32_t i=0; i<sequence.overlappingBaseCount; i++) {
                 uint32_t position = marker1.position + i;
                 uint8_t repeatCount = 0;
                 if(interval.orientedReadId.getStrand() == 0) {
-                    repeatCount = repeatCounts[position];
+                    repeatCount = reads.getReadRepeatCount(readId, position);
                 } else {
-                    repeatCount = repeatCounts[repeatCounts.size() - 1 - position];
+                    repeatCount = reads.getReadRepeatCount(readId, readLength - 1 - position);
                 }
                 intervalWithRepeatCounts.repeatCounts.push_back(repeatCount);
             }
@@ -210,13 +214,13 @@ void LocalMarkerGraph::storeEdgeInfo(
                 }
                 sequence.sequence.push_back(base);
             }
-            const auto repeatCounts = reads.getReadRepeatCounts(interval.orientedReadId.getReadId());
+            const ReadId readId = interval.orientedReadId.getReadId();
             for(uint32_t position=marker0.position+k;  position!=marker1.position; position++) {
                 uint8_t repeatCount;
                 if(interval.orientedReadId.getStrand() == 0) {
-                    repeatCount = repeatCounts[position];
+                    repeatCount = reads.getReadRepeatCount(readId, position);
                 } else {
-                    repeatCount = repeatCounts[readLength - 1 - position];
+                    repeatCount = reads.getReadRepeatCount(readId, readLength - 1 - position);
                 }
                 intervalWithRepeatCounts.repeatCounts.push_back(repeatCount);
             }
@@ -19,6 +19,7 @@ a group of aligned markers.
 #include "AssemblyGraph.hpp"
 #include "Kmer.hpp"
 #include "MarkerGraph.hpp"
+#include "Markers.hpp"
 #include "Reads.hpp"
 
 // Boost libraries.
@@ -190,7 +191,7 @@ public:
     LocalMarkerGraph(
         uint32_t k,
         const Reads& reads,
-        const MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>& markers,
+        const Markers& markers,
         const MemoryMapped::Vector<MarkerGraph::CompressedVertexId>& globalMarkerGraphVertex,
         const ConsensusCaller&
         );
@@ -264,7 +265,7 @@ private:
     // Reference to the global data structure containing all reads and markers
     // (not just those in this local marker graph).
     const Reads& reads;
-    const MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>& markers;
+    const Markers& markers;
 
     // A reference to the vector containing the global marker graph vertex id
     // corresponding to each marker.
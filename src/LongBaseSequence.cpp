@@ -91,6 +91,45 @@ void LongBaseSequences::append(size_t baseCountArgument)
 
 
 
+// Append all the sequences of another LongBaseSequences, in two steps.
+// appendRange can be called concurrently for non-overlapping ranges.
+uint64_t LongBaseSequences::beginAppend(const LongBaseSequences& that)
+{
+    baseCount.resize(baseCount.size() + that.size());
+    return data.beginAppend(that.data);
+}
+void LongBaseSequences::appendRange(
+    const LongBaseSequences& that,
+    uint64_t firstIndex,
+    uint64_t begin,
+    uint64_t end)
+{
+    std::copy(
+        that.baseCount.begin() + begin,
+        that.baseCount.begin() + end,
+        baseCount.begin() + firstIndex + begin);
+    data.appendRange(that.data, firstIndex, begin, end);
+}
+
+
+
+// Keep only the sequences for which keep[i] is true,
+// without changing their order.
+void LongBaseSequences::keepSequences(const vector<bool>& keep)
+{
+    SHASTA_ASSERT(keep.size() == size());
+    uint64_t newSize = 0;
+    for(uint64_t i=0; i<keep.size(); i++) {
+        if(keep[i]) {
+            baseCount[newSize++] = baseCount[i];
+        }
+    }
+    baseCount.resize(newSize);
+    data.keepVectors(keep);
+}
+
+
+
 void shasta::testLongBaseSequence()
 {
 
@@ -291,6 +291,15 @@ public:
     void append(const vector<Base>&);
     void append(size_t baseCount);
 
+    // Append all the sequences of another LongBaseSequences, in two steps,
+    // as in VectorOfVectors::beginAppend and VectorOfVectors::appendRange.
+    uint64_t beginAppend(const LongBaseSequences&);
+    void appendRange(const LongBaseSequences&, uint64_t firstIndex, uint64_t begin, uint64_t end);
+
+    // Keep only the sequences for which keep[i] is true,
+    // without changing their order.
+    void keepSequences(const vector<bool>& keep);
+
 private:
 
     // The number of bases of each of the sequences.
@@ -1,11 +1,16 @@
 // Shasta.
 #include "LowHash0.hpp"
+#include "LowHashFeatureHash.hpp"
+#include "LowHashSketches.hpp"
+#include "OrientedReadPairSorter.hpp"
 #include "ReadFlags.hpp"
+#include "splitRange.hpp"
 #include "timestamp.hpp"
 using namespace shasta;
 
 // Standard library.
 #include "chrono.hpp"
+#include "tuple.hpp"
 #include <numeric>
 
 
@@ -28,10 +33,15 @@ LowHash0::LowHash0(
     size_t minBucketSize,           // The minimum size for a bucket to be used.
     size_t maxBucketSize,           // The maximum size for a bucket to be used.
     size_t minFrequency,            // Minimum number of minHash hits for a pair to be considered a candidate.
+    size_t hashBatchSize,           // Number of iterations for which hashes are computed together.
+    size_t hashFamily,              // 0 = MurmurHash64A, 1 = multiply-xorshift.
+    bool noKmerIdsCopy,             // Get KmerIds from the markers instead of a copy.
+    bool sortBuckets,               // Use sorted buckets instead of log2MinHashBucketCount buckets.
+    LowHashSketches* newSketches,   // If not null, store the low hash sketches here.
+    const LowHashSketches* storedSketches,  // If not null, use these instead of hashing.
     size_t threadCountArgument,
-    const MemoryMapped::Vector<KmerInfo>& kmerTable,
     const Reads& reads,
-    const MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>& markers,
+    const Markers& markers,
     MemoryMapped::Vector<OrientedReadPair>& candidateAlignments,
     MemoryMapped::Vector< array<uint64_t, 3> >& readLowHashStatistics,
     const string& largeDataFileNamePrefix,
@@ -43,10 +53,16 @@ LowHash0::LowHash0(
     minBucketSize(minBucketSize),
     maxBucketSize(maxBucketSize),
     minFrequency(minFrequency),
+    hashBatchSize(hashBatchSize),
+    hashFamily(hashFamily),
+    noKmerIdsCopy(noKmerIdsCopy),
+    sortBuckets(sortBuckets),
+    newSketches(newSketches),
+    storedSketches(storedSketches),
     threadCount(threadCountArgument),
-    kmerTable(kmerTable),
     reads(reads),
     markers(markers),
+    candidateAlignments(candidateAlignments),
     readLowHashStatistics(readLowHashStatistics),
     largeDataFileNamePrefix(largeDataFileNamePrefix),
     largeDataPageSize(largeDataPageSize),
@@ -61,45 +77,63 @@ LowHash0::LowHash0(
         threadCount = std::thread::hardware_concurrency();
     }
 
+    // Check the hash batch size and hash family.
+    if(hashBatchSize == 0 or hashBatchSize > maxLowHashBatchSize) {
+        throw runtime_error("Invalid LowHash hash batch size " + to_string(hashBatchSize) +
+            ". Must be between 1 and " + to_string(maxLowHashBatchSize) + ".");
+    }
+    if(hashFamily > 1) {
+        throw runtime_error("Invalid LowHash hash family " + to_string(hashFamily) +
+            ". Must be 0 or 1.");
+    }
 
-    // Estimate the total number of low hashes and its base 2 log.
-    // Except for very short reads, each marker generates a feature,
-    // and each feature generates a low hash with probability hashFraction.
-    // So an estimate of the total number of hashes is:
-    const uint64_t totalLowHashCountEstimate =
-        uint64_t(hashFraction * double(markers.totalSize()));
-    const uint32_t leadingZeroBitCount = uint32_t(__builtin_clzl(totalLowHashCountEstimate));
-    const uint32_t log2TotalLowHashCountEstimate = 64 - leadingZeroBitCount;
-
-
-    // If log2MinHashBucketCount is 0, choose a reasonable value
-    // for the current number of reads.
-    // Otherwise, check that log2MinHashBucketCount is not unreasonably small.
-    if(log2MinHashBucketCount == 0) {
-        log2MinHashBucketCount = 5 + log2TotalLowHashCountEstimate;
+    // With sorted buckets, there is no need to choose the number of buckets.
+    uint32_t bucketCount = 0;
+    if(sortBuckets) {
+        cout << "LowHash0 algorithm will use sorted buckets." << endl;
     } else {
-        if(log2MinHashBucketCount < log2TotalLowHashCountEstimate) {
-            throw runtime_error("log2MinHashBucketCount is unreasonably small.");
+
+        // Estimate the total number of low hashes and its base 2 log.
+        // Except for very short reads, each marker generates a feature,
+        // and each feature generates a low hash with probability hashFraction.
+        // So an estimate of the total number of hashes is:
+        const uint64_t totalLowHashCountEstimate =
+            uint64_t(hashFraction * double(markers.totalSize()));
+        const uint32_t leadingZeroBitCount = uint32_t(__builtin_clzl(totalLowHashCountEstimate));
+        const uint32_t log2TotalLowHashCountEstimate = 64 - leadingZeroBitCount;
+
+
+        // If log2MinHashBucketCount is 0, choose a reasonable value
+        // for the current number of reads.
+        // Otherwise, check that log2MinHashBucketCount is not unreasonably small.
+        if(log2MinHashBucketCount == 0) {
+            log2MinHashBucketCount = 5 + log2TotalLowHashCountEstimate;
+        } else {
+            if(log2MinHashBucketCount < log2TotalLowHashCountEstimate) {
+                throw runtime_error("log2MinHashBucketCount is unreasonably small.");
+            }
         }
-    }
-    if(log2MinHashBucketCount > 31) {
+        if(log2MinHashBucketCount > 31) {
 
-        cout << "log2MinHashBucketCount reduced from " << log2MinHashBucketCount <<
-            " to maximum allowed value 31."  << endl;
-        log2MinHashBucketCount = 31;
+            cout << "log2MinHashBucketCount reduced from " << log2MinHashBucketCount <<
+                " to maximum allowed value 31."  << endl;
+            log2MinHashBucketCount = 31;
+        }
+        bucketCount = 1 << log2MinHashBucketCount;
+        mask = bucketCount - 1;
+        cout << "LowHash0 algorithm will use 2^" << log2MinHashBucketCount;
+        cout << " = " << bucketCount << " buckets. "<< endl;
     }
-    const uint32_t bucketCount = 1 << log2MinHashBucketCount;
-    mask = bucketCount - 1;
-    cout << "LowHash0 algorithm will use 2^" << log2MinHashBucketCount;
-    cout << " = " << bucketCount << " buckets. "<< endl;
-
 
 
 
     // Create vectors containing only the k-mer ids of all markers.
     // This is used to speed up the computation of hash functions.
-    cout << timestamp << "Creating kmer ids for oriented reads." << endl;
-    createKmerIds();
+    // It is not needed if we are using stored sketches.
+    if(not (noKmerIdsCopy or storedSketches)) {
+        cout << timestamp << "Creating kmer ids for oriented reads." << endl;
+        createKmerIds();
+    }
 
     // Compute the threshold for a hash value to be considered low.
     hashThreshold = uint64_t(double(hashFraction) * double(std::numeric_limits<uint64_t>::max()));
@@ -110,12 +144,25 @@ LowHash0::LowHash0(
     cout << "There are " << readCount << " reads, " << orientedReadCount << " oriented reads." << endl;
     
 
+    // If using stored sketches, check that they are compatible
+    // with the options we were given.
+    if(storedSketches) {
+        storedSketches->checkCanBeUsed(m, hashFraction, hashFamily,
+            orientedReadCount, minHashIterationCount, false);
+        cout << "LowHash0 will use stored sketches for up to " <<
+            storedSketches->info->iterationCount << " iterations." << endl;
+    }
+
     // Set up work areas.
-    buckets.createNew(
-        largeDataFileNamePrefix.empty() ? "" : (largeDataFileNamePrefix + "tmp-LowHash0-Buckets"),
+    if(not sortBuckets) {
+        buckets.createNew(
+            largeDataFileNamePrefix.empty() ? "" : (largeDataFileNamePrefix + "tmp-LowHash0-Buckets"),
+            largeDataPageSize);
+    }
+    lowHashes.resize(orientedReadCount * hashBatchSize);
+    candidateTable.createNew(
+        largeDataFileNamePrefix.empty() ? "" : (largeDataFileNamePrefix + "tmp-LowHash0-CandidateTable"),
         largeDataPageSize);
-    lowHashes.resize(orientedReadCount);
-    candidates.resize(readCount);
     threadStatistics.resize(threadCount);
     readLowHashStatistics.resize(readCount);
     fill(readLowHashStatistics.begin(), readLowHashStatistics.end(),
@@ -128,6 +175,7 @@ LowHash0::LowHash0(
 
     // LowHash0 iteration loop.
     uint64_t highFrequency = 0;
+    uint64_t total = 0;
     for(iteration=0; ; iteration++) {
 
         // Decide if it is time to stop the iteration.
@@ -153,62 +201,94 @@ LowHash0::LowHash0(
             }
         }
 
+        // When using stored sketches, stop when they are exhausted.
+        if(storedSketches and iteration==storedSketches->info->iterationCount) {
+            cout << "All " << iteration << " iterations of the stored sketches were used." << endl;
+            break;
+        }
+
 
 
         cout << timestamp << "LowHash0 iteration " << iteration << " begins." << endl;
 
-        // Pass1: compute the low hashes for each oriented read
-        // and prepare the buckets for filling.
-        buckets.clear();
-        buckets.beginPass1(bucketCount);
+        // At the first iteration of each batch, compute the low hashes
+        // for all iterations in the batch.
         size_t batchSize = 10000;
-        setupLoadBalancing(readCount, batchSize);
-        runThreads(&LowHash0::pass1ThreadFunction, threadCount);
-
-        // Pass 2: fill the buckets.
-        buckets.beginPass2();
-        batchSize = 10000;
-        setupLoadBalancing(readCount, batchSize);
-        runThreads(&LowHash0::pass2ThreadFunction, threadCount);
-        buckets.endPass2(false, false);
-        computeBucketHistogram();
-
-        // Pass 3: inspect the buckets to find candidates.
-        batchSize = 10000;
-        setupLoadBalancing(readCount, batchSize);
-        runThreads(&LowHash0::pass3ThreadFunction, threadCount);
+        if((iteration % hashBatchSize) == 0) {
+            batchIterationCount = hashBatchSize;
+            if(minHashIterationCount != 0) {
+                batchIterationCount = min(batchIterationCount, uint64_t(minHashIterationCount - iteration));
+            }
+            setupLoadBalancing(readCount, batchSize);
+            if(storedSketches) {
+                batchIterationCount = min(batchIterationCount,
+                    uint64_t(storedSketches->info->iterationCount - iteration));
+                getStoredLowHashes();
+            } else {
+                computeLowHashes();
+                if(newSketches) {
+                    storeSketches();
+                }
+            }
+        }
+
+        if(sortBuckets) {
+            findCandidatesWithSortedBuckets();
+        } else {
+
+            // Pass1: count the low hashes in each bucket
+            // to prepare the buckets for filling.
+            buckets.clear();
+            buckets.beginPass1(bucketCount);
+            setupLoadBalancing(readCount, batchSize);
+            runThreads(&LowHash0::pass1ThreadFunction, threadCount);
+
+            // Pass 2: fill the buckets.
+            buckets.beginPass2();
+            batchSize = 10000;
+            setupLoadBalancing(readCount, batchSize);
+            runThreads(&LowHash0::pass2ThreadFunction, threadCount);
+            buckets.endPass2(false, false);
+            computeBucketHistogram();
+
+            // Pass 3: inspect the buckets to find candidates.
+            candidateTable.reserve(newCandidateCountBound, threadCount);
+            batchSize = 10000;
+            setupLoadBalancing(readCount, batchSize);
+            runThreads(&LowHash0::pass3ThreadFunction, threadCount);
+        }
 
         // Write a summary for this iteration.
-        highFrequency = 0;
-        uint64_t total = 0;
-        uint64_t capacity = 0;
         for(const auto& s: threadStatistics) {
             highFrequency += s.highFrequency;
             total += s.total;
-            capacity += s.capacity;
         }
         cout << "Alignment candidates after iteration " << iteration;
         cout << ": high frequency " << highFrequency;
         cout << ", total " << total;
-        cout << ", capacity " << capacity << "." << endl;
+        cout << ", capacity " << 2 * candidateTable.capacity() << "." << endl;
     }
 
 
 
     // Create the candidate alignments.
+    // Each thread counts the candidates in a slice of the table.
+    // A prefix sum of the counts gives where the candidates
+    // of each slice go, and each thread then stores them there.
+    // They are then sorted by readId0, then readId1, with
+    // the same strand before opposite strands, using a multithreaded radix sort.
     cout << timestamp << "Storing candidate alignments." << endl;
     SHASTA_ASSERT(orientedReadCount == 2*readCount);
-    for(ReadId readId0=0; readId0<readCount; readId0++) {
-        const auto& candidates0 = candidates[readId0];
-        for(const Candidate& candidate: candidates0) {
-            if(candidate.frequency >= minFrequency) {
-                const ReadId readId1 = candidate.readId1;
-                SHASTA_ASSERT(readId0 < readId1);
-                candidateAlignments.push_back(
-                    OrientedReadPair(readId0, readId1, candidate.strand==0));
-            }
-        }
+    threadCandidateBegin.assign(threadCount + 1, 0);
+    runThreads(&LowHash0::countCandidatesThreadFunction, threadCount);
+    threadCandidateBegin[0] = candidateAlignments.size();
+    for(size_t threadId=0; threadId<threadCount; threadId++) {
+        threadCandidateBegin[threadId + 1] += threadCandidateBegin[threadId];
     }
+    candidateAlignments.resize(threadCandidateBegin[threadCount]);
+    runThreads(&LowHash0::storeCandidatesThreadFunction, threadCount);
+    OrientedReadPairSorter sorter(candidateAlignments, threadCount,
+        largeDataFileNamePrefix, largeDataPageSize);
     cout << "Found " << candidateAlignments.size() << " alignment candidates."<< endl;
     cout << "Average number of alignment candidates per oriented read is ";
     cout << (2.* double(candidateAlignments.size())) / double(orientedReadCount)  << "." << endl;
@@ -242,8 +322,16 @@ LowHash0::LowHash0(
 
 
     // Clean up work areas.
-    buckets.remove();
-    kmerIds.remove();
+    if(not sortBuckets) {
+        buckets.remove();
+    }
+    if(kmerIds.isOpen()) {
+        kmerIds.remove();
+    }
+    candidateTable.remove();
+    threadSortEntries.clear();
+    sortEntries.clear();
+    sortEntries.shrink_to_fit();
 
 
 
@@ -295,10 +383,7 @@ void LowHash0::createKmerIds(size_t threadId)
 
                 SHASTA_ASSERT(kmerIds.size(orientedReadId.getValue()) == orientedReadMarkers.size());
 
-                auto pointer = kmerIds.begin(orientedReadId.getValue());
-                for(const CompressedMarker& marker: orientedReadMarkers) {
-                    *pointer++ = marker.kmerId;
-                }
+                orientedReadMarkers.getKmerIds(kmerIds.begin(orientedReadId.getValue()));
             }
         }
     }
@@ -306,12 +391,27 @@ void LowHash0::createKmerIds(size_t threadId)
 
 
 
-// Pass1: compute the low hashes for each oriented read
-// and prepare the buckets for filling.
-void LowHash0::pass1ThreadFunction(size_t threadId)
+void LowHash0::computeLowHashes()
 {
-    const int featureByteCount = int(m * sizeof(KmerId));
-    const uint64_t seed = iteration * 37;
+    if(hashFamily == 0) {
+        runThreads(&LowHash0::computeLowHashesThreadFunction<MurmurFeatureHash>, threadCount);
+    } else {
+        runThreads(&LowHash0::computeLowHashesThreadFunction<MultiplyShiftFeatureHash>, threadCount);
+    }
+}
+
+
+
+// Compute the low hashes of each oriented read for all
+// iterations of the current batch, in a single pass over the markers.
+template<class FeatureHash> void LowHash0::computeLowHashesThreadFunction(size_t threadId)
+{
+    const FeatureHash featureHash(iteration, batchIterationCount, m);
+    array<uint64_t, maxLowHashBatchSize> hashes;
+
+    // Work area used to gather the KmerIds of the markers of an oriented read
+    // when noKmerIdsCopy is set.
+    vector<KmerId> kmerIdsWorkArea;
 
     // Loop over batches assigned to this thread.
     uint64_t begin, end;
@@ -324,10 +424,12 @@ void LowHash0::pass1ThreadFunction(size_t threadId)
             }
             for(Strand strand=0; strand<2; strand++) {
                 const OrientedReadId orientedReadId(readId, strand);
-
-                vector<uint64_t>& orientedReadLowHashes = lowHashes[orientedReadId.getValue()];
-                orientedReadLowHashes.clear();
-                const size_t markerCount = kmerIds.size(orientedReadId.getValue());
+                vector<uint64_t>* orientedReadLowHashes =
+                    &lowHashes[orientedReadId.getValue() * hashBatchSize];
+                for(uint64_t i=0; i<batchIterationCount; i++) {
+                    orientedReadLowHashes[i].clear();
+                }
+                const size_t markerCount = markers.size(orientedReadId.getValue());
 
                 // Handle the pathological case where there are fewer than m markers.
                 // This oriented read ends up in no bucket.
@@ -336,18 +438,21 @@ void LowHash0::pass1ThreadFunction(size_t threadId)
                 }
 
 
-                // Get the markers for this oriented read.
-                KmerId* kmerIdsPointer = kmerIds.begin(orientedReadId.getValue());
+                // Get the KmerIds of the markers of this oriented read.
+                const KmerId* kmerIdsPointer = noKmerIdsCopy ?
+                    markers[orientedReadId.getValue()].getKmerIds(kmerIdsWorkArea) :
+                    kmerIds.begin(orientedReadId.getValue());
                 const size_t featureCount = markerCount - m + 1;
 
                 // Loop over features of this oriented read.
                 // Features are sequences of m consecutive markers.
                 for(size_t j=0; j<featureCount; j++, kmerIdsPointer++) {
-                    const uint64_t hash = MurmurHash64A(kmerIdsPointer, featureByteCount, seed);
-                    if(hash < hashThreshold) {
-                        orientedReadLowHashes.push_back(hash);
-                        const uint64_t bucketId = hash & mask;
-                        buckets.incrementCountMultithreaded(bucketId);
+                    featureHash(kmerIdsPointer, hashes.data());
+                    for(uint64_t i=0; i<batchIterationCount; i++) {
+                        const uint64_t hash = hashes[i];
+                        if(hash < hashThreshold) {
+                            orientedReadLowHashes[i].push_back(hash);
+                        }
                     }
                 }
             }
@@ -358,6 +463,92 @@ void LowHash0::pass1ThreadFunction(size_t threadId)
 
 
 
+void LowHash0::getStoredLowHashes()
+{
+    runThreads(&LowHash0::getStoredLowHashesThreadFunction, threadCount);
+}
+
+
+
+// Get the low hashes of each oriented read for all
+// iterations of the current batch from the stored sketches.
+// If hashFraction is less than the one used to store the sketches,
+// only keep the hashes below the current threshold.
+void LowHash0::getStoredLowHashesThreadFunction(size_t threadId)
+{
+
+    // Loop over batches assigned to this thread.
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over oriented reads assigned to this batch.
+        for(ReadId readId=ReadId(begin); readId!=ReadId(end); readId++) {
+            if(reads.getFlags(readId).isPalindromic) {
+                continue;
+            }
+            for(Strand strand=0; strand<2; strand++) {
+                const OrientedReadId orientedReadId(readId, strand);
+                vector<uint64_t>* orientedReadLowHashes =
+                    &lowHashes[orientedReadId.getValue() * hashBatchSize];
+                for(uint64_t i=0; i<batchIterationCount; i++) {
+                    vector<uint64_t>& v = orientedReadLowHashes[i];
+                    v.clear();
+                    for(const LowHashSketches::Entry& entry:
+                        storedSketches->getSketch(iteration + i, orientedReadId)) {
+                        if(entry.hash < hashThreshold) {
+                            v.push_back(entry.hash);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+
+// Store the low hashes of the current batch in newSketches.
+void LowHash0::storeSketches()
+{
+    const OrientedReadId::Int orientedReadCount = OrientedReadId::Int(markers.size());
+    for(uint64_t i=0; i<batchIterationCount; i++) {
+        for(OrientedReadId::Int orientedReadId=0; orientedReadId<orientedReadCount; orientedReadId++) {
+            newSketches->storeSketch(lowHashes[orientedReadId * hashBatchSize + i]);
+        }
+        newSketches->endIteration();
+    }
+}
+
+
+
+// Pass1: count the low hashes in each bucket
+// to prepare the buckets for filling.
+void LowHash0::pass1ThreadFunction(size_t threadId)
+{
+
+    // Loop over batches assigned to this thread.
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over oriented reads assigned to this batch.
+        for(ReadId readId=ReadId(begin); readId!=ReadId(end); readId++) {
+            if(reads.getFlags(readId).isPalindromic) {
+                continue;
+            }
+            for(Strand strand=0; strand<2; strand++) {
+                const OrientedReadId orientedReadId(readId, strand);
+                for(const uint64_t hash: getLowHashes(orientedReadId)) {
+                    const uint64_t bucketId = hash & mask;
+                    buckets.incrementCountMultithreaded(bucketId);
+                }
+            }
+        }
+    }
+
+}
+
+
+
 // Pass 2: fill the buckets.
 void LowHash0::pass2ThreadFunction(size_t threadId)
 {
@@ -373,7 +564,7 @@ void LowHash0::pass2ThreadFunction(size_t threadId)
             }
             for(Strand strand=0; strand<2; strand++) {
                 const OrientedReadId orientedReadId(readId, strand);
-                const vector<uint64_t>& orientedReadLowHashes = lowHashes[orientedReadId.getValue()];
+                const vector<uint64_t>& orientedReadLowHashes = getLowHashes(orientedReadId);
 
                 for(const uint64_t hash: orientedReadLowHashes) {
                     const uint64_t bucketId = hash & mask;
@@ -399,15 +590,12 @@ void LowHash0::pass2ThreadFunction(size_t threadId)
 // Pass 3: inspect the buckets to find candidates.
 void LowHash0::pass3ThreadFunction(size_t threadId)
 {
+    threadStatistics[threadId].clear();
 
-    // The alignment candidates found at this iteration for a single read.
-    vector<Candidate> newCandidates;
-
-    // The merged candidates for a single readId0.
-    vector<Candidate> mergedCandidates;
-
-    ThreadStatistics& thisThreadStatistics = threadStatistics[threadId];
-    thisThreadStatistics.clear();
+    // The candidates found for a single read, as (readId1, strand).
+    // They are gathered before being added to the candidate table,
+    // so the table entries can be prefetched.
+    vector< pair<ReadId, uint64_t> > newCandidates;
 
     // Loop over batches assigned to this thread.
     uint64_t begin, end;
@@ -420,10 +608,9 @@ void LowHash0::pass3ThreadFunction(size_t threadId)
             // Loop over two strands.
             for(Strand strand0=0; strand0<2; strand0++) {
                 const OrientedReadId orientedReadId0(readId0, strand0);
-                const OrientedReadId::Int orientedReadIdInt0 = orientedReadId0.getValue();
 
                 // Loop over the low hashes for this oriented read.
-                const vector<uint64_t>& orientedReadLowHashes = lowHashes[orientedReadIdInt0];
+                const vector<uint64_t>& orientedReadLowHashes = getLowHashes(orientedReadId0);
                 for(const uint64_t hash: orientedReadLowHashes) {
                     const uint32_t hashHighBits = uint32_t(hash >> 32);
 
@@ -450,31 +637,15 @@ void LowHash0::pass3ThreadFunction(size_t threadId)
 
                         // Add it to our work area.
                         const bool isSameStrand = orientedReadId1.getStrand() == strand0;
-                        newCandidates.push_back(Candidate(readId1, isSameStrand? 0 : 1));
+                        newCandidates.push_back(make_pair(readId1, isSameStrand? 0 : 1));
+                        candidateTable.prefetch(readId0, readId1);
                     }
                 }
             }
 
-            // Sort the candidates found during this iteration.
-            sort(newCandidates.begin(), newCandidates.end());
-
-            // Merge the contents of the work area
-            // with the candidates previously stored.
-            vector<Candidate>& storedCandidates = candidates[readId0];
-            mergedCandidates.clear();
-            merge(storedCandidates, newCandidates, mergedCandidates);
-
-            // Store the merged candidates in place of the old ones.
-            storedCandidates.resize(mergedCandidates.size());
-            copy(mergedCandidates.begin(), mergedCandidates.end(), storedCandidates.begin());
-
-            // Update thread statistics.
-            thisThreadStatistics.total += storedCandidates.size();
-            thisThreadStatistics.capacity += storedCandidates.capacity();
-            for(const Candidate& candidate: storedCandidates) {
-                if(candidate.frequency >= minFrequency) {
-                    ++thisThreadStatistics.highFrequency;
-                }
+            // Add the candidates found for this read to the candidate table.
+            for(const auto& p: newCandidates) {
+                addCandidate(readId0, p.first, p.second, threadId);
             }
         }
     }
@@ -482,80 +653,72 @@ void LowHash0::pass3ThreadFunction(size_t threadId)
 
 
 
-// Merge two sorted vectors of candidates into a third one.
-// The input vectors can be sorted but can have duplicates.
-// During merging, when two candidates with the same readId1
-// and strand are found, they are combined, adding up their frequency.
-// This is used by pass4ThreadFunction.
-void LowHash0::merge(
-    const vector<LowHash0::Candidate>& x0,
-    const vector<LowHash0::Candidate>& x1,
-    vector<LowHash0::Candidate>& y
-    )
+// Increment the frequency of a candidate pair
+// and update the statistics for the calling thread.
+void LowHash0::addCandidate(ReadId readId0, ReadId readId1, uint64_t strand, size_t threadId)
 {
-    using Iterator = vector<LowHash0::Candidate>::const_iterator;
-    Iterator begin0 = x0.begin();
-    Iterator begin1 = x1.begin();
-    Iterator end0 = x0.end();
-    Iterator end1 = x1.end();
-
-
-
-    // Merge loop..
-    // At each step, we find the lowest of the two candidates
-    // currently pointed by the two iterators (ties allowed and are ok).
-    // If the merged vector is not empty and ends with an entry that compares equal,
-    // increment its frequency. Otherwise, just create a new entry in the merged vector.
-    Iterator it0 = begin0;
-    Iterator it1 = begin1;
-    while(true) {
-
-        // If we reached the end of x0, process the remaining portion of x1,
-        // then exit the merge loop.
-        if(it0 == end0) {
-            for(; it1!=end1; ++it1) {
-                if(!y.empty() && y.back() == *it1) {
-                    y.back().frequency = uint16_t(y.back().frequency + it1->frequency);
-                } else {
-                    y.push_back(*it1);
-                }
-            }
-            break;
-        }
+    const uint64_t oldFrequency = candidateTable.increment(readId0, readId1, strand);
+    ThreadStatistics& thisThreadStatistics = threadStatistics[threadId];
+    if(oldFrequency == 0) {
+        ++thisThreadStatistics.total;
+    }
+    if(oldFrequency < minFrequency and oldFrequency + 1 >= minFrequency) {
+        ++thisThreadStatistics.highFrequency;
+    }
+}
 
-        // If we reached the end of x1, process the remaining portion of x0,
-        // then exit the merge loop.
-        if(it1 == end1) {
-            for(; it0!=end0; ++it0) {
-                if(!y.empty() && y.back() == *it0) {
-                    y.back().frequency = uint16_t(y.back().frequency + it0->frequency);
-                } else {
-                    y.push_back(*it0);
-                }
+
+
+// Extract the candidates with frequency at least minFrequency
+// in a range of the candidate table.
+// Count the candidates with frequency at least minFrequency
+// in the slice of the table assigned to this thread.
+// The slices are the same used by storeCandidatesThreadFunction.
+void LowHash0::countCandidatesThreadFunction(size_t threadId)
+{
+    const CandidatePairTable::Entry* entries = candidateTable.begin();
+
+    uint64_t begin, end;
+    tie(begin, end) = splitRange(0, candidateTable.capacity(), threadCount, threadId);
+    uint64_t count = 0;
+    for(uint64_t i=begin; i!=end; i++) {
+        const CandidatePairTable::Entry& entry = entries[i];
+        if(entry.isEmpty()) {
+            continue;
+        }
+        for(uint64_t strand=0; strand<2; strand++) {
+            if(entry.frequency[strand] >= minFrequency) {
+                ++count;
             }
-            break;
         }
+    }
+    threadCandidateBegin[threadId + 1] = count;
+}
 
-        // If the current x0 entry is less than the current x1 entry,
-        // process the x0 entry.
-        if(*it0 < *it1) {
-            if(!y.empty() && y.back() == *it0) {
-                y.back().frequency  = uint16_t(y.back().frequency + it0->frequency);
-            } else {
-                y.push_back(*it0);
-            }
-            ++it0;
-        } else {
-        // If the current x0 entry is not less than the current x1 entry,
-        // process the current x1 entry.
-            if(!y.empty() && y.back() == *it1) {
-                y.back().frequency = uint16_t(y.back().frequency + it1->frequency);
-            } else {
-                y.push_back(*it1);
+
+
+// Store the candidates with frequency at least minFrequency
+// in the slice of the table assigned to this thread,
+// starting at threadCandidateBegin[threadId].
+void LowHash0::storeCandidatesThreadFunction(size_t threadId)
+{
+    const CandidatePairTable::Entry* entries = candidateTable.begin();
+    OrientedReadPair* candidate = candidateAlignments.begin() + threadCandidateBegin[threadId];
+
+    uint64_t begin, end;
+    tie(begin, end) = splitRange(0, candidateTable.capacity(), threadCount, threadId);
+    for(uint64_t i=begin; i!=end; i++) {
+        const CandidatePairTable::Entry& entry = entries[i];
+        if(entry.isEmpty()) {
+            continue;
+        }
+        for(uint64_t strand=0; strand<2; strand++) {
+            if(entry.frequency[strand] >= minFrequency) {
+                *candidate++ = OrientedReadPair(entry.readId0(), entry.readId1(), strand==0);
             }
-            ++it1;
         }
     }
+    SHASTA_ASSERT(candidate == candidateAlignments.begin() + threadCandidateBegin[threadId + 1]);
 }
 
 
@@ -567,7 +730,15 @@ void LowHash0::computeBucketHistogram()
     const uint64_t batchSize = 10000;
     setupLoadBalancing(buckets.size(), batchSize);
     runThreads(&LowHash0::computeBucketHistogramThreadFunction, threadCount);
+    writeBucketHistogram();
+}
 
+
+
+// Combine the bucket histograms computed by each thread
+// and write them out. Also compute newCandidateCountBound.
+void LowHash0::writeBucketHistogram()
+{
     // Combine the histograms found by each thread.
     uint64_t largestBucketSize = 0;
     for(const vector<uint64_t>& histogram: threadBucketHistogram) {
@@ -580,6 +751,7 @@ void LowHash0::computeBucketHistogram()
         }
     }
 
+    newCandidateCountBound = 0;
     for(uint64_t bucketSize=0; bucketSize<bucketHistogram.size(); bucketSize++) {
         const uint64_t frequency = bucketHistogram[bucketSize];
         if(frequency) {
@@ -589,6 +761,12 @@ void LowHash0::computeBucketHistogram()
                 frequency << "," <<
                 bucketSize*frequency << "\n";
         }
+
+        // Each pair of entries in a bucket that is used
+        // can generate at most one new candidate.
+        if(bucketSize >= max(uint64_t(2), uint64_t(minBucketSize)) and bucketSize <= maxBucketSize) {
+            newCandidateCountBound += frequency * (bucketSize * (bucketSize - 1) / 2);
+        }
     }
 
 
@@ -608,3 +786,224 @@ void LowHash0::computeBucketHistogramThreadFunction(size_t threadId)
         }
     }
 }
+
+
+
+// Use sorted buckets to find candidates at the current iteration.
+void LowHash0::findCandidatesWithSortedBuckets()
+{
+    const ReadId readCount = ReadId(markers.size() / 2);
+    const uint64_t batchSize = 10000;
+    threadSortEntries.resize(threadCount);
+
+    // Gather a (hash, orientedReadId) entry for each low hash
+    // at this iteration, then partition the entries
+    // using the low bits of the hash and sort each partition.
+    // Entries with the same hash end up in a contiguous run.
+    setupLoadBalancing(readCount, batchSize);
+    runThreads(&LowHash0::gatherLowHashesThreadFunction, threadCount);
+    partitionSortEntries();
+
+    // Scan the runs to find candidates.
+    // Each thread stores (readId0, candidate) entries in threadSortEntries.
+    threadBucketHistogram.clear();
+    threadBucketHistogram.resize(threadCount);
+    setupLoadBalancing(sortPartitionCount, 1);
+    runThreads(&LowHash0::scanSortedBucketsThreadFunction, threadCount);
+    writeBucketHistogram();
+
+    // Add the candidates to the candidate table.
+    candidateTable.reserve(newCandidateCountBound, threadCount);
+    runThreads(&LowHash0::addSortedCandidatesThreadFunction, threadCount);
+}
+
+
+
+void LowHash0::gatherLowHashesThreadFunction(size_t threadId)
+{
+    vector<SortEntry>& entries = threadSortEntries[threadId];
+    entries.clear();
+
+    // Loop over batches assigned to this thread.
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over oriented reads assigned to this batch.
+        for(ReadId readId=ReadId(begin); readId!=ReadId(end); readId++) {
+            if(reads.getFlags(readId).isPalindromic) {
+                continue;
+            }
+            for(Strand strand=0; strand<2; strand++) {
+                const OrientedReadId orientedReadId(readId, strand);
+                for(const uint64_t hash: getLowHashes(orientedReadId)) {
+                    entries.push_back(SortEntry(hash, orientedReadId.getValue()));
+                }
+            }
+        }
+    }
+}
+
+
+
+// Partition and sort the entries in threadSortEntries into sortEntries.
+// This is a single parallel radix partitioning pass
+// on sortPartitionBits bits of the key, followed by a sort
+// of each partition, which is small enough to be cache friendly.
+void LowHash0::partitionSortEntries()
+{
+    // Count the entries of each thread in each partition.
+    threadSortPartitionPosition.resize(threadCount);
+    runThreads(&LowHash0::countSortEntriesThreadFunction, threadCount);
+
+    // Compute the beginning of each partition,
+    // and where the entries of each thread go.
+    sortPartitionBegin.resize(sortPartitionCount + 1);
+    uint64_t position = 0;
+    for(uint64_t partitionId=0; partitionId<sortPartitionCount; partitionId++) {
+        sortPartitionBegin[partitionId] = position;
+        for(size_t threadId=0; threadId<threadCount; threadId++) {
+            uint64_t& threadPosition = threadSortPartitionPosition[threadId][partitionId];
+            const uint64_t count = threadPosition;
+            threadPosition = position;
+            position += count;
+        }
+    }
+    sortPartitionBegin[sortPartitionCount] = position;
+
+    // Store the entries by partition, then sort each partition.
+    sortEntries.resize(position);
+    runThreads(&LowHash0::scatterSortEntriesThreadFunction, threadCount);
+    setupLoadBalancing(sortPartitionCount, 1);
+    runThreads(&LowHash0::sortPartitionsThreadFunction, threadCount);
+}
+
+
+
+void LowHash0::countSortEntriesThreadFunction(size_t threadId)
+{
+    vector<uint64_t>& counts = threadSortPartitionPosition[threadId];
+    counts.assign(sortPartitionCount, 0);
+    for(const SortEntry& entry: threadSortEntries[threadId]) {
+        ++counts[sortPartitionId(entry.key)];
+    }
+}
+
+
+
+void LowHash0::scatterSortEntriesThreadFunction(size_t threadId)
+{
+    vector<uint64_t>& positions = threadSortPartitionPosition[threadId];
+    vector<SortEntry>& entries = threadSortEntries[threadId];
+    for(const SortEntry& entry: entries) {
+        sortEntries[positions[sortPartitionId(entry.key)]++] = entry;
+    }
+    entries.clear();
+}
+
+
+
+void LowHash0::sortPartitionsThreadFunction(size_t threadId)
+{
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+        for(uint64_t partitionId=begin; partitionId!=end; partitionId++) {
+            sort(
+                sortEntries.begin() + sortPartitionBegin[partitionId],
+                sortEntries.begin() + sortPartitionBegin[partitionId + 1]);
+        }
+    }
+}
+
+
+
+// Scan the runs of entries with the same hash.
+// Each run is a bucket. For each pair of entries
+// in a bucket of acceptable size, store a
+// (readId0, candidate) entry in threadSortEntries,
+// with the candidate encoded as (readId1 << 1) | strand.
+void LowHash0::scanSortedBucketsThreadFunction(size_t threadId)
+{
+    vector<SortEntry>& newCandidates = threadSortEntries[threadId];
+    newCandidates.clear();
+    vector<uint64_t>& histogram = threadBucketHistogram[threadId];
+    histogram.clear();
+
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+        for(uint64_t partitionId=begin; partitionId!=end; partitionId++) {
+            const auto partitionBegin = sortEntries.begin() + sortPartitionBegin[partitionId];
+            const auto partitionEnd = sortEntries.begin() + sortPartitionBegin[partitionId + 1];
+
+            // Loop over runs with the same hash.
+            for(auto runBegin=partitionBegin; runBegin!=partitionEnd; ) {
+                auto runEnd = runBegin;
+                while(runEnd!=partitionEnd and runEnd->key==runBegin->key) {
+                    ++runEnd;
+                }
+                const uint64_t bucketSize = uint64_t(runEnd - runBegin);
+
+                // Update the bucket histogram.
+                if(bucketSize >= histogram.size()) {
+                    histogram.resize(bucketSize + 1, 0);
+                }
+                ++histogram[bucketSize];
+
+                // Update statistics for the reads in this bucket.
+                uint64_t statisticsIndex = 1;
+                if(bucketSize < minBucketSize) {
+                    statisticsIndex = 0;
+                } else if(bucketSize > maxBucketSize) {
+                    statisticsIndex = 2;
+                }
+                for(auto it=runBegin; it!=runEnd; ++it) {
+                    const ReadId readId = OrientedReadId(ReadId(it->value)).getReadId();
+                    __sync_fetch_and_add(&readLowHashStatistics[readId][statisticsIndex], 1ULL);
+                }
+
+                // If the bucket size is acceptable, store the candidates.
+                if(bucketSize >= max(uint64_t(2), uint64_t(minBucketSize)) and bucketSize <= maxBucketSize) {
+                    for(auto it0=runBegin; it0!=runEnd; ++it0) {
+                        const OrientedReadId orientedReadId0(ReadId(it0->value));
+                        const ReadId readId0 = orientedReadId0.getReadId();
+                        for(auto it1=runBegin; it1!=runEnd; ++it1) {
+                            const OrientedReadId orientedReadId1(ReadId(it1->value));
+                            const ReadId readId1 = orientedReadId1.getReadId();
+
+                            // Only consider it if readId1 > readId0.
+                            if(readId1 <= readId0) {
+                                continue;
+                            }
+                            const uint64_t strand =
+                                (orientedReadId0.getStrand() == orientedReadId1.getStrand()) ? 0 : 1;
+                            newCandidates.push_back(SortEntry(readId0, (uint64_t(readId1) << 1) | strand));
+                        }
+                    }
+                }
+
+                runBegin = runEnd;
+            }
+        }
+    }
+}
+
+
+
+// Add to the candidate table the candidates
+// found by this thread in scanSortedBucketsThreadFunction.
+void LowHash0::addSortedCandidatesThreadFunction(size_t threadId)
+{
+    threadStatistics[threadId].clear();
+    vector<SortEntry>& newCandidates = threadSortEntries[threadId];
+
+    // Prefetch the table entries a few candidates ahead.
+    const uint64_t prefetchDistance = 16;
+    for(uint64_t i=0; i<newCandidates.size(); i++) {
+        if(i + prefetchDistance < newCandidates.size()) {
+            const SortEntry& entry = newCandidates[i + prefetchDistance];
+            candidateTable.prefetch(ReadId(entry.key), ReadId(entry.value >> 1));
+        }
+        const SortEntry& entry = newCandidates[i];
+        addCandidate(ReadId(entry.key), ReadId(entry.value >> 1), entry.value & 1, threadId);
+    }
+    newCandidates.clear();
+}
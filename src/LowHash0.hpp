@@ -2,7 +2,9 @@
 #define SHASTA_LOW_HASH0_HPP
 
 // Shasta
+#include "CandidatePairTable.hpp"
 #include "Marker.hpp"
+#include "Markers.hpp"
 #include "MemoryMappedVectorOfVectors.hpp"
 #include "MultithreadedObject.hpp"
 #include "OrientedReadPair.hpp"
@@ -11,6 +13,7 @@
 
 namespace shasta {
     class LowHash0;
+    class LowHashSketches;
     class Reads;
 }
 
@@ -36,10 +39,15 @@ public:
         size_t minBucketSize,           // The minimum size for a bucket to be used.
         size_t maxBucketSize,           // The maximum size for a bucket to be used.
         size_t minFrequency,            // Minimum number of minHash hits for a pair to be considered a candidate.
+        size_t hashBatchSize,           // Number of iterations for which hashes are computed together.
+        size_t hashFamily,              // 0 = MurmurHash64A, 1 = multiply-xorshift.
+        bool noKmerIdsCopy,             // Get KmerIds from the markers instead of a copy.
+        bool sortBuckets,               // Use sorted buckets instead of log2MinHashBucketCount buckets.
+        LowHashSketches* newSketches,   // If not null, store the low hash sketches here.
+        const LowHashSketches* storedSketches,  // If not null, use these instead of hashing.
         size_t threadCount,
-        const MemoryMapped::Vector<KmerInfo>& kmerTable,
         const Reads& reads,
-        const MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>&,
+        const Markers&,
         MemoryMapped::Vector<OrientedReadPair>&,
         MemoryMapped::Vector< array<uint64_t, 3> >& readLowHashStatistics,
         const string& largeDataFileNamePrefix,
@@ -54,10 +62,16 @@ private:
     size_t minBucketSize;           // The minimum size for a bucket to be used.
     size_t maxBucketSize;           // The maximum size for a bucket to be used.
     size_t minFrequency;            // Minimum number of minHash hits for a pair to be considered a candidate.
+    size_t hashBatchSize;           // Number of iterations for which hashes are computed together.
+    size_t hashFamily;              // 0 = MurmurHash64A, 1 = multiply-xorshift.
+    bool noKmerIdsCopy;             // Get KmerIds from the markers instead of a copy.
+    bool sortBuckets;               // Use sorted buckets instead of log2MinHashBucketCount buckets.
+    LowHashSketches* newSketches;
+    const LowHashSketches* storedSketches;
     size_t threadCount;
-    const MemoryMapped::Vector<KmerInfo>& kmerTable;
     const Reads& reads;
-    const MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>& markers;
+    const Markers& markers;
+    MemoryMapped::Vector<OrientedReadPair>& candidateAlignments;
     MemoryMapped::Vector< array<uint64_t, 3> > &readLowHashStatistics;
     const string& largeDataFileNamePrefix;
     size_t largeDataPageSize;
@@ -66,20 +80,44 @@ private:
     // for all oriented reads.
     // Indexed by OrientedReadId.getValue().
     // This is used to speed up the computation of hash functions.
+    // It is not created if noKmerIdsCopy is set. In that case the KmerIds
+    // are gathered from the markers one oriented read at a time,
+    // which uses less memory but is slower.
     MemoryMapped::VectorOfVectors<KmerId, uint64_t> kmerIds;
     void createKmerIds();
     void createKmerIds(size_t threadId);
 
     // The current MinHash iteration.
-    // This is used to compute a different MurmurHash function
+    // This is used to compute a different hash function
     // at each iteration.
     size_t iteration;
 
-    // The low hashes of each oriented read, at the current LowHash0 iteration.
-    // Indexed by OrientedReadId::getValue().
+    // The low hashes of each oriented read, for all iterations
+    // of the current batch of hashBatchSize iterations.
+    // Indexed by OrientedReadId::getValue() * hashBatchSize + i,
+    // where i is the iteration in the batch.
+    // They are computed at the first iteration of each batch,
+    // in a single pass over the markers.
     uint64_t hashThreshold;
     vector< vector<uint64_t> > lowHashes;
-    void computeLowHashes(size_t threadId);
+    uint64_t batchIterationCount;   // The number of iterations in the current batch.
+    void computeLowHashes();
+    template<class FeatureHash> void computeLowHashesThreadFunction(size_t threadId);
+
+    // If storedSketches is not null, the low hashes
+    // are obtained from the stored sketches instead.
+    void getStoredLowHashes();
+    void getStoredLowHashesThreadFunction(size_t threadId);
+
+    // If newSketches is not null, store the low hashes
+    // of the current batch there.
+    void storeSketches();
+
+    // The low hashes of an oriented read at the current iteration.
+    vector<uint64_t>& getLowHashes(OrientedReadId orientedReadId)
+    {
+        return lowHashes[orientedReadId.getValue() * hashBatchSize + iteration % hashBatchSize];
+    }
 
     // The mask used to compute to compute the bucket
     // corresponding to a hash value.
@@ -103,62 +141,34 @@ private:
 
 
 
-    // Class used to store candidate pairs.
-    class Candidate {
-    public:
-        ReadId readId1;             // The higher numbered read in the pair, readId1 > readId0.
-        uint8_t strand;             // 0=same strand, 1=opposite strands.
-        uint16_t frequency;         // Number of times this pair was found during LowHash0.
-
-        // Create a new candidate with frequency 1.
-        Candidate(
-            ReadId readId1,
-            Strand strand) :
-            readId1(readId1), strand(uint8_t(strand)), frequency(1) {}
-
-        Candidate() {}
-
-        // Comparison operators.
-        bool operator==(const Candidate& that) const
-        {
-            return (readId1 == that.readId1) && (strand == that.strand);
-        }
-        bool operator<(const Candidate& that) const
-        {
-            return tie(readId1, strand) < tie(that.readId1, that.strand);
-        }
-    };
-    static_assert(sizeof(Candidate) == 8, "Unexpected size of LowHash0::Candidate.");
-
-
+    // The number of times each pair of reads was found, for each
+    // relative orientation. This is updated in place at each iteration.
+    CandidatePairTable candidateTable;
 
-    // Merge two sorted vectors of candidates into a third one.
-    // The input vectors can be sorted but can have duplicates.
-    // During merging, when two candidates with the same readId1
-    // and strand are found, they are combined, adding up their frequency.
-    // This is used by pass4ThreadFunction.
-    static void merge(
-        const vector<Candidate>&,
-        const vector<Candidate>&,
-        vector<Candidate>&
-        );
+    // An upper bound on the number of new entries in candidateTable
+    // at the current iteration, computed from the bucket histogram.
+    uint64_t newCandidateCountBound;
 
+    // Increment the frequency of a candidate pair
+    // and update the statistics for the calling thread.
+    void addCandidate(ReadId readId0, ReadId readId1, uint64_t strand, size_t threadId);
 
+    // Extract the candidates with frequency at least minFrequency.
+    // Each thread counts them in its slice of the table, then stores them
+    // in candidateAlignments starting at threadCandidateBegin[threadId].
+    void countCandidatesThreadFunction(size_t threadId);
+    void storeCandidatesThreadFunction(size_t threadId);
+    vector<uint64_t> threadCandidateBegin;
 
-    // The alignment candidates for each read.
-    // Indexed by readId0, the read id of the lower numbered read in the pair.
-    // We only store pairs with readId1>readId0.
-    // For each readId0, this is kept sorted.
-    vector< vector<Candidate> > candidates;
 
 
-
-    // Per-iteration statistics for each thread.
+    // Per-iteration statistics for each thread:
+    // the number of candidates that were created and the number
+    // that reached minFrequency during the current iteration.
     class ThreadStatistics {
     public:
         uint64_t highFrequency;
         uint64_t total;
-        uint64_t capacity;
         ThreadStatistics()
         {
             clear();
@@ -167,7 +177,6 @@ private:
         {
             highFrequency = 0;
             total = 0;
-            capacity = 0;
         }
 
     };
@@ -178,15 +187,72 @@ private:
     // Compute a histogram of the number of entries in each histogram.
     void computeBucketHistogram();
     void computeBucketHistogramThreadFunction(size_t threadId);
+    void writeBucketHistogram();
     vector< vector<uint64_t> > threadBucketHistogram;
     ofstream histogramCsv;
 
 
 
+    // Sorted bucket construction, used when sortBuckets is true.
+    // Instead of using the two-pass VectorOfVectors buckets,
+    // each thread emits (hash, orientedReadId) pairs for the low hashes
+    // of the oriented reads it processes. The pairs are then partitioned
+    // in parallel using the low bits of the hash (radix partitioning),
+    // and each partition is sorted. A bucket is a run of entries
+    // with the same hash, which means that the number of buckets
+    // does not need to be chosen and there are no collisions.
+    // Candidates found by scanning the runs are then added to candidateTable.
+    // This replaces random access to the buckets with mostly
+    // sequential memory traffic.
+    class SortEntry {
+    public:
+        uint64_t key;
+        uint64_t value;
+        SortEntry(uint64_t key, uint64_t value) : key(key), value(value) {}
+        SortEntry() {}
+        bool operator<(const SortEntry& that) const
+        {
+            return tie(key, value) < tie(that.key, that.value);
+        }
+    };
+    static const uint64_t sortPartitionBits = 12;
+    static const uint64_t sortPartitionCount = 1ULL << sortPartitionBits;
+    static uint64_t sortPartitionId(uint64_t key)
+    {
+        return key & (sortPartitionCount - 1);
+    }
+
+    // The entries generated by each thread.
+    vector< vector<SortEntry> > threadSortEntries;
+
+    // The entries of all threads, grouped by partition.
+    // The entries of partition i are in
+    // [sortPartitionBegin[i], sortPartitionBegin[i+1]).
+    vector<SortEntry> sortEntries;
+    vector<uint64_t> sortPartitionBegin;
+
+    // For each thread, the position in sortEntries
+    // where its next entry in each partition goes.
+    vector< vector<uint64_t> > threadSortPartitionPosition;
+
+    // Partition and sort the entries in threadSortEntries into sortEntries.
+    void partitionSortEntries();
+    void countSortEntriesThreadFunction(size_t threadId);
+    void scatterSortEntriesThreadFunction(size_t threadId);
+    void sortPartitionsThreadFunction(size_t threadId);
+
+    // Use sorted buckets to find candidates at the current iteration.
+    void findCandidatesWithSortedBuckets();
+    void gatherLowHashesThreadFunction(size_t threadId);
+    void scanSortedBucketsThreadFunction(size_t threadId);
+    void addSortedCandidatesThreadFunction(size_t threadId);
+
+
+
     // Thread functions.
 
-    // Pass1: compute the low hashes for each oriented read
-    // and prepare the buckets for filling.
+    // Pass1: count the low hashes in each bucket
+    // to prepare the buckets for filling.
     void pass1ThreadFunction(size_t threadId);
 
     // Pass 2: fill the buckets.
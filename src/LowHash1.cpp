@@ -1,6 +1,8 @@
 // Shasta.
 #include "LowHash1.hpp"
 #include "AlignmentCandidates.hpp"
+#include "LowHashFeatureHash.hpp"
+#include "LowHashSketches.hpp"
 #include "Marker.hpp"
 using namespace shasta;
 
@@ -18,10 +20,14 @@ LowHash1::LowHash1(
     size_t minBucketSize,           // The minimum size for a bucket to be used.
     size_t maxBucketSize,           // The maximum size for a bucket to be used.
     size_t minFrequency,            // Minimum number of minHash hits for a pair to be considered a candidate.
+    size_t hashBatchSize,           // Number of iterations for which hashes are computed together.
+    size_t hashFamily,              // 0 = MurmurHash64A, 1 = multiply-xorshift.
+    bool noKmerIdsCopy,             // Get KmerIds from the markers instead of a copy.
+    LowHashSketches* newSketches,   // If not null, store the low hash sketches here.
+    const LowHashSketches* storedSketches,  // If not null, use these instead of hashing.
     size_t threadCountArgument,
-    const MemoryMapped::Vector<KmerInfo>& kmerTable,
     const Reads& reads,
-    const MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>& markers,
+    const Markers& markers,
     AlignmentCandidates& candidates,
     const string& largeDataFileNamePrefix,
     size_t largeDataPageSize
@@ -32,8 +38,12 @@ LowHash1::LowHash1(
     minBucketSize(minBucketSize),
     maxBucketSize(maxBucketSize),
     minFrequency(minFrequency),
+    hashBatchSize(hashBatchSize),
+    hashFamily(hashFamily),
+    noKmerIdsCopy(noKmerIdsCopy),
+    newSketches(newSketches),
+    storedSketches(storedSketches),
     threadCount(threadCountArgument),
-    kmerTable(kmerTable),
     reads(reads),
     markers(markers),
     candidates(candidates),
@@ -50,6 +60,16 @@ LowHash1::LowHash1(
         threadCount = std::thread::hardware_concurrency();
     }
 
+    // Check the hash batch size and hash family.
+    if(hashBatchSize == 0 or hashBatchSize > maxLowHashBatchSize) {
+        throw runtime_error("LowHash1: invalid hash batch size " + to_string(hashBatchSize) +
+            ". Must be between 1 and " + to_string(maxLowHashBatchSize) + ".");
+    }
+    if(hashFamily > 1) {
+        throw runtime_error("LowHash1: invalid hash family " + to_string(hashFamily) +
+            ". Must be 0 or 1.");
+    }
+
     // Estimate the total number of low hashes and its base 2 log.
     // Except for very short reads, each marker generates a feature,
     // and each feature generates a low hash with probability hashFraction.
@@ -80,8 +100,10 @@ LowHash1::LowHash1(
 
     // Create vectors containing only the k-mer ids of all markers.
     // This is used to speed up the computation of hash functions.
-    cout << timestamp << "Creating kmer ids for oriented reads." << endl;
-    createKmerIds();
+    if(not noKmerIdsCopy) {
+        cout << timestamp << "Creating kmer ids for oriented reads." << endl;
+        createKmerIds();
+    }
 
     // Compute the threshold for a hash value to be considered low.
     hashThreshold = uint64_t(hashFraction * double(std::numeric_limits<uint64_t>::max()));
@@ -91,11 +113,19 @@ LowHash1::LowHash1(
     const ReadId readCount = orientedReadCount / 2;
     SHASTA_ASSERT(orientedReadCount == 2*readCount);
 
+    // If using stored sketches, check that they are compatible
+    // with the options we were given.
+    if(storedSketches) {
+        storedSketches->checkCanBeUsed(m, hashFraction, hashFamily,
+            orientedReadCount, minHashIterationCount, true);
+        cout << "LowHash1 will use stored sketches." << endl;
+    }
+
     // Set up work areas.
     buckets.createNew(
             largeDataFileNamePrefix.empty() ? "" : (largeDataFileNamePrefix + "tmp-LowHash-Buckets"),
             largeDataPageSize);
-    lowHashes.resize(orientedReadCount);
+    lowHashes.resize(orientedReadCount * hashBatchSize);
     threadCommonFeatures.resize(threadCount);
     for(size_t threadId=0; threadId!=threadCount; threadId++) {
         threadCommonFeatures[threadId] = make_shared<MemoryMapped::Vector<CommonFeature> >();
@@ -112,13 +142,27 @@ LowHash1::LowHash1(
     for(iteration=0; iteration<minHashIterationCount; iteration++) {
         cout << timestamp << "LowHash iteration " << iteration << " begins." << endl;
 
-        // Compute the low hashes for each oriented read
-        // and count the number of low hash features in each bucket.
+        // At the first iteration of each batch, compute the low hashes
+        // for each oriented read for all iterations in the batch.
+        size_t batchSize = 10000;
+        if((iteration % hashBatchSize) == 0) {
+            batchIterationCount = min(uint64_t(hashBatchSize), uint64_t(minHashIterationCount - iteration));
+            setupLoadBalancing(readCount, batchSize);
+            if(storedSketches) {
+                runThreads(&LowHash1::getStoredHashesThreadFunction, threadCount);
+            } else {
+                computeHashes();
+                if(newSketches) {
+                    storeSketches();
+                }
+            }
+        }
+
+        // Count the number of low hash features in each bucket.
         buckets.clear();
         buckets.beginPass1(bucketCount);
-        size_t batchSize = 10000;
         setupLoadBalancing(readCount, batchSize);
-        runThreads(&LowHash1::computeHashesThreadFunction, threadCount);
+        runThreads(&LowHash1::countBucketsThreadFunction, threadCount);
 
         // Fill the buckets.
         buckets.beginPass2();
@@ -163,7 +207,9 @@ LowHash1::LowHash1(
 
     // Clean up.
     buckets.remove();
-    kmerIds.remove();
+    if(kmerIds.isOpen()) {
+        kmerIds.remove();
+    }
     lowHashes.clear();
     commonFeatures.remove();
 
@@ -215,10 +261,7 @@ void LowHash1::createKmerIds(size_t threadId)
 
                 SHASTA_ASSERT(kmerIds.size(orientedReadId.getValue()) == orientedReadMarkers.size());
 
-                auto pointer = kmerIds.begin(orientedReadId.getValue());
-                for(const CompressedMarker& marker: orientedReadMarkers) {
-                    *pointer++ = marker.kmerId;
-                }
+                orientedReadMarkers.getKmerIds(kmerIds.begin(orientedReadId.getValue()));
             }
         }
     }
@@ -226,12 +269,27 @@ void LowHash1::createKmerIds(size_t threadId)
 
 
 
-// Thread function to compute the low hashes for each oriented read
-// and count the number of entries in each bucket.
-void LowHash1::computeHashesThreadFunction(size_t threadId)
+void LowHash1::computeHashes()
+{
+    if(hashFamily == 0) {
+        runThreads(&LowHash1::computeHashesThreadFunction<MurmurFeatureHash>, threadCount);
+    } else {
+        runThreads(&LowHash1::computeHashesThreadFunction<MultiplyShiftFeatureHash>, threadCount);
+    }
+}
+
+
+
+// Thread function to compute the low hashes for each oriented read,
+// for all iterations in the current batch.
+template<class FeatureHash> void LowHash1::computeHashesThreadFunction(size_t threadId)
 {
-    const int featureByteCount = int(m * sizeof(KmerId));
-    const uint64_t seed = iteration * 37;
+    const FeatureHash featureHash(iteration, batchIterationCount, m);
+    array<uint64_t, maxLowHashBatchSize> hashes;
+
+    // Work area used to gather the KmerIds of the markers of an oriented read
+    // when noKmerIdsCopy is set.
+    vector<KmerId> kmerIdsWorkArea;
 
     // Loop over batches assigned to this thread.
     uint64_t begin, end;
@@ -245,9 +303,12 @@ void LowHash1::computeHashesThreadFunction(size_t threadId)
             for(Strand strand=0; strand<2; strand++) {
                 const OrientedReadId orientedReadId(readId, strand);
 
-                vector< pair<uint64_t, uint32_t> >& orientedReadLowHashes = lowHashes[orientedReadId.getValue()];
-                orientedReadLowHashes.clear();
-                const size_t markerCount = kmerIds.size(orientedReadId.getValue());
+                vector< pair<uint64_t, uint32_t> >* orientedReadLowHashes =
+                    &lowHashes[orientedReadId.getValue() * hashBatchSize];
+                for(uint64_t i=0; i<batchIterationCount; i++) {
+                    orientedReadLowHashes[i].clear();
+                }
+                const size_t markerCount = markers.size(orientedReadId.getValue());
 
                 // Handle the pathological case where there are fewer than m markers.
                 // This oriented read ends up in no bucket.
@@ -255,23 +316,104 @@ void LowHash1::computeHashesThreadFunction(size_t threadId)
                     continue;
                 }
 
-                // Get the markers for this oriented read.
-                KmerId* kmerIdsPointer = kmerIds.begin(orientedReadId.getValue());
+                // Get the KmerIds of the markers of this oriented read.
+                const KmerId* kmerIdsPointer = noKmerIdsCopy ?
+                    markers[orientedReadId.getValue()].getKmerIds(kmerIdsWorkArea) :
+                    kmerIds.begin(orientedReadId.getValue());
                 const size_t featureCount = markerCount - m + 1;
 
                 // Loop over features of this oriented read.
                 // Features are sequences of m consecutive markers.
                 for(size_t j=0; j<featureCount; j++, kmerIdsPointer++) {
-                    const uint64_t hash = MurmurHash64A(kmerIdsPointer, featureByteCount, seed);
-                    if(hash < hashThreshold) {
-                        orientedReadLowHashes.push_back(make_pair(hash, j));
-                        const uint64_t bucketId = hash & mask;
-                        buckets.incrementCountMultithreaded(bucketId);
+                    featureHash(kmerIdsPointer, hashes.data());
+                    for(uint64_t i=0; i<batchIterationCount; i++) {
+                        const uint64_t hash = hashes[i];
+                        if(hash < hashThreshold) {
+                            orientedReadLowHashes[i].push_back(make_pair(hash, uint32_t(j)));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+}
+
+
+
+// Thread function to get the low hashes for each oriented read,
+// for all iterations in the current batch, from storedSketches.
+// If hashFraction is less than the one used to store the sketches,
+// only keep the hashes below the current threshold.
+void LowHash1::getStoredHashesThreadFunction(size_t threadId)
+{
+
+    // Loop over batches assigned to this thread.
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over oriented reads assigned to this batch.
+        for(ReadId readId=ReadId(begin); readId!=ReadId(end); readId++) {
+            if(reads.getFlags(readId).isPalindromic) {
+                continue;
+            }
+            for(Strand strand=0; strand<2; strand++) {
+                const OrientedReadId orientedReadId(readId, strand);
+                vector< pair<uint64_t, uint32_t> >* orientedReadLowHashes =
+                    &lowHashes[orientedReadId.getValue() * hashBatchSize];
+                for(uint64_t i=0; i<batchIterationCount; i++) {
+                    vector< pair<uint64_t, uint32_t> >& v = orientedReadLowHashes[i];
+                    v.clear();
+                    for(const LowHashSketches::Entry& entry:
+                        storedSketches->getSketch(iteration + i, orientedReadId)) {
+                        if(entry.hash < hashThreshold) {
+                            v.push_back(make_pair(entry.hash, entry.ordinal));
+                        }
                     }
                 }
             }
         }
     }
+}
+
+
+
+// Store the low hashes for the current batch in newSketches.
+void LowHash1::storeSketches()
+{
+    const OrientedReadId::Int orientedReadCount = OrientedReadId::Int(markers.size());
+    for(uint64_t i=0; i<batchIterationCount; i++) {
+        for(OrientedReadId::Int orientedReadId=0; orientedReadId<orientedReadCount; orientedReadId++) {
+            newSketches->storeSketch(lowHashes[orientedReadId * hashBatchSize + i]);
+        }
+        newSketches->endIteration();
+    }
+}
+
+
+
+// Thread function to count the number of entries in each bucket.
+void LowHash1::countBucketsThreadFunction(size_t threadId)
+{
+
+    // Loop over batches assigned to this thread.
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over oriented reads assigned to this batch.
+        for(ReadId readId=ReadId(begin); readId!=ReadId(end); readId++) {
+            if(reads.getFlags(readId).isPalindromic) {
+                continue;
+            }
+            for(Strand strand=0; strand<2; strand++) {
+                const OrientedReadId orientedReadId(readId, strand);
+                for(const auto& p: getLowHashes(orientedReadId)) {
+                    const uint64_t bucketId = p.first & mask;
+                    buckets.incrementCountMultithreaded(bucketId);
+                }
+            }
+        }
+    }
 
 }
 
@@ -292,7 +434,7 @@ void LowHash1::fillBucketsThreadFunction(size_t threadId)
             }
             for(Strand strand=0; strand<2; strand++) {
                 const OrientedReadId orientedReadId(readId, strand);
-                const vector< pair<uint64_t, uint32_t> > & orientedReadLowHashes = lowHashes[orientedReadId.getValue()];
+                const vector< pair<uint64_t, uint32_t> > & orientedReadLowHashes = getLowHashes(orientedReadId);
 
                 for(const auto& p: orientedReadLowHashes) {
                     const uint64_t hash = p.first;
@@ -367,6 +509,11 @@ void LowHash1::scanBucketsThreadFunction(size_t threadId)
 
     const uint64_t mLocal = uint64_t(m);
 
+    // Work areas used to gather the KmerIds of the two features being compared
+    // when noKmerIdsCopy is set.
+    vector<KmerId> featureKmerIdsWorkArea0(mLocal);
+    vector<KmerId> featureKmerIdsWorkArea1(mLocal);
+
     // Loop over batches assigned to this thread.
     uint64_t begin, end;
     while(getNextBatch(begin, end)) {
@@ -389,9 +536,9 @@ void LowHash1::scanBucketsThreadFunction(size_t threadId)
                 const ReadId readId0 = orientedReadId0.getReadId();
                 const Strand strand0 = orientedReadId0.getStrand();
                 const uint32_t ordinal0 = feature0.ordinal;
-                const auto allKmerIds0 = kmerIds[orientedReadId0.getValue()];
-                const auto featureKmerIds0 = allKmerIds0.begin() + ordinal0;
-                const uint32_t markerCount0 = uint32_t(allKmerIds0.size());
+                const uint32_t markerCount0 = uint32_t(markers.size(orientedReadId0.getValue()));
+                const KmerId* featureKmerIds0 = getFeatureKmerIds(
+                    orientedReadId0, ordinal0, featureKmerIdsWorkArea0);
 
                 for(const BucketEntry& feature1: bucket) {
                     const OrientedReadId orientedReadId1 = feature1.orientedReadId;
@@ -404,9 +551,9 @@ void LowHash1::scanBucketsThreadFunction(size_t threadId)
 
                     const Strand strand1 = orientedReadId1.getStrand();
                     const uint32_t ordinal1 = feature1.ordinal;
-                    const auto allKmerIds1 = kmerIds[orientedReadId1.getValue()];
-                    const auto featureKmerIds1 = allKmerIds1.begin() + ordinal1;
-                    const uint32_t markerCount1 = uint32_t(allKmerIds1.size());
+                    const uint32_t markerCount1 = uint32_t(markers.size(orientedReadId1.getValue()));
+                    const KmerId* featureKmerIds1 = getFeatureKmerIds(
+                        orientedReadId1, ordinal1, featureKmerIdsWorkArea1);
 
                     // If the k-mers are not the same, this is a collision. Discard.
                     if(not std::equal(featureKmerIds0, featureKmerIds0+mLocal, featureKmerIds1)) {
@@ -454,7 +601,7 @@ void LowHash1::gatherCommonFeatures()
     commonFeatures.createNew(
             largeDataFileNamePrefix.empty() ? "" : (largeDataFileNamePrefix + "tmp-CommonFeatures"),
             largeDataPageSize);
-    commonFeatures.beginPass1(kmerIds.size()/2);
+    commonFeatures.beginPass1(markers.size()/2);
     runThreads(&LowHash1::gatherCommonFeaturesPass1, threadCount);
     commonFeatures.beginPass2();
     runThreads(&LowHash1::gatherCommonFeaturesPass2, threadCount);
@@ -489,7 +636,7 @@ void LowHash1::gatherCommonFeaturesPass2(size_t threadId)
 // Each thread stores the alignment candidates it finds in its own vector.
 void LowHash1::processCommonFeatures()
 {
-    const uint64_t readCount = kmerIds.size() / 2;
+    const uint64_t readCount = markers.size() / 2;
     const uint64_t batchSize = 1000;
 
     // Prepare areas where each thread will store what it finds.
@@ -660,8 +807,8 @@ void LowHash1::processCommonFeaturesThreadFunction(size_t threadId)
                         int32_t(feature.ordinals[1]) - int32_t(feature.ordinals[0]) << "\n";
                 }
                 cout << "Marker count " <<
-                    kmerIds[OrientedReadId(readId0, 0).getValue()].size() << " " <<
-                    kmerIds[OrientedReadId(readId1, 0).getValue()].size() << ":\n";
+                    markers.size(OrientedReadId(readId0, 0).getValue()) << " " <<
+                    markers.size(OrientedReadId(readId1, 0).getValue()) << ":\n";
                 */
 
                 // This streak generates an alignment candidate
@@ -3,6 +3,7 @@
 
 // Shasta
 #include "Kmer.hpp"
+#include "Markers.hpp"
 #include "MemoryMappedVectorOfVectors.hpp"
 #include "MultithreadedObject.hpp"
 #include "OrientedReadPair.hpp"
@@ -14,6 +15,7 @@
 namespace shasta {
     class AlignmentCandidates;
     class LowHash1;
+    class LowHashSketches;
     class CompressedMarker;
     class OrientedReadPair;
 }
@@ -35,10 +37,14 @@ public:
         size_t minBucketSize,           // The minimum size for a bucket to be used.
         size_t maxBucketSize,           // The maximum size for a bucket to be used.
         size_t minFrequency,            // Minimum number of minHash hits for a pair to be considered a candidate.
+        size_t hashBatchSize,           // Number of iterations for which hashes are computed together.
+        size_t hashFamily,              // 0 = MurmurHash64A, 1 = multiply-xorshift.
+        bool noKmerIdsCopy,             // Get KmerIds from the markers instead of a copy.
+        LowHashSketches* newSketches,   // If not null, store the low hash sketches here.
+        const LowHashSketches* storedSketches,  // If not null, use these instead of hashing.
         size_t threadCount,
-        const MemoryMapped::Vector<KmerInfo>& kmerTable,
         const Reads& reads,
-        const MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>&,
+        const Markers&,
         AlignmentCandidates& candidates,
         const string& largeDataFileNamePrefix,
         size_t largeDataPageSize
@@ -52,10 +58,14 @@ private:
     size_t minBucketSize;           // The minimum size for a bucket to be used.
     size_t maxBucketSize;           // The maximum size for a bucket to be used.
     size_t minFrequency;            // Minimum number of minHash hits for a pair to be considered a candidate.
+    size_t hashBatchSize;           // Number of iterations for which hashes are computed together.
+    size_t hashFamily;              // 0 = MurmurHash64A, 1 = multiply-xorshift.
+    bool noKmerIdsCopy;             // Get KmerIds from the markers instead of a copy.
+    LowHashSketches* newSketches;
+    const LowHashSketches* storedSketches;
     size_t threadCount;
-    const MemoryMapped::Vector<KmerInfo>& kmerTable;
     const Reads& reads;
-    const MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>& markers;
+    const Markers& markers;
     AlignmentCandidates& candidates;
     const string& largeDataFileNamePrefix;
     size_t largeDataPageSize;
@@ -64,6 +74,9 @@ private:
     // for all oriented reads.
     // Indexed by OrientedReadId.getValue().
     // This is used to speed up the computation of hash functions.
+    // It is not created if noKmerIdsCopy is set. In that case the KmerIds
+    // are gathered from the markers when needed,
+    // which uses less memory but is slower.
     MemoryMapped::VectorOfVectors<KmerId, uint64_t> kmerIds;
     void createKmerIds();
     void createKmerIds(size_t threadId);
@@ -76,16 +89,25 @@ private:
     uint64_t hashThreshold;
 
     // The current MinHash iteration.
-    // This is used to compute a different MurmurHash function
+    // This is used to compute a different hash function
     // at each iteration.
     size_t iteration;
 
     // The low hashes of each oriented read and the ordinals at
-    // which the corresponding feature occurs.
-    // This is recomputed at each iteration.
-    // Indexed by OrientedReadId::getValue().
+    // which the corresponding feature occurs, for all iterations
+    // of the current batch of hashBatchSize iterations.
+    // This is recomputed at the first iteration of each batch,
+    // in a single pass over the markers.
+    // Indexed by OrientedReadId::getValue() * hashBatchSize + i,
+    // where i is the iteration in the batch.
     vector< vector< pair<uint64_t, uint32_t> > > lowHashes;
-    void computeLowHashes(size_t threadId);
+    uint64_t batchIterationCount;   // The number of iterations in the current batch.
+
+    // The low hashes of an oriented read at the current iteration.
+    vector< pair<uint64_t, uint32_t> >& getLowHashes(OrientedReadId orientedReadId)
+    {
+        return lowHashes[orientedReadId.getValue() * hashBatchSize + iteration % hashBatchSize];
+    }
 
     // Each bucket entry describes a low hash feature.
     // It consists of an oriented read id and
@@ -207,15 +229,42 @@ private:
 
     // Thread functions.
 
-    // Thread function to compute the low hashes for each oriented read
-    // and count the number of entries in each bucket.
-    void computeHashesThreadFunction(size_t threadId);
+    // Compute the low hashes for each oriented read,
+    // for all iterations in the current batch.
+    void computeHashes();
+    template<class FeatureHash> void computeHashesThreadFunction(size_t threadId);
+
+    // Get the low hashes for each oriented read,
+    // for all iterations in the current batch, from storedSketches.
+    void getStoredHashesThreadFunction(size_t threadId);
+
+    // Store the low hashes for the current batch in newSketches.
+    void storeSketches();
+
+    // Thread function to count the number of entries in each bucket.
+    void countBucketsThreadFunction(size_t threadId);
 
     // Thread function to fill the buckets.
     void fillBucketsThreadFunction(size_t threadId);
 
     // Thread function to scan the buckets to find common features.
     void scanBucketsThreadFunction(size_t threadId);
+
+    // Return a pointer to the m KmerIds of the feature
+    // that begins at the given ordinal.
+    // If noKmerIdsCopy is set, they are gathered into the given work area.
+    const KmerId* getFeatureKmerIds(
+        OrientedReadId orientedReadId,
+        uint32_t ordinal,
+        vector<KmerId>& workArea) const
+    {
+        if(noKmerIdsCopy) {
+            markers[orientedReadId.getValue()].getKmerIds(ordinal, m, workArea.data());
+            return workArea.data();
+        } else {
+            return kmerIds.begin(orientedReadId.getValue()) + ordinal;
+        }
+    }
 };
 
 #endif
@@ -0,0 +1,131 @@
+#ifndef SHASTA_LOW_HASH_FEATURE_HASH_HPP
+#define SHASTA_LOW_HASH_FEATURE_HASH_HPP
+
+/*******************************************************************************
+
+Hash families used by LowHash0 and LowHash1 to hash features
+(sequences of m consecutive marker KmerIds).
+
+Each LowHash iteration uses a different hash function from the family.
+To reduce the number of passes over the markers, the hashes
+for a batch of consecutive iterations are computed together:
+each feature is read once, and the hash of the feature
+for each iteration in the batch is computed from it.
+Each hash family is a class with:
+
+- A constructor taking the first iteration of the batch,
+  the number of iterations in the batch, and m.
+
+- A const operator()(const KmerId* feature, uint64_t* hashes)
+  that stores in hashes[i] the hash of the feature
+  for iteration firstIteration+i.
+
+LowHash0 and LowHash1 use the hash family as a template parameter
+of their hash computation, so the hash function is inlined.
+
+MurmurFeatureHash uses MurmurHash64A with seed 37*iteration,
+and gives the same hashes that were used before batching was introduced.
+
+MultiplyShiftFeatureHash first combines the KmerIds of the feature
+into a 64-bit key using multiply-xorshift steps. The hash for each
+iteration is then obtained by combining the key with a seed
+for that iteration and applying a multiply-xorshift finalizer.
+This is much faster than MurmurHash64A, and the
+hashes obtained are sufficiently independent for LowHash.
+
+The batched hash loop over iterations is scalar.
+
+*******************************************************************************/
+
+// Shasta.
+#include "Kmer.hpp"
+#include "MurmurHash2.hpp"
+#include "SHASTA_ASSERT.hpp"
+
+// Standard library.
+#include "array.hpp"
+
+namespace shasta {
+    class MurmurFeatureHash;
+    class MultiplyShiftFeatureHash;
+
+    // The maximum number of LowHash iterations processed in a batch.
+    const uint64_t maxLowHashBatchSize = 16;
+}
+
+
+
+class shasta::MurmurFeatureHash {
+public:
+
+    MurmurFeatureHash(uint64_t firstIteration, uint64_t batchSize, uint64_t m) :
+        batchSize(batchSize),
+        featureByteCount(int(m * sizeof(KmerId)))
+    {
+        SHASTA_ASSERT(batchSize > 0 and batchSize <= maxLowHashBatchSize);
+        for(uint64_t i=0; i<batchSize; i++) {
+            seeds[i] = (firstIteration + i) * 37;
+        }
+    }
+
+    void operator()(const KmerId* feature, uint64_t* hashes) const
+    {
+        for(uint64_t i=0; i<batchSize; i++) {
+            hashes[i] = MurmurHash64A(feature, featureByteCount, seeds[i]);
+        }
+    }
+
+private:
+    uint64_t batchSize;
+    int featureByteCount;
+    array<uint64_t, maxLowHashBatchSize> seeds;
+};
+
+
+
+class shasta::MultiplyShiftFeatureHash {
+public:
+
+    MultiplyShiftFeatureHash(uint64_t firstIteration, uint64_t batchSize, uint64_t m) :
+        batchSize(batchSize),
+        m(m)
+    {
+        SHASTA_ASSERT(batchSize > 0 and batchSize <= maxLowHashBatchSize);
+        for(uint64_t i=0; i<batchSize; i++) {
+            seeds[i] = finalize((firstIteration + i + 1) * 0x9e3779b97f4a7c15ULL);
+        }
+    }
+
+    void operator()(const KmerId* feature, uint64_t* hashes) const
+    {
+        // Combine the KmerIds into a 64-bit key.
+        uint64_t key = m * 0x9e3779b97f4a7c15ULL;
+        for(uint64_t j=0; j<m; j++) {
+            key = (key ^ uint64_t(feature[j])) * 0xff51afd7ed558ccdULL;
+            key ^= key >> 32;
+        }
+
+        // Compute the hash for each iteration in the batch.
+        for(uint64_t i=0; i<batchSize; i++) {
+            hashes[i] = finalize(key ^ seeds[i]);
+        }
+    }
+
+private:
+    uint64_t batchSize;
+    uint64_t m;
+    array<uint64_t, maxLowHashBatchSize> seeds;
+
+    // The splitmix64 finalizer.
+    static uint64_t finalize(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+};
+
+#endif
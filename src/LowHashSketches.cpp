@@ -0,0 +1,113 @@
+// Shasta.
+#include "LowHashSketches.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "stdexcept.hpp"
+
+
+
+void LowHashSketches::createNew(
+    const string& name,
+    size_t pageSize,
+    uint64_t m,
+    double hashFraction,
+    uint64_t hashFamily,
+    uint64_t orientedReadCount,
+    bool hasOrdinals)
+{
+    info.createNew(name.empty() ? "" : (name + "-Info"), pageSize);
+    info->m = m;
+    info->hashFraction = hashFraction;
+    info->hashFamily = hashFamily;
+    info->orientedReadCount = orientedReadCount;
+    info->iterationCount = 0;
+    info->hasOrdinals = hasOrdinals;
+    sketches.createNew(name.empty() ? "" : (name + "-Sketches"), pageSize);
+}
+
+
+
+void LowHashSketches::accessExistingReadOnly(const string& name)
+{
+    info.accessExistingReadOnly(name + "-Info");
+    sketches.accessExistingReadOnly(name + "-Sketches");
+    if(sketches.size() != info->iterationCount * info->orientedReadCount) {
+        throw runtime_error("LowHash sketches in " + name + " are incomplete.");
+    }
+}
+
+
+
+// Check that the stored sketches can be used with the given options.
+void LowHashSketches::checkCanBeUsed(
+    uint64_t m,
+    double hashFraction,
+    uint64_t hashFamily,
+    uint64_t orientedReadCount,
+    uint64_t minHashIterationCount,
+    bool needOrdinals) const
+{
+    if(m != info->m) {
+        throw runtime_error("Stored LowHash sketches were computed with m " +
+            to_string(info->m) + " and cannot be used with m " + to_string(m) + ".");
+    }
+    if(hashFamily != info->hashFamily) {
+        throw runtime_error("Stored LowHash sketches were computed with hash family " +
+            to_string(info->hashFamily) + " and cannot be used with hash family " +
+            to_string(hashFamily) + ".");
+    }
+    if(hashFraction > info->hashFraction) {
+        throw runtime_error("Stored LowHash sketches were computed with hash fraction " +
+            to_string(info->hashFraction) + " and cannot be used with a larger hash fraction " +
+            to_string(hashFraction) + ".");
+    }
+    if(orientedReadCount != info->orientedReadCount) {
+        throw runtime_error("Stored LowHash sketches were computed for " +
+            to_string(info->orientedReadCount) + " oriented reads but there are " +
+            to_string(orientedReadCount) + ".");
+    }
+    if(minHashIterationCount > info->iterationCount) {
+        throw runtime_error("Requested " + to_string(minHashIterationCount) +
+            " LowHash iterations but only " + to_string(info->iterationCount) +
+            " are stored.");
+    }
+    if(needOrdinals and not info->hasOrdinals) {
+        throw runtime_error("Stored LowHash sketches were computed by LowHash0 "
+            "and cannot be used by LowHash1.");
+    }
+}
+
+
+
+// Store the sketch of the next oriented read, without ordinals.
+void LowHashSketches::storeSketch(const vector<uint64_t>& hashes)
+{
+    SHASTA_ASSERT(not info->hasOrdinals);
+    sketches.appendVector();
+    for(const uint64_t hash: hashes) {
+        sketches.append(Entry(hash, noOrdinal));
+    }
+}
+
+
+
+// Store the sketch of the next oriented read, with ordinals.
+void LowHashSketches::storeSketch(const vector< pair<uint64_t, uint32_t> >& hashes)
+{
+    SHASTA_ASSERT(info->hasOrdinals);
+    sketches.appendVector();
+    for(const auto& p: hashes) {
+        sketches.append(Entry(p.first, p.second));
+    }
+}
+
+
+
+// Check that sketches were stored for all oriented reads
+// at the iteration being stored.
+void LowHashSketches::endIteration()
+{
+    ++info->iterationCount;
+    SHASTA_ASSERT(sketches.size() == info->iterationCount * info->orientedReadCount);
+}
@@ -0,0 +1,112 @@
+#ifndef SHASTA_LOW_HASH_SKETCHES_HPP
+#define SHASTA_LOW_HASH_SKETCHES_HPP
+
+/*******************************************************************************
+
+Class LowHashSketches stores the low hash sketches computed by
+LowHash0 or LowHash1, so alignment candidates can later be regenerated
+under different thresholds without hashing the markers again.
+
+The sketch of an oriented read at a LowHash iteration is the list
+of low hashes of its features at that iteration. For LowHash1,
+each low hash is stored together with the ordinal of its feature.
+LowHash0 does not keep track of ordinals, so sketches stored by
+LowHash0 can only be used by LowHash0.
+
+Sketches are stored for consecutive iterations, starting at iteration 0.
+For each iteration, there is one sketch for each oriented read,
+including palindromic reads, whose sketches are empty.
+The sketch for an iteration and oriented read is at index
+iteration * orientedReadCount + orientedReadId.getValue()
+of a VectorOfVectors.
+
+The sketches depend on m, hashFraction, and hashFamily, which are
+stored with them. When regenerating alignment candidates,
+m and hashFamily must be the same as when the sketches were stored.
+A smaller hashFraction can be used, by only keeping stored hashes
+below the corresponding threshold.
+
+*******************************************************************************/
+
+// Shasta.
+#include "MemoryMappedObject.hpp"
+#include "MemoryMappedVectorOfVectors.hpp"
+#include "ReadId.hpp"
+
+// Standard library.
+#include "string.hpp"
+#include "utility.hpp"
+#include "vector.hpp"
+
+namespace shasta {
+    class LowHashSketches;
+}
+
+
+
+class shasta::LowHashSketches {
+public:
+
+    class Entry {
+    public:
+        uint64_t hash;
+        uint32_t ordinal;
+        Entry(uint64_t hash, uint32_t ordinal) : hash(hash), ordinal(ordinal) {}
+        Entry() {}
+    };
+
+    // The ordinal stored when ordinals are not available.
+    static const uint32_t noOrdinal = std::numeric_limits<uint32_t>::max();
+
+    class Info {
+    public:
+        uint64_t m;
+        double hashFraction;
+        uint64_t hashFamily;
+        uint64_t orientedReadCount;
+        uint64_t iterationCount;
+        bool hasOrdinals;
+    };
+
+    void createNew(
+        const string& name,
+        size_t pageSize,
+        uint64_t m,
+        double hashFraction,
+        uint64_t hashFamily,
+        uint64_t orientedReadCount,
+        bool hasOrdinals);
+    void accessExistingReadOnly(const string& name);
+
+    // Check that the stored sketches can be used with the given options.
+    // Throws an exception if they cannot.
+    void checkCanBeUsed(
+        uint64_t m,
+        double hashFraction,
+        uint64_t hashFamily,
+        uint64_t orientedReadCount,
+        uint64_t minHashIterationCount,
+        bool needOrdinals) const;
+
+    // Information about the stored sketches.
+    MemoryMapped::Object<Info> info;
+
+    // Store the sketch of the next oriented read
+    // at the iteration being stored.
+    // Sketches must be stored for all oriented reads in order,
+    // then endIteration must be called.
+    void storeSketch(const vector<uint64_t>&);
+    void storeSketch(const vector< pair<uint64_t, uint32_t> >&);
+    void endIteration();
+
+    // Access the sketch of an oriented read at a given iteration.
+    span<const Entry> getSketch(uint64_t iteration, OrientedReadId orientedReadId) const
+    {
+        return sketches[iteration * info->orientedReadCount + orientedReadId.getValue()];
+    }
+
+private:
+    MemoryMapped::VectorOfVectors<Entry, uint64_t> sketches;
+};
+
+#endif
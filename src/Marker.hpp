@@ -36,8 +36,9 @@ namespace shasta {
 // which requires only 5 bytes per marker.
 
 // For a run with 120 Gb of coverage and 10% of k-mers
-// used as markers, storing all the 24 G markers requires
-// 120 GB (we store markers for each read on both strands).
+// used as markers, storing the 12 G markers on strand 0
+// requires 60 GB. Markers on strand 1 are not stored
+// and are computed when needed (see Markers.hpp).
 // This compares with 30 GB to store the reads
 // (we store reads on one strand only).
 
@@ -1,28 +1,63 @@
 // shasta.
 #include "MarkerFinder.hpp"
 #include "LongBaseSequence.hpp"
+#include "MurmurHash2.hpp"
 #include "ReadId.hpp"
 #include "timestamp.hpp"
 using namespace shasta;
 
 // Standard library.
 #include <chrono>
+#include "algorithm.hpp"
+#include "stdexcept.hpp"
 #include <limits>
 
 
 MarkerFinder::MarkerFinder(
     size_t k,
     const MemoryMapped::Vector<KmerInfo>& kmerTable,
+    const SparseKmerTable& sparseKmerTable,
     const Reads& reads,
-    MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>& markers,
-    size_t threadCountArgument) :
+    Markers& markers,
+    size_t threadCountArgument,
+    uint64_t markerSelectionMethod,
+    uint64_t minimizerWindow,
+    uint64_t syncmerS) :
     MultithreadedObject(*this),
     k(k),
     kmerTable(kmerTable),
+    sparseKmerTable(sparseKmerTable),
     reads(reads),
     markers(markers),
-    threadCount(threadCountArgument)
+    threadCount(threadCountArgument),
+    markerSelectionMethod(markerSelectionMethod),
+    minimizerWindow(minimizerWindow),
+    syncmerS(syncmerS)
 {
+    // Check the marker selection method.
+    switch(markerSelectionMethod) {
+    case 0:
+        break;
+    case 1:
+        if(minimizerWindow == 0) {
+            throw runtime_error("Invalid minimizer window " + to_string(minimizerWindow));
+        }
+        break;
+    case 2:
+        if(syncmerS == 0 or syncmerS >= k or ((k - syncmerS) % 2) != 0) {
+            throw runtime_error("Invalid syncmer s-mer length " + to_string(syncmerS) +
+                " for k = " + to_string(k) +
+                ". It must be less than k, and k-s must be even.");
+        }
+        break;
+    default:
+        throw runtime_error("Invalid marker selection method " + to_string(markerSelectionMethod));
+    }
+    if(markerSelectionMethod != 0 and sparseKmerTable.isOpen()) {
+        throw runtime_error("Minimizer and syncmer marker selection "
+            "is not supported with the sparse k-mer table.");
+    }
+
     // Initial message.
     cout << timestamp << "Finding markers in " << reads.readCount() << " reads." << endl;
     const auto tBegin = std::chrono::steady_clock::now();
@@ -32,18 +67,33 @@ MarkerFinder::MarkerFinder(
         threadCount = std::thread::hardware_concurrency();
     }
 
+    // Store k, which is needed to compute markers on strand 1.
+    markers.k.resize(1);
+    markers.k[0] = k;
+
+    // Find the markers of each read on strand 0 and store them
+    // in per-thread staging areas. This also counts the markers
+    // of each read.
     const size_t batchSize = 100;
-    markers.beginPass1(2 * reads.readCount());
-    setupLoadBalancing(reads.readCount(), batchSize);
-    pass = 1;
-    runThreads(&MarkerFinder::threadFunction, threadCount);
-    markers.beginPass2();
-    markers.endPass2(false);
+    markers.strand0Markers.beginPass1(reads.readCount());
+    markers.lastPositions.resize(reads.readCount());
+    stagingAreas.clear();
+    stagingAreas.resize(threadCount);
     setupLoadBalancing(reads.readCount(), batchSize);
-    pass = 2;
     runThreads(&MarkerFinder::threadFunction, threadCount);
 
+    // Compute the final position of the markers of each read.
+    markers.strand0Markers.beginPass2();
+    markers.strand0Markers.endPass2(false);
+
+    // Each thread copies the markers in its staging area
+    // to their final position.
+    runThreads(&MarkerFinder::scatterThreadFunction, threadCount);
+    stagingAreas.clear();
+
+    // Release the capacity reserved but not used.
     markers.unreserve();
+
     // Final message.
     const auto tEnd = std::chrono::steady_clock::now();
     const double tTotal = 1.e-9 * double((std::chrono::duration_cast<std::chrono::nanoseconds>(tEnd - tBegin)).count());
@@ -54,6 +104,11 @@ MarkerFinder::MarkerFinder(
 
 void MarkerFinder::threadFunction(size_t threadId)
 {
+    StagingArea& stagingArea = stagingAreas[threadId];
+
+    // Work areas for marker selection methods 1 and 2.
+    vector<bool> isSelected;
+    SelectionWorkArea workArea;
 
     // Loop over batches assigned to this thread.
     uint64_t begin, end;
@@ -61,64 +116,188 @@ void MarkerFinder::threadFunction(size_t threadId)
 
         // Loop over reads of this batch.
         for(ReadId readId=ReadId(begin); readId!=ReadId(end); readId++) {
-
             const LongBaseSequenceView read = reads.getRead(readId);
-            size_t markerCount = 0; // For this read.
-            CompressedMarker* markerPointerStrand0 = 0;
-            CompressedMarker* markerPointerStrand1 = 0;
-            if(pass == 2) {
-                markerPointerStrand0 = markers.begin(OrientedReadId(readId, 0).getValue());
-                markerPointerStrand1 = markers.end(OrientedReadId(readId, 1).getValue()) - 1ULL;
-            }
+            stagingArea.readIds.push_back(readId);
+            const uint64_t markerCountBefore = stagingArea.markers.size();
 
             if(read.baseCount >= k) {   // Avoid pathological case.
 
-                // Loop over k-mers of this read.
-                Kmer kmer;
-                for(size_t position=0; position<k; position++) {
-                    kmer.set(position, read[position]);
+                // For minimizers and syncmers, flag
+                // the positions of this read that are markers.
+                if(markerSelectionMethod == 1) {
+                    flagMinimizers(read, isSelected, workArea);
+                } else if(markerSelectionMethod == 2) {
+                    flagSyncmers(read, isSelected, workArea);
                 }
-                for(uint32_t position=0; /*The check is done later */; position++) {
-                    const KmerId kmerId = KmerId(kmer.id(k));
-                    if(kmerTable[kmerId].isMarker) {
-                        // This k-mer is a marker.
-
-                        if(pass == 1) {
-                            ++markerCount;
-                        } else {
-                            // Strand 0.
-                            markerPointerStrand0->kmerId = kmerId;
-                            markerPointerStrand0->position = position;
-                            ++markerPointerStrand0;
-
-                            // Strand 1.
-                            markerPointerStrand1->kmerId = kmerTable[kmerId].reverseComplementedKmerId;
-                            markerPointerStrand1->position = uint32_t(read.baseCount - k - position);
-                            --markerPointerStrand1;
 
+                // Loop over k-mers of this read.
+                forEachKmer(read,
+                    [&](uint32_t position, KmerId kmerId)
+                    {
+                        const bool isMarkerPosition = (markerSelectionMethod == 0) ?
+                            isMarker(kmerId) : bool(isSelected[position]);
+                        if(isMarkerPosition) {
+                            stagingArea.markers.push_back(CompressedMarker());
+                            CompressedMarker& marker = stagingArea.markers.back();
+                            marker.kmerId = kmerId;
+                            marker.position = position;
                         }
-                    }
+                    });
+            }
 
-                    if(position+k == read.baseCount) {
-                        break;
-                    }
+            markers.strand0Markers.incrementCount(readId,
+                stagingArea.markers.size() - markerCountBefore);
+            markers.lastPositions[readId] = (read.baseCount >= k) ? uint32_t(read.baseCount - k) : 0;
+        }
+    }
 
-                    // Update the k-mer.
-                    kmer.shiftLeft();
-                    kmer.set(k-1, read[position+k]);
-                }
-            }
+}
 
-            if(pass == 1) {
-                markers.incrementCount(OrientedReadId(readId, 0).getValue(), markerCount);
-                markers.incrementCount(OrientedReadId(readId, 1).getValue(), markerCount);
-            } else {
-                SHASTA_ASSERT(markerPointerStrand0 ==
-                    markers.end(OrientedReadId(readId, 0).getValue()));
-                SHASTA_ASSERT(markerPointerStrand1 ==
-                    markers.begin(OrientedReadId(readId, 1).getValue()) - 1ULL);
-            }
+
+
+// Copy the markers in the staging area of a thread to their final position.
+void MarkerFinder::scatterThreadFunction(size_t threadId)
+{
+    StagingArea& stagingArea = stagingAreas[threadId];
+    const CompressedMarker* stagedMarker = stagingArea.markers.data();
+
+    for(const ReadId readId: stagingArea.readIds) {
+        const uint64_t markerCount = markers.strand0Markers.size(readId);
+        copy(stagedMarker, stagedMarker + markerCount, markers.strand0Markers.begin(readId));
+        stagedMarker += markerCount;
+    }
+    SHASTA_ASSERT(stagedMarker == stagingArea.markers.data() + stagingArea.markers.size());
+
+    // Free the staging area of this thread.
+    stagingArea = StagingArea();
+}
+
+
+
+// Flag the positions of a read that are window minimizers.
+void MarkerFinder::flagMinimizers(
+    const LongBaseSequenceView& read,
+    vector<bool>& isSelected,
+    SelectionWorkArea& workArea) const
+{
+    const uint64_t kmerCount = read.baseCount + 1 - k;
+
+    // Gather the hash values of the k-mers of this read.
+    // The hash value stored in the k-mer table is the same
+    // for a k-mer and its reverse complement.
+    vector<uint32_t>& hashes = workArea.hashes;
+    hashes.resize(kmerCount);
+    forEachKmer(read, [&](uint32_t position, KmerId kmerId)
+    {
+        hashes[position] = kmerTable[kmerId].hash;
+    });
+
+    // If the read is shorter than a window, use a single window.
+    const uint64_t w = min(minimizerWindow, kmerCount);
+
+    // The minimum hash value in each window.
+    const uint64_t windowCount = kmerCount + 1 - w;
+    slidingWindowExtreme(hashes, w, false, workArea.minima, workArea.queue);
+
+    // A k-mer is a minimizer if its hash value equals the minimum
+    // of at least one window containing it. Because its hash value is
+    // greater than or equal to the minimum of any window containing it,
+    // this is the case if its hash value equals the maximum
+    // of the minima of all windows that contain it.
+    // To compute that, we pad the minima with w-1 zeros on each side.
+    vector<uint32_t>& padded = workArea.padded;
+    padded.clear();
+    padded.resize(w - 1, 0);
+    padded.insert(padded.end(), workArea.minima.begin(), workArea.minima.end());
+    padded.resize(windowCount + 2 * (w - 1), 0);
+    slidingWindowExtreme(padded, w, true, workArea.maxima, workArea.queue);
+    SHASTA_ASSERT(workArea.maxima.size() == kmerCount);
+
+    isSelected.resize(kmerCount);
+    for(uint64_t position=0; position<kmerCount; position++) {
+        isSelected[position] = (hashes[position] == workArea.maxima[position]);
+    }
+}
+
+
+
+// Flag the positions of a read that are open syncmers
+// with the s-mer at offset (k-s)/2.
+void MarkerFinder::flagSyncmers(
+    const LongBaseSequenceView& read,
+    vector<bool>& isSelected,
+    SelectionWorkArea& workArea) const
+{
+    const uint64_t s = syncmerS;
+    const uint64_t offset = (k - s) / 2;
+    const uint64_t kmerCount = read.baseCount + 1 - k;
+    const uint64_t smerCount = read.baseCount + 1 - s;
+
+    // Gather the hash values of the canonical s-mers of this read.
+    // We keep the s-mer and its reverse complement as integers
+    // with 2 bits per base, updated as we move along the read.
+    vector<uint32_t>& hashes = workArea.hashes;
+    hashes.resize(smerCount);
+    const uint64_t mask = (s == 32) ? std::numeric_limits<uint64_t>::max() : ((1ULL << (2 * s)) - 1ULL);
+    const uint64_t reverseComplementShift = 2 * (s - 1);
+    uint64_t smer = 0;
+    uint64_t reverseComplementedSmer = 0;
+    for(uint64_t position=0; position<read.baseCount; position++) {
+        const uint64_t base = read[position].value;
+        smer = ((smer << 2) | base) & mask;
+        reverseComplementedSmer = (reverseComplementedSmer >> 2) | ((3ULL - base) << reverseComplementShift);
+        if(position + 1 >= s) {
+            const uint64_t canonicalSmer = min(smer, reverseComplementedSmer);
+            hashes[position + 1 - s] = MurmurHash2(&canonicalSmer, sizeof(canonicalSmer), 759);
         }
     }
 
+    // The minimum s-mer hash value in each k-mer.
+    slidingWindowExtreme(hashes, k + 1 - s, false, workArea.minima, workArea.queue);
+    SHASTA_ASSERT(workArea.minima.size() == kmerCount);
+
+    isSelected.resize(kmerCount);
+    for(uint64_t position=0; position<kmerCount; position++) {
+        isSelected[position] = (hashes[position + offset] == workArea.minima[position]);
+    }
+}
+
+
+
+void MarkerFinder::slidingWindowExtreme(
+    const vector<uint32_t>& values,
+    uint64_t w,
+    bool computeMaximum,
+    vector<uint32_t>& result,
+    vector<uint64_t>& queue)
+{
+    const uint64_t n = values.size();
+    SHASTA_ASSERT(w > 0 and w <= n);
+    result.resize(n + 1 - w);
+
+    // The queue contains indexes into values, and the corresponding
+    // values are strictly increasing (decreasing if computeMaximum is true)
+    // from front to back. The front is the extreme of the current window.
+    queue.resize(n);
+    uint64_t front = 0;
+    uint64_t back = 0;
+    for(uint64_t i=0; i<n; i++) {
+        const uint32_t value = values[i];
+        if(computeMaximum) {
+            while(back > front and values[queue[back-1]] <= value) {
+                --back;
+            }
+        } else {
+            while(back > front and values[queue[back-1]] >= value) {
+                --back;
+            }
+        }
+        queue[back++] = i;
+        if(queue[front] + w <= i) {
+            ++front;
+        }
+        if(i + 1 >= w) {
+            result[i + 1 - w] = values[queue[front]];
+        }
+    }
 }
@@ -2,8 +2,13 @@
 #define SHASTA_MARKER_FINDER_HPP
 
 #include "Marker.hpp"
+#include "Markers.hpp"
 #include "MultithreadedObject.hpp"
 #include "Reads.hpp"
+#include "SparseKmerTable.hpp"
+
+#include "algorithm.hpp"
+#include "vector.hpp"
 
 namespace shasta {
     class MarkerFinder;
@@ -17,33 +22,153 @@ namespace shasta {
 
 
 
+/*******************************************************************************
+
+Class MarkerFinder finds the markers in all reads.
+
+The markerSelectionMethod passed to the constructor controls
+which occurrences of marker k-mers are used as markers:
+
+0 = All occurrences of k-mers flagged as markers in the k-mer table.
+
+1 = Window minimizers. In each window of minimizerWindow consecutive
+    k-mers of a read, the k-mers with the lowest hash value
+    (as stored in the k-mer table) are markers.
+    This guarantees that no window of minimizerWindow consecutive
+    k-mers is free of markers.
+    All k-mers with the lowest hash value in a window are used,
+    which makes the selection independent of strand.
+
+2 = Open syncmers. A k-mer is a marker if the s-mer at offset (k-s)/2,
+    in the middle of the k-mer, has the lowest hash value among all s-mers
+    of the k-mer. S-mers are hashed in canonical form, and (k-s)
+    must be even, which makes the selection independent of strand.
+    The expected marker density is 1/(k-s+1).
+
+For methods 1 and 2, the k-mer table must flag all k-mers as markers.
+
+*******************************************************************************/
+
 class shasta::MarkerFinder :
     public MultithreadedObject<MarkerFinder>{
 public:
 
     // The constructor does all the work.
+    // If the sparse k-mer table is open, it is used
+    // instead of the dense k-mer table.
     MarkerFinder(
         size_t k,
         const MemoryMapped::Vector<KmerInfo>& kmerTable,
+        const SparseKmerTable& sparseKmerTable,
         const Reads& reads,
-        MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>& markers,
-        size_t threadCount);
+        Markers& markers,
+        size_t threadCount,
+        uint64_t markerSelectionMethod = 0,
+        uint64_t minimizerWindow = 0,
+        uint64_t syncmerS = 0);
 
 private:
 
     // The arguments passed to the constructor.
     size_t k;
     const MemoryMapped::Vector<KmerInfo>& kmerTable;
+    const SparseKmerTable& sparseKmerTable;
     const Reads& reads;
-    MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>& markers;
+    Markers& markers;
     size_t threadCount;
+    uint64_t markerSelectionMethod;
+    uint64_t minimizerWindow;
+    uint64_t syncmerS;
 
+    // Find the markers of each read on strand 0
+    // and store them in the staging area of each thread.
     void threadFunction(size_t threadId);
 
-    // In pass 1, we count the number of markers for each
-    // read and call reads.incrementCountMultithreaded.
-    // In pass 2, we store the markers.
-    size_t pass;
+    // Copy the markers in the staging area of each thread
+    // to their final position in the markers.
+    // Only markers on strand 0 are stored (see Markers.hpp).
+    void scatterThreadFunction(size_t threadId);
+
+    // The markers found by each thread, on strand 0.
+    // The markers of each read are stored contiguously,
+    // in the same order as the readIds.
+    class StagingArea {
+    public:
+        vector<ReadId> readIds;
+        vector<CompressedMarker> markers;
+    };
+    vector<StagingArea> stagingAreas;
+
+    // Call f(position, kmerId) for each k-mer of a read.
+    // The k-mer is kept as two bit planes with the same layout
+    // used by the read (see LongBaseSequenceView)
+    // and by KmerId (see ShortBaseSequence::id). They are updated with shifts
+    // as we move along the read, loading the read one 64-base block at a time,
+    // so this requires no branches or memory accesses for each base.
+    template<class F> void forEachKmer(const LongBaseSequenceView& read, const F& f) const
+    {
+        const uint64_t mask = (1ULL << k) - 1ULL;
+        uint64_t lsb = 0;
+        uint64_t msb = 0;
+
+        uint64_t position = 0;
+        for(const uint64_t* word=read.begin; position<read.baseCount; word+=2) {
+            const uint64_t word0 = word[0];
+            const uint64_t word1 = word[1];
+            const uint64_t blockEnd = min(position + 64, read.baseCount);
+            for(uint64_t bitIndex=63; position<blockEnd; position++, bitIndex--) {
+                const uint64_t bit0 = (word0 >> bitIndex) & 1ULL;
+                const uint64_t bit1 = (word1 >> bitIndex) & 1ULL;
+                lsb = ((lsb << 1) | bit0) & mask;
+                msb = ((msb << 1) | bit1) & mask;
+                if(position + 1 >= k) {
+                    f(uint32_t(position + 1 - k), KmerId((msb << k) | lsb));
+                }
+            }
+        }
+    }
+
+    // Work areas used by each thread for marker selection methods 1 and 2.
+    class SelectionWorkArea {
+    public:
+        vector<uint32_t> hashes;
+        vector<uint32_t> minima;
+        vector<uint32_t> padded;
+        vector<uint32_t> maxima;
+        vector<uint64_t> queue;
+    };
+
+    // Flag the positions of a read that are markers,
+    // for marker selection methods 1 and 2.
+    void flagMinimizers(
+        const LongBaseSequenceView&,
+        vector<bool>& isSelected,
+        SelectionWorkArea&) const;
+    void flagSyncmers(
+        const LongBaseSequenceView&,
+        vector<bool>& isSelected,
+        SelectionWorkArea&) const;
+
+    // Compute the minimum (or, if computeMaximum is true, the maximum)
+    // of each window of w consecutive values, using a monotonic queue.
+    // On return, result[i] is the minimum or maximum of
+    // values[i], ..., values[i+w-1].
+    static void slidingWindowExtreme(
+        const vector<uint32_t>& values,
+        uint64_t w,
+        bool computeMaximum,
+        vector<uint32_t>& result,
+        vector<uint64_t>& queue);
+
+    // Return true if a k-mer is a marker.
+    bool isMarker(KmerId kmerId) const
+    {
+        if(sparseKmerTable.isOpen()) {
+            return sparseKmerTable.isMarker(kmerId);
+        } else {
+            return kmerTable[kmerId].isMarker;
+        }
+    }
 
 };
 
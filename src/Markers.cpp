@@ -0,0 +1,323 @@
+// Shasta.
+#include "Markers.hpp"
+#include "SHASTA_ASSERT.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "algorithm.hpp"
+#include "iostream.hpp"
+
+
+
+void Markers::createNew(const string& name, size_t pageSize)
+{
+    if(name.empty()) {
+        strand0Markers.createNew("", pageSize);
+        lastPositions.createNew("", pageSize);
+        k.createNew("", pageSize);
+    } else {
+        strand0Markers.createNew(name, pageSize);
+        lastPositions.createNew(name + "-LastPositions", pageSize);
+        k.createNew(name + "-K", pageSize);
+    }
+}
+
+
+
+void Markers::accessExistingReadOnly(const string& name)
+{
+    // Only one of the two layouts exists.
+    try {
+        strand0Markers.accessExistingReadOnly(name);
+    } catch(const exception&) {
+        strand0KmerIds.accessExistingReadOnly(name + "-KmerIds");
+        positionBlocks.accessExistingReadOnly(name + "-PositionBlocks");
+        positionDeltas.accessExistingReadOnly(name + "-PositionDeltas");
+    }
+    lastPositions.accessExistingReadOnly(name + "-LastPositions");
+    k.accessExistingReadOnly(name + "-K");
+}
+
+
+
+void Markers::accessExistingReadWrite(const string& name)
+{
+    // Only one of the two layouts exists.
+    try {
+        strand0Markers.accessExistingReadWrite(name);
+    } catch(const exception&) {
+        strand0KmerIds.accessExistingReadWrite(name + "-KmerIds");
+        positionBlocks.accessExistingReadWrite(name + "-PositionBlocks");
+        positionDeltas.accessExistingReadWrite(name + "-PositionDeltas");
+    }
+    lastPositions.accessExistingReadWrite(name + "-LastPositions");
+    k.accessExistingReadWrite(name + "-K");
+}
+
+
+
+void Markers::remove()
+{
+    if(isCompact()) {
+        strand0KmerIds.remove();
+        positionBlocks.remove();
+        positionDeltas.remove();
+    } else {
+        strand0Markers.remove();
+    }
+    lastPositions.remove();
+    k.remove();
+}
+
+
+
+void Markers::unreserve()
+{
+    if(isCompact()) {
+        strand0KmerIds.unreserve();
+        positionBlocks.unreserve();
+        positionDeltas.unreserve();
+    } else {
+        strand0Markers.unreserve();
+    }
+    lastPositions.unreserve();
+    k.unreserve();
+}
+
+
+
+// Given a global marker id, return the oriented read
+// (as OrientedReadId::getValue()) and ordinal.
+// The markers of read i begin at global marker id 2*begin(i),
+// where begin(i) is the index of its first marker on strand 0.
+pair<uint64_t, uint64_t> Markers::find(uint64_t markerId) const
+{
+    // Find the read. Because the markers of a read on both strands
+    // are contiguous, this is the last read with
+    // 2*begin(readId) <= markerId.
+    ReadId readIdBegin = 0;
+    ReadId readIdEnd = ReadId(readCount());
+    while(readIdEnd - readIdBegin > 1) {
+        const ReadId readIdMiddle = readIdBegin + (readIdEnd - readIdBegin) / 2;
+        if(2 * strand0Begin(readIdMiddle) <= markerId) {
+            readIdBegin = readIdMiddle;
+        } else {
+            readIdEnd = readIdMiddle;
+        }
+    }
+    const ReadId readId = readIdBegin;
+
+    // Find the strand and ordinal.
+    const uint64_t offset = markerId - 2 * strand0Begin(readId);
+    const uint64_t count = markerCount(readId);
+    SHASTA_ASSERT(offset < 2 * count);
+    const Strand strand = (offset < count) ? 0 : 1;
+    const uint64_t ordinal = offset - strand * count;
+    return make_pair(OrientedReadId(readId, strand).getValue(), ordinal);
+}
+
+
+
+// Convert the markers to the compact layout.
+void Markers::compactPositions(const string& name, size_t pageSize)
+{
+    SHASTA_ASSERT(strand0Markers.isOpen());
+    SHASTA_ASSERT(not isCompact());
+
+    if(name.empty()) {
+        strand0KmerIds.createNew("", pageSize);
+        positionBlocks.createNew("", pageSize);
+        positionDeltas.createNew("", pageSize);
+    } else {
+        strand0KmerIds.createNew(name + "-KmerIds", pageSize);
+        positionBlocks.createNew(name + "-PositionBlocks", pageSize);
+        positionDeltas.createNew(name + "-PositionDeltas", pageSize);
+    }
+
+    vector<KmerId> kmerIds;
+    vector<MarkerPositionBlock> blocks;
+    vector<uint8_t> deltas;
+    for(ReadId readId=0; readId<strand0Markers.size(); readId++) {
+        const CompressedMarker* readMarkers = strand0Markers.begin(readId);
+        const uint64_t readMarkerCount = strand0Markers.size(readId);
+        kmerIds.clear();
+        blocks.clear();
+        deltas.clear();
+
+        uint32_t previousPosition = 0;
+        for(uint64_t ordinal=0; ordinal<readMarkerCount; ordinal++) {
+            const CompressedMarker& marker = readMarkers[ordinal];
+            const uint32_t position = uint32_t(marker.position);
+            kmerIds.push_back(marker.kmerId);
+
+            if((ordinal % OrientedReadMarkers::positionBlockSize) == 0) {
+                MarkerPositionBlock block;
+                block.position = position;
+                block.offset = uint32_t(deltas.size());
+                blocks.push_back(block);
+            } else {
+                // Markers are in order of increasing position.
+                SHASTA_ASSERT(position >= previousPosition);
+                uint32_t delta = position - previousPosition;
+                while(delta >= 0x80) {
+                    deltas.push_back(uint8_t((delta & 0x7f) | 0x80));
+                    delta >>= 7;
+                }
+                deltas.push_back(uint8_t(delta));
+            }
+            previousPosition = position;
+        }
+
+        strand0KmerIds.appendVector(kmerIds);
+        positionBlocks.appendVector(blocks);
+        positionDeltas.appendVector(deltas);
+    }
+    strand0KmerIds.unreserve();
+    positionBlocks.unreserve();
+    positionDeltas.unreserve();
+
+    SHASTA_ASSERT(strand0KmerIds.totalSize() == strand0Markers.totalSize());
+    strand0Markers.remove();
+}
+
+
+
+void Markers::setK(uint64_t kArgument)
+{
+    SHASTA_ASSERT(k.size() == 0);
+    k.push_back(kArgument);
+}
+
+
+
+void Markers::appendRead(
+    const vector<CompressedMarker>& readMarkers,
+    uint32_t lastPosition)
+{
+    SHASTA_ASSERT(not isCompact());
+    strand0Markers.appendVector(readMarkers);
+    lastPositions.push_back(lastPosition);
+}
+
+
+
+// The number of bytes used to store the markers,
+// excluding per-read tables of contents.
+uint64_t Markers::byteCount() const
+{
+    if(isCompact()) {
+        return
+            strand0KmerIds.totalSize() * sizeof(KmerId) +
+            positionBlocks.totalSize() * sizeof(MarkerPositionBlock) +
+            positionDeltas.totalSize() * sizeof(uint8_t);
+    } else {
+        return strand0Markers.totalSize() * sizeof(CompressedMarker);
+    }
+}
+
+
+
+// Test the reverse complement of KmerIds and the markers
+// on strand 1, in both layouts, against the old
+// layout that stored the markers of both strands.
+void shasta::testMarkers()
+{
+    // Check OrientedReadMarkers::reverseComplement against Kmer::reverseComplement
+    // for all k-mers for small k, and for a sample of k-mers for larger k,
+    // up to the maximum k-mer length allowed by the KmerId type.
+    uint64_t x = 231;
+    const auto random = [&x]()
+    {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        return x >> 16;
+    };
+    for(uint64_t k=1; k<=Kmer::capacity; k++) {
+        const uint64_t kmerCount = 1ULL << (2 * k);
+        const bool checkAll = (k <= 10);
+        const uint64_t checkCount = checkAll ? kmerCount : 100000;
+        for(uint64_t i=0; i<checkCount; i++) {
+            const KmerId kmerId = KmerId(checkAll ? i : (random() & (kmerCount - 1)));
+            const KmerId expected = KmerId(Kmer(kmerId, k).reverseComplement(k).id(k));
+            SHASTA_ASSERT(OrientedReadMarkers::reverseComplement(kmerId, k) == expected);
+            if(k <= 16) {
+                SHASTA_ASSERT(OrientedReadMarkers::reverseComplementShort(kmerId, uint32_t(k)) == expected);
+            }
+        }
+    }
+    cout << "Reverse complement of KmerIds: OK." << endl;
+
+
+
+    // Create synthetic markers on strand 0 and, at the same time,
+    // the markers of both strands as stored in the old layout, indexed by
+    // OrientedReadId::getValue().
+    // Some reads have no markers, and some have more than
+    // one block of the compact layout.
+    const uint64_t k = min(uint64_t(Kmer::capacity), uint64_t(14));
+    const uint64_t readCount = 200;
+    Markers markers;
+    markers.createNew("", 4096);
+    markers.setK(k);
+    vector< vector<CompressedMarker> > oldMarkers(2 * readCount);
+    for(ReadId readId=0; readId<readCount; readId++) {
+        const uint64_t markerCount = (readId % 10 == 0) ? 0 : (random() % 300);
+        vector<CompressedMarker> readMarkers(markerCount);
+        uint32_t position = uint32_t(random() % 5);
+        for(CompressedMarker& marker: readMarkers) {
+            marker.kmerId = KmerId(random() & ((1ULL << (2 * k)) - 1));
+            marker.position = position;
+            position += uint32_t(1 + random() % 200);
+        }
+        const uint32_t baseCount = position + uint32_t(k);
+        const uint32_t lastPosition = baseCount - uint32_t(k);
+        markers.appendRead(readMarkers, lastPosition);
+
+        oldMarkers[OrientedReadId(readId, 0).getValue()] = readMarkers;
+        vector<CompressedMarker>& strand1Markers = oldMarkers[OrientedReadId(readId, 1).getValue()];
+        for(auto it=readMarkers.rbegin(); it!=readMarkers.rend(); ++it) {
+            CompressedMarker marker;
+            marker.kmerId = KmerId(Kmer(it->kmerId, k).reverseComplement(k).id(k));
+            marker.position = baseCount - uint32_t(k) - uint32_t(it->position);
+            strand1Markers.push_back(marker);
+        }
+    }
+
+    // Check the markers in the standard layout, then in the compact layout.
+    for(uint64_t layout=0; layout<2; layout++) {
+        if(layout == 1) {
+            markers.compactPositions("", 4096);
+        }
+        SHASTA_ASSERT(markers.size() == oldMarkers.size());
+
+        vector<CompressedMarker> v;
+        vector<KmerId> kmerIds;
+        uint64_t markerId = 0;
+        for(uint64_t i=0; i<oldMarkers.size(); i++) {
+            const vector<CompressedMarker>& expected = oldMarkers[i];
+            const OrientedReadMarkers orientedReadMarkers = markers[i];
+            SHASTA_ASSERT(markers.size(i) == expected.size());
+            SHASTA_ASSERT(orientedReadMarkers.size() == expected.size());
+            SHASTA_ASSERT(markers.beginMarkerId(i) == markerId);
+
+            orientedReadMarkers.get(v);
+            kmerIds.resize(expected.size());
+            orientedReadMarkers.getKmerIds(kmerIds.data());
+            for(uint64_t ordinal=0; ordinal<expected.size(); ordinal++) {
+                const CompressedMarker& e = expected[ordinal];
+                const CompressedMarker marker = orientedReadMarkers[ordinal];
+                SHASTA_ASSERT(marker.kmerId == e.kmerId and marker.position == e.position);
+                SHASTA_ASSERT(v[ordinal].kmerId == e.kmerId and v[ordinal].position == e.position);
+                SHASTA_ASSERT(kmerIds[ordinal] == e.kmerId);
+
+                // Global marker ids are the same as in the old layout.
+                const CompressedMarker globalMarker = markers.get(markerId);
+                SHASTA_ASSERT(globalMarker.kmerId == e.kmerId and globalMarker.position == e.position);
+                SHASTA_ASSERT(markers.find(markerId) == make_pair(i, ordinal));
+                ++markerId;
+            }
+        }
+        SHASTA_ASSERT(markers.totalSize() == markerId);
+        cout << "Markers in the " << (layout == 0 ? "standard" : "compact") << " layout: OK." << endl;
+    }
+    markers.remove();
+}
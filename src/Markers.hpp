@@ -0,0 +1,568 @@
+#ifndef SHASTA_MARKERS_HPP
+#define SHASTA_MARKERS_HPP
+
+/*******************************************************************************
+
+Class Markers stores the markers of all oriented reads.
+
+Only the markers of strand 0 of each read are stored.
+The markers of strand 1 of a read are a function of its markers
+on strand 0:
+- They are in reverse order.
+- The KmerId of each is the reverse complement of the KmerId
+  of the corresponding marker on strand 0.
+- The position of each is baseCount-k-position, where position
+  is the position of the corresponding marker on strand 0
+  and baseCount is the number of bases of the read
+  in run-length representation.
+Class OrientedReadMarkers is a read-only view of the markers
+of an oriented read, which generates markers on strand 1
+as they are accessed. This halves the memory needed
+to store the markers, which is the largest data structure of a run.
+
+The interface mimics the one of the
+MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>
+indexed by OrientedReadId::getValue() that was used before,
+and global marker ids (MarkerId) are the same as with that layout:
+the markers of each read on strand 0 are followed
+by its markers on strand 1, and reads are in order of ReadId.
+Many tables indexed by MarkerId (for example, the marker graph
+vertex table) are therefore unaffected.
+
+After markers are found, they can optionally be converted
+to a compact layout (see compactPositions) in which
+KmerIds and positions are stored separately.
+Consecutive markers are usually only a few bases apart,
+so instead of a 24-bit position for each marker
+we store the difference from the position of the previous
+marker, as a variable length integer (LEB128, 7 bits per byte).
+The markers of each read are grouped in blocks of 64,
+and for each block we store the position of its first marker
+and the offset of the remaining deltas. As a result, access to
+a single marker decodes at most 63 deltas, and bulk decoding
+of all the markers of an oriented read (see OrientedReadMarkers::get)
+decodes each delta once.
+
+*******************************************************************************/
+
+// Shasta.
+#include "Marker.hpp"
+#include "MemoryMappedVectorOfVectors.hpp"
+#include "ReadId.hpp"
+
+// Standard library.
+#include "algorithm.hpp"
+#include "utility.hpp"
+#include "vector.hpp"
+
+namespace shasta {
+    class Markers;
+    class MarkerPositionBlock;
+    class OrientedReadMarkers;
+    class MarkerFinder;
+
+    // Test the reverse complement of KmerIds and the markers
+    // on strand 1, in both layouts.
+    void testMarkers();
+
+    // Benchmark the compact layout of marker positions on synthetic markers.
+    void benchmarkCompactMarkerPositions(
+        uint64_t readCount,
+        uint64_t readLength,
+        double markerDensity);
+}
+
+
+
+// In the compact layout, the information we store
+// for each block of 64 markers of a read.
+class shasta::MarkerPositionBlock {
+public:
+
+    // The position of the first marker in the block.
+    uint32_t position;
+
+    // The offset, in the position deltas of the read,
+    // of the delta for the second marker in the block.
+    uint32_t offset;
+};
+
+
+
+// A read-only view of the markers of an oriented read.
+// Markers are returned by value.
+class shasta::OrientedReadMarkers {
+public:
+
+    // The number of markers in each block of the compact layout.
+    static const uint64_t positionBlockSize = 64;
+
+    // Constructor for the standard layout.
+    OrientedReadMarkers(
+        const CompressedMarker* strand0Begin,
+        uint64_t markerCount,
+        Strand strand,
+        uint32_t lastPosition,
+        uint64_t k) :
+        strand0Begin(strand0Begin),
+        markerCount(markerCount),
+        strand(strand),
+        lastPosition(lastPosition),
+        k(k)
+    {}
+
+    // Constructor for the compact layout.
+    OrientedReadMarkers(
+        const KmerId* strand0KmerIds,
+        const MarkerPositionBlock* positionBlocks,
+        const uint8_t* positionDeltas,
+        uint64_t markerCount,
+        Strand strand,
+        uint32_t lastPosition,
+        uint64_t k) :
+        strand0KmerIds(strand0KmerIds),
+        positionBlocks(positionBlocks),
+        positionDeltas(positionDeltas),
+        markerCount(markerCount),
+        strand(strand),
+        lastPosition(lastPosition),
+        k(k)
+    {}
+
+    OrientedReadMarkers() {}
+
+    uint64_t size() const
+    {
+        return markerCount;
+    }
+    bool empty() const
+    {
+        return markerCount == 0;
+    }
+
+    CompressedMarker operator[](uint64_t ordinal) const
+    {
+        if(strand == 0) {
+            return getStrand0Marker(ordinal);
+        } else {
+            return reverseComplement(getStrand0Marker(markerCount - 1 - ordinal));
+        }
+    }
+    CompressedMarker front() const
+    {
+        return (*this)[0];
+    }
+    CompressedMarker back() const
+    {
+        return (*this)[markerCount - 1];
+    }
+
+    // Bulk decode all the markers, in order of ordinal.
+    // This should be used instead of operator[] in performance
+    // critical code, because in the compact layout
+    // it decodes each position delta only once.
+    void get(vector<CompressedMarker>& v) const
+    {
+        v.resize(markerCount);
+        get(v.data());
+    }
+    void get(CompressedMarker* output) const
+    {
+        if(strand0Begin) {
+            if(strand == 0) {
+                std::copy(strand0Begin, strand0Begin + markerCount, output);
+            } else {
+                for(uint64_t ordinal=0; ordinal<markerCount; ordinal++) {
+                    output[ordinal] = reverseComplement(strand0Begin[markerCount - 1 - ordinal]);
+                }
+            }
+        } else {
+            decodeStrand0(output);
+            if(strand == 1) {
+                std::reverse(output, output + markerCount);
+                for(uint64_t ordinal=0; ordinal<markerCount; ordinal++) {
+                    output[ordinal] = reverseComplement(output[ordinal]);
+                }
+            }
+        }
+    }
+
+    // Bulk access to the KmerIds of all the markers, in order of ordinal.
+    // This does not need to decode positions.
+    void getKmerIds(KmerId* output) const
+    {
+        getKmerIds(0, markerCount, output);
+    }
+
+    // Bulk access to the KmerIds of count markers
+    // starting at the given ordinal.
+    void getKmerIds(uint64_t beginOrdinal, uint64_t count, KmerId* output) const
+    {
+        if(strand == 0) {
+            if(strand0Begin) {
+                const CompressedMarker* p = strand0Begin + beginOrdinal;
+                for(uint64_t i=0; i<count; i++) {
+                    output[i] = p[i].kmerId;
+                }
+            } else {
+                std::copy(strand0KmerIds + beginOrdinal, strand0KmerIds + beginOrdinal + count, output);
+            }
+        } else {
+            // On strand 1, ordinal i corresponds to strand 0 ordinal markerCount-1-i.
+            // Gather first, then reverse complement in a separate loop,
+            // which the compiler can vectorize.
+            const uint64_t strand0Last = markerCount - 1 - beginOrdinal;
+            if(strand0Begin) {
+                for(uint64_t i=0; i<count; i++) {
+                    output[i] = strand0Begin[strand0Last - i].kmerId;
+                }
+            } else {
+                for(uint64_t i=0; i<count; i++) {
+                    output[i] = strand0KmerIds[strand0Last - i];
+                }
+            }
+            if(k <= 16) {
+                const uint32_t k32 = uint32_t(k);
+                for(uint64_t i=0; i<count; i++) {
+                    output[i] = reverseComplementShort(output[i], k32);
+                }
+            } else {
+                for(uint64_t i=0; i<count; i++) {
+                    output[i] = reverseComplement(output[i], k);
+                }
+            }
+        }
+    }
+
+    // Return a pointer to the KmerIds of all the markers, in order of ordinal.
+    // On strand 0 in the compact layout, the KmerIds are stored contiguously
+    // and are returned without copying. Otherwise they are gathered
+    // into the work area, which is resized as necessary.
+    // This allows code that only needs KmerIds (for example, LowHash)
+    // to avoid keeping its own copy of the KmerIds of all oriented reads.
+    const KmerId* getKmerIds(vector<KmerId>& workArea) const
+    {
+        if(strand0KmerIds and strand == 0) {
+            return strand0KmerIds;
+        }
+        workArea.resize(markerCount);
+        getKmerIds(workArea.data());
+        return workArea.data();
+    }
+
+    // Iteration over the markers, in order of ordinal.
+    class const_iterator {
+    public:
+        const_iterator(const OrientedReadMarkers& markers, uint64_t ordinal) :
+            markers(&markers), ordinal(ordinal) {}
+        CompressedMarker operator*() const
+        {
+            return (*markers)[ordinal];
+        }
+        const_iterator& operator++()
+        {
+            ++ordinal;
+            return *this;
+        }
+        bool operator==(const const_iterator& that) const
+        {
+            return ordinal == that.ordinal;
+        }
+        bool operator!=(const const_iterator& that) const
+        {
+            return ordinal != that.ordinal;
+        }
+    private:
+        const OrientedReadMarkers* markers;
+        uint64_t ordinal;
+    };
+    const_iterator begin() const
+    {
+        return const_iterator(*this, 0);
+    }
+    const_iterator end() const
+    {
+        return const_iterator(*this, markerCount);
+    }
+
+    // Return the KmerId of the reverse complement of a k-mer.
+    // A KmerId stores the low and high bits of the bases
+    // of the k-mer as two bit planes of k bits each,
+    // with the first base in the most significant bit
+    // (see ShortBaseSequence::id). Complementing a base flips
+    // both its bits, so we only need to complement
+    // and reverse the two bit planes, which we do
+    // with a single 64-bit reversal.
+    static KmerId reverseComplement(KmerId kmerId, uint64_t k)
+    {
+        if(k <= 16) {
+            return reverseComplementShort(kmerId, uint32_t(k));
+        }
+
+        const uint64_t mask = (1ULL << k) - 1ULL;
+        const uint64_t lsb = ~uint64_t(kmerId) & mask;
+        const uint64_t msb = ~(uint64_t(kmerId) >> k) & mask;
+        uint64_t x = (msb << 32) | lsb;
+        x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+        x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+        x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+        x = __builtin_bswap64(x);
+
+        // Now the reversed low bit plane is at the top of the high 32 bits
+        // and the reversed high bit plane is at the top of the low 32 bits.
+        const uint64_t shift = 32 - k;
+        const uint64_t reverseComplementLsb = x >> (32 + shift);
+        const uint64_t reverseComplementMsb = (x & 0xFFFFFFFFULL) >> shift;
+        return KmerId((reverseComplementMsb << k) | reverseComplementLsb);
+    }
+
+    // Same as above, for k <= 16. The two bit planes then fit
+    // in the two halves of a 32-bit word, and only 32-bit operations
+    // are needed, which vectorize well in bulk loops.
+    static KmerId reverseComplementShort(KmerId kmerId, uint32_t k)
+    {
+        const uint32_t mask = (1U << k) - 1U;
+        const uint32_t id = ~uint32_t(kmerId);
+        uint32_t y = (((id >> k) & mask) << 16) | (id & mask);
+        y = ((y >> 1) & 0x55555555U) | ((y & 0x55555555U) << 1);
+        y = ((y >> 2) & 0x33333333U) | ((y & 0x33333333U) << 2);
+        y = ((y >> 4) & 0x0F0F0F0FU) | ((y & 0x0F0F0F0FU) << 4);
+        y = ((y >> 8) & 0x00FF00FFU) | ((y & 0x00FF00FFU) << 8);
+
+        // Now each half contains its bit plane reversed,
+        // with the first base in the most significant bit of the half.
+        const uint32_t shift = 16 - k;
+        return KmerId((((y >> 16) >> shift) << k) | ((y & 0xFFFFU) >> shift));
+    }
+
+    // Decode a position delta of the compact layout
+    // and advance the pointer past it.
+    static uint32_t decodeDelta(const uint8_t*& p)
+    {
+        uint32_t delta = 0;
+        uint32_t shift = 0;
+        uint8_t byte;
+        do {
+            byte = *p++;
+            delta |= uint32_t(byte & 0x7f) << shift;
+            shift += 7;
+        } while(byte & 0x80);
+        return delta;
+    }
+
+private:
+
+    // Standard layout.
+    const CompressedMarker* strand0Begin = 0;
+
+    // Compact layout.
+    const KmerId* strand0KmerIds = 0;
+    const MarkerPositionBlock* positionBlocks = 0;
+    const uint8_t* positionDeltas = 0;
+
+    uint64_t markerCount = 0;
+    Strand strand = 0;
+    uint32_t lastPosition = 0;
+    uint64_t k = 0;
+
+    // Return the marker on strand 0 with the given ordinal.
+    CompressedMarker getStrand0Marker(uint64_t strand0Ordinal) const
+    {
+        if(strand0Begin) {
+            return strand0Begin[strand0Ordinal];
+        }
+
+        const MarkerPositionBlock& block = positionBlocks[strand0Ordinal / positionBlockSize];
+        uint32_t position = block.position;
+        const uint8_t* p = positionDeltas + block.offset;
+        for(uint64_t i=strand0Ordinal % positionBlockSize; i!=0; i--) {
+            position += decodeDelta(p);
+        }
+
+        CompressedMarker marker;
+        marker.kmerId = strand0KmerIds[strand0Ordinal];
+        marker.position = position;
+        return marker;
+    }
+
+    // Decode all the markers on strand 0, in the compact layout.
+    void decodeStrand0(CompressedMarker* output) const
+    {
+        const uint8_t* p = positionDeltas;
+        uint32_t position = 0;
+        for(uint64_t ordinal=0; ordinal<markerCount; ordinal++) {
+            if((ordinal % positionBlockSize) == 0) {
+                position = positionBlocks[ordinal / positionBlockSize].position;
+            } else {
+                position += decodeDelta(p);
+            }
+            output[ordinal].kmerId = strand0KmerIds[ordinal];
+            output[ordinal].position = position;
+        }
+    }
+
+    // Given a marker on strand 0, return the corresponding marker on strand 1.
+    CompressedMarker reverseComplement(const CompressedMarker& strand0Marker) const
+    {
+        CompressedMarker marker;
+        marker.kmerId = reverseComplement(strand0Marker.kmerId, k);
+        marker.position = lastPosition - uint32_t(strand0Marker.position);
+        return marker;
+    }
+};
+
+
+
+class shasta::Markers {
+public:
+
+    void createNew(const string& name, size_t pageSize);
+    void accessExistingReadOnly(const string& name);
+    void accessExistingReadWrite(const string& name);
+    void remove();
+    void unreserve();
+
+    bool isOpen() const
+    {
+        return
+            (strand0Markers.isOpen() or strand0KmerIds.isOpen()) and
+            lastPositions.isOpen and k.isOpen;
+    }
+
+    // Return true if the markers are stored in the compact layout.
+    bool isCompact() const
+    {
+        return strand0KmerIds.isOpen();
+    }
+
+    // Convert the markers to the compact layout
+    // described at the beginning of this file.
+    void compactPositions(const string& name, size_t pageSize);
+
+    // The number of oriented reads.
+    uint64_t size() const
+    {
+        return 2 * readCount();
+    }
+
+    // The total number of markers, on both strands.
+    uint64_t totalSize() const
+    {
+        return 2 * (isCompact() ? strand0KmerIds.totalSize() : strand0Markers.totalSize());
+    }
+
+    // The number of markers of an oriented read,
+    // indexed by OrientedReadId::getValue().
+    uint64_t size(uint64_t orientedReadIdValue) const
+    {
+        return markerCount(ReadId(orientedReadIdValue >> 1));
+    }
+
+    // The markers of an oriented read,
+    // indexed by OrientedReadId::getValue().
+    OrientedReadMarkers operator[](uint64_t orientedReadIdValue) const
+    {
+        const ReadId readId = ReadId(orientedReadIdValue >> 1);
+        const Strand strand = Strand(orientedReadIdValue & 1);
+        if(isCompact()) {
+            return OrientedReadMarkers(
+                strand0KmerIds.begin(readId),
+                positionBlocks.begin(readId),
+                positionDeltas.begin(readId),
+                strand0KmerIds.size(readId),
+                strand,
+                lastPositions[readId],
+                k[0]);
+        } else {
+            return OrientedReadMarkers(
+                strand0Markers.begin(readId),
+                strand0Markers.size(readId),
+                strand,
+                lastPositions[readId],
+                k[0]);
+        }
+    }
+
+    // The global marker id of the first marker
+    // of an oriented read, indexed by OrientedReadId::getValue().
+    uint64_t beginMarkerId(uint64_t orientedReadIdValue) const
+    {
+        const ReadId readId = ReadId(orientedReadIdValue >> 1);
+        return 2 * strand0Begin(readId) + (orientedReadIdValue & 1) * markerCount(readId);
+    }
+
+    // Given a global marker id, return the oriented read
+    // (as OrientedReadId::getValue()) and ordinal.
+    // This requires a binary search.
+    pair<uint64_t, uint64_t> find(uint64_t markerId) const;
+
+    // Return a marker given its global marker id.
+    // This requires a binary search.
+    CompressedMarker get(uint64_t markerId) const
+    {
+        const auto p = find(markerId);
+        return (*this)[p.first][p.second];
+    }
+
+    uint64_t getK() const
+    {
+        return k[0];
+    }
+
+    // The number of bytes used to store the markers,
+    // excluding per-read tables of contents.
+    uint64_t byteCount() const;
+
+    // Construct markers directly, without a MarkerFinder,
+    // in the standard layout. After createNew, call setK once,
+    // then appendRead for each read in order of ReadId.
+    // This is only used for testing and benchmarking.
+    void setK(uint64_t k);
+    void appendRead(
+        const vector<CompressedMarker>& readMarkers,    // The markers on strand 0.
+        uint32_t lastPosition);                         // baseCount-k for the read.
+
+private:
+
+    // The markers on strand 0 of each read, indexed by ReadId.
+    // Only used in the standard layout.
+    MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t> strand0Markers;
+
+    // The compact layout stores separately the KmerIds of the markers
+    // on strand 0 of each read and their positions. All indexed by ReadId.
+    MemoryMapped::VectorOfVectors<KmerId, uint64_t> strand0KmerIds;
+    MemoryMapped::VectorOfVectors<MarkerPositionBlock, uint64_t> positionBlocks;
+    MemoryMapped::VectorOfVectors<uint8_t, uint64_t> positionDeltas;
+
+    // For each read, baseCount-k, indexed by ReadId.
+    MemoryMapped::Vector<uint32_t> lastPositions;
+
+    // The k-mer length, stored as a vector of length 1.
+    MemoryMapped::Vector<uint64_t> k;
+
+    // The number of reads.
+    uint64_t readCount() const
+    {
+        return isCompact() ? strand0KmerIds.size() : strand0Markers.size();
+    }
+
+    // The number of markers of a read, on each strand.
+    uint64_t markerCount(ReadId readId) const
+    {
+        return isCompact() ? strand0KmerIds.size(readId) : strand0Markers.size(readId);
+    }
+
+    // The index of the first marker of a read
+    // in the concatenation of markers on strand 0 of all reads.
+    uint64_t strand0Begin(ReadId readId) const
+    {
+        return isCompact() ?
+            uint64_t(strand0KmerIds.begin(readId) - strand0KmerIds.begin()) :
+            uint64_t(strand0Markers.begin(readId) - strand0Markers.begin());
+    }
+
+    // MarkerFinder creates the markers.
+    friend class MarkerFinder;
+};
+
+#endif
@@ -0,0 +1,127 @@
+// Benchmark for the compact layout of marker positions in Markers.hpp.
+// It generates synthetic markers and, for the standard layout
+// and then for the compact layout, reports the memory used
+// and times:
+// - Bulk decoding of the markers of all oriented reads
+//   (OrientedReadMarkers::get).
+// - Access to all markers one at a time (OrientedReadMarkers::operator[]).
+
+// Shasta.
+#include "Markers.hpp"
+#include "SHASTA_ASSERT.hpp"
+#include "timestamp.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "chrono.hpp"
+#include "iostream.hpp"
+#include <random>
+
+
+
+static void benchmarkMarkers(
+    const Markers&,
+    const string& layoutName,
+    uint64_t& bulkChecksum,
+    uint64_t& singleChecksum);
+
+
+
+void shasta::benchmarkCompactMarkerPositions(
+    uint64_t readCount,
+    uint64_t readLength,
+    double markerDensity)
+{
+    const uint64_t k = 10;
+    SHASTA_ASSERT(readLength > k);
+    SHASTA_ASSERT(markerDensity > 0. and markerDensity <= 1.);
+
+    // Generate the synthetic markers in the standard layout.
+    // The spacing between consecutive markers has a geometric distribution,
+    // which is what we get when markers are selected at random.
+    cout << timestamp << "Generating markers for " << readCount <<
+        " reads of length " << readLength << "." << endl;
+    Markers markers;
+    markers.createNew("", 4096);
+    markers.setK(k);
+    std::mt19937 randomSource(231);
+    std::geometric_distribution<uint32_t> spacingDistribution(markerDensity);
+    std::uniform_int_distribution<uint64_t> kmerIdDistribution(0, (1ULL << (2*k)) - 1ULL);
+    const uint32_t lastPosition = uint32_t(readLength - k);
+    vector<CompressedMarker> readMarkers;
+    for(uint64_t readId=0; readId<readCount; readId++) {
+        readMarkers.clear();
+        for(uint32_t position=spacingDistribution(randomSource);
+            position<=lastPosition;
+            position+=spacingDistribution(randomSource)+1) {
+            CompressedMarker marker;
+            marker.kmerId = KmerId(kmerIdDistribution(randomSource));
+            marker.position = position;
+            readMarkers.push_back(marker);
+        }
+        markers.appendRead(readMarkers, lastPosition);
+    }
+    cout << "Generated " << markers.totalSize() / 2 << " markers on strand 0." << endl;
+
+    uint64_t bulkChecksum;
+    uint64_t singleChecksum;
+    benchmarkMarkers(markers, "Standard", bulkChecksum, singleChecksum);
+    const uint64_t byteCount = markers.byteCount();
+
+    // Convert to the compact layout and repeat.
+    markers.compactPositions("", 4096);
+    uint64_t compactBulkChecksum;
+    uint64_t compactSingleChecksum;
+    benchmarkMarkers(markers, "Compact", compactBulkChecksum, compactSingleChecksum);
+    SHASTA_ASSERT(compactBulkChecksum == bulkChecksum);
+    SHASTA_ASSERT(compactSingleChecksum == singleChecksum);
+    const uint64_t compactByteCount = markers.byteCount();
+    cout << "The compact layout uses " <<
+        double(compactByteCount) / double(byteCount) <<
+        " of the memory of the standard layout." << endl;
+
+    markers.remove();
+}
+
+
+
+static void benchmarkMarkers(
+    const Markers& markers,
+    const string& layoutName,
+    uint64_t& bulkChecksum,
+    uint64_t& singleChecksum)
+{
+    const uint64_t markerCount = markers.totalSize();
+    const double megaMarkers = double(markerCount) / 1.e6;
+    cout << layoutName << " layout: " << markers.byteCount() << " bytes, " <<
+        double(markers.byteCount()) / double(markerCount / 2) <<
+        " bytes per marker." << endl;
+
+    // Bulk decode.
+    vector<CompressedMarker> orientedReadMarkers;
+    bulkChecksum = 0;
+    const auto t0 = steady_clock::now();
+    for(uint64_t i=0; i<markers.size(); i++) {
+        markers[i].get(orientedReadMarkers);
+        for(const CompressedMarker& marker: orientedReadMarkers) {
+            bulkChecksum += uint64_t(marker.kmerId) + uint64_t(marker.position);
+        }
+    }
+    const double bulkTime = seconds(steady_clock::now() - t0);
+    cout << "Bulk decode: " << bulkTime << " s, " <<
+        megaMarkers / bulkTime << " million markers/s." << endl;
+
+    // One marker at a time.
+    singleChecksum = 0;
+    const auto t1 = steady_clock::now();
+    for(uint64_t i=0; i<markers.size(); i++) {
+        const OrientedReadMarkers readMarkers = markers[i];
+        for(uint64_t ordinal=0; ordinal<readMarkers.size(); ordinal++) {
+            const CompressedMarker marker = readMarkers[ordinal];
+            singleChecksum += uint64_t(marker.kmerId) + uint64_t(marker.position);
+        }
+    }
+    const double singleTime = seconds(steady_clock::now() - t1);
+    cout << "Access by ordinal: " << singleTime << " s, " <<
+        megaMarkers / singleTime << " million markers/s." << endl;
+}
@@ -210,6 +210,64 @@ public:
 
 
 
+    // Append all the vectors of another VectorOfVectors, in two steps.
+    // beginAppend makes space for them and returns the index
+    // that the first of them will have.
+    // Then appendRange fills in the vectors of that in [begin, end).
+    // appendRange can be called concurrently from multiple threads
+    // for non-overlapping ranges.
+    // The new toc entries are the old toc.back() plus the toc of that.
+    uint64_t beginAppend(const VectorOfVectors<T, Int>& that)
+    {
+        const uint64_t firstIndex = size();
+        toc.resize(toc.size() + that.size());
+        data.resize(data.size() + that.totalSize());
+        return firstIndex;
+    }
+    void appendRange(
+        const VectorOfVectors<T, Int>& that,
+        uint64_t firstIndex,
+        uint64_t begin,
+        uint64_t end)
+    {
+        const Int offset = toc[firstIndex];
+        for(uint64_t i=begin; i!=end; i++) {
+            toc[firstIndex + i + 1] = offset + that.toc[i + 1];
+        }
+        std::copy(
+            that.data.begin() + that.toc[begin],
+            that.data.begin() + that.toc[end],
+            data.begin() + offset + that.toc[begin]);
+    }
+
+
+
+    // Keep only the vectors for which keep[i] is true,
+    // without changing their order. This is done in place,
+    // without allocating additional memory.
+    void keepVectors(const vector<bool>& keep)
+    {
+        SHASTA_ASSERT(keep.size() == size());
+        Int newSize = 0;
+        Int newTotalSize = 0;
+        for(Int i=0; i<Int(keep.size()); i++) {
+            if(keep[i]) {
+                // The destination precedes the source, so copy can be used.
+                const Int oldBegin = toc[i];
+                const Int oldEnd = toc[i+1];
+                copy(data.begin() + oldBegin, data.begin() + oldEnd, data.begin() + newTotalSize);
+                toc[newSize] = newTotalSize;
+                newTotalSize += oldEnd - oldBegin;
+                ++newSize;
+            }
+        }
+        toc[newSize] = newTotalSize;
+        toc.resize(newSize + 1);
+        data.resize(newTotalSize);
+    }
+
+
+
     // Operator[] returns a span object containing all elements
     // of the vector with the requested index.
     span<T> operator[](Int i)
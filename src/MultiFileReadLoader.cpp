@@ -0,0 +1,278 @@
+// Shasta.
+#include "MultiFileReadLoader.hpp"
+#include "filesystem.hpp"
+#include "ReadLoader.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "algorithm.hpp"
+#include "chrono.hpp"
+#include "iterator.hpp"
+
+
+
+// Load reads from multiple files.
+MultiFileReadLoader::MultiFileReadLoader(
+    const vector<string>& fileNames,
+    uint64_t minReadLength,
+    bool noCache,
+    uint64_t streamingMemoryBudget,
+    uint64_t concurrentFileCount,
+    size_t threadCount,
+    const string& dataNamePrefix,
+    size_t pageSize,
+    Reads& reads):
+
+    MultithreadedObject(*this),
+    minReadLength(minReadLength),
+    noCache(noCache),
+    streamingMemoryBudget(streamingMemoryBudget),
+    concurrentFileCount(concurrentFileCount),
+    threadCount(threadCount),
+    dataNamePrefix(dataNamePrefix),
+    pageSize(pageSize),
+    reads(reads)
+{
+    const auto t0 = steady_clock::now();
+
+    // Adjust the number of threads, if necessary.
+    if(this->threadCount == 0) {
+        this->threadCount = std::thread::hardware_concurrency();
+    }
+
+    // Adjust the number of files processed concurrently.
+    // Zero means as many as possible.
+    const uint64_t fileCount = fileNames.size();
+    if(fileCount == 0) {
+        return;
+    }
+    if(this->concurrentFileCount == 0) {
+        this->concurrentFileCount = this->threadCount;
+    }
+    this->concurrentFileCount = min(this->concurrentFileCount,
+        min(fileCount, uint64_t(this->threadCount)));
+    threadCountPerFile = max(size_t(1), size_t(this->threadCount / this->concurrentFileCount));
+
+    // The memory budget for streaming mode is shared
+    // by the files processed concurrently.
+    this->streamingMemoryBudget = streamingMemoryBudget / this->concurrentFileCount;
+
+    // Initialize the file information.
+    fileInfos.resize(fileCount);
+    for(uint64_t fileId=0; fileId<fileCount; fileId++) {
+        FileInfo& fileInfo = fileInfos[fileId];
+        fileInfo.fileName = fileNames[fileId];
+        fileInfo.fileSize = filesystem::fileSize(fileInfo.fileName);
+    }
+
+    cout << timestamp << "Loading reads from " << fileCount << " files, processing " <<
+        this->concurrentFileCount << " files at a time using " <<
+        threadCountPerFile << " threads for each file." << endl;
+
+    // Process the files, storing reads in a separate Reads object for each file.
+    // Each file is moved to the global Reads object as soon as it
+    // and all the preceding files are processed.
+    processFiles();
+    SHASTA_ASSERT(nextFileToStore == fileCount);
+
+    // Free up unused allocated memory.
+    reads.readNames.unreserve();
+    reads.readMetaData.unreserve();
+    reads.readRepeatCounts.unreserve();
+    reads.reads.unreserve();
+
+    // Allocate enough space for readFlags which are populated later.
+    reads.readFlags.resize(reads.readCount());
+    const auto t1 = steady_clock::now();
+
+    // Write a summary.
+    cout << "Summary of read loading from " << fileCount << " files:" << endl;
+    for(const FileInfo& fileInfo: fileInfos) {
+        cout << "    " << fileInfo.fileName << ": " <<
+            fileInfo.fileSize << " bytes, " <<
+            fileInfo.readCount << " reads stored, processed in " <<
+            fileInfo.processingTime << " s." << endl;
+    }
+    cout << "Time to process all files:\n" <<
+        "Store (overlapped with processing): " << storeTime << " s.\n"
+        "Total: " << seconds(t1-t0) << " s." << endl;
+}
+
+
+
+// Process the input files. Larger files are processed first,
+// so small files can fill in the gaps at the end.
+// This only affects scheduling, not the order in which
+// reads are stored.
+void MultiFileReadLoader::processFiles()
+{
+    const uint64_t fileCount = fileInfos.size();
+    processingOrder.resize(fileCount);
+    for(uint64_t fileId=0; fileId<fileCount; fileId++) {
+        processingOrder[fileId] = fileId;
+    }
+    std::stable_sort(processingOrder.begin(), processingOrder.end(),
+        [this](uint64_t fileId0, uint64_t fileId1)
+        {
+            return fileInfos[fileId0].fileSize > fileInfos[fileId1].fileSize;
+        });
+
+    setupLoadBalancing(fileCount, 1);
+    runThreads(&MultiFileReadLoader::processFilesThreadFunction, concurrentFileCount);
+}
+
+
+
+void MultiFileReadLoader::processFilesThreadFunction(size_t threadId)
+{
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+        for(uint64_t i=begin; i!=end; i++) {
+            processFile(processingOrder[i]);
+        }
+    }
+}
+
+
+
+// Process one file, storing its reads in the Reads
+// object for this file.
+void MultiFileReadLoader::processFile(uint64_t fileId)
+{
+    const auto t0 = steady_clock::now();
+    FileInfo& fileInfo = fileInfos[fileId];
+
+    fileInfo.fileReads = make_shared<Reads>();
+    Reads& fileReads = *fileInfo.fileReads;
+    fileReads.createNew(
+        fileDataName(fileId, "Reads"),
+        fileDataName(fileId, "ReadNames"),
+        fileDataName(fileId, "ReadMetaData"),
+        fileDataName(fileId, "ReadRepeatCounts"),
+        fileDataName(fileId, "ReadFlags"),
+        pageSize);
+
+    // Each ReadLoader gets its own prefix for the names of
+    // its temporary data structures, to avoid collisions
+    // with ReadLoaders running concurrently.
+    const string readLoaderDataNamePrefix = fileDataName(fileId, "");
+    ReadLoader readLoader(
+        fileInfo.fileName,
+        minReadLength,
+        noCache,
+        streamingMemoryBudget,
+        threadCountPerFile,
+        readLoaderDataNamePrefix,
+        pageSize,
+        fileReads);
+
+    // We don't need the read flags of this file.
+    fileReads.readFlags.remove();
+
+    fileInfo.readCount = fileReads.readCount();
+    fileInfo.discardedInvalidBaseReadCount = readLoader.discardedInvalidBaseReadCount;
+    fileInfo.discardedInvalidBaseBaseCount = readLoader.discardedInvalidBaseBaseCount;
+    fileInfo.discardedShortReadReadCount = readLoader.discardedShortReadReadCount;
+    fileInfo.discardedShortReadBaseCount = readLoader.discardedShortReadBaseCount;
+    fileInfo.discardedBadRepeatCountReadCount = readLoader.discardedBadRepeatCountReadCount;
+    fileInfo.discardedBadRepeatCountBaseCount = readLoader.discardedBadRepeatCountBaseCount;
+    fileInfo.processingTime = seconds(steady_clock::now() - t0);
+
+    storeProcessedFiles(fileId);
+}
+
+
+
+// Called when a file has been processed.
+// If no other thread is storing files, store this file and all
+// following files that are already processed, in order.
+void MultiFileReadLoader::storeProcessedFiles(uint64_t fileId)
+{
+    std::unique_lock<std::mutex> lock(storeMutex);
+    fileInfos[fileId].isProcessed = true;
+    if(isStoring) {
+        // The thread doing the storing will pick up this file.
+        return;
+    }
+    isStoring = true;
+
+    while(nextFileToStore < fileInfos.size() and fileInfos[nextFileToStore].isProcessed) {
+        const uint64_t fileIdToStore = nextFileToStore;
+        lock.unlock();
+        storeFile(fileIdToStore);
+        lock.lock();
+        ++nextFileToStore;
+    }
+    isStoring = false;
+}
+
+
+
+// Store the reads of a file in the global Reads object,
+// then remove the Reads object of the file.
+void MultiFileReadLoader::storeFile(uint64_t fileId)
+{
+    const auto t0 = steady_clock::now();
+    FileInfo& fileInfo = fileInfos[fileId];
+    Reads& fileReads = *fileInfo.fileReads;
+    SHASTA_ASSERT(fileReads.readCount() == fileInfo.readCount);
+
+    fileInfo.firstReadId = reads.readCount();
+    FileStorer fileStorer(reads, fileReads, threadCountPerFile);
+
+    fileReads.remove();
+    fileInfo.fileReads = 0;
+    storeTime += seconds(steady_clock::now() - t0);
+}
+
+
+
+MultiFileReadLoader::FileStorer::FileStorer(
+    Reads& reads,
+    const Reads& fileReads,
+    size_t threadCount) :
+    MultithreadedObject(*this),
+    reads(reads),
+    fileReads(fileReads)
+{
+    // Make space for the reads of this file.
+    firstReadId = reads.reads.beginAppend(fileReads.reads);
+    const uint64_t firstReadNameId = reads.readNames.beginAppend(fileReads.readNames);
+    const uint64_t firstReadMetaDataId = reads.readMetaData.beginAppend(fileReads.readMetaData);
+    const uint64_t firstReadRepeatCountsId = reads.readRepeatCounts.beginAppend(fileReads.readRepeatCounts);
+    SHASTA_ASSERT(firstReadNameId == firstReadId);
+    SHASTA_ASSERT(firstReadMetaDataId == firstReadId);
+    SHASTA_ASSERT(firstReadRepeatCountsId == firstReadId);
+
+    // Copy them.
+    setupLoadBalancing(fileReads.readCount(), 10000);
+    runThreads(&FileStorer::threadFunction, threadCount);
+}
+
+
+
+void MultiFileReadLoader::FileStorer::threadFunction(size_t threadId)
+{
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+        reads.reads.appendRange(fileReads.reads, firstReadId, begin, end);
+        reads.readNames.appendRange(fileReads.readNames, firstReadId, begin, end);
+        reads.readMetaData.appendRange(fileReads.readMetaData, firstReadId, begin, end);
+        reads.readRepeatCounts.appendRange(fileReads.readRepeatCounts, firstReadId, begin, end);
+    }
+}
+
+
+
+// Create the name to be used for a MemoryMapped object
+// used while processing a file.
+string MultiFileReadLoader::fileDataName(
+    uint64_t fileId,
+    const string& dataName) const
+{
+    if(dataNamePrefix.empty()) {
+        return "";
+    } else {
+        return dataNamePrefix + "tmp-MultiFileReadLoader-" + to_string(fileId) + "-" + dataName;
+    }
+}
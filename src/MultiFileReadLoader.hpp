@@ -0,0 +1,143 @@
+#ifndef SHASTA_MULTI_FILE_READ_LOADER_HPP
+#define SHASTA_MULTI_FILE_READ_LOADER_HPP
+
+// shasta
+#include "MultithreadedObject.hpp"
+#include "ReadId.hpp"
+#include "Reads.hpp"
+
+// Standard library.
+#include "memory.hpp"
+#include <mutex>
+#include "string.hpp"
+#include "vector.hpp"
+
+namespace shasta {
+    class MultiFileReadLoader;
+}
+
+
+
+// Class used to load reads from multiple input files concurrently.
+// Up to concurrentFileCount files are processed at the same time,
+// each by a ReadLoader using its share of the available threads
+// and storing its reads in a temporary Reads object.
+// Larger files are scheduled first, to balance the load.
+// As soon as a file and all the files preceding it have been processed,
+// its reads are stored in the global Reads object and its
+// temporary Reads object is removed, so the temporary Reads
+// objects don't accumulate.
+// The reads are always stored in the order of the input files,
+// so the assignment of ReadIds does not depend on scheduling.
+class shasta::MultiFileReadLoader :
+    public MultithreadedObject<MultiFileReadLoader> {
+public:
+
+    // The constructor does all the work.
+    MultiFileReadLoader(
+        const vector<string>& fileNames,
+        uint64_t minReadLength,
+        bool noCache,
+        uint64_t streamingMemoryBudget,
+        uint64_t concurrentFileCount,
+        size_t threadCount,
+        const string& dataNamePrefix,
+        size_t pageSize,
+        Reads& reads);
+
+    // Information for each of the input files, in the order
+    // in which they were specified.
+    class FileInfo {
+    public:
+        string fileName;
+        uint64_t fileSize = 0;
+
+        // The reads of this file, before they are stored
+        // in the global Reads object.
+        shared_ptr<Reads> fileReads;
+
+        // The number of reads stored, and the ReadId
+        // assigned to the first of them.
+        uint64_t readCount = 0;
+        ReadId firstReadId = 0;
+
+        // Discarded read statistics, as computed by the ReadLoader.
+        uint64_t discardedInvalidBaseReadCount = 0;
+        uint64_t discardedInvalidBaseBaseCount = 0;
+        uint64_t discardedShortReadReadCount = 0;
+        uint64_t discardedShortReadBaseCount = 0;
+        uint64_t discardedBadRepeatCountReadCount = 0;
+        uint64_t discardedBadRepeatCountBaseCount = 0;
+
+        // Elapsed time to process this file, excluding
+        // the store in the global Reads object.
+        double processingTime = 0.;
+
+        // Set when the file has been processed.
+        // Protected by storeMutex.
+        bool isProcessed = false;
+    };
+    vector<FileInfo> fileInfos;
+
+private:
+
+    const uint64_t minReadLength;
+    const bool noCache;
+
+    // The streaming memory budget for each file.
+    // This is the total budget divided by the number of files
+    // processed concurrently.
+    uint64_t streamingMemoryBudget;
+
+    // The number of files processed concurrently, the total number
+    // of threads, and the number of threads used for each file.
+    uint64_t concurrentFileCount;
+    size_t threadCount;
+    size_t threadCountPerFile;
+
+    const string& dataNamePrefix;
+    const size_t pageSize;
+
+    // The data structure that the reads will be added to.
+    Reads& reads;
+
+    // Create the name to be used for a MemoryMapped object.
+    string fileDataName(uint64_t fileId, const string& dataName) const;
+
+    // Process the input files.
+    // Each thread loops over files in the order given by processingOrder.
+    vector<uint64_t> processingOrder;
+    void processFiles();
+    void processFilesThreadFunction(size_t threadId);
+    void processFile(uint64_t fileId);
+
+    // Store the reads of processed files in the global Reads object,
+    // in the order of the input files.
+    // When a thread finishes processing a file, it stores that file
+    // and any following files that are already processed, unless
+    // another thread is already doing that.
+    std::mutex storeMutex;
+    uint64_t nextFileToStore = 0;
+    bool isStoring = false;
+    double storeTime = 0.;
+    void storeProcessedFiles(uint64_t fileId);
+    void storeFile(uint64_t fileId);
+
+    // Class used to store the reads of one file in the global Reads object,
+    // using multiple threads. Each ReadId is the first ReadId of the file
+    // (a prefix sum of the read counts of the preceding files)
+    // plus the ReadId in the file, and each toc entry is computed
+    // similarly from the toc of the file, so all reads of the file
+    // can be copied in parallel.
+    class FileStorer : public MultithreadedObject<FileStorer> {
+    public:
+        FileStorer(Reads& reads, const Reads& fileReads, size_t threadCount);
+    private:
+        Reads& reads;
+        const Reads& fileReads;
+        uint64_t firstReadId;
+        void threadFunction(size_t threadId);
+    };
+};
+
+#endif
@@ -0,0 +1,274 @@
+// Shasta.
+#include "OrientedReadPairSorter.hpp"
+#include "splitRange.hpp"
+#include "timestamp.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "algorithm.hpp"
+#include "chrono.hpp"
+
+
+
+OrientedReadPairSorter::OrientedReadPairSorter(
+    MemoryMapped::Vector<OrientedReadPair>& pairs,
+    size_t threadCountArgument,
+    const string& largeDataFileNamePrefix,
+    size_t largeDataPageSize) :
+    MultithreadedObject(*this),
+    threadCount(threadCountArgument),
+    n(pairs.size())
+{
+    cout << timestamp << "Sorting and deduplicating " << n << " oriented read pairs." << endl;
+    const auto tBegin = steady_clock::now();
+    if(n == 0) {
+        return;
+    }
+
+    // Adjust the numbers of threads, if necessary.
+    // Use at most one thread for each 64K pairs.
+    if(threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    threadCount = max(size_t(1), min(threadCount, size_t(n >> 16)));
+
+    // Find the number of bits needed to represent the largest ReadId.
+    source = pairs.begin();
+    threadMaxReadId.resize(threadCount);
+    runThreads(&OrientedReadPairSorter::maxReadIdThreadFunction, threadCount);
+    const ReadId maxReadId = *std::max_element(threadMaxReadId.begin(), threadMaxReadId.end());
+    readIdBits = 1;
+    while((uint64_t(maxReadId) >> readIdBits) != 0) {
+        ++readIdBits;
+    }
+    const uint64_t keyBits = 2 * readIdBits + 1;
+
+    // If the key does not fit in 64 bits, fall back to std::sort.
+    if(keyBits > 64) {
+        sort(pairs.begin(), pairs.end(),
+            [](const OrientedReadPair& x, const OrientedReadPair& y)
+            {
+                return
+                    tie(x.readIds[0], x.readIds[1], y.isSameStrand) <
+                    tie(y.readIds[0], y.readIds[1], x.isSameStrand);
+            });
+        const auto uniqueEnd = unique(pairs.begin(), pairs.end(),
+            [](const OrientedReadPair& x, const OrientedReadPair& y)
+            {
+                return x.readIds == y.readIds and x.isSameStrand == y.isSameStrand;
+            });
+        pairs.resize(uniqueEnd - pairs.begin());
+        return;
+    }
+
+    // Create the buffer.
+    MemoryMapped::Vector<OrientedReadPair> buffer;
+    buffer.createNew(
+        largeDataFileNamePrefix.empty() ? "" : (largeDataFileNamePrefix + "tmp-OrientedReadPairSorter-Buffer"),
+        largeDataPageSize);
+    buffer.resize(n);
+
+    // Radix sort passes.
+    source = pairs.begin();
+    destination = buffer.begin();
+    threadDigitCount.resize(threadCount);
+    for(digitShift=0; digitShift<keyBits; digitShift+=digitBits) {
+        runThreads(&OrientedReadPairSorter::countThreadFunction, threadCount);
+
+        // Turn the counts into output positions.
+        uint64_t position = 0;
+        for(uint64_t d=0; d<digitCount; d++) {
+            for(size_t threadId=0; threadId<threadCount; threadId++) {
+                uint64_t& count = threadDigitCount[threadId][d];
+                const uint64_t digitCountInSlice = count;
+                count = position;
+                position += digitCountInSlice;
+            }
+        }
+        SHASTA_ASSERT(position == n);
+
+        runThreads(&OrientedReadPairSorter::scatterThreadFunction, threadCount);
+        std::swap(source, destination);
+    }
+    threadDigitCount.clear();
+
+    // The sorted pairs are now in source.
+    // Deduplicate them into destination.
+    threadUniqueCount.resize(threadCount);
+    runThreads(&OrientedReadPairSorter::countUniqueThreadFunction, threadCount);
+    uint64_t uniqueCount = 0;
+    for(uint64_t& count: threadUniqueCount) {
+        const uint64_t uniqueCountInSlice = count;
+        count = uniqueCount;
+        uniqueCount += uniqueCountInSlice;
+    }
+    runThreads(&OrientedReadPairSorter::storeUniqueThreadFunction, threadCount);
+
+    // If the result is in the buffer, copy it back.
+    if(destination != pairs.begin()) {
+        source = destination;
+        destination = pairs.begin();
+        n = uniqueCount;
+        runThreads(&OrientedReadPairSorter::copyThreadFunction, threadCount);
+    }
+    pairs.resize(uniqueCount);
+    buffer.remove();
+
+    const auto tEnd = steady_clock::now();
+    cout << timestamp << "Sorting and deduplication of oriented read pairs completed in " <<
+        seconds(tEnd - tBegin) << " s. " << uniqueCount << " unique pairs were kept." << endl;
+}
+
+
+
+pair<uint64_t, uint64_t> OrientedReadPairSorter::threadSlice(size_t threadId) const
+{
+    return splitRange(0, n, threadCount, threadId);
+}
+
+
+
+void OrientedReadPairSorter::maxReadIdThreadFunction(size_t threadId)
+{
+    const auto slice = threadSlice(threadId);
+    ReadId maxReadId = 0;
+    for(uint64_t i=slice.first; i!=slice.second; i++) {
+        const OrientedReadPair& p = source[i];
+        maxReadId = max(maxReadId, max(p.readIds[0], p.readIds[1]));
+    }
+    threadMaxReadId[threadId] = maxReadId;
+}
+
+
+
+void OrientedReadPairSorter::countThreadFunction(size_t threadId)
+{
+    vector<uint64_t>& count = threadDigitCount[threadId];
+    count.assign(digitCount, 0);
+    const auto slice = threadSlice(threadId);
+    for(uint64_t i=slice.first; i!=slice.second; i++) {
+        ++count[digit(source[i])];
+    }
+}
+
+
+
+void OrientedReadPairSorter::scatterThreadFunction(size_t threadId)
+{
+    vector<uint64_t>& position = threadDigitCount[threadId];
+    const auto slice = threadSlice(threadId);
+    for(uint64_t i=slice.first; i!=slice.second; i++) {
+        const OrientedReadPair& p = source[i];
+        destination[position[digit(p)]++] = p;
+    }
+}
+
+
+
+void OrientedReadPairSorter::countUniqueThreadFunction(size_t threadId)
+{
+    const auto slice = threadSlice(threadId);
+    uint64_t count = 0;
+    for(uint64_t i=slice.first; i!=slice.second; i++) {
+        if(isUnique(i)) {
+            ++count;
+        }
+    }
+    threadUniqueCount[threadId] = count;
+}
+
+
+
+void OrientedReadPairSorter::storeUniqueThreadFunction(size_t threadId)
+{
+    const auto slice = threadSlice(threadId);
+    uint64_t position = threadUniqueCount[threadId];
+    for(uint64_t i=slice.first; i!=slice.second; i++) {
+        if(isUnique(i)) {
+            destination[position++] = source[i];
+        }
+    }
+}
+
+
+
+void OrientedReadPairSorter::copyThreadFunction(size_t threadId)
+{
+    const auto slice = threadSlice(threadId);
+    std::copy(source + slice.first, source + slice.second, destination + slice.first);
+}
+
+
+
+// Compare OrientedReadPairSorter with std::sort and std::unique
+// on random pairs with duplicates, for sizes below and above
+// the 64K pairs per thread used to limit the number of threads,
+// for one and many threads, and for ReadIds large enough
+// that the key does not fit in 64 bits.
+void shasta::testOrientedReadPairSorter()
+{
+    uint64_t x = 231;
+    const auto random = [&x]()
+    {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        return x >> 16;
+    };
+
+    const auto isLess = [](const OrientedReadPair& p, const OrientedReadPair& q)
+    {
+        return
+            tie(p.readIds[0], p.readIds[1], q.isSameStrand) <
+            tie(q.readIds[0], q.readIds[1], p.isSameStrand);
+    };
+    const auto isEqual = [](const OrientedReadPair& p, const OrientedReadPair& q)
+    {
+        return p.readIds == q.readIds and p.isSameStrand == q.isSameStrand;
+    };
+
+    const vector<uint64_t> sizes = {0, 1, 2, 1000, 65535, 65536, 300000, 2000000};
+    const vector<size_t> threadCounts = {1, 16};
+
+    // The smallest ReadId and the number of ReadIds used.
+    // The third one gives the widest key that fits in 64 bits,
+    // and the last one makes the key wider than 64 bits.
+    const vector< pair<ReadId, ReadId> > readIdRanges = {
+        {0, 100},
+        {0, 1000000},
+        {(ReadId(1) << 31) - 1000, 1000},
+        {std::numeric_limits<ReadId>::max() - 1000, 1000}};
+
+    for(const auto& readIdRange: readIdRanges) {
+        for(const uint64_t n: sizes) {
+            for(const size_t threadCount: threadCounts) {
+
+                // Create random pairs. About one in four
+                // is a copy of a previous pair.
+                MemoryMapped::Vector<OrientedReadPair> pairs;
+                pairs.createNew("", 4096);
+                for(uint64_t i=0; i<n; i++) {
+                    if(i > 0 and random() % 4 == 0) {
+                        const OrientedReadPair p = pairs[random() % i];
+                        pairs.push_back(p);
+                    } else {
+                        const ReadId readId0 = readIdRange.first + ReadId(random() % readIdRange.second);
+                        ReadId readId1;
+                        do {
+                            readId1 = readIdRange.first + ReadId(random() % readIdRange.second);
+                        } while(readId1 == readId0);
+                        pairs.push_back(OrientedReadPair(readId0, readId1, random() % 2 == 0));
+                    }
+                }
+
+                vector<OrientedReadPair> expected(pairs.begin(), pairs.end());
+                sort(expected.begin(), expected.end(), isLess);
+                expected.resize(unique(expected.begin(), expected.end(), isEqual) - expected.begin());
+
+                OrientedReadPairSorter sorter(pairs, threadCount, "", 4096);
+                SHASTA_ASSERT(pairs.size() == expected.size());
+                SHASTA_ASSERT(std::equal(pairs.begin(), pairs.end(), expected.begin(), isEqual));
+                pairs.remove();
+            }
+        }
+    }
+    cout << "OrientedReadPairSorter: OK." << endl;
+}
@@ -0,0 +1,122 @@
+#ifndef SHASTA_ORIENTED_READ_PAIR_SORTER_HPP
+#define SHASTA_ORIENTED_READ_PAIR_SORTER_HPP
+
+/*******************************************************************************
+
+Class OrientedReadPairSorter sorts and deduplicates a MemoryMapped::Vector
+of OrientedReadPair using a multithreaded LSD radix sort.
+Pairs are sorted by readId0, then readId1, with the same strand
+before opposite strands, which is the order used
+for alignmentCandidates.candidates.
+
+Each pair is mapped to an integer key
+(readId0 << (b+1)) | (readId1 << 1) | (isSameStrand ? 0 : 1)
+where b is the number of bits required to represent the largest ReadId.
+The key is sorted in passes of digitBits bits each, and only the passes
+required for the number of bits in use are done.
+In each pass, the vector is split into one slice per thread.
+Each thread counts digits in its slice, the counts are turned into
+output positions in digit-major, thread-minor order (which keeps the sort stable),
+and then each thread scatters its slice.
+The passes alternate between the given vector and a temporary buffer
+of the same size.
+
+Deduplication is done in a final multithreaded pass, in which each thread
+counts and then copies the unique pairs in its slice.
+The result is always left in the vector that was passed in.
+
+In the unlikely case that the key does not fit in 64 bits
+(more than 2^31 reads), std::sort and std::unique are used instead.
+
+*******************************************************************************/
+
+// Shasta.
+#include "MemoryMappedVector.hpp"
+#include "MultithreadedObject.hpp"
+#include "OrientedReadPair.hpp"
+
+namespace shasta {
+    class OrientedReadPairSorter;
+}
+
+
+
+class shasta::OrientedReadPairSorter :
+    public MultithreadedObject<OrientedReadPairSorter> {
+public:
+
+    // The constructor does all the work.
+    OrientedReadPairSorter(
+        MemoryMapped::Vector<OrientedReadPair>&,
+        size_t threadCount,
+        const string& largeDataFileNamePrefix,
+        size_t largeDataPageSize
+    );
+
+private:
+
+    size_t threadCount;
+    uint64_t n;
+
+    // The slice of [0, n) assigned to each thread.
+    pair<uint64_t, uint64_t> threadSlice(size_t threadId) const;
+
+    // Radix sort passes read from source and write to destination.
+    // The two pointers are swapped after each pass.
+    OrientedReadPair* source;
+    OrientedReadPair* destination;
+
+    // The key used for sorting.
+    uint64_t readIdBits;
+    uint64_t key(const OrientedReadPair& p) const
+    {
+        return
+            (uint64_t(p.readIds[0]) << (readIdBits + 1)) |
+            (uint64_t(p.readIds[1]) << 1) |
+            (p.isSameStrand ? 0ULL : 1ULL);
+    }
+    static const uint64_t digitBits = 11;
+    static const uint64_t digitCount = 1ULL << digitBits;
+    uint64_t digitShift;
+    uint64_t digit(const OrientedReadPair& p) const
+    {
+        return (key(p) >> digitShift) & (digitCount - 1);
+    }
+
+    // Find the largest ReadId.
+    void maxReadIdThreadFunction(size_t threadId);
+    vector<ReadId> threadMaxReadId;
+
+    // For each thread, the number of occurrences of each digit in its slice,
+    // later replaced with the position where the next pair with that digit goes.
+    vector< vector<uint64_t> > threadDigitCount;
+    void countThreadFunction(size_t threadId);
+    void scatterThreadFunction(size_t threadId);
+
+    // Deduplication. For each thread, the number of unique pairs
+    // in its slice, later replaced with the position where
+    // they are stored.
+    vector<uint64_t> threadUniqueCount;
+    void countUniqueThreadFunction(size_t threadId);
+    void storeUniqueThreadFunction(size_t threadId);
+    bool isUnique(uint64_t i) const
+    {
+        if(i == 0) {
+            return true;
+        }
+        const OrientedReadPair& x = source[i - 1];
+        const OrientedReadPair& y = source[i];
+        return x.readIds != y.readIds or x.isSameStrand != y.isSameStrand;
+    }
+
+    // Copy from source to destination.
+    void copyThreadFunction(size_t threadId);
+};
+
+
+
+namespace shasta {
+    void testOrientedReadPairSorter();
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef SHASTA_PARSED_READ_META_DATA_HPP
+#define SHASTA_PARSED_READ_META_DATA_HPP
+
+#include "cstdint.hpp"
+#include <limits>
+
+namespace shasta {
+    class ParsedReadMetaData;
+}
+
+
+
+// Typed fields extracted from the free text read meta data
+// (the portion of the fasta or fastq header line following the read name).
+// These are the fields used by Assembler::suppressAlignment.
+// They are parsed once, after reads are loaded, so checking
+// an alignment candidate does not require parsing text.
+// The fields are stored together, one object per read,
+// so checking a pair of reads touches one cache line for each read.
+class shasta::ParsedReadMetaData {
+public:
+
+    // The read number within its channel, from meta data field "read".
+    uint64_t readNumber = invalidReadNumber;
+
+    // An integer that identifies the combination of meta data fields
+    // "sampleid" and "runid". Reads with the same sampleid and runid
+    // have the same sampleRunId.
+    uint32_t sampleRunId = invalidSampleRunId;
+
+    // The channel, from meta data field "ch".
+    uint16_t channel = invalidChannel;
+
+    // Values used when a field is missing or cannot be parsed.
+    static const uint64_t invalidReadNumber = std::numeric_limits<uint64_t>::max();
+    static const uint32_t invalidSampleRunId = std::numeric_limits<uint32_t>::max();
+    static const uint16_t invalidChannel = std::numeric_limits<uint16_t>::max();
+
+    // Return true if an alignment between two reads should be suppressed.
+    // This is the case if the two reads have the same channel,
+    // sampleid, and runid, and their read numbers differ by less than delta.
+    // If any of these fields is missing, the alignment is not suppressed.
+    // This is written without branches, because the outcome
+    // is not predictable when checking many alignment candidates.
+    static bool suppressAlignment(
+        const ParsedReadMetaData& x0,
+        const ParsedReadMetaData& x1,
+        uint64_t delta)
+    {
+        const uint64_t readNumberDifference =
+            (x0.readNumber > x1.readNumber) ?
+            (x0.readNumber - x1.readNumber) :
+            (x1.readNumber - x0.readNumber);
+        return bool(
+            (x0.channel == x1.channel) &
+            (x0.channel != invalidChannel) &
+            (x0.sampleRunId == x1.sampleRunId) &
+            (x0.sampleRunId != invalidSampleRunId) &
+            (x0.readNumber != invalidReadNumber) &
+            (x1.readNumber != invalidReadNumber) &
+            (readNumberDifference < delta));
+    }
+};
+
+#endif
@@ -3,15 +3,21 @@
 // Shasta.
 #include "Assembler.hpp"
 #include "Base.hpp"
+#include "CandidatePairTable.hpp"
 #include "CompactUndirectedGraph.hpp"
 #include "compressAlignment.hpp"
 #include "deduplicate.hpp"
 #include "dset64Test.hpp"
 #include "LongBaseSequence.hpp"
 #include "mappedCopy.hpp"
+#include "Markers.hpp"
 #include "MultithreadedObject.hpp"
+#include "OrientedReadPairSorter.hpp"
+#include "readParsingKernels.hpp"
+#include "ReadLoader.hpp"
 #include "ShortBaseSequence.hpp"
 #include "splitRange.hpp"
+#include "StrobemerChaining.hpp"
 #include "testSpoa.hpp"
 #include "SimpleBayesianConsensusCaller.hpp"
 #include "MedianConsensusCaller.hpp"
@@ -77,6 +83,15 @@ PYBIND11_MODULE(shasta, module)
             arg("readId"),
             arg("strand"),
             arg("fileName"))
+        .def("getReadId",
+            (
+                ReadId (Reads::*)
+                (const string&) const
+            )
+            &Reads::getReadId,
+            "Return the ReadId of the read with a given name, "
+            "or invalidReadId if there is no such read.",
+            arg("readName"))
         ;
 
     // Expose class Assembler to Python.
@@ -97,6 +112,14 @@ PYBIND11_MODULE(shasta, module)
             &Assembler::histogramReadLength,
             "Create a histogram of read length and write it to a csv file.",
             arg("fileName") = "ReadLengthHistogram.csv")
+        .def("getReadId",
+            &Assembler::getReadId,
+            "Return the ReadId of the read with a given name, "
+            "or invalidReadId if there is no such read.",
+            arg("readName"))
+        .def("compactRepeatCounts",
+            &Assembler::compactRepeatCounts,
+            "Convert read repeat counts to compact representation.")
 
         // K-mers.
         .def("accessKmers",
@@ -108,7 +131,8 @@ PYBIND11_MODULE(shasta, module)
             &Assembler::randomlySelectKmers,
             arg("k"),
             arg("probability"),
-            arg("seed") = 231)
+            arg("seed") = 231,
+            arg("threadCount") = 0)
         .def("selectKmersBasedOnFrequency",
             &Assembler::selectKmersBasedOnFrequency,
             arg("k"),
@@ -116,6 +140,14 @@ PYBIND11_MODULE(shasta, module)
             arg("seed") = 231,
             arg("enrichmentThreshold"),
             arg("threadCount") = 0)
+        .def("selectMinimizerKmers",
+            &Assembler::selectMinimizerKmers,
+            arg("k"),
+            arg("minimizerWindow"))
+        .def("selectSyncmerKmers",
+            &Assembler::selectSyncmerKmers,
+            arg("k"),
+            arg("syncmerS"))
         .def("selectKmers2",
             &Assembler::selectKmers2,
             arg("k"),
@@ -133,6 +165,33 @@ PYBIND11_MODULE(shasta, module)
             &Assembler::findMarkers,
             "Find markers in reads.",
             arg("threadCount") = 0)
+        .def("compactMarkerPositions",
+            &Assembler::compactMarkerPositions,
+            "Convert markers to compact representation.")
+        .def("computeKmersAndMarkersFingerprint",
+            &Assembler::computeKmersAndMarkersFingerprint,
+            "Compute a fingerprint of the reads and of a string describing "
+            "the options used to create k-mers and markers.",
+            arg("options"),
+            arg("threadCount") = 0)
+        .def("restoreKmersAndMarkersFromCache",
+            &Assembler::restoreKmersAndMarkersFromCache,
+            "Reuse k-mers and markers with the given fingerprint from a cache directory.",
+            arg("cacheDirectory"),
+            arg("fingerprint"))
+        .def("saveKmersAndMarkersToCache",
+            &Assembler::saveKmersAndMarkersToCache,
+            "Save k-mers and markers with the given fingerprint to a cache directory.",
+            arg("cacheDirectory"),
+            arg("fingerprint"))
+        .def("computeSortedMarkers",
+            &Assembler::computeSortedMarkers,
+            "Compute and store markers sorted by KmerId.",
+            arg("threadCount") = 0)
+        .def("accessSortedMarkers",
+            &Assembler::accessSortedMarkers)
+        .def("removeSortedMarkers",
+            &Assembler::removeSortedMarkers)
         .def("writeMarkers",
             (
                 void (Assembler::*)
@@ -161,6 +220,12 @@ PYBIND11_MODULE(shasta, module)
             arg("minBucketSize"),
             arg("maxBucketSize"),
             arg("minFrequency"),
+            arg("hashBatchSize") = 1,
+            arg("hashFamily") = 0,
+            arg("noKmerIdsCopy") = false,
+            arg("sortBuckets") = false,
+            arg("storeSketches") = false,
+            arg("useStoredSketches") = false,
             arg("threadCount") = 0)
         .def("findAlignmentCandidatesLowHash1",
             &Assembler::findAlignmentCandidatesLowHash1,
@@ -171,6 +236,20 @@ PYBIND11_MODULE(shasta, module)
             arg("minBucketSize"),
             arg("maxBucketSize"),
             arg("minFrequency"),
+            arg("hashBatchSize") = 1,
+            arg("hashFamily") = 0,
+            arg("noKmerIdsCopy") = false,
+            arg("storeSketches") = false,
+            arg("useStoredSketches") = false,
+            arg("threadCount") = 0)
+        .def("findAlignmentCandidatesStrobemerChaining",
+            &Assembler::findAlignmentCandidatesStrobemerChaining,
+            arg("minOffset") = 2,
+            arg("maxOffset") = 8,
+            arg("seedFraction") = 0.2,
+            arg("maxSeedFrequency") = 100,
+            arg("chainBandWidth") = 10,
+            arg("minFrequency") = 2,
             arg("threadCount") = 0)
         .def("accessAlignmentCandidates",
             &Assembler::accessAlignmentCandidates)
@@ -635,6 +714,7 @@ PYBIND11_MODULE(shasta, module)
 
 
     // Constants.
+    module.attr("invalidReadId") = invalidReadId;
     module.attr("invalidGlobalMarkerGraphVertexId") = MarkerGraph::invalidVertexId;
     module.attr("invalidCompressedGlobalMarkerGraphVertexId") =
         uint64_t(MarkerGraph::invalidCompressedVertexId);
@@ -678,6 +758,9 @@ PYBIND11_MODULE(shasta, module)
     module.def("testDeduplicateAndCount",
         testDeduplicateAndCount
         );
+    module.def("testReadLoaderGzip",
+        testReadLoaderGzip
+        );
     module.def("dset64Test",
         dset64Test,
         arg("n"),
@@ -686,6 +769,35 @@ PYBIND11_MODULE(shasta, module)
         arg("batchSize"),
         arg("seed")
         );
+    module.def("benchmarkReadParsingKernels",
+        benchmarkReadParsingKernels,
+        arg("readCount"),
+        arg("readLength"),
+        arg("fileName"),
+        arg("threadCount")
+        );
+    module.def("testMarkers",
+        testMarkers
+        );
+    module.def("testCandidatePairTable",
+        testCandidatePairTable
+        );
+    module.def("testOrientedReadPairSorter",
+        testOrientedReadPairSorter
+        );
+    module.def("benchmarkCompactMarkerPositions",
+        benchmarkCompactMarkerPositions,
+        arg("readCount"),
+        arg("readLength"),
+        arg("markerDensity")
+        );
+    module.def("benchmarkStrobemerChaining",
+        benchmarkStrobemerChaining,
+        arg("readCount"),
+        arg("readMarkerCount"),
+        arg("errorRate"),
+        arg("threadCount")
+        );
     module.def("mappedCopy",
         mappedCopy
         );
@@ -0,0 +1,404 @@
+// Shasta.
+#include "ReadArchive.hpp"
+#include "MurmurHash2.hpp"
+#include "Reads.hpp"
+#include "timestamp.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "algorithm.hpp"
+#include "chrono.hpp"
+#include "iostream.hpp"
+#include "stdexcept.hpp"
+
+// Linux.
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+const uint64_t ReadArchive::currentVersion;
+const uint64_t ReadArchive::sectionAlignment;
+const uint64_t ReadArchive::checksumBlockSize;
+const string ReadArchive::fileExtension = "shastaReads";
+const array<char, 8> ReadArchive::magic = {{'S', 'H', 'A', 'S', 'T', 'A', 'R', 'A'}};
+
+
+
+ReadArchive::ReadArchive() :
+    MultithreadedObject(*this)
+{
+}
+
+
+
+ReadArchive::~ReadArchive()
+{
+    if(isOpen()) {
+        close();
+    }
+}
+
+
+
+// Create a new archive containing all of the given reads.
+// The file is created with its final size and memory mapped,
+// then the tables of contents are computed single-threaded
+// and the reads are copied in using all threads.
+void ReadArchive::create(
+    const Reads& reads,
+    const string& fileName,
+    size_t threadCount)
+{
+    const auto t0 = steady_clock::now();
+    cout << timestamp << "Creating read archive " << fileName << endl;
+    SHASTA_ASSERT(not isOpen());
+    this->fileName = fileName;
+    if(threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    // Compute the size of each section.
+    const uint64_t readCount = reads.readCount();
+    uint64_t readNamesSize = 0;
+    uint64_t readMetaDataSize = 0;
+    uint64_t baseWordCount = 0;
+    uint64_t repeatCountCount = 0;
+    for(ReadId readId=0; readId<readCount; readId++) {
+        const uint64_t baseCount = reads.getRead(readId).baseCount;
+        readNamesSize += reads.getReadName(readId).size();
+        readMetaDataSize += reads.getReadMetaData(readId).size();
+        baseWordCount += LongBaseSequenceView::wordCount(baseCount);
+        repeatCountCount += baseCount;
+    }
+    array<uint64_t, sectionCount> sectionSizes;
+    const uint64_t tocSize = (readCount + 1) * sizeof(uint64_t);
+    sectionSizes[ReadNamesToc] = tocSize;
+    sectionSizes[ReadNames] = readNamesSize;
+    sectionSizes[ReadMetaDataToc] = tocSize;
+    sectionSizes[ReadMetaData] = readMetaDataSize;
+    sectionSizes[ReadBaseCounts] = readCount * sizeof(uint64_t);
+    sectionSizes[ReadBasesToc] = tocSize;
+    sectionSizes[ReadBases] = baseWordCount * sizeof(uint64_t);
+    sectionSizes[ReadRepeatCountsToc] = tocSize;
+    sectionSizes[ReadRepeatCounts] = repeatCountCount;
+
+    // Lay out the sections.
+    Header headerData;
+    std::fill(headerData.magic.begin(), headerData.magic.end(), 0);
+    std::copy(magic.begin(), magic.end(), headerData.magic.begin());
+    headerData.version = currentVersion;
+    headerData.readCount = readCount;
+    headerData.checksum = 0;
+    const auto align = [](uint64_t offset)
+    {
+        return ((offset + sectionAlignment - 1) / sectionAlignment) * sectionAlignment;
+    };
+    uint64_t offset = align(sizeof(Header));
+    for(uint64_t sectionId=0; sectionId<sectionCount; sectionId++) {
+        Section& section = headerData.sections[sectionId];
+        section.offset = offset;
+        section.size = sectionSizes[sectionId];
+        offset = align(offset + section.size);
+    }
+    headerData.fileSize = offset;
+
+    // Create the file with its final size and map it.
+    const int fileDescriptor = ::open(fileName.c_str(),
+        O_CREAT | O_TRUNC | O_RDWR,
+        S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if(fileDescriptor == -1) {
+        throw runtime_error("Error opening " + fileName + " for write: " + strerror(errno));
+    }
+    if(::ftruncate(fileDescriptor, headerData.fileSize) == -1) {
+        ::close(fileDescriptor);
+        throw runtime_error("Error setting size of " + fileName + " to " +
+            to_string(headerData.fileSize) + ": " + strerror(errno));
+    }
+    mappedSize = headerData.fileSize;
+    map(fileDescriptor, true);
+    header() = headerData;
+
+    // Store the tables of contents.
+    const auto t1 = steady_clock::now();
+    uint64_t* readNamesToc = section<uint64_t>(ReadNamesToc);
+    uint64_t* readMetaDataToc = section<uint64_t>(ReadMetaDataToc);
+    uint64_t* readBaseCounts = section<uint64_t>(ReadBaseCounts);
+    uint64_t* readBasesToc = section<uint64_t>(ReadBasesToc);
+    uint64_t* readRepeatCountsToc = section<uint64_t>(ReadRepeatCountsToc);
+    readNamesToc[0] = 0;
+    readMetaDataToc[0] = 0;
+    readBasesToc[0] = 0;
+    readRepeatCountsToc[0] = 0;
+    for(ReadId readId=0; readId<readCount; readId++) {
+        const uint64_t baseCount = reads.getRead(readId).baseCount;
+        readNamesToc[readId+1] = readNamesToc[readId] + reads.getReadName(readId).size();
+        readMetaDataToc[readId+1] = readMetaDataToc[readId] + reads.getReadMetaData(readId).size();
+        readBaseCounts[readId] = baseCount;
+        readBasesToc[readId+1] = readBasesToc[readId] + LongBaseSequenceView::wordCount(baseCount);
+        readRepeatCountsToc[readId+1] = readRepeatCountsToc[readId] + baseCount;
+    }
+
+    // Store the reads.
+    readsPointer = &reads;
+    setupLoadBalancing(readCount, 1000);
+    runThreads(&ReadArchive::createThreadFunction, threadCount);
+    readsPointer = 0;
+
+    // Compute and store the checksum.
+    const auto t2 = steady_clock::now();
+    header().checksum = computeChecksum(threadCount);
+
+    // Flush to disk and unmap.
+    const auto t3 = steady_clock::now();
+    if(::msync(mappedPointer, mappedSize, MS_SYNC) == -1) {
+        throw runtime_error("Error writing " + fileName + ": " + strerror(errno));
+    }
+    close();
+    const auto t4 = steady_clock::now();
+
+    cout << "Stored " << readCount << " reads in read archive " << fileName <<
+        " of size " << headerData.fileSize << " bytes." << endl;
+    cout << "Time to create the read archive:\n" <<
+        "Allocate: " << seconds(t1-t0) << " s.\n"
+        "Store: " << seconds(t2-t1) << " s.\n"
+        "Checksum: " << seconds(t3-t2) << " s.\n"
+        "Write: " << seconds(t4-t3) << " s.\n"
+        "Total: " << seconds(t4-t0) << " s." << endl;
+}
+
+
+
+void ReadArchive::createThreadFunction(size_t threadId)
+{
+    const Reads& reads = *readsPointer;
+    const uint64_t* readNamesToc = section<uint64_t>(ReadNamesToc);
+    const uint64_t* readMetaDataToc = section<uint64_t>(ReadMetaDataToc);
+    const uint64_t* readBasesToc = section<uint64_t>(ReadBasesToc);
+    const uint64_t* readRepeatCountsToc = section<uint64_t>(ReadRepeatCountsToc);
+    char* readNames = section<char>(ReadNames);
+    char* readMetaData = section<char>(ReadMetaData);
+    uint64_t* readBases = section<uint64_t>(ReadBases);
+    uint8_t* readRepeatCounts = section<uint8_t>(ReadRepeatCounts);
+
+    // Loop over all batches assigned to this thread.
+    vector<uint8_t> repeatCounts;
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over all reads in this batch.
+        for(ReadId readId=ReadId(begin); readId!=ReadId(end); readId++) {
+            const auto name = reads.getReadName(readId);
+            copy(name.begin(), name.end(), readNames + readNamesToc[readId]);
+
+            const auto metaData = reads.getReadMetaData(readId);
+            copy(metaData.begin(), metaData.end(), readMetaData + readMetaDataToc[readId]);
+
+            const LongBaseSequenceView read = reads.getRead(readId);
+            copy(read.begin, read.begin + LongBaseSequenceView::wordCount(read.baseCount),
+                readBases + readBasesToc[readId]);
+
+            reads.getReadRepeatCounts(readId, repeatCounts);
+            copy(repeatCounts.begin(), repeatCounts.end(),
+                readRepeatCounts + readRepeatCountsToc[readId]);
+        }
+    }
+}
+
+
+
+// Memory map an existing archive for read-only access,
+// after checking its header and checksum.
+void ReadArchive::open(
+    const string& fileName,
+    size_t threadCount)
+{
+    SHASTA_ASSERT(not isOpen());
+    this->fileName = fileName;
+    if(threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    // Open the file and get its size.
+    const int fileDescriptor = ::open(fileName.c_str(), O_RDONLY);
+    if(fileDescriptor == -1) {
+        throw runtime_error("Error opening " + fileName + " for read: " + strerror(errno));
+    }
+    struct stat fileInformation;
+    if(::fstat(fileDescriptor, &fileInformation) == -1) {
+        ::close(fileDescriptor);
+        throw runtime_error("Error obtaining size of " + fileName + ": " + strerror(errno));
+    }
+    mappedSize = uint64_t(fileInformation.st_size);
+    if(mappedSize < sizeof(Header)) {
+        ::close(fileDescriptor);
+        throw runtime_error(fileName + " is not a Shasta read archive: file is too short.");
+    }
+
+    // Let the system know that we will be accessing this file sequentially.
+#ifdef __linux__
+    ::posix_fadvise(fileDescriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    map(fileDescriptor, false);
+
+    // Check the header.
+    const Header& h = header();
+    if(h.magic != magic) {
+        close();
+        throw runtime_error(fileName + " is not a Shasta read archive.");
+    }
+    if(h.version != currentVersion) {
+        const uint64_t version = h.version;
+        close();
+        throw runtime_error("Read archive " + fileName + " has format version " +
+            to_string(version) + " but this version of Shasta requires version " +
+            to_string(currentVersion) + ". Recreate it using --command createReadArchive.");
+    }
+    if(h.fileSize != mappedSize) {
+        close();
+        throw runtime_error("Read archive " + fileName + " has incorrect size. "
+            "The file is truncated or corrupted.");
+    }
+    for(const Section& section: h.sections) {
+        if(section.offset % sectionAlignment or
+            section.offset > mappedSize or
+            section.size > mappedSize - section.offset) {
+            close();
+            throw runtime_error("Read archive " + fileName + " is corrupted.");
+        }
+    }
+
+    // Verify the checksum.
+    const auto t0 = steady_clock::now();
+    const uint64_t checksum = computeChecksum(threadCount);
+    const auto t1 = steady_clock::now();
+    if(checksum != h.checksum) {
+        close();
+        throw runtime_error("Checksum mismatch for read archive " + fileName +
+            ". The file is corrupted.");
+    }
+    cout << "Verified checksum of read archive " << fileName << " in " <<
+        seconds(t1 - t0) << " s." << endl;
+
+    // Check the tables of contents.
+    const uint64_t tocSize = (h.readCount + 1) * sizeof(uint64_t);
+    const auto checkToc = [&](SectionId tocSectionId, SectionId dataSectionId, uint64_t dataSize)
+    {
+        const uint64_t* toc = section<uint64_t>(tocSectionId);
+        return
+            h.sections[tocSectionId].size == tocSize and
+            toc[0] == 0 and
+            toc[h.readCount] * dataSize == h.sections[dataSectionId].size;
+    };
+    if(not (
+        checkToc(ReadNamesToc, ReadNames, sizeof(char)) and
+        checkToc(ReadMetaDataToc, ReadMetaData, sizeof(char)) and
+        checkToc(ReadBasesToc, ReadBases, sizeof(uint64_t)) and
+        checkToc(ReadRepeatCountsToc, ReadRepeatCounts, sizeof(uint8_t)) and
+        h.sections[ReadBaseCounts].size == h.readCount * sizeof(uint64_t))) {
+        close();
+        throw runtime_error("Read archive " + fileName + " is corrupted.");
+    }
+}
+
+
+
+void ReadArchive::close()
+{
+    SHASTA_ASSERT(isOpen());
+    if(::munmap(mappedPointer, mappedSize) == -1) {
+        throw runtime_error("Error unmapping " + fileName + ": " + strerror(errno));
+    }
+    mappedPointer = 0;
+    mappedSize = 0;
+}
+
+
+
+// Memory map a file. The file descriptor is closed.
+void ReadArchive::map(int fileDescriptor, bool writeAccess)
+{
+    void* pointer = ::mmap(0, mappedSize,
+        PROT_READ | (writeAccess ? PROT_WRITE : 0), MAP_SHARED,
+        fileDescriptor, 0);
+    ::close(fileDescriptor);
+    if(pointer == reinterpret_cast<void*>(-1LL)) {
+        throw runtime_error("Error mapping " + fileName + " to memory: " + strerror(errno));
+    }
+    mappedPointer = pointer;
+}
+
+
+
+uint64_t ReadArchive::readCount() const
+{
+    return header().readCount;
+}
+
+span<const char> ReadArchive::getReadName(uint64_t i) const
+{
+    const uint64_t* toc = section<uint64_t>(ReadNamesToc);
+    const char* begin = section<char>(ReadNames);
+    return span<const char>(begin + toc[i], begin + toc[i+1]);
+}
+
+span<const char> ReadArchive::getReadMetaData(uint64_t i) const
+{
+    const uint64_t* toc = section<uint64_t>(ReadMetaDataToc);
+    const char* begin = section<char>(ReadMetaData);
+    return span<const char>(begin + toc[i], begin + toc[i+1]);
+}
+
+LongBaseSequenceView ReadArchive::getRead(uint64_t i) const
+{
+    const uint64_t* toc = section<uint64_t>(ReadBasesToc);
+    const uint64_t* begin = section<uint64_t>(ReadBases);
+    const uint64_t baseCount = section<uint64_t>(ReadBaseCounts)[i];
+    return LongBaseSequenceView(begin + toc[i], baseCount);
+}
+
+span<const uint8_t> ReadArchive::getReadRepeatCounts(uint64_t i) const
+{
+    const uint64_t* toc = section<uint64_t>(ReadRepeatCountsToc);
+    const uint8_t* begin = section<uint8_t>(ReadRepeatCounts);
+    return span<const uint8_t>(begin + toc[i], begin + toc[i+1]);
+}
+
+
+
+// Compute the checksum of all data following the header.
+uint64_t ReadArchive::computeChecksum(size_t threadCount)
+{
+    const uint64_t begin = header().sections.front().offset;
+    const uint64_t blockCount = (mappedSize - begin + checksumBlockSize - 1) / checksumBlockSize;
+    blockChecksums.resize(blockCount);
+    setupLoadBalancing(blockCount, 1);
+    runThreads(&ReadArchive::computeChecksumThreadFunction, threadCount);
+    const uint64_t checksum = MurmurHash64A(blockChecksums.data(),
+        int(blockChecksums.size() * sizeof(uint64_t)), currentVersion);
+    blockChecksums.clear();
+    return checksum;
+}
+
+
+
+void ReadArchive::computeChecksumThreadFunction(size_t threadId)
+{
+    const uint64_t dataBegin = header().sections.front().offset;
+
+    // Loop over all batches assigned to this thread.
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over all blocks in this batch.
+        for(uint64_t blockId=begin; blockId!=end; blockId++) {
+            const uint64_t blockBegin = dataBegin + blockId * checksumBlockSize;
+            const uint64_t blockEnd = std::min(blockBegin + checksumBlockSize, mappedSize);
+            blockChecksums[blockId] = MurmurHash64A(data() + blockBegin,
+                int(blockEnd - blockBegin), blockId);
+        }
+    }
+}
@@ -0,0 +1,157 @@
+#ifndef SHASTA_READ_ARCHIVE_HPP
+#define SHASTA_READ_ARCHIVE_HPP
+
+// Shasta.
+#include "LongBaseSequence.hpp"
+#include "MultithreadedObject.hpp"
+#include "span.hpp"
+
+// Standard library.
+#include "array.hpp"
+#include "string.hpp"
+#include "vector.hpp"
+
+namespace shasta {
+    class ReadArchive;
+    class Reads;
+}
+
+
+
+/*******************************************************************************
+
+A read archive is a single binary file containing reads
+already in the form used by class Reads: run-length representation,
+repeat counts, read names, and read meta data.
+
+It is created by "--command createReadArchive" and can be used as an input file
+(with extension .shastaReads) in place of the fasta or fastq files
+it was created from. Loading reads from an archive does not
+require any parsing or run-length encoding, so it is limited
+only by memory bandwidth.
+
+The archive begins with a header, followed by a number of sections,
+each beginning at a multiple of sectionAlignment bytes.
+Sections that store one vector for each read consist of a table
+of contents section (readCount+1 offsets, as in MemoryMapped::VectorOfVectors)
+followed by a data section.
+This layout allows the archive to be memory mapped and
+accessed in place without any preprocessing.
+
+The header contains a format version and a checksum of all sections.
+Both are checked when an archive is opened.
+The archive uses the byte order of the machine that created it,
+so it is not portable between big endian and little endian machines.
+
+*******************************************************************************/
+
+class shasta::ReadArchive :
+    public MultithreadedObject<ReadArchive> {
+public:
+
+    // The version of the archive format.
+    // Increment this when the format changes.
+    static const uint64_t currentVersion = 1;
+
+    // The file extension for read archives.
+    static const string fileExtension;
+
+    ReadArchive();
+    ~ReadArchive();
+
+    // Create a new archive containing all of the given reads.
+    void create(
+        const Reads&,
+        const string& fileName,
+        size_t threadCount);
+
+    // Memory map an existing archive for read-only access,
+    // after checking its header and checksum.
+    void open(
+        const string& fileName,
+        size_t threadCount);
+    void close();
+    bool isOpen() const
+    {
+        return mappedPointer != 0;
+    }
+
+    // Accessors, valid after a successful call to open.
+    uint64_t readCount() const;
+    span<const char> getReadName(uint64_t i) const;
+    span<const char> getReadMetaData(uint64_t i) const;
+    LongBaseSequenceView getRead(uint64_t i) const;
+    span<const uint8_t> getReadRepeatCounts(uint64_t i) const;
+
+private:
+
+    static const uint64_t sectionAlignment = 4096;
+    static const uint64_t checksumBlockSize = 16 * 1024 * 1024;
+
+    enum SectionId {
+        ReadNamesToc,
+        ReadNames,
+        ReadMetaDataToc,
+        ReadMetaData,
+        ReadBaseCounts,
+        ReadBasesToc,
+        ReadBases,
+        ReadRepeatCountsToc,
+        ReadRepeatCounts,
+        sectionCount
+    };
+
+    class Section {
+    public:
+        uint64_t offset;    // In bytes, from the beginning of the file.
+        uint64_t size;      // In bytes.
+    };
+
+    class Header {
+    public:
+        array<char, 8> magic;
+        uint64_t version;
+        uint64_t readCount;
+        uint64_t fileSize;
+
+        // The checksum covers all bytes from the beginning
+        // of the first section to the end of the file.
+        uint64_t checksum;
+
+        array<Section, sectionCount> sections;
+    };
+    static const array<char, 8> magic;
+
+    // The memory mapped file.
+    string fileName;
+    void* mappedPointer = 0;
+    uint64_t mappedSize = 0;
+    char* data() const
+    {
+        return static_cast<char*>(mappedPointer);
+    }
+    Header& header() const
+    {
+        return *reinterpret_cast<Header*>(mappedPointer);
+    }
+    template<class T> T* section(SectionId sectionId) const
+    {
+        return reinterpret_cast<T*>(data() + header().sections[sectionId].offset);
+    }
+
+    // Memory map a file. Used by both create and open.
+    void map(int fileDescriptor, bool writeAccess);
+
+    // Functions used by create.
+    const Reads* readsPointer = 0;
+    void createThreadFunction(size_t threadId);
+
+    // Checksum computation.
+    // The data are divided in blocks of checksumBlockSize bytes
+    // that are hashed in parallel, then the block hashes are hashed.
+    vector<uint64_t> blockChecksums;
+    uint64_t computeChecksum(size_t threadCount);
+    void computeChecksumThreadFunction(size_t threadId);
+};
+
+#endif
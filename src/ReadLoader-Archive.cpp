@@ -0,0 +1,131 @@
+// Functions of class ReadLoader used to load reads
+// from a read archive created by --command createReadArchive.
+
+// Shasta.
+#include "ReadLoader.hpp"
+#include "ReadArchive.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "chrono.hpp"
+#include <numeric>
+
+
+
+// The reads in the archive are already in run-length representation,
+// so they are copied without parsing. Reads shorter than minReadLength
+// are discarded, as for other input formats. This is the same
+// structure used for compressed runnie files.
+void ReadLoader::processReadArchive()
+{
+    const auto t0 = steady_clock::now();
+
+    // Open the archive. This also verifies its checksum.
+    readArchive = make_shared<ReadArchive>();
+    ReadArchive& archive = *readArchive;
+    archive.open(fileName, threadCount);
+    const uint64_t readCountInFile = archive.readCount();
+    cout << "Read archive contains " << readCountInFile << " reads." << endl;
+
+    // Compute the raw length of each read.
+    const auto t1 = steady_clock::now();
+    readArchiveRawLengths.resize(readCountInFile);
+    setupLoadBalancing(readCountInFile, 1000);
+    runThreads(&ReadLoader::computeReadArchiveLengthsThreadFunction, threadCount);
+
+    // Use single-threaded code to create the space.
+    const auto t2 = steady_clock::now();
+    readIdTable.resize(readCountInFile);
+    ReadId readId = ReadId(reads.readCount());
+    for(uint64_t i=0; i!=readCountInFile; i++) {
+        const uint64_t rawLength = readArchiveRawLengths[i];
+        if(rawLength >= minReadLength) {
+            reads.readNames.appendVector(archive.getReadName(i).size());
+            reads.readMetaData.appendVector(archive.getReadMetaData(i).size());
+            const uint64_t baseCount = archive.getRead(i).baseCount;
+            reads.reads.append(baseCount);
+            reads.readRepeatCounts.appendVector(baseCount);
+            readIdTable[i] = readId++;
+        } else {
+            discardedShortReadReadCount++;
+            discardedShortReadBaseCount += rawLength;
+            readIdTable[i] = invalidReadId;
+        }
+    }
+    readArchiveRawLengths.clear();
+
+    // Use multithreaded code to store the reads.
+    const auto t3 = steady_clock::now();
+    setupLoadBalancing(readIdTable.size(), 1000);
+    runThreads(&ReadLoader::processReadArchiveThreadFunction, threadCount);
+    readIdTable.clear();
+    readArchive = 0;
+
+    // Free up unused allocated memory and allocate readFlags.
+    reads.readNames.unreserve();
+    reads.readMetaData.unreserve();
+    reads.readRepeatCounts.unreserve();
+    reads.reads.unreserve();
+    reads.readFlags.resize(reads.readCount());
+    const auto t4 = steady_clock::now();
+
+    cout << "Time to process this file:\n" <<
+        "Open and verify: " << seconds(t1-t0) << " s.\n"
+        "Compute read lengths: " << seconds(t2-t1) << " s.\n"
+        "Allocate: " << seconds(t3-t2) << " s.\n"
+        "Store: " << seconds(t4-t3) << " s.\n"
+        "Total: " << seconds(t4-t0) << " s." << endl;
+}
+
+
+
+void ReadLoader::computeReadArchiveLengthsThreadFunction(size_t threadId)
+{
+    const ReadArchive& archive = *readArchive;
+
+    // Loop over all batches assigned to this thread.
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over all reads in this batch.
+        for(uint64_t i=begin; i!=end; i++) {
+            const span<const uint8_t> repeatCounts = archive.getReadRepeatCounts(i);
+            readArchiveRawLengths[i] = std::accumulate(
+                repeatCounts.begin(), repeatCounts.end(), uint64_t(0));
+        }
+    }
+}
+
+
+
+void ReadLoader::processReadArchiveThreadFunction(size_t threadId)
+{
+    const ReadArchive& archive = *readArchive;
+
+    // Loop over all batches assigned to this thread.
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over all reads in this batch.
+        for(uint64_t i=begin; i!=end; i++) {
+            const ReadId readId = readIdTable[i];
+            if(readId == invalidReadId) {
+                continue;
+            }
+
+            const span<const char> name = archive.getReadName(i);
+            copy(name.begin(), name.end(), reads.readNames.begin(readId));
+
+            const span<const char> metaData = archive.getReadMetaData(i);
+            copy(metaData.begin(), metaData.end(), reads.readMetaData.begin(readId));
+
+            const LongBaseSequenceView read = archive.getRead(i);
+            const LongBaseSequenceView storedRead = reads.reads[readId];
+            copy(read.begin, read.begin + LongBaseSequenceView::wordCount(read.baseCount),
+                storedRead.begin);
+
+            const span<const uint8_t> repeatCounts = archive.getReadRepeatCounts(i);
+            copy(repeatCounts.begin(), repeatCounts.end(), reads.readRepeatCounts.begin(readId));
+        }
+    }
+}
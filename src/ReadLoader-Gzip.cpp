@@ -0,0 +1,578 @@
+// Functions of class ReadLoader used to read gzip-compressed input files.
+
+// Shasta.
+#include "ReadLoader.hpp"
+using namespace shasta;
+
+// zlib.
+#include <zlib.h>
+
+// Standard library.
+#include "array.hpp"
+#include "chrono.hpp"
+#include <cstring>
+
+// Linux.
+#include <unistd.h>
+
+
+
+// Calls inflateEnd on a z_stream when it goes out of scope,
+// including when an exception is thrown.
+namespace shasta {
+    class ZStreamGuard {
+    public:
+        z_stream& stream;
+        ZStreamGuard(z_stream& stream) : stream(stream) {}
+        ~ZStreamGuard()
+        {
+            inflateEnd(&stream);
+        }
+    };
+}
+
+
+
+// Prepare for processing a compressed file in streaming mode.
+// Look at the beginning of the file to decide if this is a bgzip file.
+// A bgzip block begins with a gzip header with the FEXTRA flag set
+// and with a "BC" extra subfield.
+// See https://samtools.github.io/hts-specs/SAMv1.pdf, section 4.1.
+void ReadLoader::startCompressedInput()
+{
+    // The buffer for compressed data gets the same
+    // amount of memory as each of the streaming chunks.
+    compressedBuffer.createNew(dataName("tmp-CompressedBuffer"), pageSize);
+    compressedBuffer.reserve(streamingData.chunkCapacity);
+    compressedBuffer.resize(streamingData.chunkCapacity);
+    compressedBegin = 0;
+    compressedEnd = 0;
+    compressedInputIsExhausted = false;
+    readCompressedData();
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(compressedBuffer.begin());
+    if(compressedEnd < 2 or p[0] != 31 or p[1] != 139) {
+        throw runtime_error(fileName + " is not a gzip file.");
+    }
+
+    uint64_t blockSize;
+    isBgzip = isBgzipBlock(0, blockSize);
+    if(isBgzip) {
+        cout << "File " << fileName << " is in bgzip format and will be "
+            "decompressed using " << threadCount + 1 << " threads." << endl;
+    } else {
+        startGzipInflation();
+    }
+}
+
+
+
+// Move the compressed data not yet inflated to the beginning
+// of compressedBuffer, then fill the rest of it with data from the file.
+void ReadLoader::readCompressedData()
+{
+    StreamingData& data = streamingData;
+    char* bufferBegin = compressedBuffer.begin();
+    std::memmove(bufferBegin, bufferBegin + compressedBegin, compressedEnd - compressedBegin);
+    compressedEnd -= compressedBegin;
+    compressedBegin = 0;
+
+    while(compressedEnd < compressedBuffer.size() and not compressedInputIsExhausted) {
+        const int64_t bytesRead = ::read(data.fileDescriptor,
+            bufferBegin + compressedEnd, compressedBuffer.size() - compressedEnd);
+        if(bytesRead == -1) {
+            throw runtime_error("Error reading from " + fileName + " near offset " +
+                to_string(data.bytesRead));
+        }
+        if(bytesRead == 0) {
+            compressedInputIsExhausted = true;
+            break;
+        }
+        compressedEnd += uint64_t(bytesRead);
+        data.bytesRead += uint64_t(bytesRead);
+    }
+#ifdef __linux__
+    if(noCache) {
+        ::posix_fadvise(data.fileDescriptor, 0, 0, POSIX_FADV_DONTNEED);
+    }
+#endif
+}
+
+
+
+// Return true if a complete bgzip block begins at this
+// position of compressedBuffer, and if so
+// store its total size (including header and trailer).
+bool ReadLoader::isBgzipBlock(uint64_t offset, uint64_t& blockSize) const
+{
+    const uint64_t n = compressedEnd;
+    if(offset + 18 > n) {
+        return false;
+    }
+    const unsigned char* p =
+        reinterpret_cast<const unsigned char*>(compressedBuffer.begin()) + offset;
+
+    // Only the FEXTRA flag can be set.
+    if(p[0] != 31 or p[1] != 139 or p[2] != 8 or p[3] != 4) {
+        return false;
+    }
+
+    // Look for the "BC" extra subfield, which contains the block size minus 1.
+    const uint64_t xlen = uint64_t(p[10]) | (uint64_t(p[11]) << 8);
+    const uint64_t headerSize = 12 + xlen;
+    if(offset + headerSize > n) {
+        return false;
+    }
+    uint64_t i = 12;
+    while(i + 4 <= headerSize) {
+        const uint64_t subfieldSize = uint64_t(p[i+2]) | (uint64_t(p[i+3]) << 8);
+        if(p[i] == 'B' and p[i+1] == 'C' and subfieldSize == 2 and i + 6 <= headerSize) {
+            blockSize = (uint64_t(p[i+4]) | (uint64_t(p[i+5]) << 8)) + 1;
+            return
+                blockSize >= headerSize + 8 and
+                offset + blockSize <= n;
+        }
+        i += 4 + subfieldSize;
+    }
+    return false;
+}
+
+
+
+// Locate the complete bgzip blocks at the beginning of the
+// compressed data that fit in a chunk that already contains size bytes,
+// and compute the position of each block in the chunk.
+// Return the size of the chunk after the blocks are inflated.
+// If the file turns out not to be entirely in bgzip format,
+// switch to plain gzip for the rest of the file.
+uint64_t ReadLoader::findBgzipBlocks(uint64_t size, uint64_t capacity, bool& isLast)
+{
+    bgzipBlocks.clear();
+    readCompressedData();
+
+    const unsigned char* p =
+        reinterpret_cast<const unsigned char*>(compressedBuffer.begin());
+    const auto readUint32 = [p](uint64_t offset)
+    {
+        return
+            uint32_t(p[offset]) |
+            (uint32_t(p[offset+1]) << 8) |
+            (uint32_t(p[offset+2]) << 16) |
+            (uint32_t(p[offset+3]) << 24);
+    };
+
+    uint64_t offset = compressedBegin;
+    while(true) {
+
+        // Check for end of file.
+        if(offset == compressedEnd and compressedInputIsExhausted) {
+            isLast = true;
+            break;
+        }
+
+        // Check that we have a complete bgzip block.
+        // A bgzip block cannot inflate to more than maxBgzipBlockSize bytes.
+        uint64_t blockSize;
+        if(not isBgzipBlock(offset, blockSize) or
+            readUint32(offset + blockSize - 4) > maxBgzipBlockSize) {
+
+            // The block is incomplete. It will be completed next time.
+            if(not compressedInputIsExhausted and compressedEnd - offset < maxBgzipBlockSize) {
+                break;
+            }
+
+            // This is not a bgzip block. Switch to plain gzip,
+            // after inflating the blocks already found, if any.
+            if(bgzipBlocks.empty()) {
+                cout << "File " << fileName << " is not entirely in bgzip format. "
+                    "The rest of it will be decompressed sequentially." << endl;
+                isBgzip = false;
+                startGzipInflation();
+            }
+            break;
+        }
+
+        const uint64_t xlen = uint64_t(p[offset+10]) | (uint64_t(p[offset+11]) << 8);
+        const uint64_t headerSize = 12 + xlen;
+
+        BgzipBlock block;
+        block.compressedBegin = offset + headerSize;
+        block.compressedSize = blockSize - headerSize - 8;
+        block.uncompressedBegin = size;
+        block.crc = readUint32(offset + blockSize - 8);
+        block.uncompressedSize = readUint32(offset + blockSize - 4);
+        block.fileOffset = streamingData.bytesRead - compressedEnd + offset;
+
+        // If the block does not fit in the chunk, leave it for the next chunk.
+        if(size + block.uncompressedSize > capacity) {
+            break;
+        }
+
+        bgzipBlocks.push_back(block);
+        size += block.uncompressedSize;
+        offset += blockSize;
+    }
+
+    compressedBegin = offset;
+    return size;
+}
+
+
+
+// This is called by all threads to inflate the blocks
+// found by findBgzipBlocks. Each thread inflates batches of blocks,
+// each of them directly into its final position in the chunk.
+void ReadLoader::inflateBgzipBlocks(char* chunkBegin)
+{
+    if(bgzipBlocks.empty()) {
+        return;
+    }
+
+    // Bgzip blocks contain raw deflate data (no zlib or gzip wrapper).
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if(inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        throw runtime_error("Error initializing zlib.");
+    }
+    const ZStreamGuard streamGuard(stream);
+
+    const uint64_t batchSize = 16;
+    while(true) {
+        const uint64_t begin = nextBgzipBlock.fetch_add(batchSize);
+        if(begin >= bgzipBlocks.size()) {
+            break;
+        }
+        const uint64_t end = min(begin + batchSize, uint64_t(bgzipBlocks.size()));
+        for(uint64_t i=begin; i!=end; i++) {
+            const BgzipBlock& block = bgzipBlocks[i];
+
+            // The empty block at the end of a bgzip file contains no data.
+            if(block.uncompressedSize == 0) {
+                continue;
+            }
+
+            unsigned char* output =
+                reinterpret_cast<unsigned char*>(chunkBegin + block.uncompressedBegin);
+            inflateReset(&stream);
+            stream.next_in = reinterpret_cast<unsigned char*>(
+                compressedBuffer.begin() + block.compressedBegin);
+            stream.avail_in = uInt(block.compressedSize);
+            stream.next_out = output;
+            stream.avail_out = block.uncompressedSize;
+            const int returnCode = inflate(&stream, Z_FINISH);
+            if(returnCode != Z_STREAM_END or stream.avail_out != 0 or
+                crc32(0, output, block.uncompressedSize) != block.crc) {
+                throw runtime_error("Error decompressing bgzip block at offset " +
+                    to_string(block.fileOffset) + " of " + fileName);
+            }
+        }
+    }
+}
+
+
+
+// Plain gzip: the stream is initialized for gzip decoding
+// and kept until the end of the file.
+void ReadLoader::startGzipInflation()
+{
+    gzipStream = shared_ptr<z_stream>(new z_stream, [](z_stream* stream)
+    {
+        inflateEnd(stream);
+        delete stream;
+    });
+    std::memset(gzipStream.get(), 0, sizeof(z_stream));
+    if(inflateInit2(gzipStream.get(), 16 + MAX_WBITS) != Z_OK) {
+        throw runtime_error("Error initializing zlib.");
+    }
+    gzipOutputIsPending = false;
+}
+
+
+
+// Inflate gzip data into the output, up to its capacity,
+// reading compressed data from the file as needed.
+// Return the number of bytes written.
+// Concatenated gzip members are allowed.
+uint64_t ReadLoader::inflateGzipData(
+    char* output,
+    uint64_t capacity,
+    bool& isLast)
+{
+    z_stream& stream = *gzipStream;
+
+    // The input and output are passed in pieces
+    // that fit in the 32-bit zlib counters.
+    const uint64_t maxPieceSize = 1ULL << 30;
+
+    uint64_t size = 0;
+    while(size < capacity) {
+        if(compressedBegin == compressedEnd and not compressedInputIsExhausted) {
+            readCompressedData();
+        }
+
+        // If all the input was inflated, we are done.
+        // If a gzip member was not completed, the file is truncated.
+        if(compressedBegin == compressedEnd and not gzipOutputIsPending) {
+            if(stream.total_in != 0) {
+                throw runtime_error("Unexpected end of file while decompressing " + fileName);
+            }
+            isLast = true;
+            break;
+        }
+
+        const uint64_t inputSize = min(compressedEnd - compressedBegin, maxPieceSize);
+        const uint64_t outputSize = min(capacity - size, maxPieceSize);
+        stream.next_in = reinterpret_cast<unsigned char*>(compressedBuffer.begin() + compressedBegin);
+        stream.avail_in = uInt(inputSize);
+        stream.next_out = reinterpret_cast<unsigned char*>(output + size);
+        stream.avail_out = uInt(outputSize);
+        const int returnCode = inflate(&stream, Z_NO_FLUSH);
+        compressedBegin += inputSize - stream.avail_in;
+        size += outputSize - stream.avail_out;
+
+        // If inflate filled all the output space it was given,
+        // it may still hold pending output after consuming all the input.
+        gzipOutputIsPending = (returnCode == Z_OK and stream.avail_out == 0);
+
+        if(returnCode == Z_STREAM_END) {
+            // End of a gzip member. Another one may follow.
+            inflateReset(&stream);
+        } else if(returnCode == Z_BUF_ERROR and stream.avail_in == 0) {
+            // No progress was possible because all the input was consumed
+            // and there was no pending output.
+            continue;
+        } else if(returnCode != Z_OK) {
+            throw runtime_error("Error decompressing " + fileName + ": " +
+                (stream.msg ? string(stream.msg) : ("zlib error " + to_string(returnCode))));
+        }
+    }
+    return size;
+}
+
+
+
+// Write gzip-compressed data to a file.
+static void writeGzipData(ofstream& file, const string& data, int level)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    SHASTA_ASSERT(deflateInit2(&stream, level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+    stream.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(data.data()));
+    stream.avail_in = uInt(data.size());
+    vector<unsigned char> output(1024 * 1024);
+    int returnCode = Z_OK;
+    while(returnCode != Z_STREAM_END) {
+        stream.next_out = output.data();
+        stream.avail_out = uInt(output.size());
+        returnCode = deflate(&stream, Z_FINISH);
+        SHASTA_ASSERT(returnCode == Z_OK or returnCode == Z_STREAM_END);
+        file.write(reinterpret_cast<const char*>(output.data()),
+            std::streamsize(output.size() - stream.avail_out));
+    }
+    deflateEnd(&stream);
+}
+
+
+
+// Write bgzip-compressed data to a file.
+// Each block contains at most 65280 bytes of uncompressed data,
+// as done by bgzip. If requested, the empty block
+// that marks the end of a bgzip file is also written.
+static void writeBgzipData(ofstream& file, const string& data, bool writeEofBlock)
+{
+    const uint64_t blockDataSize = 65280;
+    vector<unsigned char> output(2 * blockDataSize);
+    for(uint64_t begin=0; ; begin+=blockDataSize) {
+        const bool isEofBlock = (begin >= data.size());
+        if(isEofBlock and not writeEofBlock) {
+            break;
+        }
+        const uint64_t size = isEofBlock ? 0 : min(blockDataSize, data.size() - begin);
+
+        // Deflate the block without a wrapper.
+        z_stream stream;
+        std::memset(&stream, 0, sizeof(stream));
+        SHASTA_ASSERT(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(data.data() + begin);
+        stream.next_in = const_cast<unsigned char*>(input);
+        stream.avail_in = uInt(size);
+        stream.next_out = output.data();
+        stream.avail_out = uInt(output.size());
+        SHASTA_ASSERT(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+        const uint64_t compressedSize = output.size() - stream.avail_out;
+        deflateEnd(&stream);
+
+        // Write the header, the deflate data, and the trailer.
+        const uint64_t blockSize = 18 + compressedSize + 8;
+        const auto writeUint32 = [&file](uint32_t x)
+        {
+            for(uint64_t i=0; i<4; i++) {
+                file.put(char((x >> (8 * i)) & 0xff));
+            }
+        };
+        const array<unsigned char, 18> header = {31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0,
+            (unsigned char)((blockSize - 1) & 0xff), (unsigned char)((blockSize - 1) >> 8)};
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+        file.write(reinterpret_cast<const char*>(output.data()), std::streamsize(compressedSize));
+        writeUint32(uint32_t(crc32(0, input, uInt(size))));
+        writeUint32(uint32_t(size));
+
+        if(isEofBlock) {
+            break;
+        }
+    }
+}
+
+
+
+// Test loading of gzip-compressed files, including
+// corrupt and truncated files larger than the chunks
+// used in streaming mode.
+void shasta::testReadLoaderGzip()
+{
+    const string fileName = "testReadLoaderGzip.fasta.gz";
+
+    // A small memory budget, so the file is processed
+    // in many chunks of 4 MB.
+    const uint64_t chunkSize = 4 * 1024 * 1024;
+    const uint64_t memoryBudget = 3 * chunkSize;
+
+    // A fasta file with many copies of the same read.
+    // It compresses very well, so the output of each call to inflate
+    // fills the available space many times for each chunk of input.
+    const uint64_t readCount = 20000;
+    const uint64_t readLength = 10000;
+    string read;
+    uint64_t x = 231;
+    for(uint64_t i=0; i<readLength; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        read.push_back("ACGT"[x >> 62]);
+    }
+    string fasta;
+    for(uint64_t readId=0; readId<readCount; readId++) {
+        fasta += ">Read" + to_string(readId) + "\n" + read + "\n";
+    }
+    SHASTA_ASSERT(fasta.size() > 10 * chunkSize);
+
+    // Load the file and check the reads.
+    const auto checkReads = [&fileName](uint64_t memoryBudget, uint64_t expectedReadCount)
+    {
+        Reads reads;
+        reads.createNew("", "", "", "", "", 4096);
+        ReadLoader readLoader(fileName, 0, false, memoryBudget, 0, "", 4096, reads);
+        SHASTA_ASSERT(reads.readCount() == expectedReadCount);
+        for(ReadId readId=0; readId<expectedReadCount; readId++) {
+            const span<const char> name = reads.getReadName(readId);
+            SHASTA_ASSERT(string(name.begin(), name.end()) == "Read" + to_string(readId % readCount));
+            SHASTA_ASSERT(reads.getReadRawSequenceLength(readId) == readLength);
+        }
+        reads.remove();
+    };
+
+    // Load the file and check that an error is reported.
+    const auto checkError = [&fileName](uint64_t memoryBudget, const string& description)
+    {
+        bool errorWasReported = false;
+        try {
+            Reads reads;
+            reads.createNew("", "", "", "", "", 4096);
+            try {
+                ReadLoader readLoader(fileName, 0, false, memoryBudget, 0, "", 4096, reads);
+            } catch(...) {
+                reads.remove();
+                throw;
+            }
+            reads.remove();
+        } catch(const runtime_error& e) {
+            cout << description << ": " << e.what() << endl;
+            errorWasReported = true;
+        }
+        SHASTA_ASSERT(errorWasReported);
+    };
+
+    // A valid gzip file, with the default memory budget
+    // and with the small memory budget.
+    {
+        ofstream file(fileName);
+        writeGzipData(file, fasta, Z_BEST_COMPRESSION);
+    }
+    const uint64_t compressedSize = filesystem::fileSize(fileName);
+    checkReads(0, readCount);
+    checkReads(memoryBudget, readCount);
+    cout << "Valid gzip file: OK." << endl;
+
+    // Two concatenated gzip members.
+    {
+        ofstream file(fileName);
+        writeGzipData(file, fasta, Z_BEST_COMPRESSION);
+        writeGzipData(file, fasta, Z_DEFAULT_COMPRESSION);
+    }
+    checkReads(memoryBudget, 2 * readCount);
+    cout << "Concatenated gzip members: OK." << endl;
+
+    // A valid bgzip file, with the default memory budget
+    // and with the small memory budget.
+    {
+        ofstream file(fileName);
+        writeBgzipData(file, fasta, true);
+    }
+    checkReads(0, readCount);
+    checkReads(memoryBudget, readCount);
+    cout << "Valid bgzip file: OK." << endl;
+
+    // Bgzip blocks followed by a plain gzip member.
+    {
+        ofstream file(fileName);
+        writeBgzipData(file, fasta, false);
+        writeGzipData(file, fasta, Z_DEFAULT_COMPRESSION);
+    }
+    checkReads(memoryBudget, 2 * readCount);
+    cout << "Bgzip file followed by plain gzip: OK." << endl;
+
+    // A gzip file followed by garbage extending over many chunks.
+    // Decompression fails while there is still data to read,
+    // so this checks that the error does not hang the threads.
+    {
+        ofstream file(fileName);
+        writeGzipData(file, fasta.substr(0, 1000000), Z_DEFAULT_COMPRESSION);
+        const string garbage(10 * chunkSize, char(0xff));
+        file.write(garbage.data(), std::streamsize(garbage.size()));
+    }
+    checkError(memoryBudget, "Corrupt gzip file");
+
+    // A truncated gzip file.
+    {
+        ofstream file(fileName);
+        writeGzipData(file, fasta, Z_BEST_COMPRESSION);
+    }
+    ::truncate(fileName.c_str(), off_t(compressedSize / 2));
+    checkError(memoryBudget, "Truncated gzip file");
+
+    // A bgzip file with a corrupt block, which
+    // is detected while inflating blocks in parallel.
+    {
+        ofstream file(fileName);
+        writeBgzipData(file, fasta, true);
+    }
+    const uint64_t bgzipSize = filesystem::fileSize(fileName);
+    {
+        std::fstream file(fileName, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(std::streamoff(bgzipSize / 2));
+        file.put(char(0xff));
+        file.put(char(0xff));
+        file.put(char(0xff));
+        file.put(char(0xff));
+    }
+    checkError(memoryBudget, "Corrupt bgzip file");
+
+    // A truncated bgzip file.
+    {
+        ofstream file(fileName);
+        writeBgzipData(file, fasta, true);
+    }
+    ::truncate(fileName.c_str(), off_t(bgzipSize / 2));
+    checkError(memoryBudget, "Truncated bgzip file");
+
+    filesystem::remove(fileName);
+    cout << "testReadLoaderGzip: all tests passed." << endl;
+}
@@ -0,0 +1,390 @@
+// Functions of class ReadLoader used to process
+// fasta and fastq files in streaming mode.
+
+// Shasta.
+#include "ReadLoader.hpp"
+#include "readParsingKernels.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "chrono.hpp"
+
+
+
+// Process a fasta or fastq file in streaming mode.
+// The file is read in chunks of fixed size, alternating between two buffers.
+// During each iteration, threadCount threads parse the reads
+// in the current chunk, while an additional thread reads the next chunk.
+// The memory used for buffers is limited by streamingMemoryBudget,
+// regardless of the size of the file.
+// The reads are stored in the same order as in the file.
+// Compressed files are always processed in this way,
+// and the chunks receive the inflated data.
+void ReadLoader::processFileStreaming(bool isFastq)
+{
+    const auto t0 = steady_clock::now();
+    StreamingData& data = streamingData;
+    data.isFastq = isFastq;
+    data.readTime = 0.;
+    data.bytesRead = 0;
+    data.uncompressedBytes = 0;
+
+    // Each of the two buffers gets half of the memory budget.
+    // For compressed files, the budget is divided in three
+    // and the third part is used for compressed data.
+    uint64_t memoryBudget = streamingMemoryBudget;
+    if(isCompressed and memoryBudget == 0) {
+        memoryBudget = defaultCompressedMemoryBudget;
+    }
+    data.chunkCapacity = memoryBudget / (isCompressed ? 3 : 2);
+    if(data.chunkCapacity == 0 or (isCompressed and data.chunkCapacity < maxBgzipBlockSize)) {
+        throw runtime_error("Invalid memory budget for streaming mode.");
+    }
+    for(uint64_t i=0; i<data.chunks.size(); i++) {
+        StreamingData::Chunk& chunk = data.chunks[i];
+        chunk.data.createNew(dataName("tmp-StreamingBuffer-" + to_string(i)), pageSize);
+        chunk.data.reserve(data.chunkCapacity);
+        chunk.data.resize(data.chunkCapacity);
+        chunk.size = 0;
+        chunk.boundary = 0;
+        chunk.lineEnds.clear();
+        chunk.fastqRecords.clear();
+        chunk.isLast = false;
+    }
+
+    // Open the input file.
+    // We don't use O_DIRECT here because the incomplete read moved to the
+    // beginning of each chunk makes the read positions unaligned.
+    // Instead, if noCache was requested, we tell the kernel
+    // that we don't need cached data after reading each chunk.
+    data.fileDescriptor = ::open(fileName.c_str(), O_RDONLY);
+    if(data.fileDescriptor == -1) {
+        throw runtime_error("Error opening " + fileName + " for read.");
+    }
+    try {
+        if(isCompressed) {
+            startCompressedInput();
+        }
+
+        // Read the first chunk.
+        data.parseCurrentChunk = false;
+        data.nextChunkId = 0;
+        data.readNextChunk = true;
+        runStreamingThreads();
+    } catch(...) {
+        ::close(data.fileDescriptor);
+        data.fileDescriptor = -1;
+        throw;
+    }
+
+    // Main loop over chunks.
+    double parseTime = 0.;
+    double storeTime = 0.;
+    uint64_t chunkCount = 0;
+    for(uint64_t chunkId=0; ; chunkId++) {
+        StreamingData::Chunk& chunk = data.chunks[chunkId % 2];
+        const bool isLast = chunk.isLast;
+
+        // Parse the reads in this chunk and, at the same time,
+        // read the next chunk, if any.
+        const auto t1 = steady_clock::now();
+        text = span<const char>(chunk.data.begin(), chunk.data.begin() + chunk.boundary);
+        lineEnds.swap(chunk.lineEnds);
+        fastqRecords.swap(chunk.fastqRecords);
+        data.parseCurrentChunk = true;
+        data.nextChunkId = chunkId + 1;
+        data.readNextChunk = not isLast;
+        allocatePerThreadDataStructures();
+        try {
+            runStreamingThreads();
+        } catch(...) {
+            ::close(data.fileDescriptor);
+            data.fileDescriptor = -1;
+            throw;
+        }
+        text = span<const char>();
+        lineEnds.clear();
+        fastqRecords.clear();
+        const auto t2 = steady_clock::now();
+
+        // Store the reads found in this chunk.
+        storeThreadReads();
+        const auto t3 = steady_clock::now();
+
+        parseTime += seconds(t2 - t1);
+        storeTime += seconds(t3 - t2);
+        ++chunkCount;
+        if(isLast) {
+            break;
+        }
+    }
+
+    // Clean up.
+    ::close(data.fileDescriptor);
+    data.fileDescriptor = -1;
+    for(StreamingData::Chunk& chunk: data.chunks) {
+        chunk.data.remove();
+        chunk.lineEnds.clear();
+        chunk.fastqRecords.clear();
+    }
+    if(isCompressed) {
+        compressedBuffer.remove();
+        gzipStream = 0;
+    }
+
+    // Free up unused allocated memory and allocate readFlags.
+    storeReads();
+    const auto t4 = steady_clock::now();
+    const double t04 = seconds(t4 - t0);
+
+    cout << "File size: " << data.bytesRead << " bytes." << endl;
+    if(isCompressed) {
+        cout << "Uncompressed size: " << data.uncompressedBytes << " bytes." << endl;
+    }
+    cout << "Processed in streaming mode using " << chunkCount <<
+        " chunks of up to " << data.chunkCapacity << " bytes." << endl;
+    cout << "Time to process this file:\n" <<
+        (isCompressed ? "Read and decompress" : "Read") <<
+        " (overlapped with parse): " << data.readTime << " s.\n" <<
+        "Parse: " << parseTime << " s.\n"
+        "Store: " << storeTime << " s.\n"
+        "Total: " << t04 << " s." << endl;
+    cout << "Read rate: " << double(data.bytesRead) / t04 << " bytes/s." << endl;
+    if(isCompressed) {
+        cout << "Decompress rate: " << double(data.uncompressedBytes) / t04 << " bytes/s." << endl;
+    }
+}
+
+
+
+// Run the threads that parse the current chunk, if requested,
+// and read the next chunk, if requested.
+void ReadLoader::runStreamingThreads()
+{
+    StreamingData& data = streamingData;
+    data.inflateInParallel = data.readNextChunk and isBgzip;
+    data.bgzipBlocksAreReady = false;
+    data.exception = nullptr;
+
+    runThreads(&ReadLoader::streamingThreadFunction, threadCount + 1);
+
+    if(data.exception) {
+        std::exception_ptr exception = data.exception;
+        data.exception = nullptr;
+        std::rethrow_exception(exception);
+    }
+
+    // For bgzip files, the boundary of the next chunk can only
+    // be located once all threads are done inflating it.
+    if(data.inflateInParallel) {
+        locateStreamingChunkBoundary(data.nextChunkId);
+    }
+}
+
+
+
+// Threads 0 to threadCount-1 parse the current chunk, if necessary.
+// Thread threadCount reads the next chunk, if necessary.
+// For bgzip files, all threads then inflate the blocks of the next chunk.
+// Exceptions that occur while reading or inflating are
+// stored and rethrown by runStreamingThreads.
+void ReadLoader::streamingThreadFunction(size_t threadId)
+{
+    StreamingData& data = streamingData;
+
+    if(threadId == threadCount) {
+        if(data.readNextChunk) {
+            try {
+                readStreamingChunk(data.nextChunkId);
+            } catch(...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if(not data.exception) {
+                    data.exception = std::current_exception();
+                }
+                if(data.inflateInParallel) {
+                    bgzipBlocks.clear();
+                    data.bgzipBlocksAreReady = true;
+                    data.bgzipBlocksReady.notify_all();
+                }
+                return;
+            }
+        }
+    } else if(data.parseCurrentChunk) {
+        if(data.isFastq) {
+            processFastqFileThreadFunction(threadId);
+        } else {
+            processFastaFileThreadFunction(threadId);
+        }
+    }
+
+    if(data.inflateInParallel) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            data.bgzipBlocksReady.wait(lock, [&data] {return data.bgzipBlocksAreReady;});
+        }
+        try {
+            inflateBgzipBlocks(data.chunks[data.nextChunkId % 2].data.begin());
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(not data.exception) {
+                data.exception = std::current_exception();
+            }
+        }
+    }
+}
+
+
+
+// Read a chunk into its buffer and locate the last read
+// boundary in it.
+void ReadLoader::readStreamingChunk(uint64_t chunkId)
+{
+    const auto t0 = steady_clock::now();
+    StreamingData& data = streamingData;
+    StreamingData::Chunk& chunk = data.chunks[chunkId % 2];
+    char* chunkBegin = chunk.data.begin();
+
+    // Move the incomplete read at the end of the previous chunk
+    // to the beginning of this chunk. The previous chunk is
+    // being parsed, but only up to its boundary.
+    uint64_t size = 0;
+    if(chunkId > 0) {
+        const StreamingData::Chunk& previousChunk = data.chunks[(chunkId + 1) % 2];
+        size = previousChunk.size - previousChunk.boundary;
+        std::copy(
+            previousChunk.data.begin() + previousChunk.boundary,
+            previousChunk.data.begin() + previousChunk.size,
+            chunkBegin);
+    }
+
+    // Fill the rest of the chunk with data from the file.
+    chunk.isLast = false;
+    if(isCompressed) {
+        const uint64_t oldSize = size;
+        if(data.inflateInParallel) {
+
+            // Locate the bgzip blocks for this chunk and let
+            // all threads inflate them.
+            size = findBgzipBlocks(size, data.chunkCapacity, chunk.isLast);
+            nextBgzipBlock = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                data.bgzipBlocksAreReady = true;
+            }
+            data.bgzipBlocksReady.notify_all();
+
+            // If the file turned out not to be entirely in bgzip format,
+            // findBgzipBlocks switched to plain gzip mode.
+            if(not isBgzip) {
+                size += inflateGzipData(chunkBegin + size, data.chunkCapacity - size, chunk.isLast);
+            }
+        } else {
+            size += inflateGzipData(chunkBegin + size, data.chunkCapacity - size, chunk.isLast);
+        }
+        data.uncompressedBytes += size - oldSize;
+    } else {
+        while(size < data.chunkCapacity) {
+            const int64_t bytesRead = ::read(data.fileDescriptor,
+                chunkBegin + size, data.chunkCapacity - size);
+            if(bytesRead == -1) {
+                throw runtime_error("Error reading from " + fileName + " near offset " +
+                    to_string(data.bytesRead));
+            }
+            if(bytesRead == 0) {
+                chunk.isLast = true;
+                break;
+            }
+            size += uint64_t(bytesRead);
+            data.bytesRead += uint64_t(bytesRead);
+        }
+#ifdef __linux__
+        if(noCache) {
+            ::posix_fadvise(data.fileDescriptor, 0, 0, POSIX_FADV_DONTNEED);
+        }
+#endif
+    }
+    chunk.size = size;
+
+    // For bgzip files, the boundary is located by runStreamingThreads
+    // once all the blocks of this chunk are inflated.
+    if(not data.inflateInParallel) {
+        locateStreamingChunkBoundary(chunkId);
+    }
+    data.readTime += seconds(steady_clock::now() - t0);
+}
+
+
+
+// Locate the boundary of the last complete read in a chunk.
+void ReadLoader::locateStreamingChunkBoundary(uint64_t chunkId)
+{
+    StreamingData& data = streamingData;
+    StreamingData::Chunk& chunk = data.chunks[chunkId % 2];
+    const char* chunkBegin = chunk.data.begin();
+    const uint64_t size = chunk.size;
+
+    const string message =
+        "A read in " + fileName + " does not fit in a chunk of " +
+        to_string(data.chunkCapacity) + " bytes. "
+        "Increase the memory budget for streaming mode" +
+        (isCompressed ? string(".") : string(", or turn streaming mode off."));
+    chunk.lineEnds.clear();
+    chunk.fastqRecords.clear();
+    if(data.isFastq) {
+
+        // Find the line ends.
+        shasta::findLineEnds(chunkBegin, 0, size, chunk.lineEnds);
+
+        // Locate the complete records.
+        // This only looks at the first character of each line,
+        // so it is fast enough to be done sequentially.
+        const span<const char> chunkText(chunkBegin, chunkBegin + size);
+        uint64_t lineId = 0;
+        FastqRecord record;
+        string errorMessage;
+        while(true) {
+            const FastqRecordStatus status =
+                parseFastqRecord(chunkText, chunk.lineEnds, lineId, record, errorMessage);
+            if(status == FastqRecordStatus::invalid) {
+                throw runtime_error(errorMessage);
+            }
+            if(status == FastqRecordStatus::incomplete) {
+                break;
+            }
+            chunk.fastqRecords.push_back(record);
+            lineId = record.endLine;
+        }
+
+        if(chunk.isLast) {
+            if(lineId != chunk.lineEnds.size()) {
+                throw runtime_error("Incomplete read at end of file " + fileName);
+            }
+            chunk.boundary = size;
+        } else {
+            if(chunk.fastqRecords.empty()) {
+                throw runtime_error(message);
+            }
+            chunk.lineEnds.resize(lineId);
+            chunk.boundary = chunk.lineEnds.back() + 1;
+        }
+
+    } else {
+
+        // Look backward for the last ">" at the beginning of a line.
+        if(chunk.isLast) {
+            chunk.boundary = size;
+        } else {
+            uint64_t offset = size;
+            while(true) {
+                if(offset <= 1) {
+                    throw runtime_error(message);
+                }
+                --offset;
+                if(chunkBegin[offset] == '>' and chunkBegin[offset-1] == '\n') {
+                    break;
+                }
+            }
+            chunk.boundary = offset;
+        }
+    }
+}
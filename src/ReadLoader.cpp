@@ -1,11 +1,13 @@
 // Shasta.
 #include "ReadLoader.hpp"
 #include "CompressedRunnieReader.hpp"
-#include "computeRunLengthRepresentation.hpp"
+#include "ReadArchive.hpp"
+#include "readParsingKernels.hpp"
 #include "splitRange.hpp"
 using namespace shasta;
 
 // Standard library.
+#include "algorithm.hpp"
 #include "chrono.hpp"
 #include "iterator.hpp"
 
@@ -16,6 +18,7 @@ ReadLoader::ReadLoader(
     const string& fileName,
     uint64_t minReadLength,
     bool noCache,
+    uint64_t streamingMemoryBudget,
     size_t threadCount,
     const string& dataNamePrefix,
     size_t pageSize,
@@ -25,6 +28,7 @@ ReadLoader::ReadLoader(
     fileName(fileName),
     minReadLength(minReadLength),
     noCache(noCache),
+    streamingMemoryBudget(streamingMemoryBudget),
     threadCount(threadCount),
     dataNamePrefix(dataNamePrefix),
     pageSize(pageSize),
@@ -35,9 +39,15 @@ ReadLoader::ReadLoader(
     adjustThreadCount();
 
     // Get the file extension.
+    // If the file is gzip-compressed, use the extension
+    // that precedes the ".gz".
     string extension;
     try {
         extension = filesystem::extension(fileName);
+        if(extension=="gz" || extension=="GZ") {
+            isCompressed = true;
+            extension = filesystem::extension(filesystem::fileName(fileName));
+        }
     } catch (...) {
         throw runtime_error("Input file " + fileName +
             " must have an extension consistent with its format.");
@@ -45,25 +55,42 @@ ReadLoader::ReadLoader(
 
     // Fasta file. ReadLoader is more forgiving than OldFastaReadLoader.
     if(extension=="fasta" || extension=="fa" || extension=="FASTA" || extension=="FA") {
-        processFastaFile();
+        if(streamingMemoryBudget or isCompressed) {
+            processFileStreaming(false);
+        } else {
+            processFastaFile();
+        }
         return;
     }
 
     // Fastq file.
     if(extension=="fastq" || extension=="fq" || extension=="FASTQ" || extension=="FQ") {
-        processFastqFile();
+        if(streamingMemoryBudget or isCompressed) {
+            processFileStreaming(true);
+        } else {
+            processFastqFile();
+        }
         return;
     }
 
     // Runnie compressed file.
-    if(extension=="rq" || extension=="RQ") {
+    if((extension=="rq" || extension=="RQ") and not isCompressed) {
         processCompressedRunnieFile();
         return;
     }
 
+    // Read archive created by --command createReadArchive.
+    if(extension == ReadArchive::fileExtension and not isCompressed) {
+        processReadArchive();
+        return;
+    }
+
     // If getting here, the file extension is not supported.
     throw runtime_error("File extension " + extension + " is not supported. "
-        "Supported file extensions are .fasta, .fa, .FASTA, .FA.");
+        "Supported file extensions are .fasta, .fa, .FASTA, .FA, "
+        ".fastq, .fq, .FASTQ, .FQ, .rq, .RQ, ." + ReadArchive::fileExtension + ". "
+        "Fasta and fastq files can also be gzip-compressed, "
+        "with an additional .gz extension.");
 }
 
 void ReadLoader::adjustThreadCount()
@@ -81,12 +108,14 @@ void ReadLoader::processFastaFile()
     // Read the entire fasta file.
     const auto t0 = std::chrono::steady_clock::now();
     readFile();
+    text = span<const char>(buffer.begin(), buffer.end());
 
     // Each thread stores reads in its own data structures.
     const auto t1 = std::chrono::steady_clock::now();
     allocatePerThreadDataStructures();
     runThreads(&ReadLoader::processFastaFileThreadFunction, threadCount);
     const auto t2 = std::chrono::steady_clock::now();
+    text = span<const char>();
     buffer.remove();
 
     // Store the reads computed by each thread and free
@@ -110,8 +139,8 @@ void ReadLoader::processFastaFile()
 // is in the file block assigned to the read.
 void ReadLoader::processFastaFileThreadFunction(size_t threadId)
 {
-    const char* bufferPointer = &buffer[0];
-    const uint64_t bufferSize = buffer.size();
+    const char* bufferPointer = text.begin();
+    const uint64_t bufferSize = text.size();
 
     // Allocate and access the data structures where this thread will store the
     // reads it finds.
@@ -152,9 +181,9 @@ void ReadLoader::processFastaFileThreadFunction(size_t threadId)
     // Main loop over the reads in the file block allocated to this thread.
     string readName;
     string readMetaData;
-    vector<Base> read;
     vector<Base> runLengthRead;
     vector<uint8_t> readRepeatCount;
+    RunLengthEncoder encoder;
     while(offset < end) {
         SHASTA_ASSERT(fastaReadBeginsHere(offset));
 
@@ -200,58 +229,45 @@ void ReadLoader::processFastaFileThreadFunction(size_t threadId)
 
 
 
-        // Read the bases.
+        // Read the bases, one line at a time, and compute
+        // their run-length representation.
+        // White space is skipped. We stop at the beginning of the next read,
+        // which is a line beginning with ">".
         // Note that here we can go past the file block assigned to this thread.
-        read.clear();
-        uint64_t invalidBaseCount = 0;
-        while(offset != bufferSize) {
-            const char c = bufferPointer[offset];
-
-            // Skip white space.
-            if(c==' ' || c=='\t' || c=='\n' || c=='\r') {
-                ++offset;
-                continue;
-            }
-
-            // If we reached the beginning of another read, stop here.
-            if(c=='>' && fastaReadBeginsHere(offset))  {
-                break;
-            }
-
-            // Get a base from this character.
-            const Base base = Base::fromCharacterNoException(c);
-            if(base.isValid()) {
-                read.push_back(base);
-            } else {
-                ++invalidBaseCount;
-            }
-            ++offset;
+        encoder.begin(runLengthRead, readRepeatCount, true);
+        while(offset != bufferSize and bufferPointer[offset] != '>') {
+            const char* lineBegin = bufferPointer + offset;
+            const char* lineEnd = findNextLineEnd(lineBegin, bufferPointer + bufferSize);
+            encoder.append(lineBegin, lineEnd);
+            offset = min(uint64_t(lineEnd - bufferPointer) + 1, bufferSize);
         }
+        const bool repeatCountsAreValid = encoder.end();
+        const uint64_t baseCount = encoder.baseCount;
 
 
         // If we found invalid bases, skip this read.
-        if(invalidBaseCount) {
+        if(encoder.invalidCharacterCount) {
             __sync_fetch_and_add(&discardedInvalidBaseReadCount, 1);
-            __sync_fetch_and_add(&discardedInvalidBaseReadCount, read.size());
+            __sync_fetch_and_add(&discardedInvalidBaseReadCount, baseCount);
             continue;
         }
 
         // If the read is too short, skip it.
-        if(read.size() < minReadLength) {
+        if(baseCount < minReadLength) {
             __sync_fetch_and_add(&discardedShortReadReadCount, 1);
-            __sync_fetch_and_add(&discardedShortReadBaseCount, read.size());
+            __sync_fetch_and_add(&discardedShortReadBaseCount, baseCount);
             continue;
         }
 
         // Store the read bases.
-        if(computeRunLengthRepresentation(read, runLengthRead, readRepeatCount)) {
+        if(repeatCountsAreValid) {
             thisThreadReadNames.appendVector(readName.begin(), readName.end());
             thisThreadReadMetaData.appendVector(readMetaData.begin(), readMetaData.end());
             thisThreadReads.append(runLengthRead);
             thisThreadReadRepeatCounts.appendVector(readRepeatCount);
         } else {
             __sync_fetch_and_add(&discardedBadRepeatCountReadCount, 1);
-            __sync_fetch_and_add(&discardedBadRepeatCountBaseCount, read.size());
+            __sync_fetch_and_add(&discardedBadRepeatCountBaseCount, baseCount);
         }
     }
 
@@ -263,11 +279,11 @@ void ReadLoader::processFastaFileThreadFunction(size_t threadId)
 // at this position in Fasta format.
 bool ReadLoader::fastaReadBeginsHere(uint64_t offset) const
 {
-    if(buffer[offset] == '>') {
+    if(text[offset] == '>') {
         if(offset == 0) {
             return true;
         } else {
-            return buffer[offset-1] == '\n';
+            return text[offset-1] == '\n';
         }
     } else {
         return false;
@@ -277,39 +293,41 @@ bool ReadLoader::fastaReadBeginsHere(uint64_t offset) const
 
 
 // Process a fastq file under the following assumptions:
-// - 4 lines per read.
 // - For each read:
 //   * The first line must begin with '@'.
-//   * The third line must consist of just a '+' with nothing else.
-//   * The second and fourth line must have the same number of bytes,
-//     also equal to the number of bases in the read. The fourth
-//     line is otherwise ignored.
-//   * The second line can only contain ACGT. Invalid bases are not allowed.
+//   * The sequence can be on any number of lines.
+//   * The sequence is followed by a line beginning with '+'.
+//     The '+' can be followed by a repetition of the read name
+//     or of the entire header line.
+//   * The quality scores follow, on any number of lines,
+//     with the same total number of characters as the sequence.
+//     The quality scores are otherwise ignored.
+//   * The sequence can only contain ACGT. Invalid bases are not allowed.
 // - No Windows line ends.
+// The usual layout with 4 lines per read is a special case.
 void ReadLoader::processFastqFile()
 {
 
     // Read the entire fastq file.
     const auto t0 = std::chrono::steady_clock::now();
     readFile();
+    text = span<const char>(buffer.begin(), buffer.end());
 
-    // Find all line ends in the file.
+    // Find all line ends in the file, then use them
+    // to locate the fastq records.
     const auto t1 = std::chrono::steady_clock::now();
     findLineEnds();
-    cout << "Found " << lineEnds.size() << " lines in this file." << endl;
-
-    // Check that the number of lines is a multiple of 4
-    // (there must be exactly 4 mlines per read per the above assumptions).
-    if((lineEnds.size() %4) != 0) {
-        throw runtime_error("File has " + to_string(lineEnds.size()) +
-            " lines. Expected a multiple of 4. "
-            "Only fastq files with each read on exactly 4 lines are supported.");
-    }
+    locateFastqRecords();
+    cout << "Found " << fastqRecords.size() << " reads in " <<
+        lineEnds.size() << " lines in this file." << endl;
 
     // Each thread stores reads in its own data structures.
     const auto t2 = std::chrono::steady_clock::now();
     allocatePerThreadDataStructures();
     runThreads(&ReadLoader::processFastqFileThreadFunction, threadCount);
+    text = span<const char>();
+    lineEnds.clear();
+    fastqRecords.clear();
     buffer.remove();
 
 
@@ -330,6 +348,166 @@ void ReadLoader::processFastqFile()
 
 
 
+// Locate the fastq record beginning at the specified line,
+// using only the line ends and the first character of each line.
+ReadLoader::FastqRecordStatus ReadLoader::parseFastqRecord(
+    const span<const char>& text,
+    const vector<uint64_t>& lineEnds,
+    uint64_t lineId,
+    FastqRecord& record,
+    string& errorMessage)
+{
+    const uint64_t lineCount = lineEnds.size();
+    if(lineId >= lineCount) {
+        return FastqRecordStatus::incomplete;
+    }
+    const uint64_t headerBegin = lineBegin(lineEnds, lineId);
+    if(text[headerBegin] != '@') {
+        errorMessage = "Read at offset " + to_string(headerBegin) +
+            " does not begin with \"@\".";
+        return FastqRecordStatus::invalid;
+    }
+    record.headerLine = lineId;
+
+    // The sequence lines continue up to the first line beginning with '+'.
+    // A sequence line cannot begin with '+'.
+    uint64_t sequenceLength = 0;
+    ++lineId;
+    for(; lineId<lineCount; ++lineId) {
+        const uint64_t begin = lineBegin(lineEnds, lineId);
+        if(text[begin] == '+') {
+            break;
+        }
+        sequenceLength += lineEnds[lineId] - begin;
+    }
+    if(lineId == lineCount) {
+        return FastqRecordStatus::incomplete;
+    }
+    record.plusLine = lineId;
+
+    // The quality lines continue until they have as many characters
+    // as the sequence lines. There is always at least one.
+    uint64_t qualityLength = 0;
+    do {
+        ++lineId;
+        if(lineId == lineCount) {
+            return FastqRecordStatus::incomplete;
+        }
+        qualityLength += lineEnds[lineId] - lineBegin(lineEnds, lineId);
+    } while(qualityLength < sequenceLength);
+    if(qualityLength != sequenceLength) {
+        errorMessage =
+            "Inconsistent numbers of bases and quality scores for read at offset " +
+            to_string(headerBegin) + ": " +
+            to_string(sequenceLength) + " bases, " +
+            to_string(qualityLength) + " quality scores.";
+        return FastqRecordStatus::invalid;
+    }
+    record.endLine = lineId + 1;
+
+    return FastqRecordStatus::valid;
+}
+
+
+
+// Function that returns true if a fastq record appears to begin
+// at this line. We require the record, and the next one if any,
+// to be valid.
+bool ReadLoader::fastqRecordBeginsHere(uint64_t lineId) const
+{
+    FastqRecord record;
+    string errorMessage;
+    if(parseFastqRecord(text, lineEnds, lineId, record, errorMessage) !=
+        FastqRecordStatus::valid) {
+        return false;
+    }
+    if(record.endLine == lineEnds.size()) {
+        return true;
+    }
+    return parseFastqRecord(text, lineEnds, record.endLine, record, errorMessage) ==
+        FastqRecordStatus::valid;
+}
+
+
+
+// Fill fastqRecords for the entire text.
+// Each thread locates the records that begin in a block of lines.
+// The first record in each block is found using fastqRecordBeginsHere.
+// If a thread guessed wrong, its block will not begin where the
+// previous block ends, and we locate its records again sequentially.
+// This guarantees that the result is the same as sequential processing.
+void ReadLoader::locateFastqRecords()
+{
+    threadFastqRecords.clear();
+    threadFastqRecords.resize(threadCount);
+    runThreads(&ReadLoader::locateFastqRecordsThreadFunction, threadCount);
+
+    fastqRecords.clear();
+    uint64_t lineId = 0;
+    FastqRecord record;
+    string errorMessage;
+    for(size_t threadId=0; threadId<threadCount; threadId++) {
+        const vector<FastqRecord>& thisThreadFastqRecords = threadFastqRecords[threadId];
+        if(not thisThreadFastqRecords.empty() and
+            thisThreadFastqRecords.front().headerLine == lineId) {
+            fastqRecords.insert(fastqRecords.end(),
+                thisThreadFastqRecords.begin(), thisThreadFastqRecords.end());
+            lineId = thisThreadFastqRecords.back().endLine;
+        } else {
+            uint64_t begin, end;
+            tie(begin, end) = splitRange(0, lineEnds.size(), threadCount, threadId);
+            while(lineId < end) {
+                const FastqRecordStatus status =
+                    parseFastqRecord(text, lineEnds, lineId, record, errorMessage);
+                if(status == FastqRecordStatus::incomplete) {
+                    throw runtime_error("Incomplete read at offset " +
+                        to_string(lineBegin(lineEnds, lineId)) + " at end of file.");
+                }
+                if(status == FastqRecordStatus::invalid) {
+                    throw runtime_error(errorMessage);
+                }
+                fastqRecords.push_back(record);
+                lineId = record.endLine;
+            }
+        }
+    }
+    threadFastqRecords.clear();
+}
+
+
+
+void ReadLoader::locateFastqRecordsThreadFunction(size_t threadId)
+{
+    vector<FastqRecord>& thisThreadFastqRecords = threadFastqRecords[threadId];
+
+    // Compute the block of lines assigned to this thread.
+    uint64_t begin, end;
+    tie(begin, end) = splitRange(0, lineEnds.size(), threadCount, threadId);
+
+    // Locate the first record that begins in this block.
+    uint64_t lineId = begin;
+    while(lineId != end and not fastqRecordBeginsHere(lineId)) {
+        ++lineId;
+    }
+
+    // Locate all records that begin in this block.
+    // If we find an error, leave this block for sequential processing,
+    // which will report the error.
+    FastqRecord record;
+    string errorMessage;
+    while(lineId < end) {
+        if(parseFastqRecord(text, lineEnds, lineId, record, errorMessage) !=
+            FastqRecordStatus::valid) {
+            thisThreadFastqRecords.clear();
+            return;
+        }
+        thisThreadFastqRecords.push_back(record);
+        lineId = record.endLine;
+    }
+}
+
+
+
 void ReadLoader::processFastqFileThreadFunction(size_t threadId)
 {
 
@@ -342,13 +520,9 @@ void ReadLoader::processFastqFileThreadFunction(size_t threadId)
     MemoryMapped::VectorOfVectors<uint8_t, uint64_t>& thisThreadReadRepeatCounts =
         *threadReadRepeatCounts[threadId];
 
-    // Find the total number of reads in the file.
-    SHASTA_ASSERT((lineEnds.size() % 4) == 0); // We already checked for that.
-    const ReadId readCountInFile = ReadId(lineEnds.size() / 4);
-
     // Compute the range of reads in the file assigned to this thread.
     uint64_t begin, end;
-    tie(begin, end) = splitRange(0, readCountInFile, threadCount, threadId);
+    tie(begin, end) = splitRange(0, fastqRecords.size(), threadCount, threadId);
     if(begin == end) {
         return;
     }
@@ -358,34 +532,20 @@ void ReadLoader::processFastqFileThreadFunction(size_t threadId)
     // Loop over this range of reads.
     string readName;
     string readMetaData;
-    vector<Base> read;
     vector<Base> runLengthRead;
     vector<uint8_t> readRepeatCount;
-    const auto fileBegin = buffer.begin();
+    RunLengthEncoder encoder;
+    const auto fileBegin = text.begin();
     for(uint64_t i=begin; i!=end; i++) {
-
-        // Locate the 4 line ends corresponding to this read.
-        const auto thisReadLineEnds = lineEnds.begin() + i * 4;
+        const FastqRecord& record = fastqRecords[i];
 
         // Locate the header line for this read.
-        const auto headerBegin = fileBegin + ((i==0) ? 0 : (1 + *(thisReadLineEnds-1)));
-        const auto headerEnd = fileBegin + thisReadLineEnds[0];
-        SHASTA_ASSERT(headerEnd > headerBegin);
-
-        // Locate the sequence line for this read.
-        const auto sequenceBegin = headerEnd + 1;
-        const auto sequenceEnd = fileBegin + thisReadLineEnds[1];
-        SHASTA_ASSERT(sequenceEnd > sequenceBegin);
+        const auto headerBegin = fileBegin + lineBegin(lineEnds, record.headerLine);
+        const auto headerEnd = fileBegin + lineEnds[record.headerLine];
 
         // Locate the line containing the '+' for this read.
-        const auto plusBegin = sequenceEnd + 1;
-        const auto plusEnd = fileBegin + thisReadLineEnds[2];
-        SHASTA_ASSERT(plusEnd > plusBegin);
-
-        // Locate the header line for this read.
-        const auto scoresBegin = plusEnd + 1;
-        const auto scoresEnd = fileBegin + thisReadLineEnds[3];
-        SHASTA_ASSERT(scoresEnd > scoresBegin);
+        const auto plusBegin = fileBegin + lineBegin(lineEnds, record.plusLine);
+        const auto plusEnd = fileBegin + lineEnds[record.plusLine];
 
         // Check the header line.
         if(headerEnd == headerBegin) {
@@ -429,55 +589,48 @@ void ReadLoader::processFastqFileThreadFunction(size_t threadId)
 
 
         // Check the line containing the plus.
-        if(plusEnd - plusBegin != 1) {
-            throw runtime_error("Extraneous characters on third line for read " +
-                readName + " at offset " + to_string(headerBegin-fileBegin) + ".");
-        }
-        if(*plusBegin != '+') {
-            throw runtime_error("Third line does not contain \"+\" for read " +
+        // Anything following the plus must repeat the read name
+        // or the entire header line.
+        SHASTA_ASSERT(*plusBegin == '+');
+        const string plusText(plusBegin + 1, plusEnd);
+        if(not (plusText.empty() or plusText == readName or
+            plusText == string(headerBegin + 1, headerEnd))) {
+            throw runtime_error("Extraneous characters on \"+\" line for read " +
                 readName + " at offset " + to_string(headerBegin-fileBegin) + ".");
         }
 
-        // Get the number of bases.
-        const auto baseCount = sequenceEnd - sequenceBegin;
-        if(scoresEnd - scoresBegin != baseCount) {
-            throw runtime_error(
-                "Inconsistent numbers of bases and quality scores for read " +
-                readName + " at offset " +
-                to_string(headerBegin-fileBegin) + ": " +
-                to_string(baseCount) + " bases, " +
-                to_string(scoresEnd - scoresBegin) + " quality scores."
-                );
+        // Get the bases and compute their run-length representation.
+        // The sequence can be on multiple lines.
+        encoder.begin(runLengthRead, readRepeatCount, false);
+        for(uint64_t lineId=record.headerLine+1; lineId!=record.plusLine; ++lineId) {
+            encoder.append(
+                fileBegin + lineBegin(lineEnds, lineId),
+                fileBegin + lineEnds[lineId]);
         }
-
-        // Get the bases.
-        read.clear();
-        for(auto it=sequenceBegin; it!=sequenceEnd; ++it) {
-            const char c = *it;
-            const Base base = Base::fromCharacterNoException(c);
-            if(!base.isValid()) {
-                throw runtime_error("Invalid base " + string(1, c) + " for read " +
-                    readName + " at offset " + to_string(it-fileBegin) + ".");
-            }
-            read.push_back(base);
+        const bool repeatCountsAreValid = encoder.end();
+        if(encoder.invalidCharacterCount) {
+            const auto it = encoder.firstInvalidCharacter;
+            throw runtime_error("Invalid base " + string(1, *it) + " for read " +
+                readName + " at offset " + to_string(it-fileBegin) + ".");
         }
+        const uint64_t baseCount = encoder.baseCount;
 
         // If the read is too short, skip it.
-        if(read.size() < minReadLength) {
+        if(baseCount < minReadLength) {
             __sync_fetch_and_add(&discardedShortReadReadCount, 1);
-            __sync_fetch_and_add(&discardedShortReadBaseCount, read.size());
+            __sync_fetch_and_add(&discardedShortReadBaseCount, baseCount);
             continue;
         }
 
         // Store the read.
-        if(computeRunLengthRepresentation(read, runLengthRead, readRepeatCount)) {
+        if(repeatCountsAreValid) {
             thisThreadReadNames.appendVector(readName.begin(), readName.end());
             thisThreadReadMetaData.appendVector(readMetaData.begin(), readMetaData.end());
             thisThreadReads.append(runLengthRead);
             thisThreadReadRepeatCounts.appendVector(readRepeatCount);
         } else {
             __sync_fetch_and_add(&discardedBadRepeatCountReadCount, 1);
-            __sync_fetch_and_add(&discardedBadRepeatCountBaseCount, read.size());
+            __sync_fetch_and_add(&discardedBadRepeatCountBaseCount, baseCount);
         }
     }
 }
@@ -562,17 +715,13 @@ void ReadLoader::findLineEndsThreadFunction(size_t threadId)
 
     // Compute the file block assigned to this thread.
     uint64_t begin, end;
-    tie(begin, end) = splitRange(0, buffer.size(), threadCount, threadId);
+    tie(begin, end) = splitRange(0, text.size(), threadCount, threadId);
     if(begin == end) {
         return;
     }
 
     // Look for line ends in this block.
-    for(uint64_t offset=begin; offset!=end; offset++) {
-        if(buffer[offset] == '\n') {
-            thisThreadLineEnds.push_back(offset);
-        }
-    }
+    shasta::findLineEnds(text.begin(), begin, end, thisThreadLineEnds);
 }
 
 
@@ -704,9 +853,28 @@ void ReadLoader::processCompressedRunnieFileThreadFunction(size_t threadId)
 // Store the reads computed by each thread and free
 // the per-thread data structures.
 void ReadLoader::storeReads()
+{
+    storeThreadReads();
+
+    // Free up unused allocated memory.
+    reads.readNames.unreserve();
+    reads.readMetaData.unreserve();
+    reads.readRepeatCounts.unreserve();
+    reads.reads.unreserve();
+
+    // Allocate enough space for readFlags which are populated later.
+    reads.readFlags.resize(reads.readCount());
+}
+
+
+
+// Append the reads computed by each thread to the global
+// data structures, in order of increasing threadId,
+// and remove the per-thread data structures.
+void ReadLoader::storeThreadReads()
 {
     // Loop over all threads.
-    for(size_t threadId=0; threadId<threadCount; threadId++) {
+    for(size_t threadId=0; threadId<threadReadNames.size(); threadId++) {
 
         // Access the names.
         MemoryMapped::VectorOfVectors<char, uint64_t>& thisThreadReadNames =
@@ -752,14 +920,5 @@ void ReadLoader::storeReads()
     threadReadMetaData.clear();
     threadReads.clear();
     threadReadRepeatCounts.clear();
-
-    // Free up unused allocated memory.
-    reads.readNames.unreserve();
-    reads.readMetaData.unreserve();
-    reads.readRepeatCounts.unreserve();
-    reads.reads.unreserve();
-
-    // Allocate enough space for readFlags which are populated later.
-    reads.readFlags.resize(reads.readCount());
 }
 
@@ -8,13 +8,22 @@
 #include "Reads.hpp"
 
 // Standard library.
+#include "array.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
 #include "memory.hpp"
 #include "string.hpp"
 
 namespace shasta {
     class ReadLoader;
+    void testReadLoaderGzip();
 }
 class CompressedRunnieReader;
+struct z_stream_s;
+namespace shasta {
+    class ReadArchive;
+}
 
 
 
@@ -28,6 +37,7 @@ public:
         const string& fileName,
         uint64_t minReadLength,
         bool noCache,
+        uint64_t streamingMemoryBudget,
         size_t threadCount,
         const string& dataNamePrefix,
         size_t pageSize,
@@ -59,6 +69,11 @@ private:
     // If set, use the O_DIRECT flag when opening input files (Linux only).
     bool noCache;
 
+    // If not zero, fasta and fastq files are processed in streaming mode,
+    // using at most this number of bytes for the input buffers.
+    // Otherwise, each file is read entirely into memory before parsing.
+    uint64_t streamingMemoryBudget;
+
     // The number of threads to be used for processing.
     // Reading is done single-threaded as there is usually no benefit
     // frm multithreaded reading.
@@ -85,6 +100,74 @@ private:
     MemoryMapped::Vector<char> buffer;
     void readFile();
 
+
+
+    // Functions and data used for gzip-compressed input files (.gz).
+    // These are in ReadLoader-Gzip.cpp.
+    // Compressed files are always processed in streaming mode.
+    // The inflated data are stored in the same chunks
+    // used for uncompressed files, so parsing is not affected,
+    // and inflation of each chunk is overlapped with
+    // parsing of the previous one.
+    bool isCompressed = false;
+
+    // The memory budget used for compressed files
+    // if streamingMemoryBudget is zero.
+    static const uint64_t defaultCompressedMemoryBudget = 1024ULL * 1024 * 1024;
+
+    // Compressed data read from the file but not yet
+    // inflated are in compressedBuffer[compressedBegin, compressedEnd).
+    MemoryMapped::Vector<char> compressedBuffer;
+    uint64_t compressedBegin = 0;
+    uint64_t compressedEnd = 0;
+    bool compressedInputIsExhausted = false;
+    void startCompressedInput();
+    void readCompressedData();
+
+    // Return true if a complete bgzip block begins at this
+    // position of compressedBuffer, and if so
+    // store its total size (including header and trailer).
+    static const uint64_t maxBgzipBlockSize = 65536;
+    bool isBgzipBlock(uint64_t offset, uint64_t& blockSize) const;
+
+    // For bgzip files, the blocks of each chunk are inflated in parallel,
+    // each one directly into its final position in the chunk.
+    // This is done by all threads, after they are done parsing the
+    // previous chunk, while the reader thread reads compressed data
+    // for the next chunk.
+    bool isBgzip = false;
+    class BgzipBlock {
+    public:
+        uint64_t compressedBegin;   // Beginning of the deflate data in compressedBuffer.
+        uint64_t compressedSize;    // Size of the deflate data.
+        uint64_t uncompressedBegin; // Position in the chunk.
+        uint32_t uncompressedSize;  // ISIZE from the block trailer.
+        uint32_t crc;               // CRC32 from the block trailer.
+        uint64_t fileOffset;        // Position of the block in the file, for error messages.
+    };
+    vector<BgzipBlock> bgzipBlocks;
+    // Locate the blocks to be inflated into a chunk
+    // that already contains size bytes, and return the
+    // size of the chunk after they are inflated.
+    uint64_t findBgzipBlocks(uint64_t size, uint64_t capacity, bool& isLast);
+    void inflateBgzipBlocks(char* chunkBegin);
+    std::atomic<uint64_t> nextBgzipBlock {0};
+
+    // For plain gzip files, which cannot be inflated in parallel,
+    // the thread that reads compressed data also inflates them.
+    // If a file begins in bgzip format but later contains
+    // gzip members that are not bgzip blocks,
+    // we switch to this mode at that point.
+    shared_ptr<z_stream_s> gzipStream;
+    bool gzipOutputIsPending = false;
+    void startGzipInflation();
+
+    // Inflate data into the output, up to its capacity,
+    // and return the number of bytes written.
+    // Concatenated gzip members are allowed.
+    // isLast is set if all the input was inflated.
+    uint64_t inflateGzipData(char* output, uint64_t capacity, bool& isLast);
+
     // Vectors where each thread stores the reads it found.
     // Indexed by threadId.
     vector< shared_ptr<MemoryMapped::VectorOfVectors<char, uint64_t> > > threadReadNames;
@@ -97,6 +180,12 @@ private:
     // Store the reads computed by each thread and free
     // the per-thread data structures.
     void storeReads();
+    void storeThreadReads();
+
+    // The text being parsed by the fasta and fastq thread functions.
+    // This is the entire buffer or, in streaming mode,
+    // the portion of the current chunk that ends at a read boundary.
+    span<const char> text;
 
     // Functions used for fasta files.
     void processFastaFile();
@@ -109,6 +198,49 @@ private:
     void processFastqFile();
     void processFastqFileThreadFunction(size_t threadId);
 
+    // A fastq record consists of a header line beginning with "@",
+    // any number of sequence lines, a line beginning with "+",
+    // and one or more quality lines with the same total number
+    // of characters as the sequence lines.
+    // Records are located using lineEnds, before parsing.
+    class FastqRecord {
+    public:
+        // Indexes in lineEnds of the header line, of the "+" line,
+        // and of the first line following the record.
+        uint64_t headerLine;
+        uint64_t plusLine;
+        uint64_t endLine;
+    };
+    vector<FastqRecord> fastqRecords;
+
+    // Locate the fastq record beginning at the specified line.
+    // If the status is invalid, errorMessage is set.
+    // If the status is incomplete, the record extends past the last line end.
+    enum class FastqRecordStatus {valid, incomplete, invalid};
+    static FastqRecordStatus parseFastqRecord(
+        const span<const char>& text,
+        const vector<uint64_t>& lineEnds,
+        uint64_t lineId,
+        FastqRecord&,
+        string& errorMessage);
+    static uint64_t lineBegin(const vector<uint64_t>& lineEnds, uint64_t lineId)
+    {
+        return (lineId == 0) ? 0 : (lineEnds[lineId - 1] + 1);
+    }
+
+    // Function that returns true if a fastq record appears to begin
+    // at this line. Because quality lines can begin with "@" or "+",
+    // this is only a heuristic, used to split the file into blocks
+    // that are processed in parallel. The results are checked
+    // by locateFastqRecords, which falls back to sequential
+    // processing for any block where this guessed wrong.
+    bool fastqRecordBeginsHere(uint64_t lineId) const;
+
+    // Fill fastqRecords for the entire text.
+    void locateFastqRecords();
+    void locateFastqRecordsThreadFunction(size_t threadId);
+    vector< vector<FastqRecord> > threadFastqRecords;
+
     // Find all line ends in the file.
     void findLineEnds();
     void findLineEndsThreadFunction(size_t threadId);
@@ -116,15 +248,91 @@ private:
     vector<uint64_t> lineEnds;
 
 
+    // Functions and data used in streaming mode (ReadLoader-Streaming.cpp).
+    // The file is read in fixed size chunks using two buffers.
+    // While the reads in one chunk are being parsed by threadCount threads,
+    // an additional thread reads the next chunk into the other buffer.
+    // Each chunk ends at a read boundary, and the incomplete
+    // read at the end of the data read from the file is moved to
+    // the beginning of the next chunk.
+    // For compressed files, the next chunk receives inflated data.
+    void processFileStreaming(bool isFastq);
+    void runStreamingThreads();
+    void streamingThreadFunction(size_t threadId);
+    void readStreamingChunk(uint64_t chunkId);
+    void locateStreamingChunkBoundary(uint64_t chunkId);
+    class StreamingData {
+    public:
+        bool isFastq = false;
+        int fileDescriptor = -1;
+        uint64_t chunkCapacity = 0;
+        uint64_t nextChunkId = 0;
+        bool parseCurrentChunk = false;
+        bool readNextChunk = false;
+        double readTime = 0.;
+        uint64_t bytesRead = 0;
+        uint64_t uncompressedBytes = 0;
+
+        // For bgzip files, set if the threads inflate the blocks
+        // of the next chunk after parsing the current one.
+        // They wait until the reader thread located the blocks.
+        bool inflateInParallel = false;
+        bool bgzipBlocksAreReady = false;
+        std::condition_variable bgzipBlocksReady;
+
+        // An exception thrown while reading or inflating.
+        // It is rethrown once all threads are done.
+        std::exception_ptr exception;
+        class Chunk {
+        public:
+            MemoryMapped::Vector<char> data;
+
+            // The number of valid bytes in data.
+            uint64_t size = 0;
+
+            // The reads to be parsed are in [0, boundary).
+            // The rest is moved to the next chunk.
+            uint64_t boundary = 0;
+
+            // For fastq files, the line ends in [0, boundary)
+            // and the records they form.
+            vector<uint64_t> lineEnds;
+            vector<FastqRecord> fastqRecords;
+
+            // Set if this is the last chunk of the file.
+            bool isLast = false;
+        };
+        array<Chunk, 2> chunks;
+    };
+    StreamingData streamingData;
+
+
+
     // Functions and data used for compressed runnie files.
     void processCompressedRunnieFile();
     void processCompressedRunnieFileThreadFunction(size_t threadId);
     shared_ptr<CompressedRunnieReader> compressedRunnieReader;
 
-    // The ReadId corresponding to each index in the Runnie file.
+    // The ReadId corresponding to each index in the Runnie file
+    // or read archive.
     vector<ReadId> readIdTable;
 
 
+
+    // Functions and data used for read archives created by
+    // --command createReadArchive (ReadLoader-Archive.cpp).
+    // The reads are already in run-length representation,
+    // so they are copied without any parsing.
+    void processReadArchive();
+    void computeReadArchiveLengthsThreadFunction(size_t threadId);
+    void processReadArchiveThreadFunction(size_t threadId);
+    shared_ptr<ReadArchive> readArchive;
+
+    // The raw length of each read in the read archive,
+    // used to discard reads shorter than minReadLength.
+    vector<uint64_t> readArchiveRawLengths;
+
+
 };
 
 
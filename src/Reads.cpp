@@ -1,8 +1,11 @@
 // Shasta
 #include "Reads.hpp"
+#include "MurmurHash2.hpp"
 
 // Standard Library
+#include "algorithm.hpp"
 #include "fstream.hpp"
+#include <map>
 
 using namespace shasta;
 
@@ -22,18 +25,130 @@ void Reads::createNew(
     readFlags.createNew(readFlagsDataName, largeDataPageSize);
 }
 
+void Reads::remove()
+{
+    if(reads.isOpen()) {
+        reads.remove();
+    }
+    if(readNames.isOpen()) {
+        readNames.remove();
+    }
+    if(readMetaData.isOpen()) {
+        readMetaData.remove();
+    }
+    if(readRepeatCounts.isOpen()) {
+        readRepeatCounts.remove();
+    }
+    if(compactReadRepeatCounts.isOpen()) {
+        compactReadRepeatCounts.remove();
+    }
+    if(readFlags.isOpen) {
+        readFlags.remove();
+    }
+    if(readNameIndex.isOpen) {
+        readNameIndex.remove();
+    }
+    if(parsedReadMetaData.isOpen) {
+        parsedReadMetaData.remove();
+    }
+}
+
+void Reads::addRead(
+    const string& name,
+    const vector<Base>& runLengthSequence,
+    const vector<uint8_t>& repeatCounts)
+{
+    SHASTA_ASSERT(runLengthSequence.size() == repeatCounts.size());
+    readNames.appendVector(name.begin(), name.end());
+    readMetaData.appendVector();
+    reads.append(runLengthSequence);
+    readRepeatCounts.appendVector(repeatCounts);
+    readFlags.push_back(ReadFlags());
+}
+
 void Reads::access(
     const string& readsDataName,
     const string& readNamesDataName,
     const string& readMetaDataDataName,
     const string& readRepeatCountsDataName,
-    const string& readFlagsDataName)
+    const string& compactReadRepeatCountsDataName,
+    const string& readFlagsDataName,
+    const string& readNameIndexDataName,
+    const string& parsedReadMetaDataDataName)
 {
     reads.accessExistingReadWrite(readsDataName);
     readNames.accessExistingReadWrite(readNamesDataName);
     readMetaData.accessExistingReadWrite(readMetaDataDataName);
-    readRepeatCounts.accessExistingReadWrite(readRepeatCountsDataName);
+
+    // Only one of the two representations of repeat counts exists.
+    try {
+        readRepeatCounts.accessExistingReadWrite(readRepeatCountsDataName);
+    } catch(const exception&) {
+        compactReadRepeatCounts.accessExistingReadOnly(compactReadRepeatCountsDataName);
+    }
+
     readFlags.accessExistingReadWrite(readFlagsDataName);
+
+    // The read name index and the parsed meta data
+    // are not available for older assemblies.
+    try {
+        readNameIndex.accessExistingReadOnly(readNameIndexDataName);
+    } catch(const exception&) {
+        // Leave it closed.
+    }
+    try {
+        parsedReadMetaData.accessExistingReadOnly(parsedReadMetaDataDataName);
+    } catch(const exception&) {
+        // Leave it closed.
+    }
+}
+
+
+
+// Convert the repeat counts to the compact representation
+// described in CompactRepeatCounts.hpp.
+void Reads::compactRepeatCounts(const string& dataName, uint64_t largeDataPageSize)
+{
+    SHASTA_ASSERT(readRepeatCounts.isOpen());
+    SHASTA_ASSERT(not compactReadRepeatCounts.isOpen());
+
+    compactReadRepeatCounts.createNew(dataName, largeDataPageSize);
+    for(ReadId readId=0; readId<readRepeatCounts.size(); readId++) {
+        const span<uint8_t> counts = readRepeatCounts[readId];
+        compactReadRepeatCounts.append(counts.begin(), counts.end());
+    }
+    compactReadRepeatCounts.unreserve();
+    SHASTA_ASSERT(compactReadRepeatCounts.totalSize() == readRepeatCounts.totalSize());
+
+    readRepeatCounts.remove();
+}
+
+
+
+// Bulk decode all the repeat counts of a read.
+void Reads::getReadRepeatCounts(ReadId readId, vector<uint8_t>& counts) const
+{
+    getReadRepeatCounts(readId, 0, uint32_t(reads[readId].baseCount), counts);
+}
+
+
+
+// Bulk decode the repeat counts of a read at positions [begin, end).
+void Reads::getReadRepeatCounts(
+    ReadId readId,
+    uint32_t begin,
+    uint32_t end,
+    vector<uint8_t>& counts) const
+{
+    SHASTA_ASSERT(begin <= end);
+    counts.resize(end - begin);
+    if(compactReadRepeatCounts.isOpen()) {
+        compactReadRepeatCounts.get(readId, begin, end, counts.data());
+    } else {
+        const span<const uint8_t> readCounts = readRepeatCounts[readId];
+        SHASTA_ASSERT(end <= readCounts.size());
+        copy(readCounts.begin() + begin, readCounts.begin() + end, counts.begin());
+    }
 }
 
 
@@ -69,9 +184,8 @@ pair<Base, uint8_t> Reads::getOrientedReadBaseAndRepeatCount(
     const ReadId readId = orientedReadId.getReadId();
     const Strand strand = orientedReadId.getStrand();
 
-    // Access the bases and repeat counts for this read.
+    // Access the bases for this read.
     const auto& read = reads[readId];
-    const auto& counts = readRepeatCounts[readId];
 
     // Compute the position as stored, depending on strand.
     uint32_t orientedPosition = position;
@@ -80,7 +194,7 @@ pair<Base, uint8_t> Reads::getOrientedReadBaseAndRepeatCount(
     }
 
     // Extract the base and repeat count at this position.
-    pair<Base, uint8_t> p = make_pair(read[orientedPosition], counts[orientedPosition]);
+    pair<Base, uint8_t> p = make_pair(read[orientedPosition], getReadRepeatCount(readId, orientedPosition));
 
     // Complement the base, if necessary.
     if(strand == 1) {
@@ -97,15 +211,19 @@ vector<Base> Reads::getOrientedReadRawSequence(OrientedReadId orientedReadId) co
     vector<Base> sequence;
 
     // The number of bases stored, in run-length representation.
-    const uint32_t storedBaseCount = uint32_t(reads[orientedReadId.getReadId()].baseCount);
+    const ReadId readId = orientedReadId.getReadId();
+    const uint32_t storedBaseCount = uint32_t(reads[readId].baseCount);
 
+    // Decode all the repeat counts at once.
+    vector<uint8_t> counts;
+    getReadRepeatCounts(readId, counts);
 
     // We are storing a run-length representation of the read.
     // Expand it base by base to create the raw representation.
     for(uint32_t position=0; position<storedBaseCount; position++) {
-        Base base;
-        uint8_t count;
-        tie(base, count) = getOrientedReadBaseAndRepeatCount(orientedReadId, position);
+        const Base base = getOrientedReadBase(orientedReadId, position);
+        const uint8_t count = (orientedReadId.getStrand() == 0) ?
+            counts[position] : counts[storedBaseCount - 1 - position];
         for(uint32_t i=0; i<uint32_t(count); i++) {
             sequence.push_back(base);
         }
@@ -124,6 +242,9 @@ size_t Reads::getReadRawSequenceLength(ReadId readId) const
     // the repeat counts.
     // Don't use std::accumulate to compute the sum,
     // otherwise the sum is computed using uint8_t!
+    if(compactReadRepeatCounts.isOpen()) {
+        return compactReadRepeatCounts.sum(readId);
+    }
     const auto& counts = readRepeatCounts[readId];
     size_t sum = 0;;
     for(uint8_t count: counts) {
@@ -134,6 +255,112 @@ size_t Reads::getReadRawSequenceLength(ReadId readId) const
 
 
 
+// Keep only the reads for which keep[readId] is true,
+// without changing their order. Kept reads are renumbered.
+// This is done in place, without allocating additional memory.
+void Reads::keepReads(const vector<bool>& keep)
+{
+    checkReadsAreOpen();
+    checkReadNamesAreOpen();
+    checkReadMetaDataAreOpen();
+    checkReadFlagsAreOpenForWriting();
+    checkRepeatCountsAreNotCompact();
+    SHASTA_ASSERT(keep.size() == readCount());
+
+    ReadId newReadCount = 0;
+    for(ReadId readId=0; readId<keep.size(); readId++) {
+        if(keep[readId]) {
+            readFlags[newReadCount++] = readFlags[readId];
+        }
+    }
+    readFlags.resize(newReadCount);
+
+    reads.keepSequences(keep);
+    readRepeatCounts.keepVectors(keep);
+    readNames.keepVectors(keep);
+    readMetaData.keepVectors(keep);
+    checkSanity();
+    assertReadsAndFlagsOfSameSize();
+
+    if(parsedReadMetaData.isOpen) {
+        SHASTA_ASSERT(parsedReadMetaData.isOpenWithWriteAccess);
+        newReadCount = 0;
+        for(ReadId readId=0; readId<keep.size(); readId++) {
+            if(keep[readId]) {
+                parsedReadMetaData[newReadCount++] = parsedReadMetaData[readId];
+            }
+        }
+        parsedReadMetaData.resize(newReadCount);
+    }
+
+    // ReadIds changed, so the read name index must be recreated.
+    if(readNameIndex.isOpen) {
+        fillReadNameIndex();
+    }
+}
+
+
+
+// Keep the longest reads, up to a total of targetBaseCount raw bases.
+// We keep all reads at least as long as the shortest read needed
+// to reach targetBaseCount, so the total can be slightly
+// larger than requested. For a given total number of bases,
+// keeping the longest reads also maximizes the read N50.
+// The length cutoff is found from a histogram of read lengths,
+// so this requires a single pass over the repeat counts.
+uint64_t Reads::keepLongestReads(
+    uint64_t targetBaseCount,
+    uint64_t& discardedReadCount,
+    uint64_t& discardedBaseCount)
+{
+    checkReadsAreOpen();
+    discardedReadCount = 0;
+    discardedBaseCount = 0;
+
+    // Compute the raw length of each read and a histogram of lengths.
+    const ReadId totalReadCount = readCount();
+    vector<uint64_t> rawLengths(totalReadCount);
+    vector<uint64_t> lengthHistogram;
+    for(ReadId readId=0; readId<totalReadCount; readId++) {
+        const uint64_t length = getReadRawSequenceLength(readId);
+        rawLengths[readId] = length;
+        if(lengthHistogram.size() <= length) {
+            lengthHistogram.resize(length+1, 0);
+        }
+        ++lengthHistogram[length];
+    }
+
+    // Find the length cutoff, starting from the longest reads.
+    uint64_t lengthCutoff = 0;
+    uint64_t cumulativeBaseCount = 0;
+    for(uint64_t length=lengthHistogram.size(); length>0; ) {
+        --length;
+        cumulativeBaseCount += lengthHistogram[length] * length;
+        if(cumulativeBaseCount >= targetBaseCount) {
+            lengthCutoff = length;
+            break;
+        }
+    }
+
+    // Keep the reads at or above the cutoff.
+    vector<bool> keep(totalReadCount);
+    for(ReadId readId=0; readId<totalReadCount; readId++) {
+        const uint64_t length = rawLengths[readId];
+        keep[readId] = (length >= lengthCutoff);
+        if(not keep[readId]) {
+            ++discardedReadCount;
+            discardedBaseCount += length;
+        }
+    }
+    if(discardedReadCount > 0) {
+        keepReads(keep);
+    }
+
+    return lengthCutoff;
+}
+
+
+
 // Get a vector of the raw read positions
 // corresponding to each position in the run-length
 // representation of an oriented read.
@@ -141,7 +368,8 @@ vector<uint32_t> Reads::getRawPositions(OrientedReadId orientedReadId) const
 {
     const ReadId readId = orientedReadId.getReadId();
     const ReadId strand = orientedReadId.getStrand();
-    const auto repeatCounts = readRepeatCounts[readId];
+    vector<uint8_t> repeatCounts;
+    getReadRepeatCounts(readId, repeatCounts);
     const size_t n = repeatCounts.size();
 
     vector<uint32_t> v;
@@ -162,6 +390,156 @@ vector<uint32_t> Reads::getRawPositions(OrientedReadId orientedReadId) const
 }
 
 
+
+uint64_t Reads::hashReadName(const span<const char>& name)
+{
+    return MurmurHash64A(name.begin(), int(name.size()), 759);
+}
+
+
+
+// Create the read name index, or recreate it if it already exists.
+void Reads::computeReadNameIndex(const string& dataName, uint64_t largeDataPageSize)
+{
+    checkReadNamesAreOpen();
+    if(readNameIndex.isOpen) {
+        readNameIndex.remove();
+    }
+    readNameIndex.createNew(dataName, largeDataPageSize);
+    fillReadNameIndex();
+}
+
+
+
+// Fill the read name index, which must already be open
+// with write access. Reads are entered in order of increasing ReadId,
+// so the first match found during a lookup has the lowest ReadId.
+void Reads::fillReadNameIndex()
+{
+    SHASTA_ASSERT(readNameIndex.isOpenWithWriteAccess);
+
+    uint64_t slotCount = 16;
+    while(slotCount < 2 * uint64_t(readNames.size())) {
+        slotCount *= 2;
+    }
+    const uint64_t mask = slotCount - 1;
+    readNameIndex.resize(slotCount);
+    fill(readNameIndex.begin(), readNameIndex.end(), emptyReadNameIndexSlot);
+
+    for(ReadId readId=0; readId<readNames.size(); readId++) {
+        const span<char> readName = readNames[readId];
+        const uint64_t hash = hashReadName(span<const char>(readName.begin(), readName.end()));
+        const uint64_t slotValue = (hash & 0xffffffff00000000ULL) | uint64_t(readId);
+        for(uint64_t slot=hash&mask; ; slot=(slot+1)&mask) {
+            if(readNameIndex[slot] == emptyReadNameIndexSlot) {
+                readNameIndex[slot] = slotValue;
+                break;
+            }
+        }
+    }
+}
+
+
+
+// Return the ReadId of the read with a given name, or invalidReadId
+// if no read with that name exists.
+ReadId Reads::getReadId(const span<const char>& name) const
+{
+    if(not readNameIndex.isOpen) {
+        throw runtime_error("The read name index is not available.");
+    }
+    const uint64_t mask = readNameIndex.size() - 1;
+    const uint64_t hash = hashReadName(name);
+    const uint64_t hashBits = hash & 0xffffffff00000000ULL;
+
+    for(uint64_t slot=hash&mask; ; slot=(slot+1)&mask) {
+        const uint64_t slotValue = readNameIndex[slot];
+        if(slotValue == emptyReadNameIndexSlot) {
+            return invalidReadId;
+        }
+        if((slotValue & 0xffffffff00000000ULL) == hashBits) {
+            const ReadId readId = ReadId(slotValue & 0xffffffffULL);
+            const span<const char> readName = readNames[readId];
+            if(readName.size() == name.size() and
+                std::equal(readName.begin(), readName.end(), name.begin())) {
+                return readId;
+            }
+        }
+    }
+}
+
+
+
+ReadId Reads::getReadId(const string& name) const
+{
+    return getReadId(span<const char>(name.data(), name.data() + name.size()));
+}
+
+
+// Parse the meta data fields used by Assembler::suppressAlignment
+// for all reads and store them in typed form.
+// Fields that are missing or cannot be parsed are stored as invalid.
+void Reads::parseReadMetaData(const string& dataName, uint64_t largeDataPageSize)
+{
+    checkReadMetaDataAreOpen();
+    if(parsedReadMetaData.isOpen) {
+        parsedReadMetaData.remove();
+    }
+    parsedReadMetaData.createNew(dataName, largeDataPageSize);
+    parsedReadMetaData.resize(readMetaData.size());
+
+    // Convert a field to an integer. Returns false if the field
+    // is missing, contains non-digits, or overflows.
+    class Parser {
+    public:
+        static bool parse(const span<const char>& s, uint64_t maxValue, uint64_t& n)
+        {
+            if(s.empty()) {
+                return false;
+            }
+            n = 0;
+            for(const char c: s) {
+                if(c < '0' or c > '9') {
+                    return false;
+                }
+                const uint64_t digit = uint64_t(c - '0');
+                if(n > (maxValue - digit) / 10) {
+                    return false;
+                }
+                n = 10 * n + digit;
+            }
+            return true;
+        }
+    };
+
+    // Map used to assign a sampleRunId to each (sampleid, runid) pair.
+    std::map< pair<string, string>, uint32_t> sampleRunIdMap;
+
+    for(ReadId readId=0; readId<readMetaData.size(); readId++) {
+        ParsedReadMetaData& parsed = parsedReadMetaData[readId];
+        parsed = ParsedReadMetaData();
+
+        uint64_t n;
+        if(Parser::parse(getMetaData(readId, "ch"), ParsedReadMetaData::invalidChannel - 1, n)) {
+            parsed.channel = uint16_t(n);
+        }
+        if(Parser::parse(getMetaData(readId, "read"), ParsedReadMetaData::invalidReadNumber - 1, n)) {
+            parsed.readNumber = n;
+        }
+
+        const span<const char> sampleid = getMetaData(readId, "sampleid");
+        const span<const char> runid = getMetaData(readId, "runid");
+        if(not (sampleid.empty() or runid.empty())) {
+            const auto p = sampleRunIdMap.insert(make_pair(
+                make_pair(convertToString(sampleid), convertToString(runid)),
+                uint32_t(sampleRunIdMap.size())));
+            parsed.sampleRunId = p.first->second;
+        }
+    }
+}
+
+
+
 // Return a meta data field for a read, or an empty string
 // if that field is missing. This treats the meta data
 // as a space separated sequence of Key=Value,
@@ -2,11 +2,13 @@
 #define SHASTA_READS
 
 // shasta
+#include "CompactRepeatCounts.hpp"
 #include "LongBaseSequence.hpp"
 #include "MemoryMappedObject.hpp"
 #include "ReadId.hpp"
 #include "Base.hpp"
 #include "span.hpp"
+#include "ParsedReadMetaData.hpp"
 #include "ReadFlags.hpp"
 #include "SHASTA_ASSERT.hpp"
 
@@ -70,10 +72,16 @@ requirement from 2 to 10 bits per base. So overall the
 run-length representation requires more memory for the reads
 than the raw representation.
 
-Run-length representations that are more economic in memory are possible,
-at the price of additional code complexity and performance cost
+Optionally, after all reads are loaded, the repeat counts
+can be converted to a compact representation
+(see CompactRepeatCounts.hpp) that uses a little over 2 bits per base.
+This brings the memory requirement down to a little over 4 bits per base,
+at the price of a small performance cost
 in assembly phases that use the base repeat counts.
->
+Code outside this class should access repeat counts only via
+getReadRepeatCount and getReadRepeatCounts, which work
+with both representations.
+
 ***************************************************************************/
 
 class shasta::Reads {
@@ -91,12 +99,28 @@ public:
         uint64_t largeDataPageSize
     );
 
+    // Remove all the data structures that are open.
+    // This is used for Reads objects used as temporaries.
+    void remove();
+
+    // Add a read with the given name and run-length sequence,
+    // with empty meta data and default flags.
+    // This constructs reads directly, without a ReadLoader,
+    // and is only used for testing and benchmarking.
+    void addRead(
+        const string& name,
+        const vector<Base>& runLengthSequence,
+        const vector<uint8_t>& repeatCounts);
+
     void access(
         const string& readsDataName,
         const string& readNamesDataName,
         const string& readMetaDataDataName,
         const string& readRepeatCountsDataName,
-        const string& readFlagsDataName
+        const string& compactReadRepeatCountsDataName,
+        const string& readFlagsDataName,
+        const string& readNameIndexDataName,
+        const string& parsedReadMetaDataDataName
     );
 
     inline ReadId readCount() const {
@@ -107,14 +131,38 @@ public:
         return reads[readId];
     }
 
-    inline span<const uint8_t> getReadRepeatCounts(ReadId readId) const {
-        return readRepeatCounts[readId];
+    // Return the repeat count at a given position of a read.
+    // This is O(1) for both representations of repeat counts.
+    inline uint8_t getReadRepeatCount(ReadId readId, uint32_t position) const {
+        if(compactReadRepeatCounts.isOpen()) {
+            return compactReadRepeatCounts.get(readId, position);
+        } else {
+            return readRepeatCounts[readId][position];
+        }
     }
 
+    // Bulk decode all the repeat counts of a read,
+    // or the ones at positions [begin, end).
+    void getReadRepeatCounts(ReadId, vector<uint8_t>&) const;
+    void getReadRepeatCounts(ReadId, uint32_t begin, uint32_t end, vector<uint8_t>&) const;
+
     inline span<const char> getReadName(ReadId readId) const {
         return readNames[readId];
     }
 
+    // Return the ReadId of the read with a given name, or invalidReadId
+    // if no read with that name exists. If more than one read
+    // has that name, the one with the lowest ReadId is returned.
+    // This uses the read name index and is O(1).
+    ReadId getReadId(const span<const char>& name) const;
+    ReadId getReadId(const string& name) const;
+
+    // Create the read name index, or recreate it if it already exists.
+    void computeReadNameIndex(const string& dataName, uint64_t largeDataPageSize);
+    bool readNameIndexIsOpen() const {
+        return readNameIndex.isOpen;
+    }
+
     inline span<const char> getReadMetaData(ReadId readId) const {
         return readMetaData[readId];
     }
@@ -147,6 +195,20 @@ public:
     // representation of an oriented read.
     vector<uint32_t> getRawPositions(OrientedReadId) const;
 
+    // Parse the meta data fields used by Assembler::suppressAlignment
+    // for all reads and store them in typed form.
+    // See ParsedReadMetaData.hpp.
+    void parseReadMetaData(const string& dataName, uint64_t largeDataPageSize);
+    bool readMetaDataIsParsed() const {
+        return parsedReadMetaData.isOpen;
+    }
+    inline const ParsedReadMetaData& getParsedReadMetaData(ReadId readId) const {
+        return parsedReadMetaData[readId];
+    }
+    inline const ParsedReadMetaData* getParsedReadMetaData() const {
+        return parsedReadMetaData.begin();
+    }
+
     // Return a meta data field for a read, or an empty string
     // if that field is missing. This treats the meta data
     // as a space separated sequence of Key=Value,
@@ -196,7 +258,16 @@ public:
 
     inline void checkReadsAreOpen() const {
         SHASTA_ASSERT(reads.isOpen());
-        SHASTA_ASSERT(readRepeatCounts.isOpen());
+        SHASTA_ASSERT(readRepeatCounts.isOpen() or compactReadRepeatCounts.isOpen());
+    }
+
+    // Reads can only be added or removed while repeat counts
+    // are stored using one byte per base.
+    inline void checkRepeatCountsAreNotCompact() const {
+        if(compactReadRepeatCounts.isOpen()) {
+            throw runtime_error("Reads cannot be added or removed "
+                "after repeat counts are converted to compact representation.");
+        }
     }
 
     inline void checkReadNamesAreOpen() const {
@@ -230,6 +301,20 @@ public:
     }
 
     void computeAndWriteReadLengthHistogram(const string& fileName);
+
+    // Keep only the reads for which keep[readId] is true,
+    // without changing their order. Kept reads are renumbered.
+    // This must be done before any other data structures
+    // that refer to ReadIds are created.
+    void keepReads(const vector<bool>& keep);
+
+    // Keep the longest reads, up to a total of targetBaseCount raw bases.
+    // Returns the raw length cutoff used, and stores the number of reads
+    // and raw bases discarded in the last two arguments.
+    uint64_t keepLongestReads(
+        uint64_t targetBaseCount,
+        uint64_t& discardedReadCount,
+        uint64_t& discardedBaseCount);
     
     inline uint64_t getTotalBaseCount() const {
         return totalBaseCount;
@@ -239,12 +324,27 @@ public:
     }
 
     inline uint64_t getRepeatCountsTotalSize() const {
-        return readRepeatCounts.totalSize();
+        if(compactReadRepeatCounts.isOpen()) {
+            return compactReadRepeatCounts.totalSize();
+        } else {
+            return readRepeatCounts.totalSize();
+        }
+    }
+
+    // Convert the repeat counts to the compact representation
+    // described in CompactRepeatCounts.hpp.
+    // The one byte per base representation is removed.
+    void compactRepeatCounts(const string& dataName, uint64_t largeDataPageSize);
+    bool repeatCountsAreCompact() const {
+        return compactReadRepeatCounts.isOpen();
     }
 
 private:
     LongBaseSequences reads;
+
+    // The repeat counts. Only one of these is open at any given time.
     MemoryMapped::VectorOfVectors<uint8_t, uint64_t> readRepeatCounts;
+    CompactRepeatCounts compactReadRepeatCounts;
 
     // The names of the reads from the input fasta or fastq files.
     // Indexed by ReadId.
@@ -254,6 +354,19 @@ private:
     // back to its origin.
     MemoryMapped::VectorOfVectors<char, uint64_t> readNames;
 
+    // Hash index of the read names, used to find a read given its name.
+    // This is an open addressing hash table with linear probing.
+    // The number of slots is a power of 2, at least twice the number of reads.
+    // Each occupied slot stores the ReadId in the low 32 bits
+    // and the high 32 bits of the hash of the read name in the high 32 bits.
+    // The hash bits make it unnecessary to compare names
+    // for almost all slots that don't match.
+    // Empty slots contain emptyReadNameIndexSlot.
+    MemoryMapped::Vector<uint64_t> readNameIndex;
+    static const uint64_t emptyReadNameIndexSlot = std::numeric_limits<uint64_t>::max();
+    static uint64_t hashReadName(const span<const char>&);
+    void fillReadNameIndex();
+
     // Read meta data. This is the information following the read name
     // in the header line for fasta and fastq files.
     // Indexed by ReadId.
@@ -261,6 +374,10 @@ private:
 
     MemoryMapped::Vector<ReadFlags> readFlags;
 
+    // The meta data fields used by Assembler::suppressAlignment,
+    // in typed form. Indexed by ReadId.
+    MemoryMapped::Vector<ParsedReadMetaData> parsedReadMetaData;
+
     
     // Read statistics.
     vector<uint64_t> histogram;
@@ -269,6 +386,7 @@ private:
     uint64_t n50;    
 
     friend class ReadLoader;
+    friend class MultiFileReadLoader;
 };
 
 #endif
@@ -0,0 +1,106 @@
+// Shasta.
+#include "SparseKmerTable.hpp"
+#include "MurmurHash2.hpp"
+#include "SHASTA_ASSERT.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "algorithm.hpp"
+
+
+
+void SparseKmerTable::createNew(const string& name, size_t pageSize)
+{
+    if(name.empty()) {
+        keys.createNew("", pageSize);
+        values.createNew("", pageSize);
+    } else {
+        keys.createNew(name + "-Keys", pageSize);
+        values.createNew(name + "-Values", pageSize);
+    }
+    kmerCount = 0;
+}
+
+
+
+void SparseKmerTable::accessExistingReadOnly(const string& name)
+{
+    keys.accessExistingReadOnly(name + "-Keys");
+    values.accessExistingReadOnly(name + "-Values");
+    SHASTA_ASSERT(keys.size() == values.size());
+
+    kmerCount = 0;
+    for(const KmerId key: keys) {
+        if(key != emptyKey) {
+            ++kmerCount;
+        }
+    }
+}
+
+
+
+void SparseKmerTable::remove()
+{
+    keys.remove();
+    values.remove();
+    kmerCount = 0;
+}
+
+
+
+// Store the given k-mers, which must all be markers
+// and must include the reverse complement of each k-mer.
+// The fields of each KmerInfo are filled in
+// the same way as for the dense k-mer table
+// (see Assembler::initializeKmerTable).
+void SparseKmerTable::store(size_t k, const vector<KmerId>& markerKmerIds)
+{
+    SHASTA_ASSERT(k <= maxK);
+
+    uint64_t slotCount = 16;
+    while(slotCount < 2 * uint64_t(markerKmerIds.size())) {
+        slotCount *= 2;
+    }
+    const uint64_t mask = slotCount - 1;
+    keys.resize(slotCount);
+    values.resize(slotCount);
+    fill(keys.begin(), keys.end(), emptyKey);
+    kmerCount = 0;
+
+    for(const KmerId kmerId: markerKmerIds) {
+
+        // Find the slot for this k-mer.
+        uint64_t slot = hash(kmerId) & mask;
+        for(; ; slot=(slot+1)&mask) {
+            if(keys[slot] == emptyKey or keys[slot] == kmerId) {
+                break;
+            }
+        }
+        if(keys[slot] == kmerId) {
+            continue;   // Duplicate.
+        }
+        keys[slot] = kmerId;
+        ++kmerCount;
+
+        // Fill in the KmerInfo.
+        const Kmer kmer(kmerId, k);
+        KmerInfo& info = values[slot];
+        info.frequency = 0;
+        info.reverseComplementedKmerId = KmerId(kmer.reverseComplement(k).id(k));
+        info.isMarker = true;
+        info.isRleKmer = true;
+        for(size_t i=1; i<k; i++) {
+            if(kmer[i-1] == kmer[i]) {
+                info.isRleKmer = false;
+                break;
+            }
+        }
+        const uint64_t n = uint64_t(kmerId) + uint64_t(info.reverseComplementedKmerId);
+        info.hash = MurmurHash2(&n, sizeof(n), 13477);
+    }
+
+    // Check that reverse complements are present.
+    forEach([this](KmerId, const KmerInfo& info) {
+        SHASTA_ASSERT(isMarker(info.reverseComplementedKmerId));
+    });
+}
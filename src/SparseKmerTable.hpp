@@ -0,0 +1,120 @@
+#ifndef SHASTA_SPARSE_KMER_TABLE_HPP
+#define SHASTA_SPARSE_KMER_TABLE_HPP
+
+/*******************************************************************************
+
+A k-mer table that only stores the k-mers selected as markers.
+
+The ordinary k-mer table (Assembler::kmerTable) is a vector
+of 4^k KmerInfo objects indexed by KmerId. This becomes impractical
+for k greater than 14 or so, and impossible for the k-mer lengths
+that require a 64-bit KmerId (see Kmer.hpp).
+
+This class stores instead a KmerInfo only for the k-mers
+selected as markers (which always include their reverse complements),
+in an open addressing hash table with linear probing,
+keyed by KmerId. The number of slots is a power of 2
+at least twice the number of k-mers stored.
+Keys and values are stored separately, so probing
+only touches the keys.
+
+*******************************************************************************/
+
+// Shasta.
+#include "Kmer.hpp"
+#include "MemoryMappedVector.hpp"
+
+// Standard library.
+#include "string.hpp"
+#include "vector.hpp"
+#include <limits>
+
+namespace shasta {
+    class SparseKmerTable;
+}
+
+
+
+class shasta::SparseKmerTable {
+public:
+
+    void createNew(const string& name, size_t pageSize);
+    void accessExistingReadOnly(const string& name);
+    void remove();
+
+    bool isOpen() const
+    {
+        return keys.isOpen;
+    }
+
+    // Store the given k-mers, which must all be markers
+    // and must include the reverse complement of each k-mer.
+    // Any k-mers previously stored are discarded.
+    void store(size_t k, const vector<KmerId>& markerKmerIds);
+
+    // Return the KmerInfo for a k-mer, or 0 if the
+    // k-mer is not stored (that is, it is not a marker).
+    const KmerInfo* find(KmerId kmerId) const
+    {
+        const uint64_t mask = keys.size() - 1;
+        for(uint64_t slot=hash(kmerId)&mask; ; slot=(slot+1)&mask) {
+            const KmerId key = keys[slot];
+            if(key == kmerId) {
+                return values.begin() + slot;
+            }
+            if(key == emptyKey) {
+                return 0;
+            }
+        }
+    }
+
+    bool isMarker(KmerId kmerId) const
+    {
+        return find(kmerId) != 0;
+    }
+
+    // The number of k-mers stored.
+    uint64_t size() const
+    {
+        return kmerCount;
+    }
+
+    // Loop over all stored k-mers, in no particular order.
+    template<class F> void forEach(const F& f) const
+    {
+        for(uint64_t slot=0; slot<keys.size(); slot++) {
+            if(keys[slot] != emptyKey) {
+                f(keys[slot], values[slot]);
+            }
+        }
+    }
+
+    // The maximum k-mer length that can be used.
+    // The KmerId of the k-mer consisting of all T's
+    // is used to flag empty slots, so we
+    // cannot use the full capacity of a Kmer.
+    static const size_t maxK = Kmer::capacity - 1;
+
+private:
+
+    MemoryMapped::Vector<KmerId> keys;
+    MemoryMapped::Vector<KmerInfo> values;
+    uint64_t kmerCount = 0;
+
+    static const KmerId emptyKey = std::numeric_limits<KmerId>::max();
+
+    // Mix the bits of a KmerId, because the low bits
+    // of a KmerId only depend on the last few bases of the k-mer.
+    static uint64_t hash(KmerId kmerId)
+    {
+        uint64_t x = uint64_t(kmerId);
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+};
+
+#endif
@@ -0,0 +1,438 @@
+// Shasta.
+#include "StrobemerChaining.hpp"
+#include "AlignmentCandidates.hpp"
+#include "timestamp.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "algorithm.hpp"
+#include "chrono.hpp"
+
+
+
+// The splitmix64 finalizer, used to hash KmerIds and seeds.
+static uint64_t mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+
+
+StrobemerChaining::StrobemerChaining(
+    size_t minOffset,               // Minimum ordinal offset of the second marker of a seed.
+    size_t maxOffset,               // Maximum ordinal offset of the second marker of a seed.
+    double seedFraction,            // Fraction of the seeds that are used.
+    size_t maxSeedFrequency,        // Seeds more frequent than this in the index are ignored.
+    size_t chainBandWidth,          // Maximum diagonal difference between consecutive hits of a chain.
+    size_t minFrequency,            // Minimum number of hits in a chain for a pair to be a candidate.
+    size_t threadCountArgument,
+    const Reads& reads,
+    const Markers& markers,
+    AlignmentCandidates& candidates,
+    const string& largeDataFileNamePrefix,
+    size_t largeDataPageSize
+    ) :
+    MultithreadedObject(*this),
+    minOffset(minOffset),
+    maxOffset(maxOffset),
+    maxSeedFrequency(maxSeedFrequency),
+    chainBandWidth(chainBandWidth),
+    minFrequency(minFrequency),
+    threadCount(threadCountArgument),
+    reads(reads),
+    markers(markers),
+    candidates(candidates),
+    largeDataFileNamePrefix(largeDataFileNamePrefix),
+    largeDataPageSize(largeDataPageSize)
+{
+    cout << timestamp << "StrobemerChaining begins." << endl;
+    const auto tBegin = steady_clock::now();
+
+    // Adjust the numbers of threads, if necessary.
+    if(threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    // Check the arguments.
+    if(minOffset == 0 or maxOffset < minOffset) {
+        throw runtime_error("StrobemerChaining: invalid strobemer offsets " +
+            to_string(minOffset) + " " + to_string(maxOffset) +
+            ". The minimum offset must be at least 1 and "
+            "the maximum offset cannot be less than the minimum offset.");
+    }
+    if(seedFraction <= 0. or seedFraction > 1.) {
+        throw runtime_error("StrobemerChaining: invalid seed fraction " +
+            to_string(seedFraction) + ". Must be greater than 0 and not greater than 1.");
+    }
+
+    // Compute the threshold for a seed hash to be used.
+    if(seedFraction == 1.) {
+        seedHashThreshold = std::numeric_limits<uint64_t>::max();
+    } else {
+        seedHashThreshold = uint64_t(seedFraction * double(std::numeric_limits<uint64_t>::max()));
+    }
+
+    // The number of oriented reads, each with its own vector of markers.
+    const OrientedReadId::Int orientedReadCount = OrientedReadId::Int(markers.size());
+    const ReadId readCount = orientedReadCount / 2;
+    SHASTA_ASSERT(orientedReadCount == 2*readCount);
+
+    // Create the index of the seeds on strand 0 of all reads.
+    createIndex();
+
+    // Find the candidates of each readId0.
+    threadCandidateTable.resize(readCount);
+    threadAlignmentCandidates.resize(threadCount);
+    threadChainHistogram.clear();
+    threadChainHistogram.resize(threadCount);
+    cout << timestamp << "Looking up seeds and chaining." << endl;
+    setupLoadBalancing(readCount, 100);
+    runThreads(&StrobemerChaining::findCandidatesThreadFunction, threadCount);
+    index.remove();
+
+
+
+    // Gather the candidates and the features in order of increasing readId0.
+    for(ReadId readId0=0; readId0<readCount; readId0++) {
+        const auto& info = threadCandidateTable[readId0];
+        const uint64_t threadId = info[0];
+        const uint64_t begin = info[1];
+        const uint64_t end = info[2];
+        for(uint64_t i=begin; i!=end; ++i) {
+            const OrientedReadPair& orientedReadPair =
+                threadAlignmentCandidates[threadId]->candidates[i];
+            SHASTA_ASSERT(orientedReadPair.readIds[0] == readId0);
+            candidates.candidates.push_back(orientedReadPair);
+            const auto features = threadAlignmentCandidates[threadId]->featureOrdinals[i];
+            candidates.featureOrdinals.appendVector(features.begin(), features.end());
+        }
+    }
+    SHASTA_ASSERT(candidates.candidates.size() == candidates.featureOrdinals.size());
+    cout << timestamp << "Found " << candidates.candidates.size() <<
+        " alignment candidates with a total " <<
+        candidates.featureOrdinals.totalSize() <<
+        " features." << endl;
+    cout << "Average number of alignment candidates per oriented read is ";
+    cout << (2.* double(candidates.candidates.size())) / double(orientedReadCount)  << "." << endl;
+
+
+
+    // Combine the chain histograms found by each thread and write them out.
+    vector<uint64_t> chainHistogram;
+    for(const vector<uint64_t>& histogram: threadChainHistogram) {
+        if(chainHistogram.size() < histogram.size()) {
+            chainHistogram.resize(histogram.size(), 0);
+        }
+        for(uint64_t i=0; i<histogram.size(); i++) {
+            chainHistogram[i] += histogram[i];
+        }
+    }
+    ofstream csv("StrobemerChainHistogram.csv");
+    csv << "ChainHitCount,Frequency\n";
+    for(uint64_t i=0; i<chainHistogram.size(); i++) {
+        const uint64_t n = chainHistogram[i];
+        if(n > 0) {
+            csv << i << "," << n << "\n";
+        }
+    }
+
+
+
+    // Clean up.
+    threadCandidateTable.clear();
+    for(size_t threadId=0; threadId<threadCount; threadId++) {
+        threadAlignmentCandidates[threadId]->candidates.remove();
+        threadAlignmentCandidates[threadId]->featureOrdinals.remove();
+    }
+    threadAlignmentCandidates.clear();
+
+    // Done.
+    const auto tEnd = steady_clock::now();
+    const double tTotal = seconds(tEnd - tBegin);
+    cout << timestamp << "StrobemerChaining completed in " << tTotal << " s." << endl;
+}
+
+
+
+// Compute the seeds of an oriented read.
+// The seed at ordinal i uses the marker at ordinal i
+// and the marker at ordinal j in [i+minOffset, i+maxOffset]
+// that minimizes the xor of the hashes of the two KmerIds.
+// Near the end of the read, the window is truncated.
+void StrobemerChaining::computeSeeds(
+    OrientedReadId orientedReadId,
+    vector<KmerId>& kmerIdsWorkArea,
+    vector<uint64_t>& kmerHashes,
+    vector<Seed>& seeds) const
+{
+    seeds.clear();
+    const uint64_t markerCount = markers.size(orientedReadId.getValue());
+    if(markerCount <= minOffset) {
+        return;
+    }
+
+    // Hash the KmerIds.
+    const KmerId* kmerIds = markers[orientedReadId.getValue()].getKmerIds(kmerIdsWorkArea);
+    kmerHashes.resize(markerCount);
+    for(uint64_t i=0; i<markerCount; i++) {
+        kmerHashes[i] = mix(uint64_t(kmerIds[i]) + 0x9e3779b97f4a7c15ULL);
+    }
+
+    // Loop over possible positions of the first marker of a seed.
+    for(uint64_t i=0; i+minOffset<markerCount; i++) {
+        const uint64_t hash0 = kmerHashes[i];
+
+        // Choose the second marker.
+        const uint64_t end = min(i + maxOffset + 1, markerCount);
+        uint64_t bestValue = std::numeric_limits<uint64_t>::max();
+        uint64_t hash1 = 0;
+        for(uint64_t j=i+minOffset; j<end; j++) {
+            const uint64_t value = hash0 ^ kmerHashes[j];
+            if(value < bestValue) {
+                bestValue = value;
+                hash1 = kmerHashes[j];
+            }
+        }
+
+        // Sample the seed. The hash stored is rehashed,
+        // so its bits are not affected by the sampling.
+        const uint64_t seedHash = mix(hash0 ^ ((hash1 << 17) | (hash1 >> 47)));
+        if(seedHash < seedHashThreshold) {
+            seeds.push_back(Seed(mix(seedHash), uint32_t(i)));
+        }
+    }
+}
+
+
+
+// Create the index of the seeds on strand 0 of all reads.
+void StrobemerChaining::createIndex()
+{
+    cout << timestamp << "Creating the seed index." << endl;
+    const ReadId readCount = ReadId(markers.size() / 2);
+
+    // Choose the number of index buckets so there is
+    // about one seed per bucket.
+    const uint64_t seedCountEstimate = uint64_t(
+        double(seedHashThreshold) / double(std::numeric_limits<uint64_t>::max()) *
+        double(markers.totalSize() / 2));
+    indexBits = max(uint64_t(1), min(uint64_t(32), uint64_t(64 - __builtin_clzl(seedCountEstimate | 1))));
+
+    index.createNew(
+        largeDataFileNamePrefix.empty() ? "" : (largeDataFileNamePrefix + "tmp-StrobemerChaining-Index"),
+        largeDataPageSize);
+    index.beginPass1(1ULL << indexBits);
+    setupLoadBalancing(readCount, 1000);
+    runThreads(&StrobemerChaining::countIndexThreadFunction, threadCount);
+    index.beginPass2();
+    setupLoadBalancing(readCount, 1000);
+    runThreads(&StrobemerChaining::fillIndexThreadFunction, threadCount);
+    index.endPass2(false, false);
+    setupLoadBalancing(index.size(), 10000);
+    runThreads(&StrobemerChaining::sortIndexThreadFunction, threadCount);
+
+    cout << "The seed index has " << index.totalSize() << " seeds in 2^" << indexBits <<
+        " = " << index.size() << " buckets." << endl;
+}
+
+
+
+void StrobemerChaining::countIndexThreadFunction(size_t threadId)
+{
+    vector<KmerId> kmerIdsWorkArea;
+    vector<uint64_t> kmerHashes;
+    vector<Seed> seeds;
+
+    // Loop over batches assigned to this thread.
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over reads assigned to this batch.
+        for(ReadId readId=ReadId(begin); readId!=ReadId(end); readId++) {
+            if(reads.getFlags(readId).isPalindromic) {
+                continue;
+            }
+            computeSeeds(OrientedReadId(readId, 0), kmerIdsWorkArea, kmerHashes, seeds);
+            for(const Seed& seed: seeds) {
+                index.incrementCountMultithreaded(indexBucketId(seed.hash));
+            }
+        }
+    }
+}
+
+
+
+void StrobemerChaining::fillIndexThreadFunction(size_t threadId)
+{
+    vector<KmerId> kmerIdsWorkArea;
+    vector<uint64_t> kmerHashes;
+    vector<Seed> seeds;
+
+    // Loop over batches assigned to this thread.
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over reads assigned to this batch.
+        for(ReadId readId=ReadId(begin); readId!=ReadId(end); readId++) {
+            if(reads.getFlags(readId).isPalindromic) {
+                continue;
+            }
+            computeSeeds(OrientedReadId(readId, 0), kmerIdsWorkArea, kmerHashes, seeds);
+            for(const Seed& seed: seeds) {
+                index.storeMultithreaded(indexBucketId(seed.hash),
+                    IndexEntry(seed.hash, readId, seed.ordinal));
+            }
+        }
+    }
+}
+
+
+
+void StrobemerChaining::sortIndexThreadFunction(size_t threadId)
+{
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+        for(uint64_t bucketId=begin; bucketId!=end; bucketId++) {
+            const span<IndexEntry> bucket = index[bucketId];
+            sort(bucket.begin(), bucket.end());
+        }
+    }
+}
+
+
+
+void StrobemerChaining::findCandidatesThreadFunction(size_t threadId)
+{
+    // Access the AlignmentCandidates where this thread will store
+    // the alignment candidates it finds.
+    threadAlignmentCandidates[threadId] = make_shared<AlignmentCandidates>();
+    AlignmentCandidates& alignmentCandidates = *threadAlignmentCandidates[threadId];
+    alignmentCandidates.candidates.createNew(
+        largeDataFileNamePrefix.empty() ? "" :
+        (largeDataFileNamePrefix + "tmp-StrobemerChaining-Candidates-" + to_string(threadId)),
+        largeDataPageSize);
+    alignmentCandidates.featureOrdinals.createNew(
+        largeDataFileNamePrefix.empty() ? "" :
+        (largeDataFileNamePrefix + "tmp-StrobemerChaining-FeatureOrdinals-" + to_string(threadId)),
+        largeDataPageSize);
+    vector<uint64_t>& histogram = threadChainHistogram[threadId];
+
+    // Work areas.
+    vector<KmerId> kmerIdsWorkArea;
+    vector<uint64_t> kmerHashes;
+    vector<Seed> seeds;
+    vector<Hit> hits;
+    vector< array<uint32_t, 2> > features;
+
+    // Compare index entries by hash bits only.
+    class CompareHashBits {
+    public:
+        bool operator()(const IndexEntry& entry, uint32_t hashBits) const
+        {
+            return entry.hashBits < hashBits;
+        }
+        bool operator()(uint32_t hashBits, const IndexEntry& entry) const
+        {
+            return hashBits < entry.hashBits;
+        }
+    };
+
+    // Loop over all batches assigned to this thread.
+    uint64_t begin, end;
+    while(getNextBatch(begin, end)) {
+
+        // Loop over ReadId's in this batch.
+        for(ReadId readId0=ReadId(begin); readId0!=ReadId(end); readId0++) {
+            threadCandidateTable[readId0][0] = uint64_t(threadId);
+            threadCandidateTable[readId0][1] = alignmentCandidates.candidates.size();
+            threadCandidateTable[readId0][2] = alignmentCandidates.candidates.size();
+            if(reads.getFlags(readId0).isPalindromic) {
+                continue;
+            }
+
+            // Look up the seeds of both oriented reads of readId0 in the index.
+            // Only keep the hits on reads with readId1 > readId0.
+            hits.clear();
+            for(Strand strand0=0; strand0<2; strand0++) {
+                computeSeeds(OrientedReadId(readId0, strand0), kmerIdsWorkArea, kmerHashes, seeds);
+                for(const Seed& seed: seeds) {
+                    const span<IndexEntry> bucket = index[indexBucketId(seed.hash)];
+                    const auto range = std::equal_range(bucket.begin(), bucket.end(),
+                        indexEntryHashBits(seed.hash), CompareHashBits());
+                    if(uint64_t(range.second - range.first) > maxSeedFrequency) {
+                        continue;
+                    }
+                    for(auto it=range.first; it!=range.second; ++it) {
+                        if(it->readId > readId0) {
+                            hits.push_back(Hit(it->readId, strand0, seed.ordinal, it->ordinal));
+                        }
+                    }
+                }
+            }
+            sort(hits.begin(), hits.end());
+
+            // Loop over streaks of hits with the same readId1 and strand0.
+            // Within each streak, hits are sorted by diagonal.
+            for(auto streakBegin=hits.begin(); streakBegin!=hits.end(); ) {
+                const ReadId readId1 = streakBegin->readId1;
+                const uint32_t strand0 = streakBegin->strand0;
+                auto streakEnd = streakBegin;
+                while(streakEnd!=hits.end() and
+                    streakEnd->readId1==readId1 and streakEnd->strand0==strand0) {
+                    ++streakEnd;
+                }
+
+                // Find the largest chain. A chain is a run of hits in which
+                // consecutive diagonals differ by at most chainBandWidth.
+                auto bestChainBegin = streakBegin;
+                auto bestChainEnd = streakBegin;
+                for(auto chainBegin=streakBegin; chainBegin!=streakEnd; ) {
+                    auto chainEnd = chainBegin + 1;
+                    while(chainEnd!=streakEnd and
+                        chainEnd->diagonal - (chainEnd-1)->diagonal <= int64_t(chainBandWidth)) {
+                        ++chainEnd;
+                    }
+                    if(chainEnd - chainBegin > bestChainEnd - bestChainBegin) {
+                        bestChainBegin = chainBegin;
+                        bestChainEnd = chainEnd;
+                    }
+                    chainBegin = chainEnd;
+                }
+
+                // Update the histogram.
+                const uint64_t chainHitCount = uint64_t(bestChainEnd - bestChainBegin);
+                if(histogram.size() <= chainHitCount) {
+                    histogram.resize(chainHitCount + 1, 0);
+                }
+                ++histogram[chainHitCount];
+
+                // If the chain has enough hits, generate an alignment candidate
+                // and store the ordinals of its hits.
+                // If readId0 is on strand 1, we have to reverse the ordinals.
+                if(chainHitCount >= minFrequency) {
+                    const uint32_t markerCount0 = uint32_t(markers.size(OrientedReadId(readId0, 0).getValue()));
+                    const uint32_t markerCount1 = uint32_t(markers.size(OrientedReadId(readId1, 0).getValue()));
+                    features.clear();
+                    for(auto it=bestChainBegin; it!=bestChainEnd; ++it) {
+                        if(strand0 == 0) {
+                            features.push_back({it->ordinal0, it->ordinal1});
+                        } else {
+                            features.push_back({markerCount0-1-it->ordinal0, markerCount1-1-it->ordinal1});
+                        }
+                    }
+                    sort(features.begin(), features.end());
+                    alignmentCandidates.candidates.push_back(OrientedReadPair(readId0, readId1, strand0==0));
+                    alignmentCandidates.featureOrdinals.appendVector(features);
+                }
+
+                streakBegin = streakEnd;
+            }
+            threadCandidateTable[readId0][2] = alignmentCandidates.candidates.size();
+        }
+    }
+}
@@ -0,0 +1,193 @@
+#ifndef SHASTA_STROBEMER_CHAINING_HPP
+#define SHASTA_STROBEMER_CHAINING_HPP
+
+/*******************************************************************************
+
+Class StrobemerChaining finds alignment candidates using
+marker strobemers and diagonal-band chaining.
+It is used with --MinHash.version 2.
+
+Seeds are order 2 randstrobes over the markers of an oriented read.
+The seed at ordinal i combines the marker at ordinal i with
+a second marker chosen, among the markers at ordinals
+i+minOffset to i+maxOffset, as the one that minimizes
+a hash of the two KmerIds. Because the second marker is chosen
+from a window, a seed survives marker errors between its two
+markers. Only a fraction seedFraction of the seeds is used,
+chosen using a hash of the seed.
+
+The seeds on strand 0 of all reads are stored in a compact index,
+sorted by hash. The index is a VectorOfVectors indexed by
+the most significant bits of the seed hash, and each entry stores
+the 32 least significant bits of the hash, the ReadId, and the ordinal.
+Seeds that occur more than maxSeedFrequency times
+in the index are ignored, as they are likely to come from repeats.
+
+To find the candidates of readId0, the seeds of both oriented reads of
+readId0 are looked up in the index, keeping only hits
+on reads with readId1 > readId0. The hits for each readId1 and relative
+orientation are sorted by diagonal (ordinal1 - ordinal0)
+and grouped into chains: consecutive hits in diagonal order
+belong to the same chain if their diagonals differ by at most
+chainBandWidth. This allows for the drift caused by marker errors.
+A pair generates an alignment candidate if its largest chain
+contains at least minFrequency distinct hits.
+
+Like LowHash1, this stores alignmentCandidates.featureOrdinals:
+the ordinals of the first marker of each seed in the largest chain,
+interpreted with readId0 on strand 0.
+
+*******************************************************************************/
+
+// Shasta.
+#include "Markers.hpp"
+#include "MemoryMappedVectorOfVectors.hpp"
+#include "MultithreadedObject.hpp"
+#include "OrientedReadPair.hpp"
+#include "Reads.hpp"
+
+// Standard library.
+#include "memory.hpp"
+
+namespace shasta {
+    class AlignmentCandidates;
+    class StrobemerChaining;
+
+    // Benchmark StrobemerChaining against LowHash1 on simulated reads.
+    void benchmarkStrobemerChaining(
+        uint64_t readCount,
+        uint64_t readMarkerCount,
+        double errorRate,
+        size_t threadCount);
+}
+
+
+
+class shasta::StrobemerChaining :
+    public MultithreadedObject<StrobemerChaining> {
+public:
+
+    // The constructor does all the work.
+    StrobemerChaining(
+        size_t minOffset,               // Minimum ordinal offset of the second marker of a seed.
+        size_t maxOffset,               // Maximum ordinal offset of the second marker of a seed.
+        double seedFraction,            // Fraction of the seeds that are used.
+        size_t maxSeedFrequency,        // Seeds more frequent than this in the index are ignored.
+        size_t chainBandWidth,          // Maximum diagonal difference between consecutive hits of a chain.
+        size_t minFrequency,            // Minimum number of hits in a chain for a pair to be a candidate.
+        size_t threadCount,
+        const Reads& reads,
+        const Markers&,
+        AlignmentCandidates& candidates,
+        const string& largeDataFileNamePrefix,
+        size_t largeDataPageSize
+    );
+
+private:
+
+    // Store some of the arguments passed to the constructor.
+    size_t minOffset;
+    size_t maxOffset;
+    size_t maxSeedFrequency;
+    size_t chainBandWidth;
+    size_t minFrequency;
+    size_t threadCount;
+    const Reads& reads;
+    const Markers& markers;
+    AlignmentCandidates& candidates;
+    const string& largeDataFileNamePrefix;
+    size_t largeDataPageSize;
+
+    // The threshold for a seed hash to be used.
+    uint64_t seedHashThreshold;
+
+
+
+    // A seed of an oriented read.
+    class Seed {
+    public:
+        uint64_t hash;
+        uint32_t ordinal;
+        Seed(uint64_t hash, uint32_t ordinal) : hash(hash), ordinal(ordinal) {}
+        Seed() {}
+    };
+
+    // Compute the seeds of an oriented read.
+    void computeSeeds(
+        OrientedReadId,
+        vector<KmerId>& kmerIdsWorkArea,
+        vector<uint64_t>& kmerHashesWorkArea,
+        vector<Seed>& seeds) const;
+
+
+
+    // The index of the seeds on strand 0 of all reads.
+    // Indexed by the indexBits most significant bits of the seed hash.
+    // Each entry stores the 32 least significant bits of the seed hash.
+    // Each vector is sorted by hashBits, then readId, then ordinal.
+    class IndexEntry {
+    public:
+        uint32_t hashBits;
+        ReadId readId;
+        uint32_t ordinal;
+        IndexEntry(uint64_t hash, ReadId readId, uint32_t ordinal) :
+            hashBits(indexEntryHashBits(hash)), readId(readId), ordinal(ordinal) {}
+        IndexEntry() {}
+        bool operator<(const IndexEntry& that) const
+        {
+            return tie(hashBits, readId, ordinal) < tie(that.hashBits, that.readId, that.ordinal);
+        }
+    };
+    static_assert(sizeof(IndexEntry) == 12, "Unexpected size of StrobemerChaining::IndexEntry.");
+    MemoryMapped::VectorOfVectors<IndexEntry, uint64_t> index;
+    uint64_t indexBits;
+    uint64_t indexBucketId(uint64_t hash) const
+    {
+        return hash >> (64 - indexBits);
+    }
+    static uint32_t indexEntryHashBits(uint64_t hash)
+    {
+        return uint32_t(hash);
+    }
+    void createIndex();
+    void countIndexThreadFunction(size_t threadId);
+    void fillIndexThreadFunction(size_t threadId);
+    void sortIndexThreadFunction(size_t threadId);
+    vector<uint64_t> threadSeedCount;
+
+
+
+    // A hit of a seed of readId0 in the index.
+    class Hit {
+    public:
+        ReadId readId1;
+        uint32_t strand0;   // Strand of readId0. The hit is on strand 0 of readId1.
+        int64_t diagonal;
+        uint32_t ordinal0;
+        uint32_t ordinal1;
+        Hit(ReadId readId1, uint32_t strand0, uint32_t ordinal0, uint32_t ordinal1) :
+            readId1(readId1), strand0(strand0),
+            diagonal(int64_t(ordinal1) - int64_t(ordinal0)),
+            ordinal0(ordinal0), ordinal1(ordinal1) {}
+        bool operator<(const Hit& that) const
+        {
+            return
+                tie(readId1, strand0, diagonal, ordinal0) <
+                tie(that.readId1, that.strand0, that.diagonal, that.ordinal0);
+        }
+    };
+
+    // Find the candidates of each readId0.
+    // Each thread stores the alignment candidates it finds in its own
+    // AlignmentCandidates, and threadCandidateTable tells
+    // where the candidates of each readId0 are.
+    void findCandidatesThreadFunction(size_t threadId);
+    vector< shared_ptr<AlignmentCandidates> > threadAlignmentCandidates;
+    vector< array<uint64_t, 3> > threadCandidateTable;
+
+    // Histogram of the number of hits in the largest chain
+    // of each pair with at least one hit.
+    vector< vector<uint64_t> > threadChainHistogram;
+};
+
+#endif
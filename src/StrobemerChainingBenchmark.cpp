@@ -0,0 +1,232 @@
+// Benchmark for the alignment candidates found by StrobemerChaining
+// (--MinHash.version 2), compared with LowHash1 (--MinHash.version 1).
+// It simulates markers for reads sampled from a random genome,
+// with marker errors (deletions, substitutions, and insertions),
+// then runs both methods on the same reads and reports
+// for each the time, the number of candidates found,
+// recall (the fraction of the true overlaps that are found),
+// and precision (the fraction of the candidates that are true overlaps).
+
+// Shasta.
+#include "AlignmentCandidates.hpp"
+#include "LowHash1.hpp"
+#include "Markers.hpp"
+#include "Reads.hpp"
+#include "SHASTA_ASSERT.hpp"
+#include "StrobemerChaining.hpp"
+#include "timestamp.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "algorithm.hpp"
+#include "chrono.hpp"
+#include "iostream.hpp"
+#include <map>
+#include <random>
+#include <thread>
+
+
+
+// The true overlap of a pair of simulated reads, with readId0 < readId1.
+namespace shasta {
+    class StrobemerChainingBenchmarkOverlap {
+    public:
+        uint64_t length;    // In markers of the genome.
+        bool isSameStrand;
+    };
+}
+
+static void evaluateCandidates(
+    const string& methodName,
+    double time,
+    const AlignmentCandidates&,
+    const std::map< pair<ReadId, ReadId>, StrobemerChainingBenchmarkOverlap>& trueOverlaps,
+    uint64_t minOverlapLength);
+
+
+
+void shasta::benchmarkStrobemerChaining(
+    uint64_t readCount,
+    uint64_t readMarkerCount,
+    double errorRate,
+    size_t threadCount)
+{
+    const uint64_t k = 10;
+    const uint64_t coverage = 20;
+    SHASTA_ASSERT(readCount > coverage);
+    SHASTA_ASSERT(readMarkerCount > 100);
+    SHASTA_ASSERT(errorRate >= 0. and errorRate < 0.5);
+    if(threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    // Pairs that overlap by at least this number of genome markers
+    // are counted when computing recall.
+    const uint64_t minOverlapLength = readMarkerCount / 10;
+
+    // Generate a random genome of markers.
+    const uint64_t genomeMarkerCount = (readCount * readMarkerCount) / coverage;
+    cout << timestamp << "Simulating " << readCount << " reads of " <<
+        readMarkerCount << " markers from a genome of " <<
+        genomeMarkerCount << " markers with marker error rate " << errorRate << "." << endl;
+    std::mt19937 randomSource(231);
+    std::uniform_int_distribution<uint64_t> kmerIdDistribution(0, (1ULL << (2*k)) - 1ULL);
+    vector<KmerId> genome(genomeMarkerCount);
+    for(KmerId& kmerId: genome) {
+        kmerId = KmerId(kmerIdDistribution(randomSource));
+    }
+
+    // Sample the reads. Errors are equally divided between
+    // deletions, substitutions, and insertions.
+    // Only the markers are used, so the reads are stored without sequence.
+    Reads reads;
+    reads.createNew("", "", "", "", "", 4096);
+    Markers markers;
+    markers.createNew("", 4096);
+    markers.setK(k);
+    std::uniform_int_distribution<uint64_t> startDistribution(0, genomeMarkerCount - readMarkerCount);
+    std::uniform_real_distribution<double> uniformDistribution(0., 1.);
+    vector<uint64_t> readStarts(readCount);
+    vector<bool> readIsOnStrand0(readCount);
+    vector<KmerId> readKmerIds;
+    vector<CompressedMarker> readMarkers;
+    for(ReadId readId=0; readId<readCount; readId++) {
+        const uint64_t start = startDistribution(randomSource);
+        readStarts[readId] = start;
+        readIsOnStrand0[readId] = (uniformDistribution(randomSource) < 0.5);
+
+        readKmerIds.clear();
+        for(uint64_t i=start; i<start+readMarkerCount; i++) {
+            const double r = uniformDistribution(randomSource);
+            if(r < errorRate / 3.) {
+                // Deletion.
+            } else if(r < 2. * errorRate / 3.) {
+                // Substitution.
+                readKmerIds.push_back(KmerId(kmerIdDistribution(randomSource)));
+            } else if(r < errorRate) {
+                // Insertion.
+                readKmerIds.push_back(genome[i]);
+                readKmerIds.push_back(KmerId(kmerIdDistribution(randomSource)));
+            } else {
+                readKmerIds.push_back(genome[i]);
+            }
+        }
+        if(not readIsOnStrand0[readId]) {
+            std::reverse(readKmerIds.begin(), readKmerIds.end());
+            for(KmerId& kmerId: readKmerIds) {
+                kmerId = OrientedReadMarkers::reverseComplement(kmerId, k);
+            }
+        }
+
+        readMarkers.resize(readKmerIds.size());
+        for(uint64_t ordinal=0; ordinal<readKmerIds.size(); ordinal++) {
+            readMarkers[ordinal].kmerId = readKmerIds[ordinal];
+            readMarkers[ordinal].position = uint32_t(10 * ordinal);
+        }
+        markers.appendRead(readMarkers, uint32_t(10 * readKmerIds.size()));
+        reads.addRead(to_string(readId), {}, {});
+    }
+
+    // Find the true overlaps.
+    vector<ReadId> sortedReadIds(readCount);
+    for(ReadId readId=0; readId<readCount; readId++) {
+        sortedReadIds[readId] = readId;
+    }
+    sort(sortedReadIds.begin(), sortedReadIds.end(),
+        [&readStarts](ReadId x, ReadId y) {return readStarts[x] < readStarts[y];});
+    std::map< pair<ReadId, ReadId>, StrobemerChainingBenchmarkOverlap> trueOverlaps;
+    for(uint64_t i=0; i<readCount; i++) {
+        const ReadId readIdA = sortedReadIds[i];
+        for(uint64_t j=i+1; j<readCount; j++) {
+            const ReadId readIdB = sortedReadIds[j];
+            const uint64_t offset = readStarts[readIdB] - readStarts[readIdA];
+            if(offset >= readMarkerCount) {
+                break;
+            }
+            StrobemerChainingBenchmarkOverlap overlap;
+            overlap.length = readMarkerCount - offset;
+            overlap.isSameStrand = (readIsOnStrand0[readIdA] == readIsOnStrand0[readIdB]);
+            trueOverlaps.insert(make_pair(
+                make_pair(min(readIdA, readIdB), max(readIdA, readIdB)), overlap));
+        }
+    }
+    uint64_t trueOverlapCount = 0;
+    for(const auto& p: trueOverlaps) {
+        if(p.second.length >= minOverlapLength) {
+            ++trueOverlapCount;
+        }
+    }
+    cout << "There are " << trueOverlapCount << " true overlaps of at least " <<
+        minOverlapLength << " markers." << endl;
+
+    // LowHash1 with typical options.
+    {
+        AlignmentCandidates candidates;
+        candidates.candidates.createNew("", 4096);
+        candidates.featureOrdinals.createNew("", 4096);
+        const auto t0 = steady_clock::now();
+        LowHash1 lowHash1(
+            4, 0.01, 20, 0, 0, 2 * coverage, 2, 1, 0, false, 0, 0,
+            threadCount, reads, markers, candidates, "", 4096);
+        const double time = seconds(steady_clock::now() - t0);
+        evaluateCandidates("LowHash1", time, candidates, trueOverlaps, minOverlapLength);
+        candidates.candidates.remove();
+        candidates.featureOrdinals.remove();
+    }
+
+    // StrobemerChaining with the default options.
+    {
+        AlignmentCandidates candidates;
+        candidates.candidates.createNew("", 4096);
+        candidates.featureOrdinals.createNew("", 4096);
+        const auto t0 = steady_clock::now();
+        StrobemerChaining strobemerChaining(
+            2, 8, 0.2, 100, 10, 2,
+            threadCount, reads, markers, candidates, "", 4096);
+        const double time = seconds(steady_clock::now() - t0);
+        evaluateCandidates("StrobemerChaining", time, candidates, trueOverlaps, minOverlapLength);
+        candidates.candidates.remove();
+        candidates.featureOrdinals.remove();
+    }
+
+    markers.remove();
+    reads.remove();
+}
+
+
+
+static void evaluateCandidates(
+    const string& methodName,
+    double time,
+    const AlignmentCandidates& candidates,
+    const std::map< pair<ReadId, ReadId>, StrobemerChainingBenchmarkOverlap>& trueOverlaps,
+    uint64_t minOverlapLength)
+{
+    uint64_t trueOverlapCount = 0;
+    for(const auto& p: trueOverlaps) {
+        if(p.second.length >= minOverlapLength) {
+            ++trueOverlapCount;
+        }
+    }
+
+    // A candidate is correct if the reads overlap
+    // and the relative orientation is correct.
+    uint64_t correctCount = 0;
+    uint64_t foundCount = 0;
+    for(const OrientedReadPair& candidate: candidates.candidates) {
+        const auto it = trueOverlaps.find(make_pair(candidate.readIds[0], candidate.readIds[1]));
+        if(it == trueOverlaps.end() or it->second.isSameStrand != candidate.isSameStrand) {
+            continue;
+        }
+        ++correctCount;
+        if(it->second.length >= minOverlapLength) {
+            ++foundCount;
+        }
+    }
+
+    const uint64_t candidateCount = candidates.candidates.size();
+    cout << methodName << ": " << time << " s, " <<
+        candidateCount << " candidates, recall " <<
+        double(foundCount) / double(trueOverlapCount) << ", precision " <<
+        (candidateCount == 0 ? 0. : double(correctCount) / double(candidateCount)) << endl;
+}
@@ -2,6 +2,7 @@
 #define SHASTA_FIND_MARKER_ID_HPP
 
 #include "Marker.hpp"
+#include "Markers.hpp"
 #include "MemoryMappedVectorOfVectors.hpp"
 #include "ReadId.hpp"
 
@@ -13,10 +14,10 @@ namespace shasta {
 
     // Given a global marker id in the global marker table,
     // return the corresponding OrientedReadId and ordinal.
-    // This requires a binary search in the markers toc.
+    // This requires a binary search (see Markers::find).
     inline pair<OrientedReadId, uint32_t> findMarkerId(
         MarkerId,
-        const MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>& markers);
+        const Markers& markers);
 
 }
 
@@ -24,12 +25,10 @@ namespace shasta {
 inline std::pair<shasta::OrientedReadId, uint32_t>
     shasta::findMarkerId(
     MarkerId markerId,
-    const MemoryMapped::VectorOfVectors<CompressedMarker, uint64_t>& markers)
+    const Markers& markers)
 {
-    OrientedReadId::Int orientedReadIdValue;
-    uint32_t ordinal;
-    tie(orientedReadIdValue, ordinal) = markers.find(markerId);
-    return make_pair(OrientedReadId(orientedReadIdValue), ordinal);
+    const pair<uint64_t, uint64_t> p = markers.find(markerId);
+    return make_pair(OrientedReadId(OrientedReadId::Int(p.first)), uint32_t(p.second));
 }
 
 
@@ -0,0 +1,576 @@
+// Shasta.
+#include "readParsingKernels.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "algorithm.hpp"
+#include <cstring>
+#include "stdexcept.hpp"
+
+// Intrinsics.
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+
+
+// The level currently in use.
+namespace shasta {
+    static SimdLevel simdLevel = getBestSimdLevel();
+}
+
+
+
+SimdLevel shasta::getBestSimdLevel()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        return SimdLevel::avx2;
+    }
+    if(__builtin_cpu_supports("sse4.2")) {
+        return SimdLevel::sse42;
+    }
+    return SimdLevel::scalar;
+#elif defined(__ARM_NEON)
+    return SimdLevel::neon;
+#else
+    return SimdLevel::scalar;
+#endif
+}
+
+
+
+SimdLevel shasta::getSimdLevel()
+{
+    return simdLevel;
+}
+
+
+
+void shasta::setSimdLevel(SimdLevel level)
+{
+    const SimdLevel bestLevel = getBestSimdLevel();
+    bool isSupported = false;
+    switch(level) {
+    case SimdLevel::scalar:
+        isSupported = true;
+        break;
+    case SimdLevel::sse42:
+        isSupported = (bestLevel == SimdLevel::sse42 or bestLevel == SimdLevel::avx2);
+        break;
+    case SimdLevel::avx2:
+        isSupported = (bestLevel == SimdLevel::avx2);
+        break;
+    case SimdLevel::neon:
+        isSupported = (bestLevel == SimdLevel::neon);
+        break;
+    }
+    if(not isSupported) {
+        throw runtime_error("Instruction set " + simdLevelName(level) +
+            " is not supported by this processor.");
+    }
+    simdLevel = level;
+}
+
+
+
+string shasta::simdLevelName(SimdLevel level)
+{
+    switch(level) {
+    case SimdLevel::scalar:
+        return "scalar";
+    case SimdLevel::sse42:
+        return "SSE4.2";
+    case SimdLevel::avx2:
+        return "AVX2";
+    case SimdLevel::neon:
+        return "NEON";
+    }
+    return "unknown";
+}
+
+
+
+// Append to lineEnds the offsets of all '\n' characters
+// in text[begin, end).
+void shasta::findLineEnds(
+    const char* text,
+    uint64_t begin,
+    uint64_t end,
+    vector<uint64_t>& lineEnds)
+{
+    switch(simdLevel) {
+    case SimdLevel::avx2:
+        findLineEndsAvx2(text, begin, end, lineEnds);
+        break;
+    case SimdLevel::sse42:
+        findLineEndsSse42(text, begin, end, lineEnds);
+        break;
+    case SimdLevel::neon:
+        findLineEndsNeon(text, begin, end, lineEnds);
+        break;
+    default:
+        findLineEndsScalar(text, begin, end, lineEnds);
+    }
+}
+
+
+
+void shasta::findLineEndsScalar(
+    const char* text,
+    uint64_t begin,
+    uint64_t end,
+    vector<uint64_t>& lineEnds)
+{
+    for(uint64_t offset=begin; offset<end; offset++) {
+        if(text[offset] == '\n') {
+            lineEnds.push_back(offset);
+        }
+    }
+}
+
+
+
+// The vectorized versions compare a block of characters at a time
+// and obtain a bit mask of the positions of the line ends in the block.
+// The last incomplete block is processed by the scalar version.
+#if defined(__x86_64__)
+
+__attribute__((target("avx2")))
+void shasta::findLineEndsAvx2(
+    const char* text,
+    uint64_t begin,
+    uint64_t end,
+    vector<uint64_t>& lineEnds)
+{
+    const __m256i lineEnd = _mm256_set1_epi8('\n');
+    uint64_t offset = begin;
+    for(; offset + 32 <= end; offset += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + offset));
+        uint64_t mask = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, lineEnd)));
+        for(; mask; mask &= mask - 1) {
+            lineEnds.push_back(offset + uint64_t(__builtin_ctzll(mask)));
+        }
+    }
+    findLineEndsScalar(text, offset, end, lineEnds);
+}
+
+
+
+__attribute__((target("sse4.2")))
+void shasta::findLineEndsSse42(
+    const char* text,
+    uint64_t begin,
+    uint64_t end,
+    vector<uint64_t>& lineEnds)
+{
+    const __m128i lineEnd = _mm_set1_epi8('\n');
+    uint64_t offset = begin;
+    for(; offset + 16 <= end; offset += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + offset));
+        uint64_t mask = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, lineEnd)));
+        for(; mask; mask &= mask - 1) {
+            lineEnds.push_back(offset + uint64_t(__builtin_ctzll(mask)));
+        }
+    }
+    findLineEndsScalar(text, offset, end, lineEnds);
+}
+
+#else
+
+void shasta::findLineEndsAvx2(
+    const char* text,
+    uint64_t begin,
+    uint64_t end,
+    vector<uint64_t>& lineEnds)
+{
+    findLineEndsScalar(text, begin, end, lineEnds);
+}
+
+
+
+void shasta::findLineEndsSse42(
+    const char* text,
+    uint64_t begin,
+    uint64_t end,
+    vector<uint64_t>& lineEnds)
+{
+    findLineEndsScalar(text, begin, end, lineEnds);
+}
+
+#endif
+
+
+
+#if defined(__ARM_NEON)
+
+// NEON has no movemask instruction. Narrowing the comparison
+// result gives a mask with 4 bits for each position.
+void shasta::findLineEndsNeon(
+    const char* text,
+    uint64_t begin,
+    uint64_t end,
+    vector<uint64_t>& lineEnds)
+{
+    const uint8x16_t lineEnd = vdupq_n_u8('\n');
+    uint64_t offset = begin;
+    for(; offset + 16 <= end; offset += 16) {
+        const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(text + offset));
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(vceqq_u8(v, lineEnd)), 4)), 0);
+        while(mask) {
+            const uint64_t position = uint64_t(__builtin_ctzll(mask)) >> 2;
+            lineEnds.push_back(offset + position);
+            mask &= ~(0xfULL << (position << 2));
+        }
+    }
+    findLineEndsScalar(text, offset, end, lineEnds);
+}
+
+#else
+
+void shasta::findLineEndsNeon(
+    const char* text,
+    uint64_t begin,
+    uint64_t end,
+    vector<uint64_t>& lineEnds)
+{
+    findLineEndsScalar(text, begin, end, lineEnds);
+}
+
+#endif
+
+
+
+// Return a pointer to the first '\n' character in [begin, end),
+// or end if there is none.
+// The standard library memchr is already vectorized on all
+// the platforms we support, so it is used regardless of the SimdLevel.
+const char* shasta::findNextLineEnd(const char* begin, const char* end)
+{
+    const void* p = std::memchr(begin, '\n', size_t(end - begin));
+    return p ? static_cast<const char*>(p) : end;
+}
+
+
+
+void RunLengthEncoder::begin(
+    vector<Base>& runLengthSequenceArgument,
+    vector<uint8_t>& repeatCountsArgument,
+    bool skipWhiteSpaceArgument)
+{
+    runLengthSequence = &runLengthSequenceArgument;
+    repeatCounts = &repeatCountsArgument;
+    runLengthSequence->clear();
+    repeatCounts->clear();
+    skipWhiteSpace = skipWhiteSpaceArgument;
+    simdLevel = getSimdLevel();
+
+    baseCount = 0;
+    invalidCharacterCount = 0;
+    firstInvalidCharacter = 0;
+    hasRun = false;
+    runLength = 0;
+    hasOverflow = false;
+}
+
+
+
+void RunLengthEncoder::append(const char* begin, const char* end)
+{
+    switch(simdLevel) {
+    case SimdLevel::avx2:
+        appendAvx2(begin, end);
+        break;
+    case SimdLevel::sse42:
+        appendSse42(begin, end);
+        break;
+    case SimdLevel::neon:
+        appendNeon(begin, end);
+        break;
+    default:
+        appendScalar(begin, end);
+    }
+}
+
+
+
+bool RunLengthEncoder::end()
+{
+    finishRun();
+    SHASTA_ASSERT(runLengthSequence->size() == repeatCounts->size());
+    return not hasOverflow;
+}
+
+
+
+void RunLengthEncoder::finishRun()
+{
+    if(hasRun) {
+        if(runLength > 255) {
+            hasOverflow = true;
+        }
+        repeatCounts->push_back(uint8_t(min(runLength, uint64_t(255))));
+        hasRun = false;
+    }
+}
+
+
+
+void RunLengthEncoder::appendCharacter(const char* p)
+{
+    const char c = *p;
+    if(skipWhiteSpace and (c==' ' or c=='\t' or c=='\n' or c=='\r')) {
+        return;
+    }
+
+    const Base base = Base::fromCharacterNoException(c);
+    if(not base.isValid()) {
+        if(invalidCharacterCount == 0) {
+            firstInvalidCharacter = p;
+        }
+        ++invalidCharacterCount;
+        return;
+    }
+
+    ++baseCount;
+    if(hasRun and runLengthSequence->back() == base) {
+        ++runLength;
+    } else {
+        finishRun();
+        runLengthSequence->push_back(base);
+        hasRun = true;
+        runLength = 1;
+    }
+}
+
+
+
+// Process a block of n characters, all valid bases.
+// Bit i (or bits 4i to 4i+3 if bitsPerPosition is 4)
+// of runBeginMask are set if the character at position i is a different
+// base than the character at position i-1.
+template<uint64_t bitsPerPosition> void RunLengthEncoder::appendBlock(
+    const char* p,
+    uint64_t n,
+    uint64_t runBeginMask)
+{
+    baseCount += n;
+
+    // The first position can extend the current run.
+    const Base base0 = Base::fromCharacterNoException(p[0]);
+    if(hasRun and runLengthSequence->back() == base0) {
+        ++runLength;
+    } else {
+        finishRun();
+        runLengthSequence->push_back(base0);
+        hasRun = true;
+        runLength = 1;
+    }
+    const uint64_t positionMask = (1ULL << bitsPerPosition) - 1ULL;
+    runBeginMask &= ~positionMask;
+    if(runBeginMask == 0) {
+        runLength += n - 1;
+        return;
+    }
+
+    // Each remaining bit set in the mask begins a new run.
+    // The first one ends the current run, which can be long.
+    // All others end a run that is entirely in this block, so there
+    // is no need to check for overflow, and we can store them
+    // directly without going through finishRun.
+    uint64_t runBegin = uint64_t(__builtin_ctzll(runBeginMask)) / bitsPerPosition;
+    runBeginMask &= ~(positionMask << (runBegin * bitsPerPosition));
+    runLength += runBegin - 1;
+    finishRun();
+
+    const uint64_t runCount = 1 + uint64_t(__builtin_popcountll(runBeginMask)) / bitsPerPosition;
+    const uint64_t oldSize = repeatCounts->size();
+    runLengthSequence->resize(oldSize + runCount);
+    repeatCounts->resize(oldSize + runCount);
+    Base* base = runLengthSequence->data() + oldSize;
+    uint8_t* repeatCount = repeatCounts->data() + oldSize;
+    while(runBeginMask) {
+        const uint64_t position = uint64_t(__builtin_ctzll(runBeginMask)) / bitsPerPosition;
+        runBeginMask &= ~(positionMask << (position * bitsPerPosition));
+        *base++ = Base::fromCharacterNoException(p[runBegin]);
+        *repeatCount++ = uint8_t(position - runBegin);
+        runBegin = position;
+    }
+
+    // The last run in the block remains open.
+    *base = Base::fromCharacterNoException(p[runBegin]);
+    repeatCounts->pop_back();
+    hasRun = true;
+    runLength = n - runBegin;
+}
+
+
+
+void RunLengthEncoder::appendScalar(const char* begin, const char* end)
+{
+    for(const char* p=begin; p!=end; ++p) {
+        appendCharacter(p);
+    }
+}
+
+
+
+// The vectorized versions process a block of characters at a time.
+// If all characters in the block are valid bases, a bit mask
+// of the run beginnings is computed by comparing the block with the
+// same block shifted by one position, after converting to upper case.
+// Otherwise, the block is processed one character at a time.
+// The first character is always processed by itself, so the block
+// shifted by one position never starts before begin.
+#if defined(__x86_64__)
+
+__attribute__((target("avx2")))
+void RunLengthEncoder::appendAvx2(const char* begin, const char* end)
+{
+    if(begin == end) {
+        return;
+    }
+    appendCharacter(begin);
+    const char* p = begin + 1;
+
+    const __m256i caseMask = _mm256_set1_epi8(char(0xdf));
+    const __m256i A = _mm256_set1_epi8('A');
+    const __m256i C = _mm256_set1_epi8('C');
+    const __m256i G = _mm256_set1_epi8('G');
+    const __m256i T = _mm256_set1_epi8('T');
+    for(; end - p >= 32; p += 32) {
+        const __m256i v = _mm256_and_si256(caseMask,
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        const __m256i isValid = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, A), _mm256_cmpeq_epi8(v, C)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, G), _mm256_cmpeq_epi8(v, T)));
+        if(uint32_t(_mm256_movemask_epi8(isValid)) == 0xffffffffU) {
+            const __m256i previous = _mm256_and_si256(caseMask,
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p - 1)));
+            const uint32_t isSame = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, previous)));
+            appendBlock<1>(p, 32, uint64_t(~isSame));
+        } else {
+            appendScalar(p, p + 32);
+        }
+    }
+    appendScalar(p, end);
+}
+
+
+
+__attribute__((target("sse4.2")))
+void RunLengthEncoder::appendSse42(const char* begin, const char* end)
+{
+    if(begin == end) {
+        return;
+    }
+    appendCharacter(begin);
+    const char* p = begin + 1;
+
+    const __m128i caseMask = _mm_set1_epi8(char(0xdf));
+    const __m128i A = _mm_set1_epi8('A');
+    const __m128i C = _mm_set1_epi8('C');
+    const __m128i G = _mm_set1_epi8('G');
+    const __m128i T = _mm_set1_epi8('T');
+    for(; end - p >= 16; p += 16) {
+        const __m128i v = _mm_and_si128(caseMask,
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        const __m128i isValid = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, A), _mm_cmpeq_epi8(v, C)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, G), _mm_cmpeq_epi8(v, T)));
+        if(uint32_t(_mm_movemask_epi8(isValid)) == 0xffffU) {
+            const __m128i previous = _mm_and_si128(caseMask,
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p - 1)));
+            const uint32_t isSame = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, previous)));
+            appendBlock<1>(p, 16, uint64_t(~isSame & 0xffffU));
+        } else {
+            appendScalar(p, p + 16);
+        }
+    }
+    appendScalar(p, end);
+}
+
+
+
+void RunLengthEncoder::appendNeon(const char* begin, const char* end)
+{
+    appendScalar(begin, end);
+}
+
+#elif defined(__ARM_NEON)
+
+void RunLengthEncoder::appendAvx2(const char* begin, const char* end)
+{
+    appendScalar(begin, end);
+}
+
+
+
+void RunLengthEncoder::appendSse42(const char* begin, const char* end)
+{
+    appendScalar(begin, end);
+}
+
+
+
+// NEON has no movemask instruction. Narrowing the comparison
+// results gives masks with 4 bits for each position.
+void RunLengthEncoder::appendNeon(const char* begin, const char* end)
+{
+    if(begin == end) {
+        return;
+    }
+    appendCharacter(begin);
+    const char* p = begin + 1;
+
+    const uint8x16_t caseMask = vdupq_n_u8(0xdf);
+    const uint8x16_t A = vdupq_n_u8('A');
+    const uint8x16_t C = vdupq_n_u8('C');
+    const uint8x16_t G = vdupq_n_u8('G');
+    const uint8x16_t T = vdupq_n_u8('T');
+    for(; end - p >= 16; p += 16) {
+        const uint8x16_t v = vandq_u8(caseMask, vld1q_u8(reinterpret_cast<const uint8_t*>(p)));
+        const uint8x16_t isValid = vorrq_u8(
+            vorrq_u8(vceqq_u8(v, A), vceqq_u8(v, C)),
+            vorrq_u8(vceqq_u8(v, G), vceqq_u8(v, T)));
+        const uint64_t isValidMask = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(isValid), 4)), 0);
+        if(isValidMask == ~0ULL) {
+            const uint8x16_t previous = vandq_u8(caseMask,
+                vld1q_u8(reinterpret_cast<const uint8_t*>(p - 1)));
+            const uint64_t isSameMask = vget_lane_u64(vreinterpret_u64_u8(
+                vshrn_n_u16(vreinterpretq_u16_u8(vceqq_u8(v, previous)), 4)), 0);
+            appendBlock<4>(p, 16, ~isSameMask);
+        } else {
+            appendScalar(p, p + 16);
+        }
+    }
+    appendScalar(p, end);
+}
+
+#else
+
+void RunLengthEncoder::appendAvx2(const char* begin, const char* end)
+{
+    appendScalar(begin, end);
+}
+
+
+
+void RunLengthEncoder::appendSse42(const char* begin, const char* end)
+{
+    appendScalar(begin, end);
+}
+
+
+
+void RunLengthEncoder::appendNeon(const char* begin, const char* end)
+{
+    appendScalar(begin, end);
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef SHASTA_READ_PARSING_KERNELS_HPP
+#define SHASTA_READ_PARSING_KERNELS_HPP
+
+/*******************************************************************************
+
+Low level functions used by ReadLoader to parse fasta and fastq files:
+- Locating line ends.
+- Validating bases and computing the run-length representation
+  of a read directly from the characters in the input file.
+
+Each of these is implemented using AVX2 and SSE4.2 on x86_64,
+using NEON on aarch64, and in portable scalar code.
+The implementation to be used is selected at run time,
+based on the features supported by the processor,
+so the same executable runs on all x86_64 processors.
+All implementations give identical results.
+
+*******************************************************************************/
+
+// Shasta.
+#include "Base.hpp"
+
+// Standard library.
+#include "cstdint.hpp"
+#include "string.hpp"
+#include "vector.hpp"
+
+namespace shasta {
+
+    // The instruction set used by the functions below.
+    enum class SimdLevel {
+        scalar,
+        sse42,
+        avx2,
+        neon
+    };
+
+    // The best level supported by this processor.
+    SimdLevel getBestSimdLevel();
+
+    // The level currently in use. The default is the best supported.
+    SimdLevel getSimdLevel();
+
+    // Change the level in use. This is normally only used for testing
+    // and benchmarking. Throws if the requested level
+    // is not supported by this processor.
+    void setSimdLevel(SimdLevel);
+
+    string simdLevelName(SimdLevel);
+
+    // Append to lineEnds the offsets of all '\n' characters
+    // in text[begin, end).
+    void findLineEnds(
+        const char* text,
+        uint64_t begin,
+        uint64_t end,
+        vector<uint64_t>& lineEnds);
+
+    // The implementations of findLineEnds for each SimdLevel.
+    // An implementation not available on this platform
+    // falls back to the scalar version.
+    void findLineEndsScalar(const char* text, uint64_t begin, uint64_t end, vector<uint64_t>&);
+    void findLineEndsSse42(const char* text, uint64_t begin, uint64_t end, vector<uint64_t>&);
+    void findLineEndsAvx2(const char* text, uint64_t begin, uint64_t end, vector<uint64_t>&);
+    void findLineEndsNeon(const char* text, uint64_t begin, uint64_t end, vector<uint64_t>&);
+
+    // Return a pointer to the first '\n' character in [begin, end),
+    // or end if there is none.
+    const char* findNextLineEnd(const char* begin, const char* end);
+
+    class RunLengthEncoder;
+
+    // Benchmark the read parsing kernels on a synthetic fastq file.
+    void benchmarkReadParsingKernels(
+        uint64_t readCount,
+        uint64_t readLength,
+        const string& fileName,
+        size_t threadCount);
+}
+
+
+
+// Class used to compute the run-length representation of a read
+// directly from the characters that describe its bases in the input file.
+// The characters can be supplied in multiple calls to append,
+// for example one for each line of a multi-line fasta read.
+// Upper and lower case are treated as the same base.
+class shasta::RunLengthEncoder {
+public:
+
+    // Start a new read, storing its run-length representation in the given vectors.
+    // If skipWhiteSpace is true, spaces, tabs, and line ends (\r, \n)
+    // are skipped. Otherwise they are treated as invalid characters.
+    void begin(
+        vector<Base>& runLengthSequence,
+        vector<uint8_t>& repeatCounts,
+        bool skipWhiteSpace);
+
+    // Process the characters in [begin, end).
+    void append(const char* begin, const char* end);
+
+    // Finish processing the read.
+    // Returns false if any repeat count is 256 or more,
+    // which cannot be represented with a one-byte repeat count.
+    bool end();
+
+    // The number of valid bases found so far in the read.
+    uint64_t baseCount = 0;
+
+    // The number of invalid characters found so far in the read,
+    // and a pointer to the first one.
+    uint64_t invalidCharacterCount = 0;
+    const char* firstInvalidCharacter = 0;
+
+private:
+
+    vector<Base>* runLengthSequence = 0;
+    vector<uint8_t>* repeatCounts = 0;
+    bool skipWhiteSpace = false;
+    SimdLevel simdLevel = SimdLevel::scalar;
+
+    // The current run, not yet stored in repeatCounts.
+    // The base of the current run is already in runLengthSequence.
+    bool hasRun = false;
+    uint64_t runLength = 0;
+    bool hasOverflow = false;
+
+    // Process one character.
+    void appendCharacter(const char*);
+
+    // Process a block of n characters, all valid bases, given
+    // a bit mask of the positions where the character is different
+    // from the previous character (ignoring case).
+    // The bit for position 0 is ignored.
+    // Each position takes bitsPerPosition bits in the mask
+    // (this is 4 for NEON).
+    template<uint64_t bitsPerPosition> void appendBlock(
+        const char*,
+        uint64_t n,
+        uint64_t runBeginMask);
+
+    void finishRun();
+
+    // The implementations of append.
+    void appendScalar(const char* begin, const char* end);
+    void appendSse42(const char* begin, const char* end);
+    void appendAvx2(const char* begin, const char* end);
+    void appendNeon(const char* begin, const char* end);
+};
+
+#endif
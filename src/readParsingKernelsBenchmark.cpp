@@ -0,0 +1,145 @@
+// Benchmark for the read parsing kernels in readParsingKernels.hpp.
+// It generates a synthetic fastq file and times, for each
+// SimdLevel supported by this processor:
+// - Locating line ends.
+// - Validating bases and computing the run-length representation.
+// - Loading the entire file with ReadLoader.
+// The run-length encoding is also timed using the original
+// one character at a time code (Base::fromCharacterNoException
+// followed by computeRunLengthRepresentation), for reference.
+
+// Shasta.
+#include "readParsingKernels.hpp"
+#include "computeRunLengthRepresentation.hpp"
+#include "MurmurHash2.hpp"
+#include "ReadLoader.hpp"
+#include "Reads.hpp"
+#include "SHASTA_ASSERT.hpp"
+#include "timestamp.hpp"
+using namespace shasta;
+
+// Standard library.
+#include "chrono.hpp"
+#include "fstream.hpp"
+#include "iostream.hpp"
+#include <random>
+
+
+
+void shasta::benchmarkReadParsingKernels(
+    uint64_t readCount,
+    uint64_t readLength,
+    const string& fileName,
+    size_t threadCount)
+{
+    // Generate the synthetic fastq file.
+    // Bases are random, which gives a distribution of
+    // homopolymer run lengths similar to real reads.
+    cout << timestamp << "Generating " << readCount << " reads of length " <<
+        readLength << "." << endl;
+    string text;
+    text.reserve(readCount * (2 * readLength + 32));
+    std::mt19937 randomSource(231);
+    std::uniform_int_distribution<uint32_t> baseDistribution(0, 3);
+    vector< pair<uint64_t, uint64_t> > sequenceLines;
+    for(uint64_t i=0; i<readCount; i++) {
+        text += "@read" + to_string(i) + " synthetic\n";
+        const uint64_t sequenceBegin = text.size();
+        for(uint64_t j=0; j<readLength; j++) {
+            text.push_back("ACGT"[baseDistribution(randomSource)]);
+        }
+        sequenceLines.push_back(make_pair(sequenceBegin, text.size()));
+        text += "\n+\n";
+        text.append(readLength, '#');
+        text.push_back('\n');
+    }
+    {
+        ofstream file(fileName);
+        if(not file) {
+            throw runtime_error("Error opening " + fileName);
+        }
+        file << text;
+    }
+    const double megabytes = double(text.size()) / 1.e6;
+    const double sequenceMegabytes = double(readCount * readLength) / 1.e6;
+    cout << "Generated " << megabytes << " MB in " << fileName << endl;
+
+
+
+    // Reference run-length encoding, one character at a time.
+    vector<Base> read;
+    vector<Base> runLengthRead;
+    vector<uint8_t> repeatCounts;
+    uint64_t referenceChecksum = 0;
+    const auto r0 = steady_clock::now();
+    for(const auto& sequenceLine: sequenceLines) {
+        read.clear();
+        for(uint64_t offset=sequenceLine.first; offset!=sequenceLine.second; offset++) {
+            const Base base = Base::fromCharacterNoException(text[offset]);
+            SHASTA_ASSERT(base.isValid());
+            read.push_back(base);
+        }
+        SHASTA_ASSERT(computeRunLengthRepresentation(read, runLengthRead, repeatCounts));
+        referenceChecksum +=
+            MurmurHash64A(&runLengthRead.front(), int(runLengthRead.size() * sizeof(Base)), 0) +
+            MurmurHash64A(&repeatCounts.front(), int(repeatCounts.size()), 0);
+    }
+    const double referenceTime = seconds(steady_clock::now() - r0);
+    cout << "Reference run-length encoding: " << referenceTime << " s, " <<
+        sequenceMegabytes / referenceTime << " MB/s." << endl;
+
+
+
+    // Time the kernels and ReadLoader for each supported level.
+    const SimdLevel oldSimdLevel = getSimdLevel();
+    const vector<SimdLevel> simdLevels =
+        {SimdLevel::scalar, SimdLevel::sse42, SimdLevel::avx2, SimdLevel::neon};
+    for(const SimdLevel simdLevel: simdLevels) {
+        try {
+            setSimdLevel(simdLevel);
+        } catch(const runtime_error&) {
+            continue;
+        }
+        cout << "Instruction set " << simdLevelName(simdLevel) << ":" << endl;
+
+        // Locate line ends, using a single thread.
+        vector<uint64_t> lineEnds;
+        lineEnds.reserve(4 * readCount);
+        const auto t0 = steady_clock::now();
+        findLineEnds(text.data(), 0, text.size(), lineEnds);
+        const double lineEndsTime = seconds(steady_clock::now() - t0);
+        SHASTA_ASSERT(lineEnds.size() == 4 * readCount);
+        cout << "Locate line ends: " << lineEndsTime << " s, " <<
+            megabytes / lineEndsTime << " MB/s." << endl;
+
+        // Run-length encoding, using a single thread.
+        RunLengthEncoder encoder;
+        uint64_t checksum = 0;
+        const auto t1 = steady_clock::now();
+        for(const auto& sequenceLine: sequenceLines) {
+            encoder.begin(runLengthRead, repeatCounts, false);
+            encoder.append(text.data() + sequenceLine.first, text.data() + sequenceLine.second);
+            SHASTA_ASSERT(encoder.end());
+            SHASTA_ASSERT(encoder.invalidCharacterCount == 0);
+            checksum +=
+                MurmurHash64A(&runLengthRead.front(), int(runLengthRead.size() * sizeof(Base)), 0) +
+                MurmurHash64A(&repeatCounts.front(), int(repeatCounts.size()), 0);
+        }
+        const double encoderTime = seconds(steady_clock::now() - t1);
+        SHASTA_ASSERT(checksum == referenceChecksum);
+        cout << "Run-length encoding: " << encoderTime << " s, " <<
+            sequenceMegabytes / encoderTime << " MB/s, speedup " <<
+            referenceTime / encoderTime << " relative to reference." << endl;
+
+        // Load the entire file.
+        Reads reads;
+        reads.createNew("", "", "", "", "", 4096);
+        const auto t2 = steady_clock::now();
+        ReadLoader readLoader(fileName, 0, false, 0, threadCount, "", 4096, reads);
+        const double loadTime = seconds(steady_clock::now() - t2);
+        SHASTA_ASSERT(reads.readCount() == readCount);
+        cout << "ReadLoader with " << threadCount << " threads: " << loadTime << " s, " <<
+            megabytes / loadTime << " MB/s." << endl;
+    }
+    setSimdLevel(oldSimdLevel);
+}
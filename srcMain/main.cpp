@@ -9,6 +9,7 @@
 #include "AssemblerOptions.hpp"
 #include "buildId.hpp"
 #include "filesystem.hpp"
+#include "ReadArchive.hpp"
 #include "timestamp.hpp"
 #include "platformDependent.hpp"
 
@@ -43,6 +44,8 @@ namespace shasta {
         void cleanupBinaryData(const AssemblerOptions&);
         void explore(const AssemblerOptions&);
         void createBashCompletionScript(const AssemblerOptions&);
+        void createReadArchive(const AssemblerOptions&);
+        void regenerateAlignmentCandidates(const AssemblerOptions&);
 
     }
 }
@@ -137,11 +140,18 @@ void shasta::main::main(int argumentCount, const char** arguments)
     } else if(assemblerOptions.commandLineOnlyOptions.command == "createBashCompletionScript") {
         createBashCompletionScript(assemblerOptions);
         return;
+    } else if(assemblerOptions.commandLineOnlyOptions.command == "createReadArchive") {
+        createReadArchive(assemblerOptions);
+        return;
+    } else if(assemblerOptions.commandLineOnlyOptions.command == "regenerateAlignmentCandidates") {
+        regenerateAlignmentCandidates(assemblerOptions);
+        return;
     }
 
     // If getting here, the requested command is invalid.
     throw runtime_error("Invalid command " + assemblerOptions.commandLineOnlyOptions.command +
-        ". Valid commands are: assemble, saveBinaryData, cleanupBinaryData, createBashCompletionScript.");
+        ". Valid commands are: assemble, saveBinaryData, cleanupBinaryData, createBashCompletionScript, "
+        "createReadArchive, regenerateAlignmentCandidates.");
 
 }
 
@@ -178,12 +188,44 @@ void shasta::main::assemble(
             "using command line option \"--input\".");
     }
 
+    // Check assemblerOptions.readsOptions.streamingMemoryBudget.
+    if(assemblerOptions.readsOptions.streamingMemoryBudget < 0) {
+        throw runtime_error("Invalid value " +
+            to_string(assemblerOptions.readsOptions.streamingMemoryBudget) +
+            " specified for --Reads.streamingMemoryBudget. Must be 0 or positive.");
+    }
+
+    // Check assemblerOptions.readsOptions.concurrentFileCount.
+    if(assemblerOptions.readsOptions.concurrentFileCount < 0) {
+        throw runtime_error("Invalid value " +
+            to_string(assemblerOptions.readsOptions.concurrentFileCount) +
+            " specified for --Reads.concurrentFileCount. Must be 0 or positive.");
+    }
+
+    // Check assemblerOptions.readsOptions.desiredCoverage and genomeSize.
+    if(assemblerOptions.readsOptions.desiredCoverage < 0.) {
+        throw runtime_error("Invalid value " +
+            to_string(assemblerOptions.readsOptions.desiredCoverage) +
+            " specified for --Reads.desiredCoverage. Must be 0 or positive.");
+    }
+    if(assemblerOptions.readsOptions.desiredCoverage > 0. and
+        assemblerOptions.readsOptions.genomeSize <= 0.) {
+        throw runtime_error("--Reads.genomeSize must be specified "
+            "when --Reads.desiredCoverage is not zero.");
+    }
+
     // Check assemblerOptions.minHashOptions.version.
     if( assemblerOptions.minHashOptions.version!=0 and
-        assemblerOptions.minHashOptions.version!=1) {
+        assemblerOptions.minHashOptions.version!=1 and
+        assemblerOptions.minHashOptions.version!=2) {
         throw runtime_error("Invalid value " +
             to_string(assemblerOptions.minHashOptions.version) +
-            " specified for --MinHash.version. Must be 0 or 1.");
+            " specified for --MinHash.version. Must be 0, 1, or 2.");
+    }
+    if(assemblerOptions.minHashOptions.version==2 and
+        assemblerOptions.minHashOptions.storeSketches) {
+        throw runtime_error("--MinHash.storeSketches cannot be used "
+            "with --MinHash.version 2.");
     }
 
     // If coverage data was requested, memoryMode should be filesystem,
@@ -474,13 +516,13 @@ void shasta::main::assemble(
     // Add reads from the specified input files.
     cout << timestamp << "Begin loading reads from " << inputFileNames.size() << " files." << endl;
     const auto t0 = steady_clock::now();
-    for(const string& inputFileName: inputFileNames) {
-        assembler.addReads(
-            inputFileName,
-            assemblerOptions.readsOptions.minReadLength,
-            assemblerOptions.readsOptions.noCache,
-            threadCount);
-    }
+    assembler.addReads(
+        inputFileNames,
+        assemblerOptions.readsOptions.minReadLength,
+        assemblerOptions.readsOptions.noCache,
+        uint64_t(assemblerOptions.readsOptions.streamingMemoryBudget) * 1024 * 1024,
+        assemblerOptions.readsOptions.concurrentFileCount,
+        threadCount);
     if(assembler.getReads().readCount() == 0) {
         throw runtime_error("There are no input reads.");
     }
@@ -488,56 +530,121 @@ void shasta::main::assemble(
     cout << timestamp << "Done loading reads from " << inputFileNames.size() << " files." << endl;
     cout << "Read loading took " << seconds(t1-t0) << "s." << endl;
 
+    // If requested, keep only the longest reads needed
+    // to reach the desired coverage.
+    if(assemblerOptions.readsOptions.desiredCoverage > 0.) {
+        assembler.selectReadsForCoverage(
+            assemblerOptions.readsOptions.genomeSize,
+            assemblerOptions.readsOptions.desiredCoverage);
+    }
 
-    // Create a histogram of read lengths.
-    assembler.histogramReadLength("ReadLengthHistogram.csv");
-
+    // If requested, store repeat counts in compact representation.
+    if(assemblerOptions.readsOptions.compactRepeatCounts) {
+        assembler.compactRepeatCounts();
+    }
 
 
-    // Select the k-mers that will be used as markers.
-    switch(assemblerOptions.kmersOptions.generationMethod) {
-    case 0:
-        assembler.randomlySelectKmers(
-            assemblerOptions.kmersOptions.k,
-            assemblerOptions.kmersOptions.probability, 231);
-        break;
+    // Create a histogram of read lengths.
+    assembler.histogramReadLength("ReadLengthHistogram.csv");
 
-    case 1:
-        // Randomly select the k-mers to be used as markers, but
-        // excluding those that are globally overenriched in the input reads,
-        // as measured by total frequency in all reads.
-        assembler.selectKmersBasedOnFrequency(
-            assemblerOptions.kmersOptions.k,
-            assemblerOptions.kmersOptions.probability, 231,
-            assemblerOptions.kmersOptions.enrichmentThreshold, threadCount);
-        break;
 
-    case 2:
-        // Randomly select the k-mers to be used as markers, but
-        // excluding those that are overenriched even in a single oriented read.
-        assembler.selectKmers2(
-            assemblerOptions.kmersOptions.k,
-            assemblerOptions.kmersOptions.probability, 231,
-            assemblerOptions.kmersOptions.enrichmentThreshold, threadCount);
-        break;
 
-    case 3:
-        // Read the k-mers to be used as markers from a file.
+    // If the k-mers are read from a file, check that
+    // the file is specified by an absolute path.
+    if(assemblerOptions.kmersOptions.generationMethod == 3) {
         if(assemblerOptions.kmersOptions.file.empty() or
             assemblerOptions.kmersOptions.file[0] != '/') {
             throw runtime_error("Option --Kmers.file must specify an absolute path. "
                 "A relative path is not accepted.");
         }
-        assembler.readKmersFromFile(
-            assemblerOptions.kmersOptions.k,
-            assemblerOptions.kmersOptions.file);
-        break;
+    }
 
-    default:
-        throw runtime_error("Invalid --Kmers generationMethod. "
-            "Specify a value between 0 and 3, inclusive.");
+    // If requested, reuse k-mers and markers saved by a previous run
+    // with the same reads and Kmers options.
+    const string& kmersCacheDirectory = assemblerOptions.kmersOptions.cacheDirectory;
+    string kmersFingerprint;
+    bool kmersRestored = false;
+    if(not kmersCacheDirectory.empty()) {
+        const auto& kmersOptions = assemblerOptions.kmersOptions;
+        std::ostringstream options;
+        options <<
+            "generationMethod " << kmersOptions.generationMethod <<
+            " k " << kmersOptions.k <<
+            " probability " << kmersOptions.probability <<
+            " enrichmentThreshold " << kmersOptions.enrichmentThreshold <<
+            " minimizerWindow " << kmersOptions.minimizerWindow <<
+            " syncmerS " << kmersOptions.syncmerS <<
+            " compactMarkerPositions " << int(kmersOptions.compactMarkerPositions);
+        if(kmersOptions.generationMethod == 3) {
+            ifstream kmersFile(kmersOptions.file);
+            if(not kmersFile) {
+                throw runtime_error("Error opening " + kmersOptions.file);
+            }
+            options << " file " << kmersFile.rdbuf();
+            if(not options or kmersFile.bad()) {
+                throw runtime_error("Error reading " + kmersOptions.file);
+            }
+        }
+        kmersFingerprint = assembler.computeKmersAndMarkersFingerprint(options.str(), threadCount);
+        kmersRestored = assembler.restoreKmersAndMarkersFromCache(
+            kmersCacheDirectory, kmersFingerprint);
     }
 
+    if(not kmersRestored) {
+        // Select the k-mers that will be used as markers.
+        switch(assemblerOptions.kmersOptions.generationMethod) {
+        case 0:
+            assembler.randomlySelectKmers(
+                assemblerOptions.kmersOptions.k,
+                assemblerOptions.kmersOptions.probability, 231, threadCount);
+            break;
+
+        case 1:
+            // Randomly select the k-mers to be used as markers, but
+            // excluding those that are globally overenriched in the input reads,
+            // as measured by total frequency in all reads.
+            assembler.selectKmersBasedOnFrequency(
+                assemblerOptions.kmersOptions.k,
+                assemblerOptions.kmersOptions.probability, 231,
+                assemblerOptions.kmersOptions.enrichmentThreshold, threadCount);
+            break;
+
+        case 2:
+            // Randomly select the k-mers to be used as markers, but
+            // excluding those that are overenriched even in a single oriented read.
+            assembler.selectKmers2(
+                assemblerOptions.kmersOptions.k,
+                assemblerOptions.kmersOptions.probability, 231,
+                assemblerOptions.kmersOptions.enrichmentThreshold, threadCount);
+            break;
+
+        case 3:
+            // Read the k-mers to be used as markers from a file.
+            // The file name was checked above.
+            assembler.readKmersFromFile(
+                assemblerOptions.kmersOptions.k,
+                assemblerOptions.kmersOptions.file);
+            break;
+
+        case 4:
+            // Use window minimizers as markers.
+            assembler.selectMinimizerKmers(
+                assemblerOptions.kmersOptions.k,
+                assemblerOptions.kmersOptions.minimizerWindow);
+            break;
+
+        case 5:
+            // Use open syncmers as markers.
+            assembler.selectSyncmerKmers(
+                assemblerOptions.kmersOptions.k,
+                assemblerOptions.kmersOptions.syncmerS);
+            break;
+
+        default:
+            throw runtime_error("Invalid --Kmers generationMethod. "
+                "Specify a value between 0 and 5, inclusive.");
+        }
+
 #if 0
     if(not assemblerOptions.kmersOptions.file.empty() or
         assemblerOptions.kmersOptions.file[0] != '/') {
@@ -574,8 +681,25 @@ void shasta::main::assemble(
 #endif
 
 
-    // Find the markers in the reads.
-    assembler.findMarkers(0);
+        // Find the markers in the reads.
+        assembler.findMarkers(0);
+
+        // If requested, store marker positions in compact representation.
+        if(assemblerOptions.kmersOptions.compactMarkerPositions) {
+            assembler.compactMarkerPositions();
+        }
+
+        // If requested, save k-mers and markers for reuse by later runs.
+        if(not kmersCacheDirectory.empty()) {
+            assembler.saveKmersAndMarkersToCache(kmersCacheDirectory, kmersFingerprint);
+        }
+    }
+
+    // If requested, compute and store markers sorted by KmerId.
+    if(assemblerOptions.alignOptions.storeSortedMarkers and
+        assemblerOptions.alignOptions.alignMethod == 0) {
+        assembler.computeSortedMarkers(threadCount);
+    }
 
     if(!assemblerOptions.readsOptions.palindromicReads.skipFlagging) {
         // Flag palindromic reads.
@@ -600,21 +724,41 @@ void shasta::main::assemble(
             assemblerOptions.minHashOptions.hashFraction,
             assemblerOptions.minHashOptions.minHashIterationCount,
             assemblerOptions.minHashOptions.alignmentCandidatesPerRead,
-            0,
+            assemblerOptions.minHashOptions.log2MinHashBucketCount,
             assemblerOptions.minHashOptions.minBucketSize,
             assemblerOptions.minHashOptions.maxBucketSize,
             assemblerOptions.minHashOptions.minFrequency,
+            assemblerOptions.minHashOptions.hashBatchSize,
+            assemblerOptions.minHashOptions.hashFamily,
+            assemblerOptions.minHashOptions.noKmerIdsCopy,
+            assemblerOptions.minHashOptions.sortBuckets,
+            assemblerOptions.minHashOptions.storeSketches,
+            false,
             threadCount);
-    } else {
-        SHASTA_ASSERT(assemblerOptions.minHashOptions.version == 1);    // Already checked for that.
+    } else if(assemblerOptions.minHashOptions.version == 1) {
         assembler.findAlignmentCandidatesLowHash1(
             assemblerOptions.minHashOptions.m,
             assemblerOptions.minHashOptions.hashFraction,
             assemblerOptions.minHashOptions.minHashIterationCount,
-            0,
+            assemblerOptions.minHashOptions.log2MinHashBucketCount,
             assemblerOptions.minHashOptions.minBucketSize,
             assemblerOptions.minHashOptions.maxBucketSize,
             assemblerOptions.minHashOptions.minFrequency,
+            assemblerOptions.minHashOptions.hashBatchSize,
+            assemblerOptions.minHashOptions.hashFamily,
+            assemblerOptions.minHashOptions.noKmerIdsCopy,
+            assemblerOptions.minHashOptions.storeSketches,
+            false,
+            threadCount);
+    } else {
+        SHASTA_ASSERT(assemblerOptions.minHashOptions.version == 2);    // Already checked for that.
+        assembler.findAlignmentCandidatesStrobemerChaining(
+            assemblerOptions.minHashOptions.strobemerMinOffset,
+            assemblerOptions.minHashOptions.strobemerMaxOffset,
+            assemblerOptions.minHashOptions.seedFraction,
+            assemblerOptions.minHashOptions.maxSeedFrequency,
+            assemblerOptions.minHashOptions.chainBandWidth,
+            assemblerOptions.minHashOptions.minFrequency,
             threadCount);
     }
 
@@ -716,6 +860,10 @@ void shasta::main::assemble(
     // that are aligned based on an alignment present in the read graph.
     createMarkerGraphVertices(assembler, assemblerOptions, threadCount);
 
+    // Markers sorted by KmerId, if they were stored,
+    // are not used after this point.
+    assembler.removeSortedMarkers();
+
     // Find the reverse complement of each marker graph vertex.
     assembler.findMarkerGraphReverseComplementVertices(threadCount);
 
@@ -1118,7 +1266,7 @@ void shasta::main::createBashCompletionScript(const AssemblerOptions& assemblerO
     }
 
     // Other keywords. This should be modified to only accept them after the appropriate option.
-    file << "assemble saveBinaryData cleanupBinaryData explore createBashCompletionScript \\\n";
+    file << "assemble saveBinaryData cleanupBinaryData explore createBashCompletionScript createReadArchive regenerateAlignmentCandidates \\\n";
     file << "filesystem anonymous \\\n";
     file << "disk 4K 2M \\\n";
     file << "user local unrestricted \\\n";
@@ -1126,3 +1274,169 @@ void shasta::main::createBashCompletionScript(const AssemblerOptions& assemblerO
     // Finish the "complete" command.
     file << "\" shasta\n";
 }
+
+
+
+// Implementation of --command createReadArchive.
+// This loads reads from the input files, using the options
+// in the [Reads] section, and writes them to a read archive.
+// The read archive can then be used as input to subsequent assemblies
+// in place of the original input files, without the need
+// to parse them again.
+void shasta::main::createReadArchive(const AssemblerOptions& assemblerOptions)
+{
+    SHASTA_ASSERT(assemblerOptions.commandLineOnlyOptions.command == "createReadArchive");
+    const string& readArchiveFileName = assemblerOptions.commandLineOnlyOptions.readArchiveFileName;
+
+    // Check that we have at least one input file.
+    if(assemblerOptions.commandLineOnlyOptions.inputFileNames.empty()) {
+        throw runtime_error("Specify at least one input file "
+            "using command line option \"--input\".");
+    }
+    for(const string& inputFileName: assemblerOptions.commandLineOnlyOptions.inputFileNames) {
+        if(!filesystem::exists(inputFileName)) {
+            throw runtime_error("Input file not found: " + inputFileName);
+        }
+    }
+
+    // Check the name of the read archive.
+    string extension;
+    try {
+        extension = filesystem::extension(readArchiveFileName);
+    } catch (...) {
+    }
+    if(extension != ReadArchive::fileExtension) {
+        throw runtime_error("The read archive name specified using --readArchive must have extension ." +
+            ReadArchive::fileExtension + ".");
+    }
+    if(filesystem::exists(readArchiveFileName)) {
+        throw runtime_error("Read archive " + readArchiveFileName + " already exists.");
+    }
+
+    // Check assemblerOptions.readsOptions.
+    if(assemblerOptions.readsOptions.streamingMemoryBudget < 0) {
+        throw runtime_error("Invalid value " +
+            to_string(assemblerOptions.readsOptions.streamingMemoryBudget) +
+            " specified for --Reads.streamingMemoryBudget. Must be 0 or positive.");
+    }
+    if(assemblerOptions.readsOptions.concurrentFileCount < 0) {
+        throw runtime_error("Invalid value " +
+            to_string(assemblerOptions.readsOptions.concurrentFileCount) +
+            " specified for --Reads.concurrentFileCount. Must be 0 or positive.");
+    }
+
+    // Adjust the number of threads, if necessary.
+    uint32_t threadCount = assemblerOptions.commandLineOnlyOptions.threadCount;
+    if(threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    // Load the reads, using anonymous memory.
+    Assembler assembler("", true, 4096);
+    assembler.addReads(
+        assemblerOptions.commandLineOnlyOptions.inputFileNames,
+        assemblerOptions.readsOptions.minReadLength,
+        assemblerOptions.readsOptions.noCache,
+        uint64_t(assemblerOptions.readsOptions.streamingMemoryBudget) * 1024 * 1024,
+        assemblerOptions.readsOptions.concurrentFileCount,
+        threadCount);
+    if(assembler.getReads().readCount() == 0) {
+        throw runtime_error("There are no input reads.");
+    }
+
+    // Write the read archive.
+    assembler.createReadArchive(readArchiveFileName, threadCount);
+}
+
+
+
+// Implementation of --command regenerateAlignmentCandidates.
+// This uses the LowHash sketches stored by an assembly that used
+// --MinHash.storeSketches to regenerate the alignment candidates
+// with the options in the [MinHash] section, without
+// hashing the markers again. This is useful to quickly
+// explore the effect of the LowHash thresholds.
+// Only the alignment candidates are regenerated.
+void shasta::main::regenerateAlignmentCandidates(
+    const AssemblerOptions& assemblerOptions)
+{
+    SHASTA_ASSERT(assemblerOptions.commandLineOnlyOptions.command == "regenerateAlignmentCandidates");
+
+    // Check assemblerOptions.minHashOptions.version.
+    if( assemblerOptions.minHashOptions.version!=0 and
+        assemblerOptions.minHashOptions.version!=1) {
+        throw runtime_error("Invalid value " +
+            to_string(assemblerOptions.minHashOptions.version) +
+            " specified for --MinHash.version. Must be 0 or 1.");
+    }
+    if(assemblerOptions.minHashOptions.storeSketches) {
+        throw runtime_error("--MinHash.storeSketches cannot be used "
+            "with --command regenerateAlignmentCandidates.");
+    }
+
+    // Go to the assembly directory.
+    filesystem::changeDirectory(assemblerOptions.commandLineOnlyOptions.assemblyDirectory);
+
+    // Check that we have the binary data.
+    if(!filesystem::exists("Data")) {
+        throw runtime_error("Binary directory \"Data\" not available "
+        " in assembly directory " +
+        assemblerOptions.commandLineOnlyOptions.assemblyDirectory + ".");
+    }
+
+    // Adjust the number of threads, if necessary.
+    uint32_t threadCount = assemblerOptions.commandLineOnlyOptions.threadCount;
+    if(threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    // Access the binary data we need.
+    Assembler assembler("Data/", false, 0);
+    assembler.accessKmers();
+    assembler.accessMarkers();
+
+    // Regenerate the alignment candidates.
+    if(assemblerOptions.minHashOptions.version == 0) {
+        assembler.findAlignmentCandidatesLowHash0(
+            assemblerOptions.minHashOptions.m,
+            assemblerOptions.minHashOptions.hashFraction,
+            assemblerOptions.minHashOptions.minHashIterationCount,
+            assemblerOptions.minHashOptions.alignmentCandidatesPerRead,
+            assemblerOptions.minHashOptions.log2MinHashBucketCount,
+            assemblerOptions.minHashOptions.minBucketSize,
+            assemblerOptions.minHashOptions.maxBucketSize,
+            assemblerOptions.minHashOptions.minFrequency,
+            assemblerOptions.minHashOptions.hashBatchSize,
+            assemblerOptions.minHashOptions.hashFamily,
+            assemblerOptions.minHashOptions.noKmerIdsCopy,
+            assemblerOptions.minHashOptions.sortBuckets,
+            false,
+            true,
+            threadCount);
+    } else {
+        assembler.findAlignmentCandidatesLowHash1(
+            assemblerOptions.minHashOptions.m,
+            assemblerOptions.minHashOptions.hashFraction,
+            assemblerOptions.minHashOptions.minHashIterationCount,
+            assemblerOptions.minHashOptions.log2MinHashBucketCount,
+            assemblerOptions.minHashOptions.minBucketSize,
+            assemblerOptions.minHashOptions.maxBucketSize,
+            assemblerOptions.minHashOptions.minFrequency,
+            assemblerOptions.minHashOptions.hashBatchSize,
+            assemblerOptions.minHashOptions.hashFamily,
+            assemblerOptions.minHashOptions.noKmerIdsCopy,
+            false,
+            true,
+            threadCount);
+    }
+
+    // Suppress alignment candidates where reads are close on the same channel.
+    if(assemblerOptions.alignOptions.sameChannelReadAlignmentSuppressDeltaThreshold > 0) {
+        assembler.suppressAlignmentCandidates(
+            assemblerOptions.alignOptions.sameChannelReadAlignmentSuppressDeltaThreshold,
+            threadCount);
+    }
+
+    cout << "Alignment candidates were regenerated. Assembly data structures "
+        "computed from the previous alignment candidates were not updated." << endl;
+}